@@ -0,0 +1,135 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    benchmark.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if defined(BENCHMARK_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+
+static unsigned long benchmarkAllocations = 0;
+static unsigned long long benchmarkAllocatedBytes = 0;
+
+/**
+ * @brief Counts every heap allocation of the benchmark program and its bytes (operator new ends up here as well).
+ * Only available with glibc, which allows malloc to be interposed by the executable.
+ */
+extern "C" void* malloc(size_t size)
+{
+    benchmarkAllocations++;
+    benchmarkAllocatedBytes += size;
+    return __libc_malloc(size);
+}
+
+inline unsigned long BenchmarkAllocations()
+{
+    return benchmarkAllocations;
+}
+
+inline unsigned long long BenchmarkAllocatedBytes()
+{
+    return benchmarkAllocatedBytes;
+}
+#else
+inline unsigned long BenchmarkAllocations()
+{
+    return 0;
+}
+
+inline unsigned long long BenchmarkAllocatedBytes()
+{
+    return 0;
+}
+#endif
+
+/**
+ * @brief Minimal wall clock stopwatch shared by the benchmark programs.
+ */
+class BenchmarkTimer
+{
+    public:
+        BenchmarkTimer()
+        {
+            this->Start();
+        }
+
+        void Start()
+        {
+            gettimeofday(&this->begin, NULL);
+        }
+
+        /**
+         * @return milliseconds elapsed since the last call to Start().
+         */
+        double ElapsedMs() const
+        {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            return (now.tv_sec - this->begin.tv_sec) * 1000.0 + (now.tv_usec - this->begin.tv_usec) / 1000.0;
+        }
+
+    private:
+        struct timeval begin;
+};
+
+/**
+ * @brief Prints one result row: total time, time per iteration and, if bytes is not 0, throughput.
+ */
+inline void BenchmarkReport(const std::string& name, double ms, int iterations, size_t bytes = 0)
+{
+    printf("%-40s %10.2f ms %12.3f us/iter", name.c_str(), ms, ms * 1000.0 / iterations);
+    if (bytes > 0 && ms > 0)
+    {
+        printf(" %10.1f MB/s", (double(bytes) * iterations / (1024.0 * 1024.0)) / (ms / 1000.0));
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Prints the number of heap allocations per iteration, if they can be counted on this platform.
+ */
+inline void BenchmarkReportAllocations(const std::string& name, unsigned long allocations, int iterations)
+{
+    if (allocations > 0)
+    {
+        printf("%-40s %10.1f allocations/iter\n", name.c_str(), double(allocations) / iterations);
+    }
+}
+
+/**
+ * @brief Prints the number of heap bytes allocated per iteration, if they can be counted on this platform.
+ */
+inline void BenchmarkReportAllocatedBytes(const std::string& name, unsigned long long bytes, int iterations)
+{
+    if (BenchmarkAllocations() > 0)
+    {
+        printf("%-40s %10.1f bytes allocated/iter\n", name.c_str(), double(bytes) / iterations);
+    }
+}
+
+/**
+ * @brief Number of iterations, may be overridden by the first command line argument.
+ */
+inline int BenchmarkIterations(int argc, char** argv, int defaultIterations)
+{
+    if (argc > 1)
+    {
+        int iterations = atoi(argv[1]);
+        if (iterations > 0)
+            return iterations;
+    }
+    return defaultIterations;
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,295 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    concurrentclients.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+#define PORT 8388
+#define CLIENT_THREADS 2
+/**
+ * Seconds after which a run is given up, the requests answered until then are reported.
+ */
+#define DEADLINE 30
+
+#define BODY "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value1\":3,\"value2\":4},\"id\":1}"
+
+class AddHandler : public AbstractRequestHandler
+{
+    public:
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            output = input["value1"].asInt() + input["value2"].asInt();
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+};
+
+/**
+ * @brief A keep-alive client connection that sends its requests one after another.
+ */
+struct ClientConnection
+{
+    int fd;
+    bool connected;
+    int remaining;
+    string buffer;
+};
+
+/**
+ * @brief The connections of one client thread, all served by one epoll instance.
+ */
+struct ClientGroup
+{
+    int connections;
+    int rounds;
+    int answered;
+    int failed;
+};
+
+static void Finish(int epoll, ClientConnection* connection)
+{
+    //Resets the connection instead of leaving it in TIME_WAIT, so repeated runs do not run out of ports.
+    struct linger reset = {1, 0};
+    setsockopt(connection->fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    epoll_ctl(epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    connection->fd = -1;
+}
+
+static string request;
+
+static bool SendRequest(ClientConnection* connection)
+{
+    return send(connection->fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t) request.size();
+}
+
+/**
+ * @brief Reads what arrived and sends the next request for every complete response.
+ * @return the number of responses, -1 if the connection failed.
+ */
+static int Receive(ClientConnection* connection)
+{
+    char data[4096];
+    ssize_t received;
+    while ((received = recv(connection->fd, data, sizeof(data), 0)) > 0)
+    {
+        connection->buffer.append(data, received);
+    }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        return -1;
+    }
+    int responses = 0;
+    size_t headerEnd;
+    while ((headerEnd = connection->buffer.find("\r\n\r\n")) != string::npos)
+    {
+        size_t position = connection->buffer.find("Content-Length: ");
+        size_t length = position < headerEnd ? atoi(connection->buffer.c_str() + position + 16) : 0;
+        if (connection->buffer.size() < headerEnd + 4 + length)
+        {
+            break;
+        }
+        if (connection->buffer.compare(0, 12, "HTTP/1.1 200") != 0)
+        {
+            return -1;
+        }
+        connection->buffer.erase(0, headerEnd + 4 + length);
+        responses++;
+        connection->remaining--;
+        if (connection->remaining > 0 && !SendRequest(connection))
+        {
+            return -1;
+        }
+    }
+    return responses;
+}
+
+static void* RunClients(void* data)
+{
+    ClientGroup* group = (ClientGroup*) data;
+    int epoll = epoll_create1(0);
+    vector<ClientConnection> connections(group->connections);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    int open = 0;
+    for (int i = 0; i < group->connections; i++)
+    {
+        ClientConnection& connection = connections[i];
+        connection.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        connection.connected = false;
+        connection.remaining = group->rounds;
+        connect(connection.fd, (struct sockaddr*) &address, sizeof(address));
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        event.data.ptr = &connection;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, connection.fd, &event);
+        open++;
+    }
+
+    struct epoll_event events[256];
+    BenchmarkTimer timer;
+    while (open > 0 && timer.ElapsedMs() < DEADLINE * 1000)
+    {
+        int count = epoll_wait(epoll, events, 256, 100);
+        for (int i = 0; i < count; i++)
+        {
+            ClientConnection* connection = (ClientConnection*) events[i].data.ptr;
+            if (connection->fd < 0)
+            {
+                continue;
+            }
+            int responses = 0;
+            if (!connection->connected)
+            {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(connection->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (!(events[i].events & EPOLLOUT) || error != 0)
+                {
+                    responses = error != 0 ? -1 : 0;
+                }
+                else
+                {
+                    connection->connected = true;
+                    responses = SendRequest(connection) ? 0 : -1;
+                }
+            }
+            else
+            {
+                responses = Receive(connection);
+            }
+            if (responses < 0)
+            {
+                group->failed++;
+                Finish(epoll, connection);
+                open--;
+                continue;
+            }
+            group->answered += responses;
+            if (connection->remaining == 0)
+            {
+                Finish(epoll, connection);
+                open--;
+            }
+        }
+    }
+    for (int i = 0; i < group->connections; i++)
+    {
+        if (connections[i].fd >= 0)
+        {
+            group->failed++;
+            Finish(epoll, &connections[i]);
+        }
+    }
+    close(epoll);
+    return NULL;
+}
+
+/**
+ * @brief Opens all connections at once and keeps each of them alive for rounds requests sent one after another.
+ */
+static void Run(AbstractServerConnector& connector, const string& name, int connections, int rounds)
+{
+    if (!connector.StartListening())
+    {
+        cerr << "could not listen on port " << PORT << endl;
+        return;
+    }
+    pthread_t threads[CLIENT_THREADS];
+    ClientGroup groups[CLIENT_THREADS];
+    BenchmarkTimer timer;
+    for (int i = 0; i < CLIENT_THREADS; i++)
+    {
+        groups[i].connections = connections / CLIENT_THREADS + (i < connections % CLIENT_THREADS ? 1 : 0);
+        groups[i].rounds = rounds;
+        groups[i].answered = 0;
+        groups[i].failed = 0;
+        pthread_create(&threads[i], NULL, RunClients, &groups[i]);
+    }
+    int answered = 0;
+    int failed = 0;
+    for (int i = 0; i < CLIENT_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        answered += groups[i].answered;
+        failed += groups[i].failed;
+    }
+    double ms = timer.ElapsedMs();
+    connector.StopListening();
+
+    stringstream label;
+    label << name << ", " << connections << " clients";
+    if (answered > 0)
+    {
+        BenchmarkReport(label.str(), ms, answered);
+    }
+    printf("%-40s %10.0f requests/s %8d of %d answered, %d connections failed\n", label.str().c_str(),
+           answered / (ms / 1000.0), answered, connections * rounds, failed);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 100000);
+    stringstream message;
+    message << "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: "
+            << strlen(BODY) << "\r\n\r\n" << BODY;
+    request = message.str();
+
+    //Clients and server share the descriptors of this process.
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    int maxConnections = limit.rlim_cur == RLIM_INFINITY ? 10000 : ((int) limit.rlim_cur - 256) / 2;
+
+    AddHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+
+    int levels[] = {100, 1000, 10000};
+    for (int i = 0; i < 3; i++)
+    {
+        int connections = levels[i] < maxConnections ? levels[i] : maxConnections;
+        int rounds = iterations / connections > 0 ? iterations / connections : 1;
+
+        EpollHttpServer epollConnector(PORT);
+        epollConnector.SetHandler(server);
+        Run(epollConnector, "EpollHttpServer", connections, rounds);
+
+        HttpServer threadedConnector(PORT);
+        threadedConnector.SetHandler(server);
+        Run(threadedConnector, "HttpServer", connections, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    connectionreuse.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <cstdio>
+#include <pthread.h>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+#define PORT 8386
+#define CLIENTS 8
+
+class AddHandler : public AbstractRequestHandler
+{
+    public:
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            output = input["value1"].asInt() + input["value2"].asInt();
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+};
+
+struct ClientRun
+{
+    int requests;
+    int failures;
+};
+
+/**
+ * @brief Sends its requests one after another through one HttpClient, which reuses its connection if the server keeps it alive.
+ */
+static void* SendRequests(void* data)
+{
+    ClientRun* run = (ClientRun*) data;
+    HttpClient client("http://127.0.0.1:8386");
+    string request = "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value1\":3,\"value2\":4},\"id\":1}";
+    string response;
+    for (int i = 0; i < run->requests; i++)
+    {
+        client.SendMessage(request, response);
+        if (response != "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":7}\n")
+        {
+            run->failures++;
+        }
+    }
+    return NULL;
+}
+
+static void Run(RpcProtocolServer& server, const string& name, bool keepAlive, int clients, int iterations)
+{
+    HttpServer connector(PORT);
+    connector.SetHandler(server);
+    connector.SetKeepAlive(keepAlive);
+    if (!connector.StartListening())
+    {
+        cerr << "could not listen on port " << PORT << endl;
+        return;
+    }
+    pthread_t threads[CLIENTS];
+    ClientRun runs[CLIENTS];
+    BenchmarkTimer timer;
+    for (int i = 0; i < clients; i++)
+    {
+        runs[i].requests = iterations / clients;
+        runs[i].failures = 0;
+        pthread_create(&threads[i], NULL, SendRequests, &runs[i]);
+    }
+    int failures = 0;
+    for (int i = 0; i < clients; i++)
+    {
+        pthread_join(threads[i], NULL);
+        failures += runs[i].failures;
+    }
+    double ms = timer.ElapsedMs();
+    connector.StopListening();
+    BenchmarkReport(name, ms, iterations);
+    printf("%-40s %10.0f requests/s\n", name.c_str(), iterations / (ms / 1000.0));
+    if (failures > 0)
+    {
+        cerr << name << ": " << failures << " requests failed" << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 4000);
+    AddHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+
+    Run(server, "1 client, connection per request", false, 1, iterations);
+    Run(server, "1 client, reused connection", true, 1, iterations);
+    Run(server, "8 clients, connection per request", false, CLIENTS, iterations);
+    Run(server, "8 clients, reused connection", true, CLIENTS, iterations);
+    return 0;
+}
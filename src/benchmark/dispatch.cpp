@@ -0,0 +1,106 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    dispatch.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+#define PROCEDURES 400
+
+/**
+ * @brief Connector that never receives anything, AbstractServer only needs one to exist.
+ */
+class NullConnector : public AbstractServerConnector
+{
+    public:
+        virtual bool StartListening() { return true; }
+        virtual bool StopListening() { return true; }
+        virtual bool SendResponse(const std::string& response, void* addInfo) { return true; }
+        virtual bool SendEvent(const std::string& data) { return true; }
+};
+
+/**
+ * @brief A server with as many bound methods as the xbmc remote specification.
+ */
+class DispatchServer : public AbstractServer<DispatchServer>
+{
+    public:
+        DispatchServer() :
+            AbstractServer<DispatchServer>(new NullConnector()),
+            calls(0)
+        {
+            for (int i = 0; i < PROCEDURES; i++)
+            {
+                stringstream name;
+                name << "Namespace" << i % 20 << ".Procedure" << i;
+                this->bindAndAddMethod(new Procedure(name.str(), PARAMS_BY_NAME, JSON_INTEGER, NULL), &DispatchServer::count);
+            }
+            this->bindAndAddNotification(new Procedure("notify", PARAMS_BY_NAME, NULL), &DispatchServer::notify);
+        }
+
+        void count(const Json::Value& request, Json::Value& response)
+        {
+            this->calls++;
+        }
+
+        void notify(const Json::Value& request)
+        {
+            this->calls++;
+        }
+
+        unsigned long calls;
+};
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 2000000);
+    DispatchServer server;
+    procedurelist_t& procedures = server.GetProtocolHanlder()->GetProcedures();
+    vector<Procedure*> methods;
+    Procedure* notification = NULL;
+    for (procedurelist_t::iterator it = procedures.begin(); it != procedures.end(); it++)
+    {
+        if (it->second->GetProcedureType() == RPC_METHOD)
+        {
+            methods.push_back(it->second);
+        }
+        else
+        {
+            notification = it->second;
+        }
+    }
+
+    Json::Value input, output;
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++)
+    {
+        server.handleMethodCall(methods[i % methods.size()], input, output);
+    }
+    BenchmarkReport("dispatch method call", timer.ElapsedMs(), iterations);
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        server.handleNotificationCall(notification, input);
+    }
+    BenchmarkReport("dispatch notification", timer.ElapsedMs(), iterations);
+
+    if (server.calls != 2 * (unsigned long)iterations)
+    {
+        cerr << "unexpected number of calls: " << server.calls << endl;
+        return -1;
+    }
+    return 0;
+}
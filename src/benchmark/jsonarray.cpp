@@ -0,0 +1,97 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    jsonarray.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/json/json.h>
+#include <iostream>
+
+#include "benchmark.h"
+
+using namespace std;
+
+#define ARRAY_SIZE 50000
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 20);
+    BenchmarkTimer timer;
+
+    Json::Value numbers;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        numbers = Json::Value(Json::arrayValue);
+        for (int j = 0; j < ARRAY_SIZE; j++)
+        {
+            numbers.append(j);
+        }
+    }
+    BenchmarkReport("append 50000 ints", timer.ElapsedMs(), iterations);
+
+    long long sum = 0;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (Json::Value::ArrayIndex j = 0; j < numbers.size(); j++)
+        {
+            sum += numbers[j].asInt();
+        }
+    }
+    BenchmarkReport("index 50000 ints", timer.ElapsedMs(), iterations);
+
+    Json::FastWriter writer;
+    string document;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        document = writer.write(numbers);
+    }
+    BenchmarkReport("serialize 50000 ints", timer.ElapsedMs(), iterations, document.size());
+
+    Json::Reader reader;
+    Json::Value parsed;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        reader.parse(document, parsed, false);
+    }
+    BenchmarkReport("parse 50000 ints", timer.ElapsedMs(), iterations, document.size());
+
+    Json::Value batch;
+    for (int j = 0; j < 1000; j++)
+    {
+        Json::Value request;
+        request["jsonrpc"] = "2.0";
+        request["method"] = "add";
+        request["params"]["value1"] = j;
+        request["params"]["value2"] = j + 1;
+        request["id"] = j;
+        batch.append(request);
+    }
+    string batchDocument = writer.write(batch);
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        reader.parse(batchDocument, parsed, false);
+    }
+    BenchmarkReport("parse batch of 1000 requests", timer.ElapsedMs(), iterations, batchDocument.size());
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        document = writer.write(parsed);
+    }
+    BenchmarkReport("serialize batch of 1000 requests", timer.ElapsedMs(), iterations, document.size());
+
+    if (parsed != batch || sum == 0)
+    {
+        cerr << "benchmark result mismatch" << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    jsonobject.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#define BENCHMARK_COUNT_ALLOCATIONS
+#include <jsonrpc/json/json.h>
+#include <iostream>
+#include <sstream>
+
+#include "benchmark.h"
+
+using namespace std;
+
+#define REQUESTS 1000
+#define LARGE_OBJECT_SIZE 10000
+
+static const char* parameterNames[] = {"name", "value", "timeout", "retries", "enabled", "tags"};
+
+static void BuildRequest(Json::Value& request, int id)
+{
+    request["jsonrpc"] = "2.0";
+    request["method"] = "configure";
+    Json::Value& params = request["params"];
+    params["name"] = "device";
+    params["value"] = id;
+    params["timeout"] = 1.5;
+    params["retries"] = 3;
+    params["enabled"] = true;
+    params["tags"] = Json::Value(Json::arrayValue);
+    request["id"] = id;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 20);
+    BenchmarkTimer timer;
+    unsigned long allocations;
+
+    Json::Value batch(Json::arrayValue);
+    allocations = BenchmarkAllocations();
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        batch = Json::Value(Json::arrayValue);
+        for (int j = 0; j < REQUESTS; j++)
+        {
+            BuildRequest(batch[j], j);
+        }
+    }
+    BenchmarkReport("build 1000 requests", timer.ElapsedMs(), iterations);
+    BenchmarkReportAllocations("build 1000 requests", BenchmarkAllocations() - allocations, iterations);
+
+    long long found = 0;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (Json::Value::ArrayIndex j = 0; j < batch.size(); j++)
+        {
+            const Json::Value& request = batch[j];
+            if (request.isMember("jsonrpc") && request.isMember("method") && !request.isMember("auth"))
+            {
+                const Json::Value& params = request["params"];
+                for (int k = 0; k < 6; k++)
+                {
+                    found += params.isMember(parameterNames[k]);
+                }
+                found += params["value"].asInt() == request["id"].asInt();
+            }
+        }
+    }
+    BenchmarkReport("look up members of 1000 requests", timer.ElapsedMs(), iterations);
+
+    Json::FastWriter writer;
+    string document;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        document = writer.write(batch);
+    }
+    BenchmarkReport("serialize 1000 requests", timer.ElapsedMs(), iterations, document.size());
+
+    Json::Reader reader;
+    Json::Value parsed;
+    allocations = BenchmarkAllocations();
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        reader.parse(document, parsed, false);
+    }
+    BenchmarkReport("parse 1000 requests", timer.ElapsedMs(), iterations, document.size());
+    BenchmarkReportAllocations("parse 1000 requests", BenchmarkAllocations() - allocations, iterations);
+
+    vector<string> keys;
+    for (int j = 0; j < LARGE_OBJECT_SIZE; j++)
+    {
+        stringstream key;
+        key << "member" << (j * 7919) % LARGE_OBJECT_SIZE;
+        keys.push_back(key.str());
+    }
+    Json::Value large;
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        large = Json::Value(Json::objectValue);
+        for (int j = 0; j < LARGE_OBJECT_SIZE; j++)
+        {
+            large[keys[j]] = j;
+        }
+    }
+    BenchmarkReport("insert 10000 members", timer.ElapsedMs(), iterations);
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        const Json::Value& constLarge = large;
+        for (int j = 0; j < LARGE_OBJECT_SIZE; j++)
+        {
+            found += constLarge[keys[j]].asInt() == j;
+        }
+    }
+    BenchmarkReport("look up 10000 members", timer.ElapsedMs(), iterations);
+
+    if (parsed != batch || large.size() != LARGE_OBJECT_SIZE || found != (long long)iterations * (REQUESTS * 7 + LARGE_OBJECT_SIZE))
+    {
+        cerr << "benchmark result mismatch" << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    jsonreader.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/json/json.h>
+#include <iostream>
+#include <sstream>
+
+#include "benchmark.h"
+
+using namespace std;
+
+#define DOCUMENT_ITEMS 200
+
+static const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief Requests carrying a 4 KiB base64 blob each: long strings without any escapes.
+ */
+static string Base64Document()
+{
+    Json::Value document(Json::arrayValue);
+    for (int i = 0; i < DOCUMENT_ITEMS; i++)
+    {
+        string blob;
+        for (int j = 0; j < 4096; j++)
+        {
+            blob += base64Alphabet[(i * 31 + j * 7) % 64];
+        }
+        Json::Value& request = document[i];
+        request["jsonrpc"] = "2.0";
+        request["method"] = "upload";
+        request["params"]["name"] = "attachment.bin";
+        request["params"]["data"] = blob;
+        request["id"] = i;
+    }
+    return Json::FastWriter().write(document);
+}
+
+/**
+ * @brief Log lines of ~200 bytes with quotes, tabs and non-ASCII characters that need escaping.
+ */
+static string LogDocument()
+{
+    Json::Value document(Json::arrayValue);
+    for (int i = 0; i < DOCUMENT_ITEMS * 10; i++)
+    {
+        stringstream line;
+        line << "2014-10-18 12:00:" << i % 60 << "\tINFO\tworker-" << i % 8
+             << " handled request \"calculate\" from client 10.0.0." << i % 255
+             << " in " << i % 97 << " ms, payload path C:\\data\\input" << i
+             << ".json, status \"ok\", retries 0, queue depth " << i % 13 << "\n";
+        document[i]["level"] = "info";
+        document[i]["message"] = line.str();
+    }
+    return Json::FastWriter().write(document);
+}
+
+/**
+ * @brief Small numeric requests as produced by typical RPC clients, short strings only.
+ */
+static string RequestDocument()
+{
+    Json::Value document(Json::arrayValue);
+    for (int i = 0; i < DOCUMENT_ITEMS * 10; i++)
+    {
+        Json::Value& request = document[i];
+        request["jsonrpc"] = "2.0";
+        request["method"] = "add";
+        request["params"]["value1"] = i;
+        request["params"]["value2"] = i * 3;
+        request["id"] = i;
+    }
+    return Json::FastWriter().write(document);
+}
+
+/**
+ * @brief Telemetry samples: a long array of doubles with 64 bit timestamps.
+ */
+static string TelemetryDocument()
+{
+    stringstream document;
+    document.precision(17);
+    document << "[";
+    for (int i = 0; i < DOCUMENT_ITEMS * 50; i++)
+    {
+        document << (i > 0 ? "," : "") << 1413633600000000LL + i * 1000 << "," << 20.0 + (i % 1000) * 0.0123456789;
+    }
+    document << "]";
+    return document.str();
+}
+
+/**
+ * @brief The request document pretty printed, which makes whitespace dominate.
+ */
+static string IndentedDocument()
+{
+    Json::Value document;
+    Json::Reader().parse(RequestDocument(), document);
+    return Json::StyledWriter().write(document);
+}
+
+static bool RunParse(const string& name, const string& document, int iterations)
+{
+    Json::Reader reader;
+    Json::Value root;
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++)
+    {
+        if (!reader.parse(document, root, false))
+        {
+            cerr << name << ": " << reader.getFormatedErrorMessages() << endl;
+            return false;
+        }
+    }
+    BenchmarkReport(name, timer.ElapsedMs(), iterations, document.size());
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 50);
+    string base64 = Base64Document();
+    string log = LogDocument();
+    string requests = RequestDocument();
+    string indented = IndentedDocument();
+    string telemetry = TelemetryDocument();
+
+    if (!RunParse("parse base64 blobs", base64, iterations)
+            || !RunParse("parse log lines", log, iterations)
+            || !RunParse("parse small requests", requests, iterations)
+            || !RunParse("parse indented requests", indented, iterations)
+            || !RunParse("parse telemetry samples", telemetry, iterations))
+    {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    jsonwriter.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/json/json.h>
+#include <iostream>
+#include <sstream>
+
+#include "benchmark.h"
+
+using namespace std;
+
+#define SAMPLES 10000
+
+/**
+ * @brief Telemetry samples: measured values with a few decimals and computed values with full precision.
+ */
+static Json::Value TelemetryDocument()
+{
+    Json::Value document(Json::arrayValue);
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        Json::Value& sample = document.append(Json::Value(Json::objectValue));
+        sample["temperature"] = 20.0 + (i % 100) * 0.1;
+        sample["load"] = 0.5 + (i % 7) * 0.25;
+        sample["ratio"] = 1.0 / (i + 3);
+        sample["energy"] = (i + 1) * 1.0e-7;
+    }
+    return document;
+}
+
+/**
+ * @brief Responses with large string fields: base64 blobs and log lines that need some escaping.
+ */
+static Json::Value StringDocument()
+{
+    static const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    Json::Value document(Json::arrayValue);
+    for (int i = 0; i < SAMPLES / 50; i++)
+    {
+        Json::Value& response = document.append(Json::Value(Json::objectValue));
+        string blob;
+        for (int j = 0; j < 4096; j++)
+        {
+            blob += base64Alphabet[(i * 31 + j * 7) % 64];
+        }
+        response["data"] = blob;
+        Json::Value& log = response["log"];
+        for (int j = 0; j < 20; j++)
+        {
+            stringstream line;
+            line << "2014-10-18 12:00:" << j << "\tINFO\tworker-" << i % 8 << " handled \"calculate\" from 10.0.0." << j
+                 << " in " << j * 3 << " ms, path C:\\data\\input" << i << ".json, status ok, queue depth " << j % 13 << "\n";
+            log.append(line.str());
+        }
+    }
+    return document;
+}
+
+static void RunWrite(const string& name, Json::Writer& writer, const Json::Value& document, int iterations)
+{
+    string output;
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++)
+    {
+        output = writer.write(document);
+    }
+    BenchmarkReport(name, timer.ElapsedMs(), iterations, output.size());
+    printf("%-40s %10lu bytes\n", name.c_str(), (unsigned long)output.size());
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 50);
+    Json::Value telemetry = TelemetryDocument();
+    Json::Value strings = StringDocument();
+
+    Json::FastWriter fastWriter;
+    Json::StyledWriter styledWriter;
+    RunWrite("fast writer telemetry samples", fastWriter, telemetry, iterations);
+    RunWrite("styled writer telemetry samples", styledWriter, telemetry, iterations);
+    RunWrite("fast writer string fields", fastWriter, strings, iterations);
+    RunWrite("styled writer string fields", styledWriter, strings, iterations);
+
+    Json::Value parsed;
+    Json::Reader reader;
+    if (!reader.parse(fastWriter.write(telemetry), parsed) || parsed != telemetry)
+    {
+        cerr << "written doubles did not read back unchanged" << endl;
+        return -1;
+    }
+    if (!reader.parse(fastWriter.write(strings), parsed) || parsed != strings)
+    {
+        cerr << "written strings did not read back unchanged" << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    requesthandling.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#define BENCHMARK_COUNT_ALLOCATIONS
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <jsonrpc/rpcprotocolclient.h>
+#include <iostream>
+#include <sstream>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+#define BATCH_SIZE 100
+#define LARGE_RESULT_SIZE 100000
+
+/**
+ * @brief Answers "add" and "echo" without any connector, so that only the protocol layer is measured.
+ */
+class BenchmarkHandler : public AbstractRequestHandler
+{
+    public:
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            if (proc->GetProcedureName() == "add")
+            {
+                output = input["value1"].asInt() + input["value2"].asInt();
+            }
+            else
+            {
+                output = input;
+            }
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+};
+
+/**
+ * @brief Drops the response, like a connector that sends each chunk as soon as it is full.
+ */
+class DiscardingSink : public Json::OutputSink
+{
+    public:
+        DiscardingSink() : bytes(0) {}
+
+        virtual void write(const char* data, size_t length)
+        {
+            this->bytes += length;
+        }
+
+        size_t bytes;
+};
+
+static void RunRequests(RpcProtocolServer& server, const string& name, const string& request, int iterations, int requestsPerIteration)
+{
+    string response;
+    BenchmarkTimer timer;
+    unsigned long allocations = BenchmarkAllocations();
+    for (int i = 0; i < iterations; i++)
+    {
+        server.HandleRequest(request, response);
+    }
+    BenchmarkReport(name, timer.ElapsedMs(), iterations, request.size());
+    BenchmarkReportAllocations(name, BenchmarkAllocations() - allocations, iterations * requestsPerIteration);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 20000);
+    BenchmarkHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+    server.AddProcedure(new Procedure("echo", PARAMS_BY_NAME, JSON_OBJECT, "name", JSON_STRING, "tags", JSON_ARRAY, "nested", JSON_OBJECT, NULL));
+
+    string add = "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value1\":3,\"value2\":4},\"id\":1}";
+    string echo = "{\"jsonrpc\":\"2.0\",\"method\":\"echo\",\"params\":{\"name\":\"benchmark\",\"tags\":[\"a\",\"b\",\"c\"],"
+                  "\"nested\":{\"x\":1.5,\"y\":-2,\"label\":\"point\"}},\"id\":\"request-1\"}";
+    stringstream batch;
+    batch << "[";
+    for (int i = 0; i < BATCH_SIZE; i++)
+    {
+        batch << (i > 0 ? "," : "") << "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value1\":" << i << ",\"value2\":1},\"id\":" << i << "}";
+    }
+    batch << "]";
+
+    string response;
+    server.HandleRequest(add, response);
+    if (response != "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":7}\n")
+    {
+        cerr << "unexpected response: " << response << endl;
+        return -1;
+    }
+
+    RunRequests(server, "handle add request", add, iterations, 1);
+    //The difference to the previous run is the cost of the stats, see RpcProtocolServer::SetStatsEnabled
+    server.SetStatsEnabled(true);
+    RunRequests(server, "handle add request with stats", add, iterations, 1);
+    server.SetStatsEnabled(false);
+
+    //A server with as many procedures as the xbmc remote specification
+    BenchmarkHandler largeHandler;
+    RpcProtocolServer largeServer(&largeHandler);
+    for (int i = 0; i < 400; i++)
+    {
+        stringstream name;
+        name << "Namespace" << i % 20 << ".Procedure" << i;
+        largeServer.AddProcedure(new Procedure(name.str(), PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+    }
+    largeServer.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+    RunRequests(largeServer, "handle add request among 400 procedures", add, iterations, 1);
+    RunRequests(server, "handle echo request", echo, iterations, 1);
+    RunRequests(server, "handle request for a missing method", "{\"jsonrpc\":\"2.0\",\"method\":\"missing\",\"params\":{},\"id\":1}",
+                iterations, 1);
+    RunRequests(server, "handle batch of 100 add requests", batch.str(), iterations / BATCH_SIZE, BATCH_SIZE);
+
+    stringstream large;
+    large << "{\"jsonrpc\":\"2.0\",\"method\":\"echo\",\"params\":{\"name\":\"large\",\"nested\":{},\"tags\":[";
+    for (int i = 0; i < LARGE_RESULT_SIZE; i++)
+    {
+        large << (i > 0 ? "," : "") << "{\"index\":" << i << ",\"label\":\"item\"}";
+    }
+    large << "]},\"id\":1}";
+    string largeRequest = large.str();
+    int largeIterations = iterations / 2000 > 0 ? iterations / 2000 : 1;
+    RunRequests(server, "handle echo request with 100000 items", largeRequest, largeIterations, 1);
+
+    DiscardingSink sink;
+    BenchmarkTimer streamTimer;
+    unsigned long streamAllocations = BenchmarkAllocations();
+    for (int i = 0; i < largeIterations; i++)
+    {
+        server.HandleRequest(largeRequest, sink, 16384);
+    }
+    BenchmarkReport("stream echo response with 100000 items", streamTimer.ElapsedMs(), largeIterations, largeRequest.size());
+    BenchmarkReportAllocations("stream echo response with 100000 items", BenchmarkAllocations() - streamAllocations, largeIterations);
+
+    string largeResponse;
+    server.HandleRequest(largeRequest, largeResponse);
+    RpcProtocolClient client;
+    Json::Value result;
+    BenchmarkTimer timer;
+    unsigned long allocations = BenchmarkAllocations();
+    for (int i = 0; i < largeIterations; i++)
+    {
+        client.HandleResponse(largeResponse, result);
+    }
+    BenchmarkReport("client response with 100000 items", timer.ElapsedMs(), largeIterations, largeResponse.size());
+    BenchmarkReportAllocations("client response with 100000 items", BenchmarkAllocations() - allocations, largeIterations);
+    if (result["tags"].size() != LARGE_RESULT_SIZE)
+    {
+        cerr << "unexpected result size: " << result["tags"].size() << endl;
+        return -1;
+    }
+    return 0;
+}
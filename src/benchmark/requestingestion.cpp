@@ -0,0 +1,136 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    requestingestion.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#define BENCHMARK_COUNT_ALLOCATIONS
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+#define LARGE_REQUEST_ITEMS 2000
+#define RESPONSE_CHUNK_SIZE 16384
+
+class EchoHandler : public AbstractRequestHandler
+{
+    public:
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            output = input["items"].size();
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+};
+
+class DiscardingSink : public Json::OutputSink
+{
+    public:
+        virtual void write(const char* data, size_t length)
+        {
+        }
+};
+
+/**
+ * @brief A connector that received its requests into a buffer of its own, like HttpServer, and streams the responses away.
+ */
+class BufferConnector : public AbstractServerConnector
+{
+    public:
+        virtual bool StartListening()
+        {
+            return true;
+        }
+
+        virtual bool StopListening()
+        {
+            return true;
+        }
+
+        virtual bool SendResponse(const std::string& response, void* addInfo)
+        {
+            return true;
+        }
+
+        virtual bool SendEvent(const std::string& data)
+        {
+            return false;
+        }
+
+    protected:
+        virtual bool ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo)
+        {
+            DiscardingSink sink;
+            handler.HandleRequest(request, length, sink, RESPONSE_CHUNK_SIZE);
+            return true;
+        }
+};
+
+static void Run(BufferConnector& connector, const string& name, const vector<char>& buffer, bool copy, int iterations)
+{
+    BenchmarkTimer timer;
+    unsigned long allocations = BenchmarkAllocations();
+    unsigned long long bytes = BenchmarkAllocatedBytes();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (copy)
+        {
+            //What the connectors did before: the buffer becomes a std::string first.
+            connector.OnRequest(string(&buffer[0], buffer.size()), NULL);
+        }
+        else
+        {
+            connector.OnRequest(&buffer[0], buffer.size(), NULL);
+        }
+    }
+    BenchmarkReport(name, timer.ElapsedMs(), iterations, buffer.size());
+    BenchmarkReportAllocations(name, BenchmarkAllocations() - allocations, iterations);
+    BenchmarkReportAllocatedBytes(name, BenchmarkAllocatedBytes() - bytes, iterations);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 20000);
+    EchoHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("count", PARAMS_BY_NAME, JSON_INTEGER, "items", JSON_ARRAY, NULL));
+    BufferConnector connector;
+    connector.SetHandler(server);
+
+    string small = "{\"jsonrpc\":\"2.0\",\"method\":\"count\",\"params\":{\"items\":[1,2,3]},\"id\":1}";
+    stringstream large;
+    large << "{\"jsonrpc\":\"2.0\",\"method\":\"count\",\"params\":{\"items\":[";
+    for (int i = 0; i < LARGE_REQUEST_ITEMS; i++)
+    {
+        large << (i > 0 ? "," : "") << "{\"index\":" << i << ",\"label\":\"item\"}";
+    }
+    large << "]},\"id\":1}";
+
+    //Receive buffers are not terminated
+    vector<char> smallBuffer(small.begin(), small.end());
+    string largeRequest = large.str();
+    vector<char> largeBuffer(largeRequest.begin(), largeRequest.end());
+
+    //Warms up the context of this thread and lets it keep its buffers, so that only the copies are counted
+    ProtocolContext::SetMaxRetainedSize(64 * 1024 * 1024);
+    connector.OnRequest(&largeBuffer[0], largeBuffer.size(), NULL);
+
+    Run(connector, "small request copied to a string", smallBuffer, true, iterations);
+    Run(connector, "small request from the buffer", smallBuffer, false, iterations);
+    int largeIterations = iterations / 200 > 0 ? iterations / 200 : 1;
+    Run(connector, "large request copied to a string", largeBuffer, true, largeIterations);
+    Run(connector, "large request from the buffer", largeBuffer, false, largeIterations);
+    return 0;
+}
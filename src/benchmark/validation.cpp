@@ -0,0 +1,128 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    validation.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/procedure.h>
+#include <iostream>
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+/**
+ * @brief The validator Procedure used before the checks were compiled: a walk over the parameter
+ * map with two look-ups per parameter and top level types only.
+ */
+static bool MapWalkValidate(const parameterNameList_t& parameters, const Json::Value& input)
+{
+    for (parameterNameList_t::const_iterator it = parameters.begin(); it != parameters.end(); it++)
+    {
+        if (!input.isMember(it->first.c_str()))
+        {
+            return false;
+        }
+        const Json::Value& value = input[it->first];
+        bool ok = true;
+        switch (it->second)
+        {
+            case JSON_STRING:   ok = value.isString(); break;
+            case JSON_BOOLEAN:  ok = value.isBool(); break;
+            case JSON_INTEGER:  ok = value.isInt(); break;
+            case JSON_REAL:     ok = value.isDouble(); break;
+            case JSON_OBJECT:   ok = value.isObject(); break;
+            case JSON_ARRAY:    ok = value.isArray(); break;
+            case JSON_NULL:     ok = value.isNull(); break;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief What a handler had to check by hand on top of MapWalkValidate for the nested parameters.
+ */
+static bool HandWrittenItemsCheck(const Json::Value& input)
+{
+    const Json::Value& items = input["items"];
+    if (items.size() < 1 || items.size() > 16)
+    {
+        return false;
+    }
+    for (unsigned int i = 0; i < items.size(); i++)
+    {
+        const Json::Value& item = items[i];
+        if (!item.isObject() || !item.isMember("sku") || !item["sku"].isString()
+                || !item.isMember("count") || !item["count"].isInt() || item["count"].asInt() < 1 || item["count"].asInt() > 99)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Json::Value Parse(const string& document)
+{
+    Json::Value value;
+    Json::Reader().parse(document, value);
+    return value;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BenchmarkIterations(argc, argv, 2000000);
+
+    Procedure flat("flat", PARAMS_BY_NAME, JSON_BOOLEAN, "name", JSON_STRING, "age", JSON_INTEGER, "active", JSON_BOOLEAN,
+                   "score", JSON_REAL, "tags", JSON_ARRAY, "address", JSON_OBJECT, NULL);
+    Json::Value flatInput = Parse("{\"name\":\"Peter\",\"age\":42,\"active\":true,\"score\":1.5,\"tags\":[],\"address\":{}}");
+
+    BenchmarkTimer timer;
+    int valid = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        valid += MapWalkValidate(flat.GetParameters(), flatInput);
+    }
+    BenchmarkReport("flat, map walk", timer.ElapsedMs(), iterations);
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        valid += flat.ValdiateParameters(flatInput);
+    }
+    BenchmarkReport("flat, compiled", timer.ElapsedMs(), iterations);
+
+    Procedure nested("nested", PARAMS_BY_NAME, JSON_BOOLEAN, "customer", JSON_STRING, "items", JSON_ARRAY, NULL);
+    nested.SetParameterSchema("items", Parse("{\"minItems\":1,\"maxItems\":16,\"items\":{\"type\":\"object\",\"required\":[\"sku\",\"count\"],"
+                                             "\"properties\":{\"sku\":{\"type\":\"string\"},\"count\":{\"type\":\"integer\",\"minimum\":1,\"maximum\":99}}}}"));
+    Json::Value nestedInput = Parse("{\"customer\":\"Peter\",\"items\":[{\"sku\":\"a\",\"count\":1},{\"sku\":\"b\",\"count\":2},"
+                                    "{\"sku\":\"c\",\"count\":3},{\"sku\":\"d\",\"count\":4}]}");
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        valid += MapWalkValidate(nested.GetParameters(), nestedInput) && HandWrittenItemsCheck(nestedInput);
+    }
+    BenchmarkReport("nested, map walk and handler checks", timer.ElapsedMs(), iterations);
+
+    timer.Start();
+    for (int i = 0; i < iterations; i++)
+    {
+        valid += nested.ValdiateParameters(nestedInput);
+    }
+    BenchmarkReport("nested, compiled schema", timer.ElapsedMs(), iterations);
+
+    if (valid != 4 * iterations)
+    {
+        cerr << "validators disagree: " << valid << " of " << 4 * iterations << " passed" << endl;
+        return -1;
+    }
+    return 0;
+}
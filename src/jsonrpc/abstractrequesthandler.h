@@ -12,10 +12,22 @@
 
 namespace jsonrpc
 {
+    class MethodCompletion;
+
     class AbstractRequestHandler {
         public:
             virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output) = 0;
             virtual void handleNotificationCall(Procedure* proc, const Json::Value& input) = 0;
+
+            /**
+             * @brief Called instead of handleMethodCall for procedures marked with Procedure::SetAsynchronous.
+             * The handler may return before the call is answered and complete it later from any thread.
+             * Errors are reported with MethodCompletion::Fail, the handler must not throw.
+             * The default implementation answers the call synchronously through handleMethodCall.
+             * @param input - the parameters, valid until the call is completed.
+             * @param completion - answers the call, see MethodCompletion.
+             */
+            virtual void handleAsyncMethodCall(Procedure* proc, const Json::Value& input, MethodCompletion* completion);
     };
 }
 
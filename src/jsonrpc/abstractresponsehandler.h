@@ -0,0 +1,34 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    abstractresponsehandler.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef ABSTRACTRESPONSEHANDLER_H
+#define ABSTRACTRESPONSEHANDLER_H
+
+namespace jsonrpc
+{
+    class ProtocolContext;
+
+    /**
+     * @brief Receives the response of a request handed to RpcProtocolServer::HandleRequest(const std::string&, AbstractResponseHandler*).
+     */
+    class AbstractResponseHandler {
+        public:
+            virtual ~AbstractResponseHandler() {}
+
+            /**
+             * @brief Called once the request is answered. If the request contains asynchronous methods, this is the thread
+             * that completed the last of them, otherwise the thread that handed in the request.
+             * @param context - the calling thread's context, used to serialize the response.
+             * @param response - the response Object or Array, null if the request contained only notifications.
+             */
+            virtual void OnResponse(ProtocolContext& context, const Json::Value& response) = 0;
+    };
+}
+
+#endif // ABSTRACTRESPONSEHANDLER_H
@@ -0,0 +1,97 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    concurrencylimit.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "concurrencylimit.h"
+#include <sys/time.h>
+#include <errno.h>
+
+namespace jsonrpc
+{
+    ConcurrencyLimit::ConcurrencyLimit(unsigned int maxConcurrent, unsigned int maxQueued, unsigned int maxQueueTime) :
+        maxConcurrent(maxConcurrent > 0 ? maxConcurrent : 1),
+        maxQueued(maxQueued),
+        maxQueueTime(maxQueueTime),
+        running(0),
+        waiting(0)
+    {
+        pthread_mutex_init(&this->mutex, NULL);
+        pthread_cond_init(&this->released, NULL);
+    }
+
+    ConcurrencyLimit::~ConcurrencyLimit()
+    {
+        pthread_cond_destroy(&this->released);
+        pthread_mutex_destroy(&this->mutex);
+    }
+
+    bool ConcurrencyLimit::Acquire()
+    {
+        pthread_mutex_lock(&this->mutex);
+        if (this->running < this->maxConcurrent)
+        {
+            this->running++;
+            pthread_mutex_unlock(&this->mutex);
+            return true;
+        }
+        if (this->waiting >= this->maxQueued)
+        {
+            pthread_mutex_unlock(&this->mutex);
+            return false;
+        }
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long nanoseconds = now.tv_usec * 1000L + (this->maxQueueTime % 1000) * 1000000L;
+        struct timespec deadline;
+        deadline.tv_sec = now.tv_sec + this->maxQueueTime / 1000 + nanoseconds / 1000000000L;
+        deadline.tv_nsec = nanoseconds % 1000000000L;
+
+        this->waiting++;
+        int result = 0;
+        while (this->running >= this->maxConcurrent && result != ETIMEDOUT)
+        {
+            result = pthread_cond_timedwait(&this->released, &this->mutex, &deadline);
+        }
+        this->waiting--;
+        bool admitted = this->running < this->maxConcurrent;
+        if (admitted)
+        {
+            this->running++;
+        }
+        pthread_mutex_unlock(&this->mutex);
+        return admitted;
+    }
+
+    void ConcurrencyLimit::Release()
+    {
+        pthread_mutex_lock(&this->mutex);
+        this->running--;
+        if (this->waiting > 0)
+        {
+            pthread_cond_signal(&this->released);
+        }
+        pthread_mutex_unlock(&this->mutex);
+    }
+
+    unsigned int ConcurrencyLimit::GetMaxConcurrent() const
+    {
+        return this->maxConcurrent;
+    }
+
+    unsigned int ConcurrencyLimit::GetMaxQueued() const
+    {
+        return this->maxQueued;
+    }
+
+    unsigned int ConcurrencyLimit::GetMaxQueueTime() const
+    {
+        return this->maxQueueTime;
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,59 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    concurrencylimit.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef CONCURRENCYLIMIT_H_
+#define CONCURRENCYLIMIT_H_
+
+#include <pthread.h>
+
+namespace jsonrpc
+{
+    /**
+     * @brief Admission control for the calls of one procedure.
+     *
+     * At most maxConcurrent calls run at once. Up to maxQueued further calls wait for a free slot,
+     * each for at most maxQueueTime milliseconds, all others are turned away.
+     */
+    class ConcurrencyLimit
+    {
+        public:
+            /**
+             * @param maxConcurrent - number of calls that may run at once, at least 1.
+             * @param maxQueued - number of calls that may wait for a slot, 0 rejects every call over the limit.
+             * @param maxQueueTime - milliseconds a call waits for a slot before it is rejected.
+             */
+            ConcurrencyLimit(unsigned int maxConcurrent, unsigned int maxQueued, unsigned int maxQueueTime);
+            ~ConcurrencyLimit();
+
+            /**
+             * @brief Takes a slot, waiting for one if the limit is reached and the queue has room.
+             * @return true if the call may run and has to Release its slot afterwards, false if it is rejected.
+             */
+            bool Acquire();
+            void Release();
+
+            unsigned int GetMaxConcurrent() const;
+            unsigned int GetMaxQueued() const;
+            unsigned int GetMaxQueueTime() const;
+
+        private:
+            ConcurrencyLimit(const ConcurrencyLimit&);      // no implementation
+            void operator=(const ConcurrencyLimit&);        // no implementation
+
+            unsigned int maxConcurrent;
+            unsigned int maxQueued;
+            unsigned int maxQueueTime;
+            unsigned int running;
+            unsigned int waiting;
+            pthread_mutex_t mutex;
+            pthread_cond_t released;
+    };
+
+} /* namespace jsonrpc */
+#endif /* CONCURRENCYLIMIT_H_ */
@@ -0,0 +1,832 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    epollhttpserver.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifdef __linux__
+
+#include "epollhttpserver.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**
+ * Bytes read from a socket at once.
+ */
+#define EPOLL_HTTP_READ_SIZE 65536
+#define EPOLL_HTTP_MAX_HEADER_SIZE 16384
+#define EPOLL_HTTP_MAX_BODY_SIZE (64 * 1024 * 1024)
+/**
+ * Buffers that grew beyond this capacity are released once they are empty, so idle connections stay small.
+ */
+#define EPOLL_HTTP_RETAINED_SIZE 65536
+#define EPOLL_HTTP_MAX_EVENTS 256
+/**
+ * Connections a loop accepts per wakeup before it serves the others again.
+ */
+#define EPOLL_HTTP_MAX_ACCEPTS 64
+
+namespace jsonrpc
+{
+    typedef enum
+    {
+        METHOD_GET, METHOD_POST, METHOD_OTHER
+    } httpmethod_t;
+
+    /**
+     * @brief A client connection, owned by the loop that accepted it.
+     */
+    class EpollHttpServer::Connection
+    {
+        public:
+            Connection(Loop* loop, int fd) :
+                loop(loop),
+                fd(fd),
+                written(0),
+                scanned(0),
+                headerParsed(false),
+                headerLength(0),
+                contentLength(0),
+                method(METHOD_OTHER),
+                requestKeepAlive(false),
+                expectContinue(false),
+                continued(false),
+                requests(0),
+                closing(false),
+                lastActive(0),
+                previous(NULL),
+                next(NULL)
+            {
+            }
+
+            Loop* loop;
+            int fd;
+            /**
+             * The received part of a request that is not complete yet.
+             */
+            std::string input;
+            std::string output;
+            size_t written;
+            /**
+             * Bytes of the pending request that were searched for the end of its header.
+             */
+            size_t scanned;
+
+            //The request being received, valid once headerParsed is set.
+            bool headerParsed;
+            size_t headerLength;
+            size_t contentLength;
+            httpmethod_t method;
+            bool requestKeepAlive;
+            bool expectContinue;
+            bool continued;
+
+            int requests;
+            /**
+             * Set once the last response of the connection is queued, it is closed when that is sent.
+             */
+            bool closing;
+            unsigned long long lastActive;
+            Connection* previous;
+            Connection* next;
+    };
+
+    /**
+     * @brief An event loop thread with its epoll instance and the connections it accepted,
+     * listed from the least to the most recently active one.
+     */
+    class EpollHttpServer::Loop
+    {
+        public:
+            Loop(EpollHttpServer* server) :
+                server(server),
+                epoll(-1),
+                reserve(-1),
+                first(NULL),
+                last(NULL),
+                now(0),
+                buffer(EPOLL_HTTP_READ_SIZE)
+            {
+            }
+
+            ~Loop()
+            {
+                while (this->first != NULL)
+                {
+                    this->Close(this->first);
+                }
+                if (this->epoll >= 0)
+                {
+                    close(this->epoll);
+                }
+                if (this->reserve >= 0)
+                {
+                    close(this->reserve);
+                }
+            }
+
+            void Accept();
+            /**
+             * @brief Sends what is queued and reads and answers requests until the socket would block.
+             */
+            void Service(Connection* connection);
+            /**
+             * @brief Closes the connections that have been idle for longer than the timeout.
+             */
+            void Expire();
+            /**
+             * @return the milliseconds until the least recently active connection expires, -1 if none will.
+             */
+            int GetTimeout() const;
+
+            static unsigned long long Now();
+
+            EpollHttpServer* server;
+            pthread_t thread;
+            int epoll;
+            /**
+             * A spare descriptor, given up to turn away a client when the process runs out of them.
+             */
+            int reserve;
+            Connection* first;
+            Connection* last;
+            unsigned long long now;
+            std::vector<char> buffer;
+            /**
+             * The response being serialized, reused by all connections of the loop.
+             */
+            std::string body;
+
+        private:
+            /**
+             * @return false if the connection failed, true if everything was sent or the socket is full.
+             */
+            bool Flush(Connection* connection);
+            void Close(Connection* connection);
+            void Touch(Connection* connection);
+            void Unlink(Connection* connection);
+    };
+
+    static void ReleaseIfLarge(std::string& buffer)
+    {
+        if (buffer.capacity() > EPOLL_HTTP_RETAINED_SIZE)
+        {
+            std::string().swap(buffer);
+        }
+    }
+
+    /**
+     * @return true if the comma separated header value contains token, ignoring case.
+     */
+    static bool ContainsToken(const char* value, size_t length, const char* token)
+    {
+        size_t tokenLength = strlen(token);
+        for (size_t i = 0; i + tokenLength <= length; i++)
+        {
+            if (strncasecmp(value + i, token, tokenLength) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned long long EpollHttpServer::Loop::Now()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    }
+
+    void EpollHttpServer::Loop::Accept()
+    {
+        for (int i = 0; i < EPOLL_HTTP_MAX_ACCEPTS && __sync_add_and_fetch(&this->server->stopping, 0) == 0; i++)
+        {
+            int fd = accept4(this->server->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                if ((errno == EMFILE || errno == ENFILE) && this->reserve >= 0)
+                {
+                    //The listener stays readable as long as the client waits, so it is accepted and closed right away.
+                    close(this->reserve);
+                    fd = accept(this->server->listener, NULL, NULL);
+                    if (fd >= 0)
+                    {
+                        close(fd);
+                    }
+                    this->reserve = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                }
+                return;
+            }
+            int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+            Connection* connection = new Connection(this, fd);
+            __sync_add_and_fetch(&this->server->connections, 1);
+            this->Touch(connection);
+            //Edge triggered for both directions, so the registration never has to change. Data that arrived
+            //before the registration is reported right away.
+            struct epoll_event event;
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = connection;
+            if (epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+            {
+                this->Close(connection);
+            }
+        }
+    }
+
+    void EpollHttpServer::Loop::Service(Connection* connection)
+    {
+        while (true)
+        {
+            if (!this->Flush(connection))
+            {
+                this->Close(connection);
+                return;
+            }
+            if (connection->written < connection->output.size())
+            {
+                //Reading resumes when the socket has room again, so a client that does not read its responses
+                //cannot make the server buffer any number of them.
+                return;
+            }
+            if (connection->closing)
+            {
+                this->Close(connection);
+                return;
+            }
+
+            ssize_t received = recv(connection->fd, &this->buffer[0], this->buffer.size(), 0);
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return;
+            }
+            if (received <= 0)
+            {
+                this->Close(connection);
+                return;
+            }
+            this->Touch(connection);
+
+            if (connection->input.empty())
+            {
+                //Requests that arrived in one piece are parsed where they were read.
+                size_t consumed = this->server->Consume(connection, &this->buffer[0], received);
+                connection->input.assign(&this->buffer[0] + consumed, received - consumed);
+            }
+            else
+            {
+                connection->input.append(&this->buffer[0], received);
+                size_t consumed = this->server->Consume(connection, connection->input.data(), connection->input.size());
+                connection->input.erase(0, consumed);
+                if (connection->input.empty())
+                {
+                    ReleaseIfLarge(connection->input);
+                }
+            }
+        }
+    }
+
+    bool EpollHttpServer::Loop::Flush(Connection* connection)
+    {
+        while (connection->written < connection->output.size())
+        {
+            ssize_t sent = send(connection->fd, connection->output.data() + connection->written,
+                                connection->output.size() - connection->written, MSG_NOSIGNAL);
+            if (sent > 0)
+            {
+                connection->written += sent;
+                this->Touch(connection);
+            }
+            else if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+        }
+        connection->output.clear();
+        connection->written = 0;
+        ReleaseIfLarge(connection->output);
+        return true;
+    }
+
+    void EpollHttpServer::Loop::Expire()
+    {
+        if (this->server->keepAliveTimeout <= 0)
+        {
+            return;
+        }
+        while (this->first != NULL && this->first->lastActive + this->server->keepAliveTimeout <= this->now)
+        {
+            this->Close(this->first);
+        }
+    }
+
+    int EpollHttpServer::Loop::GetTimeout() const
+    {
+        if (this->first == NULL || this->server->keepAliveTimeout <= 0)
+        {
+            return -1;
+        }
+        unsigned long long expiry = this->first->lastActive + this->server->keepAliveTimeout;
+        if (expiry <= this->now)
+        {
+            return 0;
+        }
+        return expiry - this->now > INT_MAX ? INT_MAX : (int)(expiry - this->now);
+    }
+
+    void EpollHttpServer::Loop::Close(Connection* connection)
+    {
+        this->Unlink(connection);
+        //Closing the socket removes it from the epoll instance.
+        close(connection->fd);
+        delete connection;
+        __sync_sub_and_fetch(&this->server->connections, 1);
+    }
+
+    void EpollHttpServer::Loop::Touch(Connection* connection)
+    {
+        connection->lastActive = this->now;
+        if (this->last == connection)
+        {
+            return;
+        }
+        if (connection->previous != NULL || this->first == connection)
+        {
+            this->Unlink(connection);
+        }
+        connection->previous = this->last;
+        connection->next = NULL;
+        if (this->last != NULL)
+        {
+            this->last->next = connection;
+        }
+        else
+        {
+            this->first = connection;
+        }
+        this->last = connection;
+    }
+
+    void EpollHttpServer::Loop::Unlink(Connection* connection)
+    {
+        if (connection->previous != NULL)
+        {
+            connection->previous->next = connection->next;
+        }
+        else
+        {
+            this->first = connection->next;
+        }
+        if (connection->next != NULL)
+        {
+            connection->next->previous = connection->previous;
+        }
+        else
+        {
+            this->last = connection->previous;
+        }
+        connection->previous = NULL;
+        connection->next = NULL;
+    }
+
+    EpollHttpServer::EpollHttpServer(int port, bool enableSpecification, unsigned int loops) :
+        AbstractServerConnector(),
+        port(port),
+        showSpec(enableSpecification),
+        loopCount(loops),
+        running(false),
+        listener(-1),
+        wakeup(-1),
+        stopping(0),
+        connections(0),
+        keepAlive(true),
+        keepAliveTimeout(30000),
+        maxKeepAliveRequests(0),
+        notificationThreads(0),
+        maxQueuedNotifications(0),
+        notificationPolicy(OVERFLOW_DROP),
+        notificationPool(NULL)
+    {
+        if (this->loopCount == 0)
+        {
+            long processors = sysconf(_SC_NPROCESSORS_ONLN);
+            this->loopCount = processors > 0 ? (unsigned int) processors : 1;
+        }
+    }
+
+    EpollHttpServer::~EpollHttpServer()
+    {
+        this->StopListening();
+    }
+
+    bool EpollHttpServer::StartListening()
+    {
+        if (this->running)
+        {
+            return true;
+        }
+        this->stopping = 0;
+        this->listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        this->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (this->listener < 0 || this->wakeup < 0)
+        {
+            this->Stop(0);
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(this->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(this->port);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(this->listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(this->listener, SOMAXCONN) != 0)
+        {
+            this->Stop(0);
+            return false;
+        }
+
+        for (unsigned int i = 0; i < this->loopCount; i++)
+        {
+            Loop* loop = new Loop(this);
+            this->loops.push_back(loop);
+            loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+            loop->reserve = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            //The listener and the wakeup event are level triggered and carry no connection. Only one of the loops
+            //is woken for a new client where the kernel supports it.
+            struct epoll_event event;
+            event.data.ptr = NULL;
+            event.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+            event.events |= EPOLLEXCLUSIVE;
+            if (loop->epoll >= 0 && epoll_ctl(loop->epoll, EPOLL_CTL_ADD, this->listener, &event) != 0 && errno == EINVAL)
+            {
+                event.events = EPOLLIN;
+                epoll_ctl(loop->epoll, EPOLL_CTL_ADD, this->listener, &event);
+            }
+#else
+            epoll_ctl(loop->epoll, EPOLL_CTL_ADD, this->listener, &event);
+#endif
+            event.events = EPOLLIN;
+            if (loop->epoll < 0 || epoll_ctl(loop->epoll, EPOLL_CTL_ADD, this->wakeup, &event) != 0)
+            {
+                this->Stop(0);
+                return false;
+            }
+        }
+
+        if (this->notificationThreads > 0)
+        {
+            this->notificationPool = new ThreadPool(this->notificationThreads, this->maxQueuedNotifications);
+        }
+        unsigned int started = 0;
+        while (started < this->loops.size() && pthread_create(&this->loops[started]->thread, NULL, EpollHttpServer::Run, this->loops[started]) == 0)
+        {
+            started++;
+        }
+        if (started < this->loops.size())
+        {
+            this->Stop(started);
+            return false;
+        }
+        this->running = true;
+        return true;
+    }
+
+    bool EpollHttpServer::StopListening()
+    {
+        if (this->running)
+        {
+            this->Stop(this->loops.size());
+            this->running = false;
+        }
+        return true;
+    }
+
+    void EpollHttpServer::Stop(unsigned int started)
+    {
+        __sync_lock_test_and_set(&this->stopping, 1);
+        if (this->wakeup >= 0)
+        {
+            //Never read, so the event stays set and wakes every loop until it exits.
+            uint64_t one = 1;
+            ssize_t written = write(this->wakeup, &one, sizeof(one));
+            (void) written;
+        }
+        for (unsigned int i = 0; i < started; i++)
+        {
+            pthread_join(this->loops[i]->thread, NULL);
+        }
+        for (unsigned int i = 0; i < this->loops.size(); i++)
+        {
+            delete this->loops[i];
+        }
+        this->loops.clear();
+        //Runs the notifications that were acknowledged but are still queued.
+        delete this->notificationPool;
+        this->notificationPool = NULL;
+        if (this->listener >= 0)
+        {
+            close(this->listener);
+            this->listener = -1;
+        }
+        if (this->wakeup >= 0)
+        {
+            close(this->wakeup);
+            this->wakeup = -1;
+        }
+    }
+
+    void* EpollHttpServer::Run(void* data)
+    {
+        Loop* loop = (Loop*) data;
+        struct epoll_event events[EPOLL_HTTP_MAX_EVENTS];
+        loop->now = Loop::Now();
+        while (__sync_add_and_fetch(&loop->server->stopping, 0) == 0)
+        {
+            int count = epoll_wait(loop->epoll, events, EPOLL_HTTP_MAX_EVENTS, loop->GetTimeout());
+            loop->now = Loop::Now();
+            for (int i = 0; i < count; i++)
+            {
+                Connection* connection = (Connection*) events[i].data.ptr;
+                if (connection == NULL)
+                {
+                    loop->Accept();
+                }
+                else
+                {
+                    loop->Service(connection);
+                }
+            }
+            //Only after the events, none of them may refer to an expired connection.
+            loop->Expire();
+        }
+        return NULL;
+    }
+
+    size_t EpollHttpServer::Consume(Connection* connection, const char* data, size_t length)
+    {
+        size_t offset = 0;
+        while (!connection->closing && offset < length)
+        {
+            const char* request = data + offset;
+            size_t available = length - offset;
+            if (!connection->headerParsed)
+            {
+                //Only the bytes that arrived since the last search are searched again.
+                size_t start = connection->scanned > 3 ? connection->scanned - 3 : 0;
+                const char* end = (const char*) memmem(request + start, available - start, "\r\n\r\n", 4);
+                if (end == NULL)
+                {
+                    connection->scanned = available;
+                    if (available > EPOLL_HTTP_MAX_HEADER_SIZE)
+                    {
+                        this->QueueError(connection, "431 Request Header Fields Too Large");
+                    }
+                    break;
+                }
+                connection->scanned = 0;
+                if (!this->ParseHeader(connection, request, end + 4 - request))
+                {
+                    break;
+                }
+            }
+            if (available - connection->headerLength < connection->contentLength)
+            {
+                if (connection->expectContinue && !connection->continued)
+                {
+                    connection->output.append("HTTP/1.1 100 Continue\r\n\r\n");
+                    connection->continued = true;
+                }
+                break;
+            }
+            this->Dispatch(connection, request + connection->headerLength, connection->contentLength);
+            connection->headerParsed = false;
+            offset += connection->headerLength + connection->contentLength;
+        }
+        return offset;
+    }
+
+    bool EpollHttpServer::ParseHeader(Connection* connection, const char* data, size_t headerLength)
+    {
+        const char* end = data + headerLength - 2;
+        const char* line = data;
+        const char* lineEnd = (const char*) memchr(line, '\r', end - line);
+
+        //Request line: method, target and version, separated by single spaces.
+        const char* space = (const char*) memchr(line, ' ', lineEnd - line);
+        if (space == NULL || lineEnd - line < 14 || strncmp(lineEnd - 8, "HTTP/1.", 7) != 0)
+        {
+            this->QueueError(connection, "400 Bad Request");
+            return false;
+        }
+        bool http10 = lineEnd[-1] == '0';
+        if (space - line == 4 && strncmp(line, "POST", 4) == 0)
+        {
+            connection->method = METHOD_POST;
+        }
+        else if (space - line == 3 && strncmp(line, "GET", 3) == 0)
+        {
+            connection->method = METHOD_GET;
+        }
+        else
+        {
+            connection->method = METHOD_OTHER;
+        }
+
+        size_t contentLength = 0;
+        bool closeRequested = false;
+        bool keepAliveRequested = false;
+        bool expectContinue = false;
+        for (line = lineEnd + 2; line < end; line = lineEnd + 2)
+        {
+            lineEnd = (const char*) memchr(line, '\r', end - line + 1);
+            const char* colon = (const char*) memchr(line, ':', lineEnd - line);
+            if (colon == NULL)
+            {
+                this->QueueError(connection, "400 Bad Request");
+                return false;
+            }
+            const char* value = colon + 1;
+            while (value < lineEnd && (*value == ' ' || *value == '\t'))
+            {
+                value++;
+            }
+            size_t nameLength = colon - line;
+            size_t valueLength = lineEnd - value;
+            if (nameLength == 14 && strncasecmp(line, "Content-Length", 14) == 0)
+            {
+                contentLength = 0;
+                const char* digit = value;
+                while (digit < lineEnd && *digit >= '0' && *digit <= '9' && contentLength <= EPOLL_HTTP_MAX_BODY_SIZE)
+                {
+                    contentLength = contentLength * 10 + (*digit++ - '0');
+                }
+                if (contentLength > EPOLL_HTTP_MAX_BODY_SIZE)
+                {
+                    this->QueueError(connection, "413 Payload Too Large");
+                    return false;
+                }
+                if (digit == value || (digit < lineEnd && *digit != ' ' && *digit != '\t'))
+                {
+                    this->QueueError(connection, "400 Bad Request");
+                    return false;
+                }
+            }
+            else if (nameLength == 10 && strncasecmp(line, "Connection", 10) == 0)
+            {
+                closeRequested = closeRequested || ContainsToken(value, valueLength, "close");
+                keepAliveRequested = keepAliveRequested || ContainsToken(value, valueLength, "keep-alive");
+            }
+            else if (nameLength == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0)
+            {
+                //Chunked request bodies are not supported, the bytes that follow could not be told apart from the next request.
+                this->QueueError(connection, "501 Not Implemented");
+                return false;
+            }
+            else if (nameLength == 6 && strncasecmp(line, "Expect", 6) == 0)
+            {
+                expectContinue = !http10 && ContainsToken(value, valueLength, "100-continue");
+            }
+        }
+
+        connection->headerParsed = true;
+        connection->headerLength = headerLength;
+        connection->contentLength = contentLength;
+        connection->requestKeepAlive = http10 ? keepAliveRequested && !closeRequested : !closeRequested;
+        connection->expectContinue = expectContinue;
+        connection->continued = false;
+        return true;
+    }
+
+    void EpollHttpServer::Dispatch(Connection* connection, const char* body, size_t length)
+    {
+        connection->requests++;
+        if (connection->method == METHOD_POST)
+        {
+            if (!this->OnRequest(body, length, connection))
+            {
+                this->QueueError(connection, "500 Internal Server Error");
+            }
+        }
+        else if (connection->method == METHOD_GET && this->showSpec)
+        {
+            this->SendResponse(this->GetSpecification(), connection);
+        }
+        else if (connection->method == METHOD_GET)
+        {
+            this->QueueError(connection, "404 Not Found");
+        }
+        else
+        {
+            this->QueueError(connection, "405 Method Not Allowed");
+        }
+    }
+
+    void EpollHttpServer::QueueResponse(Connection* connection, const char* status, const char* contentType, const char* body, size_t length)
+    {
+        connection->closing = connection->closing || !this->keepAlive || !connection->requestKeepAlive
+                || (this->maxKeepAliveRequests > 0 && connection->requests >= this->maxKeepAliveRequests)
+                || __sync_add_and_fetch(&this->stopping, 0) != 0;
+        const char* keepAlive = connection->closing ? "close" : "keep-alive";
+        char header[256];
+        if (contentType == NULL)
+        {
+            snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nConnection: %s\r\n\r\n", status, keepAlive);
+        }
+        else
+        {
+            snprintf(header, sizeof(header), "HTTP/1.1 %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %lu\r\n"
+                     "Connection: %s\r\n"
+                     "\r\n", status, contentType, (unsigned long) length, keepAlive);
+        }
+        connection->output.append(header);
+        connection->output.append(body, length);
+    }
+
+    void EpollHttpServer::QueueError(Connection* connection, const char* status)
+    {
+        //What follows the request cannot be trusted, or the client is not served at all.
+        connection->closing = true;
+        this->QueueResponse(connection, status, "text/plain", "", 0);
+    }
+
+    bool EpollHttpServer::SendResponse(const std::string& response, void* addInfo)
+    {
+        this->QueueResponse((Connection*) addInfo, "200 OK", "application/json", response.data(), response.size());
+        return true;
+    }
+
+    bool EpollHttpServer::ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo)
+    {
+        Connection* connection = (Connection*) addInfo;
+        if (this->notificationPool != NULL
+                && handler.HandleNotifications(request, length, *this->notificationPool, this->notificationPolicy))
+        {
+            this->QueueResponse(connection, "204 No Content", NULL, NULL, 0);
+            return true;
+        }
+        std::string& body = connection->loop->body;
+        handler.HandleRequest(request, length, body);
+        this->QueueResponse(connection, "200 OK", "application/json", body.data(), body.size());
+        ReleaseIfLarge(body);
+        return true;
+    }
+
+    void EpollHttpServer::SetKeepAlive(bool enabled, int idleTimeout, int maxRequests)
+    {
+        this->keepAlive = enabled;
+        this->keepAliveTimeout = idleTimeout;
+        this->maxKeepAliveRequests = maxRequests;
+    }
+
+    void EpollHttpServer::SetNotificationExecutor(unsigned int threads, unsigned int maxQueued, overflowpolicy_t policy)
+    {
+        this->notificationThreads = threads;
+        this->maxQueuedNotifications = maxQueued;
+        this->notificationPolicy = policy;
+    }
+
+    unsigned int EpollHttpServer::GetConnectionCount() const
+    {
+        return __sync_add_and_fetch(const_cast<volatile unsigned int*>(&this->connections), 0);
+    }
+
+    bool EpollHttpServer::SendEvent(const std::string& data)
+    {
+        return false;
+    }
+
+} /* namespace jsonrpc */
+
+#endif /* __linux__ */
@@ -0,0 +1,137 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    epollhttpserver.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef EPOLLHTTPSERVERCONNECTOR_H_
+#define EPOLLHTTPSERVERCONNECTOR_H_
+
+#ifdef __linux__
+
+#include <vector>
+#include "../serverconnector.h"
+#include "../threadpool.h"
+
+namespace jsonrpc
+{
+    /**
+     * @brief An HTTP/1.1 server connector built on non-blocking sockets and epoll, a drop-in alternative to HttpServer
+     * for many concurrent, mostly idle keep-alive clients.
+     *
+     * A fixed number of event loop threads share the listening socket. Every connection stays with the loop that accepted it,
+     * which reads its requests as they arrive, parses them incrementally and hands each complete body to the RpcProtocolServer.
+     * An open connection costs its buffers instead of a thread, so the number of clients is limited by file descriptors only.
+     * Handlers run on the loop threads and hold up the other connections of their loop while they run, slow notifications are
+     * best moved away with SetNotificationExecutor. Responses are collected completely before they are sent.
+     * Answers like HttpServer: HTTP-Status 200 for every JSON-RPC response, the specification for GET requests if enabled.
+     * Request bodies need a Content-Length header, SSL is not supported. Only available on Linux.
+     */
+    class EpollHttpServer: public AbstractServerConnector
+    {
+        public:
+            /**
+             * @param port - on which the server is listening.
+             * @param enableSpecification - defines if the specification is returned in case of a GET request.
+             * @param loops - number of event loop threads, 0 starts one per online processor.
+             */
+            EpollHttpServer(int port, bool enableSpecification = true, unsigned int loops = 0);
+            virtual ~EpollHttpServer();
+
+            virtual bool StartListening();
+            virtual bool StopListening();
+
+            bool virtual SendResponse(const std::string& response,
+                    void* addInfo = NULL);
+
+            bool virtual SendEvent(const std::string& data);
+
+            /**
+             * @brief Lets clients send further requests over the connection of their last one, including pipelined requests.
+             * Enabled by default. Must be called while the server is not listening.
+             * @param enabled - whether connections are kept open after a response.
+             * @param idleTimeout - milliseconds a connection may go without receiving or sending anything before it is closed.
+             * It applies to connections in the middle of a request as well.
+             * @param maxRequests - number of requests answered per connection before it is closed, 0 for no limit.
+             */
+            void SetKeepAlive(bool enabled, int idleTimeout = 30000, int maxRequests = 0);
+
+            /**
+             * @brief Acknowledges POST requests that hold only notifications with 204 No Content and runs their handlers on
+             * threads of their own, like HttpServer::SetNotificationExecutor. Must be called while the server is not listening.
+             * @param threads - number of threads running the notifications, 0 to run them on the event loop, which is the default.
+             * @param maxQueued - number of notification requests waiting for a thread beyond which policy applies, 0 for no limit.
+             * @param policy - OVERFLOW_DROP acknowledges and drops the notifications of a request finding the queue full,
+             * OVERFLOW_BLOCK holds up the event loop until there is room.
+             */
+            void SetNotificationExecutor(unsigned int threads, unsigned int maxQueued, overflowpolicy_t policy = OVERFLOW_DROP);
+
+            /**
+             * @return the number of connections that are open at the moment.
+             */
+            unsigned int GetConnectionCount() const;
+
+        protected:
+            /**
+             * @brief Serializes the response into the output buffer of the connection, it is sent once the event loop
+             * regains control. Requests holding only notifications are acknowledged before they run, if a notification
+             * executor is set.
+             */
+            virtual bool ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo);
+
+        private:
+            class Loop;
+            class Connection;
+
+            EpollHttpServer(const EpollHttpServer&);        // no implementation
+            void operator=(const EpollHttpServer&);         // no implementation
+
+            static void* Run(void* data);
+
+            /**
+             * @brief Stops and joins the first started loops, then closes every socket and deletes all loops.
+             */
+            void Stop(unsigned int started);
+
+            /**
+             * @brief Parses and answers the complete requests in data, received by connection.
+             * @return the number of bytes consumed, the rest is the beginning of a request that is not complete yet.
+             */
+            size_t Consume(Connection* connection, const char* data, size_t length);
+            /**
+             * @brief Parses the header of the request at the beginning of data, which ends at headerLength.
+             * @return false if it is malformed, an error response has been queued then.
+             */
+            bool ParseHeader(Connection* connection, const char* data, size_t headerLength);
+            void Dispatch(Connection* connection, const char* body, size_t length);
+            /**
+             * @brief Queues a response with status, which includes the reason phrase, and decides if the connection stays open.
+             */
+            void QueueResponse(Connection* connection, const char* status, const char* contentType, const char* body, size_t length);
+            void QueueError(Connection* connection, const char* status);
+
+            int port;
+            bool showSpec;
+            unsigned int loopCount;
+            bool running;
+            int listener;
+            int wakeup;
+            volatile int stopping;
+            volatile unsigned int connections;
+            bool keepAlive;
+            int keepAliveTimeout;
+            int maxKeepAliveRequests;
+            unsigned int notificationThreads;
+            unsigned int maxQueuedNotifications;
+            overflowpolicy_t notificationPolicy;
+            ThreadPool* notificationPool;
+            std::vector<Loop*> loops;
+    };
+
+} /* namespace jsonrpc */
+
+#endif /* __linux__ */
+#endif /* EPOLLHTTPSERVERCONNECTOR_H_ */
@@ -9,22 +9,152 @@
 
 #include "httpserver.h"
 #include "mongoose.h"
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+
+#define HTTP_RESPONSE_CHUNK_SIZE 16384
 
 namespace jsonrpc
 {
+    /**
+     * @return the value of the Connection header of the response to the current request of conn.
+     */
+    static const char* GetConnectionHeader(struct mg_connection* conn)
+    {
+        return mg_is_keep_alive(conn) ? "keep-alive" : "close";
+    }
+
+    /**
+     * @brief Sends a response to a mongoose connection while it is being serialized.
+     * A response that fits into the first chunk is sent with a Content-Length header as before,
+     * larger ones switch to chunked transfer encoding. HTTP/1.0 clients do not understand chunked
+     * responses, for them the whole response is collected and sent at once.
+     */
+    class HttpResponseSink : public Json::OutputSink
+    {
+        public:
+            HttpResponseSink(struct mg_connection* conn, bool allowChunked) :
+                conn(conn),
+                allowChunked(allowChunked),
+                chunked(false),
+                success(true)
+            {
+            }
+
+            virtual void write(const char* data, size_t length)
+            {
+                if (!this->chunked && (this->pending.empty() || !this->allowChunked))
+                {
+                    this->pending.append(data, length);
+                    return;
+                }
+                if (!this->chunked)
+                {
+                    //The header goes out together with the first chunk.
+                    this->chunked = true;
+                    this->frame = "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: application/json\r\n"
+                                  "Transfer-Encoding: chunked\r\n"
+                                  "Connection: ";
+                    this->frame += GetConnectionHeader(this->conn);
+                    this->frame += "\r\n\r\n";
+                    this->AppendChunk(this->pending.data(), this->pending.size());
+                    this->Send();
+                    std::string().swap(this->pending);
+                }
+                this->frame.clear();
+                this->AppendChunk(data, length);
+                this->Send();
+            }
+
+            bool Finish()
+            {
+                if (this->chunked)
+                {
+                    this->frame = "0\r\n\r\n";
+                }
+                else
+                {
+                    char header[160];
+                    snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: application/json\r\n"
+                             "Content-Length: %lu\r\n"
+                             "Connection: %s\r\n"
+                             "\r\n", (unsigned long)this->pending.size(), GetConnectionHeader(this->conn));
+                    this->frame = header;
+                    this->frame.append(this->pending);
+                }
+                this->Send();
+                return this->success;
+            }
+
+        private:
+            void AppendChunk(const char* data, size_t length)
+            {
+                char size[32];
+                snprintf(size, sizeof(size), "%lx\r\n", (unsigned long)length);
+                this->frame.append(size);
+                this->frame.append(data, length);
+                this->frame.append("\r\n", 2);
+            }
+
+            void Send()
+            {
+                //Once the client is gone, the rest of the response is dropped.
+                if (this->success)
+                {
+                    this->success = mg_write(this->conn, this->frame.data(), this->frame.size()) == (int)this->frame.size();
+                }
+            }
+
+            struct mg_connection* conn;
+            bool allowChunked;
+            bool chunked;
+            bool success;
+            std::string pending;
+            std::string frame;
+    };
+
+    /**
+     * @return the length of the request body of conn, 0 if there is none and -1 if its Content-Length header is malformed,
+     * negative or larger than INT_MAX.
+     */
+    static int GetContentLength(struct mg_connection* conn)
+    {
+        const char* header = mg_get_header(conn, "Content-Length");
+        if (header == NULL)
+        {
+            return 0;
+        }
+        char* end;
+        errno = 0;
+        unsigned long length = strtoul(header, &end, 10);
+        while (isspace((unsigned char) *end))
+        {
+            end++;
+        }
+        if (end == header || *end != '\0' || errno == ERANGE || strchr(header, '-') != NULL || length > INT_MAX)
+        {
+            return -1;
+        }
+        return (int) length;
+    }
+
     int HttpServer::callback(struct mg_connection *conn)
     {
         const struct mg_request_info *request_info = mg_get_request_info(conn);
         char* readBuffer = NULL;
-        int postSize = 0;
 
         HttpServer* _this = (HttpServer*) request_info->user_data;
 
         if (strcmp(request_info->request_method, "GET") == 0)
         {
+            //A body sent along is not read, mongoose skips it if it arrived completely and closes the connection otherwise.
             if(_this->showSpec)
             {
                 _this->SendResponse(_this->GetSpecification(), conn);
@@ -35,19 +165,23 @@ namespace jsonrpc
         }
         else if (strcmp(request_info->request_method, "POST") == 0)
         {
-            //get size of postData
-            const char* size_header = mg_get_header(conn, "Content-Length");
-            if (size_header != NULL)
+            //get size of postData, a body that is not read completely closes the connection after the response
+            int postSize = GetContentLength(conn);
+            if (postSize > 0 && (readBuffer = (char*) malloc(sizeof(char) * postSize)) != NULL)
             {
-                sscanf(size_header, "%d", &postSize);
-                readBuffer = (char*) malloc(sizeof(char) * (postSize + 1));
-                mg_read(conn, readBuffer, postSize);
-                _this->OnRequest(readBuffer, conn);
+                //The body is parsed where it was read, only the bytes mongoose delivered are passed on.
+                int received = 0;
+                int read;
+                while (received < postSize && (read = mg_read(conn, readBuffer + received, postSize - received)) > 0)
+                {
+                    received += read;
+                }
+                _this->OnRequest(readBuffer, received, conn);
                 free(readBuffer);
             }
             else
             {
-                _this->OnRequest("", conn);
+                _this->OnRequest("", 0, conn);
             }
 
 
@@ -67,7 +201,14 @@ namespace jsonrpc
         running(false),
         showSpec(enableSpecification),
         sslcert(sslcert),
-        threads(threads)
+        threads(threads),
+        keepAlive(true),
+        keepAliveTimeout(30000),
+        maxKeepAliveRequests(0),
+        notificationThreads(0),
+        maxQueuedNotifications(0),
+        notificationPolicy(OVERFLOW_DROP),
+        notificationPool(NULL)
     {
     }
 
@@ -82,24 +223,39 @@ namespace jsonrpc
         {
             char port[6];
             char threads[6];
+            char keepAliveTimeout[12];
+            char maxKeepAliveRequests[12];
             struct mg_callbacks callbacks;
             memset(&callbacks, 0, sizeof(callbacks));
             callbacks.begin_request = callback;
 
             sprintf(port, "%d", this->port);
             sprintf(threads, "%d", this->threads);
-
-            if(this->sslcert == "")
+            sprintf(keepAliveTimeout, "%d", this->keepAliveTimeout);
+            sprintf(maxKeepAliveRequests, "%d", this->maxKeepAliveRequests);
+            if (this->notificationThreads > 0)
             {
-                const char *options[] = { "listening_ports", port, "num_threads", threads, NULL };
-                this->ctx = mg_start(&callbacks, this, options);
+                this->notificationPool = new ThreadPool(this->notificationThreads, this->maxQueuedNotifications);
             }
-            else
+
+            std::vector<const char*> options;
+            options.push_back("listening_ports");
+            options.push_back(port);
+            options.push_back("num_threads");
+            options.push_back(threads);
+            options.push_back("enable_keep_alive");
+            options.push_back(this->keepAlive ? "yes" : "no");
+            options.push_back("keep_alive_timeout_ms");
+            options.push_back(keepAliveTimeout);
+            options.push_back("max_keep_alive_requests");
+            options.push_back(maxKeepAliveRequests);
+            if(this->sslcert != "")
             {
-                const char *options[] =
-                { "listening_ports", port, "ssl_certificate", "num_threads", threads, this->sslcert.c_str(), NULL };
-                this->ctx = mg_start(&callbacks, this, options);
+                options.push_back("ssl_certificate");
+                options.push_back(this->sslcert.c_str());
             }
+            options.push_back(NULL);
+            this->ctx = mg_start(&callbacks, this, &options[0]);
 
             if (this->ctx != NULL)
             {
@@ -108,6 +264,8 @@ namespace jsonrpc
             }
             else
             {
+                delete this->notificationPool;
+                this->notificationPool = NULL;
                 this->running = false;
                 return false;
             }
@@ -123,6 +281,9 @@ namespace jsonrpc
         if(this->running)
         {
             mg_stop(this->ctx);
+            //Runs the notifications that were acknowledged but are still queued.
+            delete this->notificationPool;
+            this->notificationPool = NULL;
             this->running = false;
             return true;
         }
@@ -135,8 +296,9 @@ namespace jsonrpc
         if (mg_printf(conn, "HTTP/1.1 200 OK\r\n"
                       "Content-Type: application/json\r\n"
                       "Content-Length: %d\r\n"
+                      "Connection: %s\r\n"
                       "\r\n"
-                      "%s",(int)response.length(), response.c_str()) > 0)
+                      "%s",(int)response.length(), GetConnectionHeader(conn), response.c_str()) > 0)
         {
             return true;
         }
@@ -146,6 +308,34 @@ namespace jsonrpc
         }
     }
 
+    bool HttpServer::ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo)
+    {
+        struct mg_connection* conn = (struct mg_connection*) addInfo;
+        if (this->notificationPool != NULL
+                && handler.HandleNotifications(request, length, *this->notificationPool, this->notificationPolicy))
+        {
+            return mg_printf(conn, "HTTP/1.1 204 No Content\r\nConnection: %s\r\n\r\n", GetConnectionHeader(conn)) > 0;
+        }
+        const char* version = mg_get_request_info(conn)->http_version;
+        HttpResponseSink sink(conn, version != NULL && strcmp(version, "1.0") != 0);
+        handler.HandleRequest(request, length, sink, HTTP_RESPONSE_CHUNK_SIZE);
+        return sink.Finish();
+    }
+
+    void HttpServer::SetKeepAlive(bool enabled, int idleTimeout, int maxRequests)
+    {
+        this->keepAlive = enabled;
+        this->keepAliveTimeout = idleTimeout;
+        this->maxKeepAliveRequests = maxRequests;
+    }
+
+    void HttpServer::SetNotificationExecutor(unsigned int threads, unsigned int maxQueued, overflowpolicy_t policy)
+    {
+        this->notificationThreads = threads;
+        this->maxQueuedNotifications = maxQueued;
+        this->notificationPolicy = policy;
+    }
+
     bool HttpServer::SendEvent(const std::string& data)
     {
     	return false;
@@ -12,6 +12,7 @@
 
 #include "mongoose.h"
 #include "../serverconnector.h"
+#include "../threadpool.h"
 
 namespace jsonrpc
 {
@@ -42,6 +43,39 @@ namespace jsonrpc
 
             bool virtual SendEvent(const std::string& data);
 
+            /**
+             * @brief Lets clients send further requests over the connection of their last one, including pipelined requests
+             * that were sent before the previous response arrived. Enabled by default. A kept alive connection occupies one of
+             * the threads while it waits for the next request, so idleTimeout should be short if there are more clients than threads.
+             * Must be called while the server is not listening.
+             * @param enabled - whether connections are kept open after a response.
+             * @param idleTimeout - milliseconds a connection waits for its next request before it is closed.
+             * @param maxRequests - number of requests answered per connection before it is closed, 0 for no limit.
+             */
+            void SetKeepAlive(bool enabled, int idleTimeout = 30000, int maxRequests = 0);
+
+            /**
+             * @brief Acknowledges POST requests that hold only notifications with 204 No Content right away and runs their
+             * handlers on threads of their own, so that the client does not wait for them. Errors of such notifications are
+             * never reported, like for any notification. The threads are started by StartListening and run the notifications
+             * still queued when StopListening is called. Must be called while the server is not listening.
+             * @param threads - number of threads running the notifications, 0 to run them before answering again, which is the default.
+             * @param maxQueued - number of notification requests waiting for a thread beyond which policy applies, 0 for no limit.
+             * @param policy - OVERFLOW_DROP acknowledges and drops the notifications of a request finding the queue full,
+             * OVERFLOW_BLOCK holds the acknowledgement back until there is room.
+             */
+            void SetNotificationExecutor(unsigned int threads, unsigned int maxQueued, overflowpolicy_t policy = OVERFLOW_DROP);
+
+        protected:
+            /**
+             * @brief Serializes the response straight into the connection. Responses that exceed one chunk
+             * are sent with chunked transfer encoding while they are written, so the memory needed per
+             * request does not grow with the size of the response. Mongoose answers a request on the thread
+             * that received it, so this thread waits for the asynchronous methods of the request. Requests holding
+             * only notifications are acknowledged before they run, if a notification executor is set.
+             */
+            virtual bool ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo);
+
         private:
             int port;
             struct mg_context *ctx;
@@ -49,6 +83,13 @@ namespace jsonrpc
             bool showSpec;
             std::string sslcert;
             int threads;
+            bool keepAlive;
+            int keepAliveTimeout;
+            int maxKeepAliveRequests;
+            unsigned int notificationThreads;
+            unsigned int maxQueuedNotifications;
+            overflowpolicy_t notificationPolicy;
+            ThreadPool* notificationPool;
 
             static int callback(struct mg_connection *conn);
 
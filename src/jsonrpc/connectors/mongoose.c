@@ -446,6 +446,7 @@ enum {
   GLOBAL_PASSWORDS_FILE, INDEX_FILES, ENABLE_KEEP_ALIVE, ACCESS_CONTROL_LIST,
   EXTRA_MIME_TYPES, LISTENING_PORTS, DOCUMENT_ROOT, SSL_CERTIFICATE,
   NUM_THREADS, RUN_AS_USER, REWRITE, HIDE_FILES, REQUEST_TIMEOUT,
+  KEEP_ALIVE_TIMEOUT, MAX_KEEP_ALIVE_REQUESTS,
   NUM_OPTIONS
 };
 
@@ -475,6 +476,8 @@ static const char *config_options[] = {
   "url_rewrite_patterns", NULL,
   "hide_files_patterns", NULL,
   "request_timeout_ms", "30000",
+  "keep_alive_timeout_ms", "30000",
+  "max_keep_alive_requests", "0",
   NULL
 };
 
@@ -519,6 +522,7 @@ struct mg_connection {
   int throttle;               // Throttling, bytes/sec. <= 0 means no throttle
   time_t last_throttle_time;  // Last time throttled data was sent
   int64_t last_throttle_bytes;// Bytes sent this second
+  int num_requests;           // Requests received on this connection
 };
 
 const char **mg_get_valid_option_names(void) {
@@ -912,9 +916,11 @@ static int match_prefix(const char *pattern, int pattern_len, const char *str) {
 static int should_keep_alive(const struct mg_connection *conn) {
   const char *http_version = conn->request_info.http_version;
   const char *header = mg_get_header(conn, "Connection");
+  int max_requests = atoi(conn->ctx->config[MAX_KEEP_ALIVE_REQUESTS]);
   if (conn->must_close ||
       conn->status_code == 401 ||
       mg_strcasecmp(conn->ctx->config[ENABLE_KEEP_ALIVE], "yes") != 0 ||
+      (max_requests > 0 && conn->num_requests >= max_requests) ||
       (header != NULL && mg_strcasecmp(header, "keep-alive") != 0) ||
       (header == NULL && http_version && strcmp(http_version, "1.1"))) {
     return 0;
@@ -926,6 +932,20 @@ static const char *suggest_connection_header(const struct mg_connection *conn) {
   return should_keep_alive(conn) ? "keep-alive" : "close";
 }
 
+// Return 1 if the body of the current request has been read completely or
+// is buffered completely, so that the next request starts right after it.
+// Otherwise the rest of the body would be taken for the next request.
+static int is_body_drained(const struct mg_connection *conn) {
+  return conn->content_len >= 0 &&
+    (conn->consumed_content == conn->content_len ||
+     conn->request_len + conn->content_len <= (int64_t) conn->data_len);
+}
+
+int mg_is_keep_alive(const struct mg_connection *conn) {
+  return conn->ctx->stop_flag == 0 && is_body_drained(conn) &&
+    should_keep_alive(conn);
+}
+
 static void send_http_error(struct mg_connection *, int, const char *,
                             PRINTF_FORMAT_STRING(const char *fmt), ...)
   PRINTF_ARGS(4, 5);
@@ -4984,7 +5004,17 @@ static int getreq(struct mg_connection *conn, char *ebuf, size_t ebuf_len) {
   } else {
     // Request is valid
     if ((cl = get_header(&conn->request_info, "Content-Length")) != NULL) {
-      conn->content_len = strtoll(cl, NULL, 10);
+      char *end;
+      errno = 0;
+      conn->content_len = strtoll(cl, &end, 10);
+      while (isspace(* (unsigned char *) end)) {
+        end++;
+      }
+      // The end of the body is unknown, the connection is closed afterwards
+      if (end == cl || *end != '\0' || errno == ERANGE ||
+          conn->content_len < 0) {
+        conn->content_len = -1;
+      }
     } else if (!mg_strcasecmp(conn->request_info.request_method, "POST") ||
                !mg_strcasecmp(conn->request_info.request_method, "PUT")) {
       conn->content_len = -1;
@@ -5018,6 +5048,33 @@ struct mg_connection *mg_download(const char *host, int port, int use_ssl,
   return conn;
 }
 
+// Wait until the next request of a kept alive connection arrives. Polls in
+// short slices, so that an idle connection does not delay mg_stop().
+// Return 1 if the request can be read, 0 if the connection has been idle for
+// keep_alive_timeout_ms or the server is stopping.
+static int wait_for_next_request(struct mg_connection *conn) {
+  struct pollfd pfd;
+  int idle_ms = 0, timeout_ms = atoi(conn->ctx->config[KEEP_ALIVE_TIMEOUT]);
+
+  // Pipelined requests are already buffered. SSL may buffer data the socket
+  // does not show, such a connection waits in the read instead.
+  if (conn->data_len > 0 || conn->ssl != NULL) {
+    return 1;
+  }
+  pfd.fd = conn->client.sock;
+  pfd.events = POLLIN;
+  while (conn->ctx->stop_flag == 0 && idle_ms < timeout_ms) {
+    int slice_ms = timeout_ms - idle_ms < 200 ? timeout_ms - idle_ms : 200;
+    if (poll(&pfd, 1, slice_ms) != 0) {
+      // A client closing its idle connection is not an error
+      char c;
+      return recv(conn->client.sock, &c, 1, MSG_PEEK) > 0;
+    }
+    idle_ms += slice_ms;
+  }
+  return 0;
+}
+
 static void process_new_connection(struct mg_connection *conn) {
   struct mg_request_info *ri = &conn->request_info;
   int keep_alive_enabled, keep_alive, discard_len;
@@ -5029,7 +5086,11 @@ static void process_new_connection(struct mg_connection *conn) {
   // Important: on new connection, reset the receiving buffer. Credit goes
   // to crule42.
   conn->data_len = 0;
+  conn->num_requests = 0;
   do {
+    if (conn->num_requests > 0 && !wait_for_next_request(conn)) {
+      break;
+    }
     if (!getreq(conn, ebuf, sizeof(ebuf))) {
       send_http_error(conn, 500, "Server Error", "%s", ebuf);
       conn->must_close = 1;
@@ -5043,6 +5104,7 @@ static void process_new_connection(struct mg_connection *conn) {
     }
 
     if (ebuf[0] == '\0') {
+      conn->num_requests++;
       handle_request(conn);
       if (conn->ctx->callbacks.end_request != NULL) {
         conn->ctx->callbacks.end_request(conn, conn->status_code);
@@ -5059,7 +5121,7 @@ static void process_new_connection(struct mg_connection *conn) {
     // Therefore, memorize should_keep_alive() result now for later use
     // in loop exit condition.
     keep_alive = conn->ctx->stop_flag == 0 && keep_alive_enabled &&
-      conn->content_len >= 0 && should_keep_alive(conn);
+      is_body_drained(conn) && should_keep_alive(conn);
 
     // Discard all buffered data for this request
     discard_len = conn->content_len >= 0 && conn->request_len > 0 &&
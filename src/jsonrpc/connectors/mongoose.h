@@ -242,6 +242,14 @@ void mg_send_file(struct mg_connection *conn, const char *path);
 int mg_read(struct mg_connection *, void *buf, size_t len);
 
 
+// Return 1 if the connection stays open for another request once the
+// current one is answered, 0 if it will be closed. That includes requests
+// whose body has not been read completely with mg_read() yet. Callbacks that
+// write their own response headers use it to send the matching "Connection:"
+// header after reading the body.
+int mg_is_keep_alive(const struct mg_connection *conn);
+
+
 // Get the value of particular HTTP header.
 //
 // This is a helper function. It traverses request_info->http_headers array,
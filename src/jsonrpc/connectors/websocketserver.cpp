@@ -53,8 +53,161 @@
 
 #define WS_FRAME_PAYLOAD_LENGTH_INDEX           1
 
+#define WS_RESPONSE_CHUNK_SIZE                  16384
+
 namespace jsonrpc
 {
+    /**
+     * @brief Sends a response to a websocket connection while it is being serialized.
+     * A response that fits into the first chunk is sent as a single text frame, larger ones
+     * are fragmented into a text frame, continuation frames and an empty final frame.
+     */
+    class WebsocketServer::ResponseSink : public Json::OutputSink
+    {
+        public:
+            ResponseSink(WebsocketServer* server, struct mg_connection* conn) :
+                server(server),
+                conn(conn),
+                fragmented(false),
+                success(true)
+            {
+            }
+
+            virtual void write(const char* data, size_t length)
+            {
+                if (!this->fragmented && this->pending.empty())
+                {
+                    this->pending.assign(data, length);
+                    return;
+                }
+                if (!this->fragmented)
+                {
+                    this->fragmented = true;
+                    this->Send(WS_OPCODE_TEXT, this->pending.data(), this->pending.size());
+                    std::string().swap(this->pending);
+                }
+                this->Send(WS_OPCODE_CONTINUATION, data, length);
+            }
+
+            bool Finish()
+            {
+                if (this->fragmented)
+                {
+                    this->Send(WS_FRAME_FIN + WS_OPCODE_CONTINUATION, NULL, 0);
+                }
+                else
+                {
+                    this->Send(WS_FRAME_FIN + WS_OPCODE_TEXT, this->pending.data(), this->pending.size());
+                }
+                return this->success;
+            }
+
+        private:
+            void Send(const unsigned int frameHeader, const char* data, size_t length)
+            {
+                //Once the client is gone, the rest of the response is dropped.
+                if (this->success)
+                {
+                    this->success = this->server->SendFrame(this->conn, frameHeader, data, length);
+                }
+            }
+
+            WebsocketServer* server;
+            struct mg_connection* conn;
+            bool fragmented;
+            bool success;
+            std::string pending;
+    };
+
+    /**
+     * @brief Send state of an open websocket connection. Whoever sends holds the lock for a whole message,
+     * the connection is marked closed before mongoose reuses it. It is reference counted, because
+     * responses may still be pending when the connection is closed.
+     */
+    class WebsocketServer::Connection
+    {
+        public:
+            Connection(struct mg_connection* conn) :
+                conn(conn),
+                open(true),
+                references(1)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+            }
+
+            ~Connection()
+            {
+                pthread_mutex_destroy(&this->mutex);
+            }
+
+            void Reference()
+            {
+                __sync_add_and_fetch(&this->references, 1);
+            }
+
+            void Unreference()
+            {
+                if (__sync_sub_and_fetch(&this->references, 1) == 0)
+                {
+                    delete this;
+                }
+            }
+
+            void Lock()
+            {
+                pthread_mutex_lock(&this->mutex);
+            }
+
+            void Unlock()
+            {
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            struct mg_connection* conn;
+            /**
+             * Guarded by the lock.
+             */
+            bool open;
+
+        private:
+            volatile int references;
+            pthread_mutex_t mutex;
+    };
+
+    /**
+     * @brief Sends the response of a request to its connection, on whichever thread it was completed.
+     */
+    class WebsocketServer::ResponseSender : public AbstractResponseHandler
+    {
+        public:
+            ResponseSender(WebsocketServer* server, Connection* connection) :
+                server(server),
+                connection(connection)
+            {
+            }
+
+            virtual ~ResponseSender()
+            {
+                this->connection->Unreference();
+            }
+
+            virtual void OnResponse(ProtocolContext& context, const Json::Value& response)
+            {
+                this->connection->Lock();
+                if (this->connection->open)
+                {
+                    ResponseSink sink(this->server, this->connection->conn);
+                    context.Write(response, sink, WS_RESPONSE_CHUNK_SIZE);
+                    sink.Finish();
+                }
+                this->connection->Unlock();
+            }
+
+        private:
+            WebsocketServer* server;
+            Connection* connection;
+    };
+
     void* WebsocketServer::sendContinuousPing(void* data)
     {
 
@@ -155,7 +308,8 @@ namespace jsonrpc
         else if (opCode == WS_OPCODE_TEXT)
         {
             jsonrpc::debug_log("[WebsocketServer.OpCode] Text data received");
-            source->OnRequest(data, connection);
+            //The frame is parsed where mongoose received it, it is not terminated.
+            source->OnRequest(data, data_len, connection);
 
         }
         else if (opCode == WS_OPCODE_BINARY)
@@ -203,6 +357,17 @@ namespace jsonrpc
 
         source->_wsConnections.push_back(wsConnection);
 
+        pthread_mutex_lock(&source->_connectionsMutex);
+        source->_connections[connection] = new Connection(connection);
+        pthread_mutex_unlock(&source->_connectionsMutex);
+    }
+
+    void WebsocketServer::websocketEndRequestCallback(const struct mg_connection *connection, int statusCode)
+    {
+        //Mongoose reuses the connection for the next client once this callback returns.
+        struct mg_connection* conn = (struct mg_connection*) connection;
+        WebsocketServer* source = (WebsocketServer*) mg_get_request_info(conn)->user_data;
+        source->CloseConnection(conn);
     }
 
     int WebsocketServer::websocketConnectCallback(const struct mg_connection *connection)
@@ -240,12 +405,17 @@ namespace jsonrpc
               _connMaintainerThread(-1),
               _ctx(NULL)
     {
-
+        pthread_mutex_init(&this->_connectionsMutex, NULL);
     }
 
     WebsocketServer::~WebsocketServer()
     {
         this->StopListening();
+        while (!this->_connections.empty())
+        {
+            this->CloseConnection(this->_connections.begin()->first);
+        }
+        pthread_mutex_destroy(&this->_connectionsMutex);
     }
 
     void WebsocketServer::SendPingBroadcast()
@@ -299,6 +469,7 @@ namespace jsonrpc
         wsCallbacks.websocket_data = websocketDataCallback;
         wsCallbacks.websocket_ready = websocketReadyCallback;
         wsCallbacks.begin_request = websocketConnectionRequestCallback;
+        wsCallbacks.end_request = websocketEndRequestCallback;
 
         snprintf(port, sizeof(port), "%d", this->_port);
         snprintf(threads, sizeof(threads), "%d", this->_numThreads);
@@ -336,6 +507,19 @@ namespace jsonrpc
         return this->SendData(conn, WS_OPCODE_TEXT, response);
     }
 
+    bool WebsocketServer::ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo)
+    {
+        Connection* connection = this->AcquireConnection((struct mg_connection*) addInfo);
+        if (connection == NULL)
+        {
+            return false;
+        }
+        //The mongoose thread goes on reading the next requests of this connection
+        //while asynchronous methods of this one are still running.
+        handler.HandleRequest(request, length, new ResponseSender(this, connection));
+        return true;
+    }
+
     bool WebsocketServer::SendEvent(const std::string& event)
     {
     	bool result = false;
@@ -423,17 +607,36 @@ namespace jsonrpc
      */
 
     bool WebsocketServer::SendData(struct mg_connection* connection, const unsigned int opCode, const std::string& data)
+    {
+        Connection* state = this->AcquireConnection(connection);
+        if (state == NULL)
+        {
+            return this->SendFrame(connection, WS_FRAME_FIN + (opCode & 0x0f), data.c_str(), data.length());
+        }
+        //Keeps the frame out of responses that are sent by other threads.
+        bool result = false;
+        state->Lock();
+        if (state->open)
+        {
+            result = this->SendFrame(connection, WS_FRAME_FIN + (opCode & 0x0f), data.c_str(), data.length());
+        }
+        state->Unlock();
+        state->Unreference();
+        return result;
+    }
+
+    bool WebsocketServer::SendFrame(struct mg_connection* connection, const unsigned int frameHeader, const char* data, size_t length)
     {
         int bytesSent = -1;
 
         unsigned char* buff;
-        size_t buffLength = data.length();
+        size_t buffLength = length;
         int extendedHeaderLength = 0;
 
         buff = (unsigned char*) malloc(buffLength + WS_FRAME_LENGTH);
 
         //add FIN, OPCODE etc.
-        buff[0] = WS_FRAME_FIN + (opCode & 0x0f);
+        buff[0] = frameHeader;
 
         //we have to check ifbuffLength the payload fits in the 7 bit payload field
         if (buffLength < WS_PAYLOAD_LENGTH_7BIT)
@@ -469,7 +672,10 @@ namespace jsonrpc
             extendedHeaderLength = 10;
         }
 
-        memcpy(buff + extendedHeaderLength, data.c_str(), buffLength);
+        if (buffLength > 0)
+        {
+            memcpy(buff + extendedHeaderLength, data, buffLength);
+        }
         bytesSent = mg_write(connection, buff, buffLength + extendedHeaderLength);
 
         if(jsonrpc::debug_enabled() && bytesSent > 0)
@@ -483,7 +689,7 @@ namespace jsonrpc
                 payload.append(tmp);
             }
             payload.erase(payload.size() -1);
-            jsonrpc::debug_log("[WebsocketServer.SendData] <%d> bytes sent; payload <%s>", bytesSent, payload.c_str());
+            jsonrpc::debug_log("[WebsocketServer.SendFrame] <%d> bytes sent; payload <%s>", bytesSent, payload.c_str());
         }
 
         free(buff);
@@ -526,13 +732,50 @@ namespace jsonrpc
             }
 
             this->_wsConnections.erase(it);
-            mg_close_connection(it->conn);
+            this->CloseConnection(connection);
+            mg_close_connection(connection);
             result = true;
         }
 
         return result;
     }
 
+    WebsocketServer::Connection* WebsocketServer::AcquireConnection(struct mg_connection* conn)
+    {
+        Connection* connection = NULL;
+        pthread_mutex_lock(&this->_connectionsMutex);
+        connectionMap::iterator it = this->_connections.find(conn);
+        if (it != this->_connections.end())
+        {
+            connection = it->second;
+            connection->Reference();
+        }
+        pthread_mutex_unlock(&this->_connectionsMutex);
+        return connection;
+    }
+
+    void WebsocketServer::CloseConnection(struct mg_connection* conn)
+    {
+        Connection* connection = NULL;
+        pthread_mutex_lock(&this->_connectionsMutex);
+        connectionMap::iterator it = this->_connections.find(conn);
+        if (it != this->_connections.end())
+        {
+            connection = it->second;
+            this->_connections.erase(it);
+        }
+        pthread_mutex_unlock(&this->_connectionsMutex);
+
+        if (connection != NULL)
+        {
+            //Waits for a response that is currently being sent.
+            connection->Lock();
+            connection->open = false;
+            connection->Unlock();
+            connection->Unreference();
+        }
+    }
+
     bool WebsocketServer::IsClientMaintenanceThreadRunning()
     {
         return (this->_connMaintainerThread != -1);
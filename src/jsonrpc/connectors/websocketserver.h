@@ -11,6 +11,8 @@
 #define WEBSOCKETSERVER_H_
 
 #include <list>
+#include <map>
+#include <pthread.h>
 
 #include "mongoose.h"
 #include "../serverconnector.h"
@@ -66,7 +68,21 @@ namespace jsonrpc
 
             bool virtual SendEvent(const std::string& resonse);
 
+        protected:
+            /**
+             * @brief Dispatches the request and returns without waiting for its response. The response is serialized
+             * straight into the connection once all its asynchronous methods are completed, so responses of one
+             * connection may be sent in a different order than their requests arrived. Responses that exceed one chunk
+             * are sent as a fragmented message while they are written.
+             */
+            virtual bool ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo);
+
         private:
+            class ResponseSink;
+            class Connection;
+            class ResponseSender;
+
+            typedef std::map<struct mg_connection*, Connection*> connectionMap;
 
             unsigned int _port;
             std::string _protocol;
@@ -76,6 +92,12 @@ namespace jsonrpc
             unsigned int _numThreads;
             int _connMaintainerThread;
             websocketConnectionList _wsConnections;
+            /**
+             * Send state of the open websocket connections, used to serialize frames sent by different threads
+             * and to drop responses completed after their connection was closed.
+             */
+            connectionMap _connections;
+            pthread_mutex_t _connectionsMutex;
 
             struct mg_context *_ctx;
 
@@ -83,6 +105,7 @@ namespace jsonrpc
             bool SendPong(struct mg_connection*);
 
             bool SendData(struct mg_connection*, const unsigned int opCode, const std::string& data);
+            bool SendFrame(struct mg_connection*, const unsigned int frameHeader, const char* data, size_t length);
 
             bool IsClientMaintenanceThreadRunning();
             void StartMaintenanceThread();
@@ -90,6 +113,12 @@ namespace jsonrpc
 
             bool RemoveConnection(struct mg_connection*);
 
+            /**
+             * @return the referenced send state of an open connection, NULL if the connection is closed.
+             */
+            Connection* AcquireConnection(struct mg_connection*);
+            void CloseConnection(struct mg_connection*);
+
             static void handleWebsocketStatusCode(const int statusCode, struct mg_connection* connection);
 
             /**
@@ -119,6 +148,13 @@ namespace jsonrpc
              */
             static void websocketReadyCallback(struct mg_connection *connection);
 
+            /**
+             * @brief Callback that indicates that a request, including a whole websocket session, is finished.
+             * @param connection - mg_connection that represents the current connection.
+             * @param statusCode - int HTTP status code of the reply
+             */
+            static void websocketEndRequestCallback(const struct mg_connection *connection, int statusCode);
+
             /**
              * @brief Utility method that verifies a connection in order to distinguish between websocket and a plain HTTP connection.
              * @param connection - mg_connection that represents the current connection.
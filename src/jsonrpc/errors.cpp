@@ -10,9 +10,13 @@
 #include "errors.h"
 #include "exception.h"
 
+#include <cstring>
+#include <sstream>
+
 namespace jsonrpc
 {
     std::map<int, std::string> Errors::possibleErrors;
+    std::map<int, std::string> Errors::serializedErrors;
     Errors::_init Errors::_initializer;
 
     const int Errors::ERROR_RPC_JSON_PARSE_ERROR =  -32700;
@@ -27,6 +31,8 @@ namespace jsonrpc
     const int Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_NOT_FOUND =    -32000;
     const int Errors::ERROR_SERVER_CONNECTOR =                            -32002;
     const int Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX =       -32007;
+    const int Errors::ERROR_SERVER_BUSY =                                 -32008;
+    const int Errors::ERROR_SERVER_PROCEDURE_BUSY =                       -32009;
 
     const int Errors::ERROR_CLIENT_CONNECTOR =   -32003;
     const int Errors::ERROR_CLIENT_INVALID_RESPONSE =     -32001;
@@ -56,22 +62,37 @@ namespace jsonrpc
         possibleErrors[ERROR_CLIENT_INVALID_RESPONSE] = "The response is invalid";
         possibleErrors[ERROR_CLIENT_CONNECTOR] = "Client connector error";
         possibleErrors[ERROR_SERVER_CONNECTOR] = "Server connector error";
+        possibleErrors[ERROR_SERVER_BUSY] = "SERVER_BUSY: The server is overloaded, try again later";
+        possibleErrors[ERROR_SERVER_PROCEDURE_BUSY] =
+                "PROCEDURE_BUSY: Too many calls of the requested procedure are in progress, try again later";
+
+        //Rendered like Json::FastWriter would, with the members in name order
+        for (std::map<int, std::string>::const_iterator it = possibleErrors.begin(); it != possibleErrors.end(); it++)
+        {
+            std::stringstream serialized;
+            serialized << "{\"code\":" << it->first << ",\"message\":" << Json::valueToQuotedString(it->second.c_str()) << "}";
+            serializedErrors[it->first] = serialized.str();
+        }
     }
 
     Json::Value Errors::GetErrorBlock(const Json::Value& request, const int& errorCode)
     {
+        //Neither the member names nor the messages are copied into the block.
         Json::Value error;
-        error["jsonrpc"] = "2.0";
-        error["error"]["code"] = errorCode;
-        error["error"]["message"] = GetErrorMessage(errorCode);
+        error[Json::StaticString("jsonrpc")] = Json::StaticString("2.0");
+        Json::Value& block = error[Json::StaticString("error")];
+        block[Json::StaticString("code")] = errorCode;
+        std::map<int, std::string>::const_iterator message = possibleErrors.find(errorCode);
+        block[Json::StaticString("message")] = Json::StaticString(message != possibleErrors.end() ? message->second.c_str() : "");
 
-        if(request["id"].isNull() || request["id"].isInt() || request["id"].isUInt() || request["id"].isString())
+        const Json::Value& id = request["id"];
+        if(id.isNull() || id.isInt() || id.isUInt() || id.isString())
         {
-            error["id"] = request["id"];
+            error[Json::StaticString("id")] = id;
         }
         else
         {
-            error["id"] = Json::nullValue;
+            error[Json::StaticString("id")] = Json::nullValue;
         }
         return error;
     }
@@ -94,5 +115,27 @@ namespace jsonrpc
         return possibleErrors[errorCode];
     }
 
+    const char* Errors::GetSerializedError(const Json::Value& error)
+    {
+        if (!error.isObject() || error.size() != 2 || !error["code"].isInt() || !error["message"].isString())
+        {
+            return NULL;
+        }
+        int code = error["code"].asInt();
+        std::map<int, std::string>::const_iterator serialized = serializedErrors.find(code);
+        if (serialized == serializedErrors.end())
+        {
+            return NULL;
+        }
+        //Blocks from GetErrorBlock point at the message itself, others are compared
+        const char* message = error["message"].asCString();
+        const std::string& expected = possibleErrors.find(code)->second;
+        if (message != expected.c_str() && strcmp(message, expected.c_str()) != 0)
+        {
+            return NULL;
+        }
+        return serialized->second.c_str();
+    }
+
 
 } /* namespace jsonrpc */
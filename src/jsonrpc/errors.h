@@ -40,6 +40,13 @@ namespace jsonrpc
              */
             static std::string GetErrorMessage(int errorCode);
 
+            /**
+             * @param error - the error object of an error block, e.g. \code response["error"] \endcode
+             * @return the error object serialized, if it holds a known code with its unchanged message, NULL otherwise.
+             * The serialized error objects are rendered once, so that error responses are written without serializing them.
+             */
+            static const char* GetSerializedError(const Json::Value& error);
+
             static class _init
             {
                 public:
@@ -64,6 +71,8 @@ namespace jsonrpc
             static const int ERROR_SERVER_PROCEDURE_SPECIFICATION_NOT_FOUND;
             static const int ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX;
             static const int ERROR_SERVER_CONNECTOR;
+            static const int ERROR_SERVER_BUSY;
+            static const int ERROR_SERVER_PROCEDURE_BUSY;
 
             /**
              * Client Library Errors
@@ -72,6 +81,7 @@ namespace jsonrpc
             static const int ERROR_CLIENT_INVALID_RESPONSE;
         private:
             static std::map<int, std::string> possibleErrors;
+            static std::map<int, std::string> serializedErrors;
     };
 } /* namespace jsonrpc */
 #endif /* ERRORS_H_ */
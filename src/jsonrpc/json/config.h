@@ -6,18 +6,6 @@
 
 /// If defined, indicates that json may leverage CppTL library
 //#  define JSON_USE_CPPTL 1
-/// If defined, indicates that cpptl vector based map should be used instead of std::map
-/// as Value container.
-//#  define JSON_USE_CPPTL_SMALLMAP 1
-/// If defined, indicates that Json specific container should be used
-/// (hash table & simple deque container with customizable allocator).
-/// THIS FEATURE IS STILL EXPERIMENTAL!
-//#  define JSON_VALUE_USE_INTERNAL_MAP 1
-/// Force usage of standard new/malloc based allocator instead of memory pool based allocator.
-/// The memory pools allocator used optimization (initializing Value and ValueInternalLink
-/// as if it was a POD) that may cause some validation tool to report errors.
-/// Only has effects if JSON_VALUE_USE_INTERNAL_MAP is defined.
-//#  define JSON_USE_SIMPLE_INTERNAL_ALLOCATOR 1
 
 /// If defined, indicates that Json use exception to report invalid type manipulation
 /// instead of C assert macro.
@@ -30,6 +18,13 @@
 #  endif
 # endif
 
+/// If defined, Value provides move construction, move assignment and an rvalue append().
+/// Detected from the compiler of the including code, which is safe because those members are
+/// defined inline in value.h. Code that must also build as C++03 should use Value::swap().
+# if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#  define JSON_HAS_RVALUE_REFERENCES 1
+# endif
+
 # ifdef JSON_IN_CPPTL
 #  define JSON_API CPPTL_API
 # elif defined(JSON_DLL_BUILD)
@@ -18,20 +18,24 @@ namespace Json {
    // value.h
    typedef int Int;
    typedef unsigned int UInt;
+# if defined(_MSC_VER)
+   typedef __int64 Int64;
+   typedef unsigned __int64 UInt64;
+# else
+   typedef long long int Int64;
+   typedef unsigned long long int UInt64;
+# endif
    class StaticString;
+   class MemberKey;
+   class ValueArena;
+   class ValueArenaScope;
    class Path;
    class PathArgument;
    class Value;
    class ValueIteratorBase;
    class ValueIterator;
    class ValueConstIterator;
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
-   class ValueAllocator;
-   class ValueMapAllocator;
-   class ValueInternalLink;
-   class ValueInternalArray;
-   class ValueInternalMap;
-#endif // #ifdef JSON_VALUE_USE_INTERNAL_MAP
+   class ValueObjectMap;
 
 } // namespace Json
 
@@ -0,0 +1,431 @@
+// included by json_writer.cpp
+// everything is within Json namespace
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// Double formatting
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// Binary to decimal conversion with Loitsch's Grisu3: the boundaries of
+// the rounding interval of a double are scaled by a cached power of ten
+// into a 64 bit fixed point range, and digits are generated until the
+// remainder lies within the interval. Grisu3 knows when the imprecision
+// of the scaling could make its digits longer or farther from the value
+// than necessary, and leaves those values to printf(). The result is the
+// shortest string that reads back as the same double.
+
+/// Floating point number f * 2^e with a 64 bit significand.
+struct DiyFp
+{
+   DiyFp( UInt64 significand = 0, int exponent = 0 )
+      : f( significand )
+      , e( exponent )
+   {
+   }
+
+   UInt64 f;
+   int e;
+};
+
+static const int diyFpSignificandSize = 64;
+static const int doubleSignificandSize = 52;
+static const int doubleExponentBias = 0x3ff + doubleSignificandSize;
+static const UInt64 doubleHiddenBit = UInt64( 1 ) << doubleSignificandSize;
+
+// 10^k for k = -348, -340, ..., 340 rounded to 64 bits, as { f, e }.
+static const struct
+{
+   UInt64 f;
+   int e;
+} cachedPowers[] =
+{
+   { 0xfa8fd5a0081c0288ULL, -1220 }, // 1e-348
+   { 0xbaaee17fa23ebf76ULL, -1193 }, // 1e-340
+   { 0x8b16fb203055ac76ULL, -1166 }, // 1e-332
+   { 0xcf42894a5dce35eaULL, -1140 }, // 1e-324
+   { 0x9a6bb0aa55653b2dULL, -1113 }, // 1e-316
+   { 0xe61acf033d1a45dfULL, -1087 }, // 1e-308
+   { 0xab70fe17c79ac6caULL, -1060 }, // 1e-300
+   { 0xff77b1fcbebcdc4fULL, -1034 }, // 1e-292
+   { 0xbe5691ef416bd60cULL, -1007 }, // 1e-284
+   { 0x8dd01fad907ffc3cULL,  -980 }, // 1e-276
+   { 0xd3515c2831559a83ULL,  -954 }, // 1e-268
+   { 0x9d71ac8fada6c9b5ULL,  -927 }, // 1e-260
+   { 0xea9c227723ee8bcbULL,  -901 }, // 1e-252
+   { 0xaecc49914078536dULL,  -874 }, // 1e-244
+   { 0x823c12795db6ce57ULL,  -847 }, // 1e-236
+   { 0xc21094364dfb5637ULL,  -821 }, // 1e-228
+   { 0x9096ea6f3848984fULL,  -794 }, // 1e-220
+   { 0xd77485cb25823ac7ULL,  -768 }, // 1e-212
+   { 0xa086cfcd97bf97f4ULL,  -741 }, // 1e-204
+   { 0xef340a98172aace5ULL,  -715 }, // 1e-196
+   { 0xb23867fb2a35b28eULL,  -688 }, // 1e-188
+   { 0x84c8d4dfd2c63f3bULL,  -661 }, // 1e-180
+   { 0xc5dd44271ad3cdbaULL,  -635 }, // 1e-172
+   { 0x936b9fcebb25c996ULL,  -608 }, // 1e-164
+   { 0xdbac6c247d62a584ULL,  -582 }, // 1e-156
+   { 0xa3ab66580d5fdaf6ULL,  -555 }, // 1e-148
+   { 0xf3e2f893dec3f126ULL,  -529 }, // 1e-140
+   { 0xb5b5ada8aaff80b8ULL,  -502 }, // 1e-132
+   { 0x87625f056c7c4a8bULL,  -475 }, // 1e-124
+   { 0xc9bcff6034c13053ULL,  -449 }, // 1e-116
+   { 0x964e858c91ba2655ULL,  -422 }, // 1e-108
+   { 0xdff9772470297ebdULL,  -396 }, // 1e-100
+   { 0xa6dfbd9fb8e5b88fULL,  -369 }, // 1e-92
+   { 0xf8a95fcf88747d94ULL,  -343 }, // 1e-84
+   { 0xb94470938fa89bcfULL,  -316 }, // 1e-76
+   { 0x8a08f0f8bf0f156bULL,  -289 }, // 1e-68
+   { 0xcdb02555653131b6ULL,  -263 }, // 1e-60
+   { 0x993fe2c6d07b7facULL,  -236 }, // 1e-52
+   { 0xe45c10c42a2b3b06ULL,  -210 }, // 1e-44
+   { 0xaa242499697392d3ULL,  -183 }, // 1e-36
+   { 0xfd87b5f28300ca0eULL,  -157 }, // 1e-28
+   { 0xbce5086492111aebULL,  -130 }, // 1e-20
+   { 0x8cbccc096f5088ccULL,  -103 }, // 1e-12
+   { 0xd1b71758e219652cULL,   -77 }, // 1e-4
+   { 0x9c40000000000000ULL,   -50 }, // 1e4
+   { 0xe8d4a51000000000ULL,   -24 }, // 1e12
+   { 0xad78ebc5ac620000ULL,     3 }, // 1e20
+   { 0x813f3978f8940984ULL,    30 }, // 1e28
+   { 0xc097ce7bc90715b3ULL,    56 }, // 1e36
+   { 0x8f7e32ce7bea5c70ULL,    83 }, // 1e44
+   { 0xd5d238a4abe98068ULL,   109 }, // 1e52
+   { 0x9f4f2726179a2245ULL,   136 }, // 1e60
+   { 0xed63a231d4c4fb27ULL,   162 }, // 1e68
+   { 0xb0de65388cc8ada8ULL,   189 }, // 1e76
+   { 0x83c7088e1aab65dbULL,   216 }, // 1e84
+   { 0xc45d1df942711d9aULL,   242 }, // 1e92
+   { 0x924d692ca61be758ULL,   269 }, // 1e100
+   { 0xda01ee641a708deaULL,   295 }, // 1e108
+   { 0xa26da3999aef774aULL,   322 }, // 1e116
+   { 0xf209787bb47d6b85ULL,   348 }, // 1e124
+   { 0xb454e4a179dd1877ULL,   375 }, // 1e132
+   { 0x865b86925b9bc5c2ULL,   402 }, // 1e140
+   { 0xc83553c5c8965d3dULL,   428 }, // 1e148
+   { 0x952ab45cfa97a0b3ULL,   455 }, // 1e156
+   { 0xde469fbd99a05fe3ULL,   481 }, // 1e164
+   { 0xa59bc234db398c25ULL,   508 }, // 1e172
+   { 0xf6c69a72a3989f5cULL,   534 }, // 1e180
+   { 0xb7dcbf5354e9beceULL,   561 }, // 1e188
+   { 0x88fcf317f22241e2ULL,   588 }, // 1e196
+   { 0xcc20ce9bd35c78a5ULL,   614 }, // 1e204
+   { 0x98165af37b2153dfULL,   641 }, // 1e212
+   { 0xe2a0b5dc971f303aULL,   667 }, // 1e220
+   { 0xa8d9d1535ce3b396ULL,   694 }, // 1e228
+   { 0xfb9b7cd9a4a7443cULL,   720 }, // 1e236
+   { 0xbb764c4ca7a44410ULL,   747 }, // 1e244
+   { 0x8bab8eefb6409c1aULL,   774 }, // 1e252
+   { 0xd01fef10a657842cULL,   800 }, // 1e260
+   { 0x9b10a4e5e9913129ULL,   827 }, // 1e268
+   { 0xe7109bfba19c0c9dULL,   853 }, // 1e276
+   { 0xac2820d9623bf429ULL,   880 }, // 1e284
+   { 0x80444b5e7aa7cf85ULL,   907 }, // 1e292
+   { 0xbf21e44003acdd2dULL,   933 }, // 1e300
+   { 0x8e679c2f5e44ff8fULL,   960 }, // 1e308
+   { 0xd433179d9c8cb841ULL,   986 }, // 1e316
+   { 0x9e19db92b4e31ba9ULL,  1013 }, // 1e324
+   { 0xeb96bf6ebadf77d9ULL,  1039 }, // 1e332
+   { 0xaf87023b9bf0ee6bULL,  1066 }   // 1e340
+};
+
+
+static inline DiyFp
+operator -( const DiyFp &a, const DiyFp &b )
+{
+   return DiyFp( a.f - b.f, a.e );
+}
+
+
+// Product rounded to the upper 64 bits.
+static inline DiyFp
+operator *( const DiyFp &a, const DiyFp &b )
+{
+#if defined(__SIZEOF_INT128__)
+   unsigned __int128 product = (unsigned __int128)( a.f ) * b.f;
+   UInt64 high = UInt64( product >> 64 );
+   UInt64 low = UInt64( product );
+   return DiyFp( high + ( low >> 63 ), a.e + b.e + 64 );
+#else
+   const UInt64 mask32 = 0xffffffffu;
+   UInt64 aHigh = a.f >> 32;
+   UInt64 aLow = a.f & mask32;
+   UInt64 bHigh = b.f >> 32;
+   UInt64 bLow = b.f & mask32;
+   UInt64 highHigh = aHigh * bHigh;
+   UInt64 lowHigh = aLow * bHigh;
+   UInt64 highLow = aHigh * bLow;
+   UInt64 lowLow = aLow * bLow;
+   UInt64 middle = ( lowLow >> 32 ) + ( highLow & mask32 ) + ( lowHigh & mask32 );
+   middle += UInt64( 1 ) << 31; // round
+   return DiyFp( highHigh + ( highLow >> 32 ) + ( lowHigh >> 32 ) + ( middle >> 32 ), a.e + b.e + 64 );
+#endif
+}
+
+
+static inline DiyFp
+normalize( DiyFp value )
+{
+   while ( !( value.f & ( UInt64( 1 ) << 63 ) ) )
+   {
+      value.f <<= 1;
+      --value.e;
+   }
+   return value;
+}
+
+
+/// Splits a positive finite double and computes the normalized boundaries
+/// of its rounding interval, both with the exponent of plus.
+static DiyFp
+decompose( double value, DiyFp &minus, DiyFp &plus )
+{
+   UInt64 bits;
+   memcpy( &bits, &value, sizeof(bits) );
+   int biasedExponent = int( bits >> doubleSignificandSize );
+   UInt64 significand = bits & ( doubleHiddenBit - 1 );
+   DiyFp v = biasedExponent != 0 ? DiyFp( significand + doubleHiddenBit, biasedExponent - doubleExponentBias )
+                                 : DiyFp( significand, 1 - doubleExponentBias );
+
+   plus = normalize( DiyFp( ( v.f << 1 ) + 1, v.e - 1 ) );
+   // the interval below a power of two is half as wide
+   minus = v.f == doubleHiddenBit ? DiyFp( ( v.f << 2 ) - 1, v.e - 2 )
+                                  : DiyFp( ( v.f << 1 ) - 1, v.e - 1 );
+   minus.f <<= minus.e - plus.e;
+   minus.e = plus.e;
+   return normalize( v );
+}
+
+
+/// Returns c = 10^-k with the exponent of c * 2^exponent in [-60, -32].
+static DiyFp
+cachedPower( int exponent, int &k )
+{
+   // ceil( ( -61 - exponent ) * log10(2) ), offset to stay positive
+   double dk = ( -61 - exponent ) * 0.30102999566398114 + 347;
+   int index = int( dk );
+   if ( dk - index > 0.0 )
+      ++index;
+   index = ( index >> 3 ) + 1;
+   k = -( -348 + index * 8 );
+   return DiyFp( cachedPowers[index].f, cachedPowers[index].e );
+}
+
+
+static const UInt powersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+
+/// Moves the last digit towards w while the result stays within the unsafe
+/// interval. The scaled values are off by up to unit, so the digits are only
+/// accepted if they are known to be the closest ones and to read back as w.
+static inline bool
+roundWeed( char *digits, int length, UInt64 distance, UInt64 unsafeInterval, UInt64 rest, UInt64 tenKappa, UInt64 unit )
+{
+   const UInt64 smallDistance = distance - unit;
+   const UInt64 bigDistance = distance + unit;
+   while ( rest < smallDistance  &&  unsafeInterval - rest >= tenKappa
+           &&  ( rest + tenKappa < smallDistance  ||  smallDistance - rest >= rest + tenKappa - smallDistance ) )
+   {
+      --digits[length - 1];
+      rest += tenKappa;
+   }
+   // another digit might be closer to the real w
+   if ( rest < bigDistance  &&  unsafeInterval - rest >= tenKappa
+        &&  ( rest + tenKappa < bigDistance  ||  bigDistance - rest > rest + tenKappa - bigDistance ) )
+      return false;
+   // the digits must lie within the safe interval
+   return 2 * unit <= rest  &&  rest <= unsafeInterval - 4 * unit;
+}
+
+
+/// Generates the shortest digits within the unsafe interval (low, high),
+/// widened by one unit to each side.
+/// \return false if the digits may not be the shortest or closest ones.
+static bool
+generateDigits( const DiyFp &low, const DiyFp &w, const DiyFp &high, char *digits, int &length, int &k )
+{
+   UInt64 unit = 1;
+   const DiyFp tooHigh( high.f + unit, high.e );
+   UInt64 unsafeInterval = tooHigh.f - ( low.f - unit );
+   const DiyFp one( UInt64( 1 ) << -w.e, w.e );
+   const UInt64 distance = ( tooHigh - w ).f;
+   UInt p1 = UInt( tooHigh.f >> -one.e );
+   UInt64 p2 = tooHigh.f & ( one.f - 1 );
+   int kappa = 1;
+   while ( kappa < 10  &&  p1 >= powersOf10[kappa] )
+      ++kappa;
+   length = 0;
+   while ( kappa > 0 )
+   {
+      --kappa;
+      UInt digit = p1 / powersOf10[kappa];
+      p1 %= powersOf10[kappa];
+      if ( digit  ||  length )
+         digits[length++] = char( '0' + digit );
+      UInt64 rest = ( UInt64( p1 ) << -one.e ) + p2;
+      if ( rest < unsafeInterval )
+      {
+         k += kappa;
+         return roundWeed( digits, length, distance, unsafeInterval, rest, UInt64( powersOf10[kappa] ) << -one.e, unit );
+      }
+   }
+   while ( true )
+   {
+      p2 *= 10;
+      unit *= 10;
+      unsafeInterval *= 10;
+      char digit = char( p2 >> -one.e );
+      if ( digit  ||  length )
+         digits[length++] = char( '0' + digit );
+      p2 &= one.f - 1;
+      --kappa;
+      if ( p2 < unsafeInterval )
+      {
+         k += kappa;
+         return roundWeed( digits, length, distance * unit, unsafeInterval, p2, one.f, unit );
+      }
+   }
+}
+
+
+/// Writes the digits of a positive finite double with Grisu3: value = digits * 10^k.
+/// \return false for the about 0.5% of the values it can not decide.
+static bool
+grisu3( double value, char *digits, int &length, int &k )
+{
+   DiyFp minus, plus;
+   DiyFp v = decompose( value, minus, plus );
+   DiyFp scale = cachedPower( plus.e, k );
+   return generateDigits( minus * scale, v * scale, plus * scale, digits, length, k );
+}
+
+
+/// Fallback for the values grisu3() gives up on: the shortest of the 15, 16
+/// and 17 digit renderings of printf() that reads back as value. Any decimal
+/// with up to 15 digits survives the trip through a double, so stripping the
+/// zeros of the 15 digit rendering finds the shorter ones too.
+static void
+printfDigits( double value, char *digits, int &length, int &k )
+{
+   char buffer[32];
+   for ( int precision = 15; ; ++precision )
+   {
+      // both use the decimal point of the current locale
+      snprintf( buffer, sizeof(buffer), "%.*e", precision - 1, value );
+      if ( precision == 17  ||  strtod( buffer, 0 ) == value )
+         break;
+   }
+   length = 0;
+   const char *current = buffer;
+   for ( ; *current != 'e'; ++current )
+   {
+      if ( *current >= '0'  &&  *current <= '9' )
+         digits[length++] = *current;
+   }
+   while ( length > 1  &&  digits[length - 1] == '0' )
+      --length;
+   k = atoi( current + 1 ) - ( length - 1 );
+}
+
+
+static char *
+writeExponent( int exponent, char *current )
+{
+   *current++ = 'e';
+   if ( exponent < 0 )
+   {
+      *current++ = '-';
+      exponent = -exponent;
+   }
+   else
+      *current++ = '+';
+   if ( exponent >= 100 )
+      *current++ = char( '0' + exponent / 100 );
+   if ( exponent >= 10 )
+      *current++ = char( '0' + exponent / 10 % 10 );
+   *current++ = char( '0' + exponent % 10 );
+   return current;
+}
+
+
+/** Writes the shortest decimal string that reads back as value. The result
+ * always contains '.' or 'e', so that readers keep it a real. Plain notation
+ * is used for magnitudes in [1e-6, 1e21), as in ECMAScript.
+ * \param buffer receives at most 25 characters, not 0 terminated.
+ * \return end of the written characters.
+ */
+static char *
+formatDouble( double value, char *buffer )
+{
+   char *current = buffer;
+   if ( value != value )
+   {
+      memcpy( current, "nan", 3 );
+      return current + 3;
+   }
+   UInt64 bits;
+   memcpy( &bits, &value, sizeof(bits) );
+   if ( bits >> 63 )
+   {
+      *current++ = '-';
+      value = -value;
+   }
+   if ( value == 0 )
+   {
+      memcpy( current, "0.0", 3 );
+      return current + 3;
+   }
+   if ( value > 1.7976931348623157e308 )
+   {
+      memcpy( current, "inf", 3 );
+      return current + 3;
+   }
+
+   char digits[20];
+   int length;
+   int k;
+   if ( !grisu3( value, digits, length, k ) )
+      printfDigits( value, digits, length, k );
+   int point = length + k; // position of the decimal point relative to the digits
+
+   if ( point > 0  &&  point <= 21 )
+   {
+      if ( k >= 0 )
+      {
+         // integral: 1234000.0
+         memcpy( current, digits, length );
+         current += length;
+         memset( current, '0', k );
+         current += k;
+         memcpy( current, ".0", 2 );
+         return current + 2;
+      }
+      // 1234.56
+      memcpy( current, digits, point );
+      current += point;
+      *current++ = '.';
+      memcpy( current, digits + point, length - point );
+      return current + length - point;
+   }
+   if ( point > -6  &&  point <= 0 )
+   {
+      // 0.00123
+      *current++ = '0';
+      *current++ = '.';
+      memset( current, '0', -point );
+      current += -point;
+      memcpy( current, digits, length );
+      return current + length;
+   }
+   // 1.23e+45
+   *current++ = digits[0];
+   if ( length > 1 )
+   {
+      *current++ = '.';
+      memcpy( current, digits + 1, length - 1 );
+      current += length - 1;
+   }
+   return writeExponent( point - 1, current );
+}
@@ -0,0 +1,495 @@
+// included by json_value.cpp
+// everything is within Json namespace
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValueObjectMap
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+static const ValueObjectMap::MemberIndex noMember = ValueObjectMap::MemberIndex( -1 );
+
+// Size of the first key page allocated once inlineKeys_ is full. Following
+// pages double in size, up to keyPageSize << maxKeyPageShift.
+static const size_t keyPageSize = 256;
+static const size_t maxKeyPageShift = 6;
+
+
+ValueObjectMap::ValueObjectMap()
+   : order_( inlineOrder_ )
+   , buckets_( 0 )
+   , keyCurrent_( inlineKeys_ )
+   , keyEnd_( inlineKeys_ + inlineKeyBytes )
+   , size_( 0 )
+   , memberCount_( 0 )
+   , freeMember_( noMember )
+   , orderCapacity_( inlineMembers )
+   , bucketCount_( 0 )
+   , keyBytes_( 0 )
+   , deadKeyBytes_( 0 )
+{
+}
+
+
+ValueObjectMap::ValueObjectMap( const ValueObjectMap &other )
+   : order_( inlineOrder_ )
+   , buckets_( 0 )
+   , keyCurrent_( inlineKeys_ )
+   , keyEnd_( inlineKeys_ + inlineKeyBytes )
+   , size_( 0 )
+   , memberCount_( 0 )
+   , freeMember_( noMember )
+   , orderCapacity_( inlineMembers )
+   , bucketCount_( 0 )
+   , keyBytes_( 0 )
+   , deadKeyBytes_( 0 )
+{
+   // Members are visited in member name order, so each one is appended
+   // at the end of the sorted index.
+   for ( MemberIndex position = 0; position < other.size_; ++position )
+   {
+      const Member &otherMember = other.member( other.order_[position] );
+      Value &value = addMember( otherMember.key_, otherMember.isStatic_, 0, size_ );
+      Value copy( otherMember.value_ );
+      value.swap( copy );
+      std::swap( value.comments_, copy.comments_ );
+   }
+}
+
+
+ValueObjectMap::~ValueObjectMap()
+{
+   releaseStorage();
+}
+
+
+ValueObjectMap::MemberIndex
+ValueObjectMap::size() const
+{
+   return size_;
+}
+
+
+void
+ValueObjectMap::clear()
+{
+   MemberIndex inlineCount = memberCount_ < MemberIndex(inlineMembers) ? memberCount_
+                                                                       : MemberIndex(inlineMembers);
+   for ( MemberIndex index = 0; index < inlineCount; ++index )
+      resetValue( inline_[index].value_ );
+   releaseStorage();
+   order_ = inlineOrder_;
+   buckets_ = 0;
+   keyCurrent_ = inlineKeys_;
+   keyEnd_ = inlineKeys_ + inlineKeyBytes;
+   size_ = 0;
+   memberCount_ = 0;
+   freeMember_ = noMember;
+   orderCapacity_ = inlineMembers;
+   bucketCount_ = 0;
+   keyBytes_ = 0;
+   deadKeyBytes_ = 0;
+}
+
+
+const Value *
+ValueObjectMap::find( const char *key ) const
+{
+   return find( key, buckets_ ? hash( key ) : 0 );
+}
+
+
+const Value *
+ValueObjectMap::find( const char *key,
+                      unsigned int hashedKey ) const
+{
+   if ( buckets_ )
+   {
+      MemberIndex index = findMember( key, hashedKey );
+      return index == noMember ? 0 : &member( index ).value_;
+   }
+   MemberIndex position = lowerBound( key );
+   if ( position < size_ )
+   {
+      const Member &found = member( order_[position] );
+      if ( strcmp( found.key_, key ) == 0 )
+         return &found.value_;
+   }
+   return 0;
+}
+
+
+Value *
+ValueObjectMap::find( const char *key )
+{
+   const ValueObjectMap *constThis = this;
+   return const_cast<Value *>( constThis->find( key ) );
+}
+
+
+Value &
+ValueObjectMap::resolveReference( const char *key,
+                                  bool isStatic )
+{
+   if ( buckets_ )
+   {
+      unsigned int hashedKey = hash( key );
+      MemberIndex index = findMember( key, hashedKey );
+      if ( index != noMember )
+         return member( index ).value_;
+      return addMember( key, isStatic, hashedKey, lowerBound( key ) );
+   }
+   MemberIndex position = lowerBound( key );
+   if ( position < size_ )
+   {
+      Member &found = member( order_[position] );
+      if ( strcmp( found.key_, key ) == 0 )
+         return found.value_;
+   }
+   return addMember( key, isStatic, 0, position );
+}
+
+
+bool
+ValueObjectMap::remove( const char *key )
+{
+   MemberIndex position = lowerBound( key );
+   if ( position == size_  ||  strcmp( member( order_[position] ).key_, key ) != 0 )
+      return false;
+   MemberIndex index = order_[position];
+   memmove( order_ + position, order_ + position + 1, (size_ - position - 1) * sizeof(MemberIndex) );
+   --size_;
+   // The member slot is recycled by the next addMember(). The copy of its
+   // name, if any, stays in the key pages until compactKeys() drops it.
+   Member &removed = member( index );
+   resetValue( removed.value_ );
+   if ( !removed.isStatic_ )
+   {
+      size_t length = strlen( removed.key_ ) + 1;
+      keyBytes_ -= length;
+      deadKeyBytes_ += length;
+   }
+   removed.key_ = 0;
+   removed.hash_ = freeMember_;
+   freeMember_ = index;
+   if ( buckets_ )
+      rehash( bucketCount_ );   // open addressing: rebuild rather than leave tombstones.
+   // Each name is copied at most once per dead byte, so this is amortized constant.
+   if ( deadKeyBytes_ > keyBytes_  &&  deadKeyBytes_ >= keyPageSize )
+      compactKeys();
+   return true;
+}
+
+
+bool
+ValueObjectMap::operator ==( const ValueObjectMap &other ) const
+{
+   if ( size_ != other.size_ )
+      return false;
+   for ( MemberIndex position = 0; position < size_; ++position )
+   {
+      if ( strcmp( keyAt( position ), other.keyAt( position ) ) != 0
+           ||  valueAt( position ) != other.valueAt( position ) )
+         return false;
+   }
+   return true;
+}
+
+
+bool
+ValueObjectMap::operator <( const ValueObjectMap &other ) const
+{
+   // Lexicographical comparison of the (name, value) pairs in member name order.
+   MemberIndex count = size_ < other.size_ ? size_ : other.size_;
+   for ( MemberIndex position = 0; position < count; ++position )
+   {
+      int keyComparison = strcmp( keyAt( position ), other.keyAt( position ) );
+      if ( keyComparison != 0 )
+         return keyComparison < 0;
+      if ( valueAt( position ) < other.valueAt( position ) )
+         return true;
+      if ( other.valueAt( position ) < valueAt( position ) )
+         return false;
+   }
+   return size_ < other.size_;
+}
+
+
+const char *
+ValueObjectMap::keyAt( MemberIndex position ) const
+{
+   return member( order_[position] ).key_;
+}
+
+
+bool
+ValueObjectMap::isStaticKeyAt( MemberIndex position ) const
+{
+   return member( order_[position] ).isStatic_;
+}
+
+
+Value &
+ValueObjectMap::valueAt( MemberIndex position )
+{
+   return member( order_[position] ).value_;
+}
+
+
+const Value &
+ValueObjectMap::valueAt( MemberIndex position ) const
+{
+   return member( order_[position] ).value_;
+}
+
+
+inline ValueObjectMap::Member &
+ValueObjectMap::member( MemberIndex index )
+{
+   if ( index < MemberIndex(inlineMembers) )
+      return inline_[index];
+   // Page n holds the members [inlineMembers << n, inlineMembers << (n+1)).
+   MemberIndex pageIndex = 0;
+   MemberIndex pageStart = inlineMembers;
+   while ( index - pageStart >= pageStart )
+   {
+      pageStart *= 2;
+      ++pageIndex;
+   }
+   return pages_[pageIndex][index - pageStart];
+}
+
+
+inline const ValueObjectMap::Member &
+ValueObjectMap::member( MemberIndex index ) const
+{
+   return const_cast<ValueObjectMap *>( this )->member( index );
+}
+
+
+ValueObjectMap::MemberIndex
+ValueObjectMap::lowerBound( const char *key ) const
+{
+   MemberIndex first = 0;
+   MemberIndex count = size_;
+   while ( count > 0 )
+   {
+      MemberIndex half = count / 2;
+      if ( strcmp( member( order_[first + half] ).key_, key ) < 0 )
+      {
+         first += half + 1;
+         count -= half + 1;
+      }
+      else
+         count = half;
+   }
+   return first;
+}
+
+
+ValueObjectMap::MemberIndex
+ValueObjectMap::findMember( const char *key,
+                            unsigned int hashedKey ) const
+{
+   MemberIndex mask = bucketCount_ - 1;
+   for ( MemberIndex bucket = hashedKey & mask; buckets_[bucket] != noMember; bucket = (bucket + 1) & mask )
+   {
+      const Member &candidate = member( buckets_[bucket] );
+      if ( candidate.hash_ == hashedKey  &&  strcmp( candidate.key_, key ) == 0 )
+         return buckets_[bucket];
+   }
+   return noMember;
+}
+
+
+Value &
+ValueObjectMap::addMember( const char *key,
+                           bool isStatic,
+                           unsigned int hashedKey,
+                           MemberIndex position )
+{
+   MemberIndex index = freeMember_;
+   if ( index != noMember )
+      freeMember_ = member( index ).hash_;
+   else
+   {
+      index = memberCount_++;
+      // Page boundaries are inlineMembers times a power of two.
+      if ( index >= MemberIndex(inlineMembers)  &&  (index & (index - 1)) == 0 )
+         pages_.push_back( newPage( index ) );
+   }
+   Member &added = member( index );
+   added.key_ = isStatic ? key : copyKey( key );
+   added.hash_ = hashedKey;
+   added.isStatic_ = isStatic;
+
+   if ( size_ == orderCapacity_ )
+   {
+      MemberIndex *order = static_cast<MemberIndex *>( ValueArena::allocate( orderCapacity_ * 2 * sizeof(MemberIndex) ) );
+      memcpy( order, order_, size_ * sizeof(MemberIndex) );
+      if ( order_ != inlineOrder_ )
+         ValueArena::release( order_ );
+      order_ = order;
+      orderCapacity_ *= 2;
+   }
+   memmove( order_ + position + 1, order_ + position, (size_ - position) * sizeof(MemberIndex) );
+   order_[position] = index;
+   ++size_;
+
+   if ( buckets_ )
+   {
+      if ( size_ * 2 > bucketCount_ )
+         rehash( bucketCount_ * 2 );
+      else
+         insertBucket( index );
+   }
+   else if ( size_ > MemberIndex(hashThreshold) )
+      rehash( hashThreshold * 4 );
+   return added.value_;
+}
+
+
+const char *
+ValueObjectMap::copyKey( const char *key )
+{
+   size_t length = strlen( key ) + 1;
+   if ( length > size_t( keyEnd_ - keyCurrent_ ) )
+   {
+      size_t shift = keyPages_.size() < maxKeyPageShift ? keyPages_.size() : maxKeyPageShift;
+      size_t pageSize = keyPageSize << shift;
+      if ( pageSize < length )
+         pageSize = length;
+      keyPages_.push_back( static_cast<char *>( ValueArena::allocate( pageSize ) ) );
+      keyCurrent_ = keyPages_.back();
+      keyEnd_ = keyCurrent_ + pageSize;
+   }
+   char *copy = keyCurrent_;
+   memcpy( copy, key, length );
+   keyCurrent_ += length;
+   keyBytes_ += length;
+   return copy;
+}
+
+
+void
+ValueObjectMap::compactKeys()
+{
+   std::vector<char *, ValueArenaAllocator<char *> > oldPages;
+   oldPages.swap( keyPages_ );
+   if ( keyBytes_ == 0 )
+   {
+      keyCurrent_ = inlineKeys_;
+      keyEnd_ = inlineKeys_ + inlineKeyBytes;
+   }
+   else
+   {
+      // Room for as many names again before the next page is needed. The
+      // names in the inline key bytes move as well, those bytes stay unused.
+      size_t pageSize = keyBytes_ * 2 > keyPageSize ? keyBytes_ * 2 : keyPageSize;
+      keyPages_.push_back( static_cast<char *>( ValueArena::allocate( pageSize ) ) );
+      keyCurrent_ = keyPages_.back();
+      keyEnd_ = keyCurrent_ + pageSize;
+      for ( MemberIndex position = 0; position < size_; ++position )
+      {
+         Member &current = member( order_[position] );
+         if ( current.isStatic_ )
+            continue;
+         size_t length = strlen( current.key_ ) + 1;
+         memcpy( keyCurrent_, current.key_, length );
+         current.key_ = keyCurrent_;
+         keyCurrent_ += length;
+      }
+   }
+   for ( MemberIndex pageIndex = 0; pageIndex < oldPages.size(); ++pageIndex )
+      ValueArena::release( oldPages[pageIndex] );
+   deadKeyBytes_ = 0;
+}
+
+
+void
+ValueObjectMap::insertBucket( MemberIndex index )
+{
+   MemberIndex mask = bucketCount_ - 1;
+   MemberIndex bucket = member( index ).hash_ & mask;
+   while ( buckets_[bucket] != noMember )
+      bucket = (bucket + 1) & mask;
+   buckets_[bucket] = index;
+}
+
+
+void
+ValueObjectMap::rehash( MemberIndex bucketCount )
+{
+   ValueArena::release( buckets_ );
+   buckets_ = static_cast<MemberIndex *>( ValueArena::allocate( bucketCount * sizeof(MemberIndex) ) );
+   bucketCount_ = bucketCount;
+   for ( MemberIndex bucket = 0; bucket < bucketCount; ++bucket )
+      buckets_[bucket] = noMember;
+   for ( MemberIndex position = 0; position < size_; ++position )
+   {
+      Member &current = member( order_[position] );
+      current.hash_ = hash( current.key_ );
+      insertBucket( order_[position] );
+   }
+}
+
+
+void
+ValueObjectMap::releaseStorage()
+{
+   MemberIndex pageSize = inlineMembers;
+   for ( MemberIndex pageIndex = 0; pageIndex < pages_.size(); ++pageIndex, pageSize *= 2 )
+      deletePage( pages_[pageIndex], pageSize );
+   pages_.clear();
+   for ( MemberIndex pageIndex = 0; pageIndex < keyPages_.size(); ++pageIndex )
+      ValueArena::release( keyPages_[pageIndex] );
+   keyPages_.clear();
+   if ( order_ != inlineOrder_ )
+      ValueArena::release( order_ );
+   ValueArena::release( buckets_ );
+}
+
+
+ValueObjectMap::Member *
+ValueObjectMap::newPage( MemberIndex size )
+{
+   Member *page = static_cast<Member *>( ValueArena::allocate( size * sizeof(Member) ) );
+   for ( MemberIndex index = 0; index < size; ++index )
+      new ( page + index ) Member();
+   return page;
+}
+
+
+void
+ValueObjectMap::deletePage( Member *page, 
+                            MemberIndex size )
+{
+   for ( MemberIndex index = 0; index < size; ++index )
+      page[index].~Member();
+   ValueArena::release( page );
+}
+
+
+unsigned int
+ValueObjectMap::hash( const char *key )
+{
+   // 32 bits FNV-1a.
+   unsigned int hashedKey = 2166136261u;
+   for ( ; *key; ++key )
+   {
+      hashedKey ^= (unsigned char)*key;
+      hashedKey *= 16777619u;
+   }
+   return hashedKey;
+}
+
+
+void
+ValueObjectMap::resetValue( Value &value )
+{
+   Value empty;
+   value.swap( empty );
+   std::swap( value.comments_, empty.comments_ );
+}
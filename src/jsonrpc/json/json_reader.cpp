@@ -4,6 +4,8 @@
 #include <cstdio>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
+#include <clocale>
 #include <iostream>
 #include <stdexcept>
 
@@ -11,8 +13,12 @@
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
 #endif
 
+#include "json_scanner.inl"
+
 namespace Json {
 
+#include "json_number.inl"
+
 // Implementation of class Features
 // ////////////////////////////////
 
@@ -348,14 +354,10 @@ Reader::readToken( Token &token )
 void 
 Reader::skipSpaces()
 {
-   while ( current_ != end_ )
-   {
-      Char c = *current_;
-      if ( c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n' )
-         ++current_;
-      else
-         break;
-   }
+   // Compact documents rarely contain any whitespace, so look at one
+   // character before handing longer runs to the scanner.
+   if ( current_ != end_  &&  isSpace( *current_ ) )
+      current_ = scanNonSpace( current_ + 1, end_ );
 }
 
 
@@ -463,16 +465,18 @@ Reader::readNumber()
 bool
 Reader::readString()
 {
-   Char c = 0;
-   while ( current_ != end_ )
+   while ( true )
    {
-      c = getNextChar();
-      if ( c == '\\' )
-         getNextChar();
-      else if ( c == '"' )
-         break;
+      current_ = scanStringSpecial( current_, end_ );
+      if ( current_ == end_ )
+         return false;
+      if ( *current_++ == '"' )
+         return true;
+      // skip the escaped character
+      if ( current_ == end_ )
+         return false;
+      ++current_;
    }
-   return c == '"';
 }
 
 
@@ -546,10 +550,10 @@ Reader::readArray( Token &tokenStart )
       readToken( endArray );
       return true;
    }
-   int index = 0;
    while ( true )
    {
-      Value &value = currentValue()[ index++ ];
+      // Element references stay valid: the array only grows between elements.
+      Value &value = currentValue().append( Value() );
       nodes_.push( &value );
       bool ok = readValue();
       nodes_.pop();
@@ -581,37 +585,110 @@ Reader::readArray( Token &tokenStart )
 bool 
 Reader::decodeNumber( Token &token )
 {
-   bool isDouble = false;
-   for ( Location inspect = token.start_; inspect != token.end_; ++inspect )
-   {
-      isDouble = isDouble  
-                 ||  in( *inspect, '.', 'e', 'E', '+' )  
-                 ||  ( *inspect == '-'  &&  inspect != token.start_ );
-   }
-   if ( isDouble )
-      return decodeDouble( token );
+   // Single pass over the token: collect the decimal mantissa (as many
+   // digits as fit into 64 bits) and the decimal exponent.
    Location current = token.start_;
-   bool isNegative = *current == '-';
+   Location end = token.end_;
+   bool isNegative = current != end  &&  *current == '-';
    if ( isNegative )
       ++current;
-   Value::UInt threshold = (isNegative ? Value::UInt(-Value::minInt) 
-                                       : Value::maxUInt) / 10;
-   Value::UInt value = 0;
-   while ( current < token.end_ )
+   const Value::UInt64 threshold = Value::maxUInt64 / 10;
+   const int thresholdDigit = int( Value::maxUInt64 % 10 );
+   Value::UInt64 mantissa = 0;
+   int exponent10 = 0;
+   int digits = 0;
+   bool isFull = false;     // mantissa can not take further digits
+   bool isInexact = false;  // a non zero digit was dropped
+   for ( ; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current, ++digits )
+   {
+      int digit = *current - '0';
+      if ( !isFull  &&  ( mantissa < threshold  ||  ( mantissa == threshold  &&  digit <= thresholdDigit ) ) )
+         mantissa = mantissa * 10 + digit;
+      else
+      {
+         isFull = true;
+         isInexact = isInexact  ||  digit != 0;
+         ++exponent10;
+      }
+   }
+   bool isInteger = true;
+   if ( current != end  &&  *current == '.' )
    {
-      Char c = *current++;
-      if ( c < '0'  ||  c > '9' )
+      isInteger = false;
+      for ( ++current; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current, ++digits )
+      {
+         int digit = *current - '0';
+         if ( !isFull  &&  ( mantissa < threshold  ||  ( mantissa == threshold  &&  digit <= thresholdDigit ) ) )
+         {
+            mantissa = mantissa * 10 + digit;
+            --exponent10;
+         }
+         else
+         {
+            isFull = true;
+            isInexact = isInexact  ||  digit != 0;
+         }
+      }
+   }
+   if ( digits == 0 )
+      return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
+   if ( current != end  &&  ( *current == 'e'  ||  *current == 'E' ) )
+   {
+      isInteger = false;
+      ++current;
+      bool isNegativeExponent = current != end  &&  *current == '-';
+      if ( current != end  &&  ( *current == '-'  ||  *current == '+' ) )
+         ++current;
+      Location exponentBegin = current;
+      int exponent = 0;
+      for ( ; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current )
+      {
+         // saturate, anything this large is 0 or infinity anyway
+         if ( exponent < 100000 )
+            exponent = exponent * 10 + ( *current - '0' );
+      }
+      if ( current == exponentBegin )
          return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
-      if ( value >= threshold )
+      exponent10 += isNegativeExponent ? -exponent : exponent;
+   }
+   if ( current != end )
+      return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
+
+   if ( isInteger  &&  exponent10 == 0 )
+   {
+      if ( !isNegative )
+      {
+         if ( mantissa <= Value::UInt64(Value::maxInt) )
+            currentValue() = Value::Int64( mantissa );
+         else
+            currentValue() = mantissa;
+         return true;
+      }
+      if ( mantissa <= Value::UInt64(Value::maxInt64) )
+      {
+         currentValue() = -Value::Int64( mantissa );
+         return true;
+      }
+      if ( mantissa == Value::UInt64(Value::maxInt64) + 1 )
+      {
+         currentValue() = Value::minInt64;
+         return true;
+      }
+   }
+
+   double value;
+   if ( !decimalToDouble( mantissa, exponent10, isNegative, value ) )
+      return decodeDouble( token );
+   if ( isInexact )
+   {
+      // the dropped digits lie between mantissa and mantissa + 1
+      double upper;
+      if ( mantissa == Value::maxUInt64  
+           ||  !decimalToDouble( mantissa + 1, exponent10, isNegative, upper )
+           ||  upper != value )
          return decodeDouble( token );
-      value = value * 10 + Value::UInt(c - '0');
    }
-   if ( isNegative )
-      currentValue() = -Value::Int( value );
-   else if ( value <= Value::UInt(Value::maxInt) )
-      currentValue() = Value::Int( value );
-   else
-      currentValue() = value;
+   currentValue() = value;
    return true;
 }
 
@@ -619,24 +696,33 @@ Reader::decodeNumber( Token &token )
 bool 
 Reader::decodeDouble( Token &token )
 {
-   double value = 0;
-   const int bufferSize = 32;
-   int count;
+   // Slow path for the rare numbers decodeNumber() can not decide. strtod()
+   // expects the decimal point of the current locale, so substitute it.
+   const int bufferSize = 64;
+   char buffer[bufferSize];
+   std::string longBuffer;
+   char *number = buffer;
    int length = int(token.end_ - token.start_);
-   if ( length <= bufferSize )
+   if ( length >= bufferSize )
+   {
+      longBuffer.assign( token.start_, token.end_ );
+      number = &longBuffer[0];
+   }
+   else
    {
-      Char buffer[bufferSize];
       memcpy( buffer, token.start_, length );
       buffer[length] = 0;
-      count = sscanf( buffer, "%lf", &value );
    }
-   else
+   char decimalPoint = localeconv()->decimal_point[0];
+   if ( decimalPoint != '.' )
    {
-      std::string buffer( token.start_, token.end_ );
-      count = sscanf( buffer.c_str(), "%lf", &value );
+      char *point = strchr( number, '.' );
+      if ( point )
+         *point = decimalPoint;
    }
-
-   if ( count != 1 )
+   char *numberEnd;
+   double value = strtod( number, &numberEnd );
+   if ( numberEnd != number + length )
       return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
    currentValue() = value;
    return true;
@@ -646,6 +732,14 @@ Reader::decodeDouble( Token &token )
 bool 
 Reader::decodeString( Token &token )
 {
+   Location begin = token.start_ + 1; // skip '"'
+   Location end = token.end_ - 1;     // do not include '"'
+   if ( scanStringSpecial( begin, end ) == end )
+   {
+      // nothing to unescape: copy the characters straight into the value
+      currentValue() = Value( begin, end );
+      return true;
+   }
    std::string decoded;
    if ( !decodeString( token, decoded ) )
       return false;
@@ -662,6 +756,11 @@ Reader::decodeString( Token &token, std::string &decoded )
    Location end = token.end_ - 1;      // do not include '"'
    while ( current != end )
    {
+      Location special = scanStringSpecial( current, end );
+      decoded.append( current, special );
+      if ( special == end )
+         break;
+      current = special;
       Char c = *current++;
       if ( c == '"' )
          break;
@@ -692,10 +791,6 @@ Reader::decodeString( Token &token, std::string &decoded )
             return addError( "Bad escape sequence in string", token, current );
          }
       }
-      else
-      {
-         decoded += c;
-      }
    }
    return true;
 }
@@ -0,0 +1,331 @@
+// included by json_reader.cpp and json_writer.cpp, ahead of the Json
+// namespace because of the intrinsics headers
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// Character scanning
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// Each scanner returns the first position in [begin, end) holding one of
+// the characters it looks for, or end. Everything is inline, so that each
+// includer only keeps the scanners it uses. The vector variants inspect 16 or
+// 32 bytes per step using unaligned loads that never cross end, and finish
+// the remainder with the scalar variant.
+//
+// SSE2 is part of the x86-64 baseline and NEON of AArch64, so those are
+// chosen at compile time. AVX2 is detected at runtime on the first call.
+
+#if defined(__GNUC__)  &&  ( defined(__x86_64__)  ||  defined(__i386__) )  &&  defined(__SSE2__)
+# define JSON_SCANNER_SSE2 1
+# include <emmintrin.h>
+# if ( __GNUC__ * 100 + __GNUC_MINOR__ >= 409 )  ||  defined(__clang__)
+#  define JSON_SCANNER_AVX2 1
+#  include <immintrin.h>
+# endif
+#elif defined(__GNUC__)  &&  defined(__aarch64__)
+# define JSON_SCANNER_NEON 1
+# include <arm_neon.h>
+#endif
+
+namespace Json {
+
+typedef const char *(*ScanFunction)( const char *begin, const char *end );
+
+
+static inline bool
+isStringSpecial( char c )
+{
+   return c == '"'  ||  c == '\\';
+}
+
+
+static inline bool
+isEscaped( char c )
+{
+   return c == '"'  ||  c == '\\'  ||  (unsigned char)( c ) < 0x20;
+}
+
+
+static inline bool
+isSpace( char c )
+{
+   return c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n';
+}
+
+
+static inline const char *
+scanStringSpecialScalar( const char *begin, const char *end )
+{
+   while ( begin != end  &&  !isStringSpecial( *begin ) )
+      ++begin;
+   return begin;
+}
+
+
+static inline const char *
+scanEscapedScalar( const char *begin, const char *end )
+{
+   while ( begin != end  &&  !isEscaped( *begin ) )
+      ++begin;
+   return begin;
+}
+
+
+static inline const char *
+scanNonSpaceScalar( const char *begin, const char *end )
+{
+   while ( begin != end  &&  isSpace( *begin ) )
+      ++begin;
+   return begin;
+}
+
+
+#if defined(JSON_SCANNER_SSE2)
+
+static inline const char *
+scanStringSpecialSse2( const char *begin, const char *end )
+{
+   const __m128i quote = _mm_set1_epi8( '"' );
+   const __m128i backslash = _mm_set1_epi8( '\\' );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( begin ) );
+      int mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                  _mm_cmpeq_epi8( chunk, backslash ) ) );
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanStringSpecialScalar( begin, end );
+}
+
+
+// Control characters are the bytes c with max( c, 0x1f ) == 0x1f unsigned.
+static inline const char *
+scanEscapedSse2( const char *begin, const char *end )
+{
+   const __m128i quote = _mm_set1_epi8( '"' );
+   const __m128i backslash = _mm_set1_epi8( '\\' );
+   const __m128i lastControl = _mm_set1_epi8( 0x1f );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( begin ) );
+      __m128i escaped = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                    _mm_cmpeq_epi8( chunk, backslash ) ),
+                                      _mm_cmpeq_epi8( _mm_max_epu8( chunk, lastControl ), lastControl ) );
+      int mask = _mm_movemask_epi8( escaped );
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanEscapedScalar( begin, end );
+}
+
+
+static inline const char *
+scanNonSpaceSse2( const char *begin, const char *end )
+{
+   const __m128i space = _mm_set1_epi8( ' ' );
+   const __m128i tab = _mm_set1_epi8( '\t' );
+   const __m128i carriageReturn = _mm_set1_epi8( '\r' );
+   const __m128i newLine = _mm_set1_epi8( '\n' );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( begin ) );
+      __m128i spaces = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, space ),
+                                                   _mm_cmpeq_epi8( chunk, tab ) ),
+                                     _mm_or_si128( _mm_cmpeq_epi8( chunk, carriageReturn ),
+                                                   _mm_cmpeq_epi8( chunk, newLine ) ) );
+      int mask = ~_mm_movemask_epi8( spaces ) & 0xffff;
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanNonSpaceScalar( begin, end );
+}
+
+#endif // JSON_SCANNER_SSE2
+
+
+#if defined(JSON_SCANNER_AVX2)
+
+__attribute__(( target( "avx2" ) ))
+static inline const char *
+scanStringSpecialAvx2( const char *begin, const char *end )
+{
+   const __m256i quote = _mm256_set1_epi8( '"' );
+   const __m256i backslash = _mm256_set1_epi8( '\\' );
+   for ( ; end - begin >= 32; begin += 32 )
+   {
+      __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( begin ) );
+      unsigned int mask = unsigned( _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote ),
+                                                                           _mm256_cmpeq_epi8( chunk, backslash ) ) ) );
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanStringSpecialSse2( begin, end );
+}
+
+
+__attribute__(( target( "avx2" ) ))
+static inline const char *
+scanEscapedAvx2( const char *begin, const char *end )
+{
+   const __m256i quote = _mm256_set1_epi8( '"' );
+   const __m256i backslash = _mm256_set1_epi8( '\\' );
+   const __m256i lastControl = _mm256_set1_epi8( 0x1f );
+   for ( ; end - begin >= 32; begin += 32 )
+   {
+      __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( begin ) );
+      __m256i escaped = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote ),
+                                                          _mm256_cmpeq_epi8( chunk, backslash ) ),
+                                         _mm256_cmpeq_epi8( _mm256_max_epu8( chunk, lastControl ), lastControl ) );
+      unsigned int mask = unsigned( _mm256_movemask_epi8( escaped ) );
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanEscapedSse2( begin, end );
+}
+
+
+__attribute__(( target( "avx2" ) ))
+static inline const char *
+scanNonSpaceAvx2( const char *begin, const char *end )
+{
+   const __m256i space = _mm256_set1_epi8( ' ' );
+   const __m256i tab = _mm256_set1_epi8( '\t' );
+   const __m256i carriageReturn = _mm256_set1_epi8( '\r' );
+   const __m256i newLine = _mm256_set1_epi8( '\n' );
+   for ( ; end - begin >= 32; begin += 32 )
+   {
+      __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( begin ) );
+      __m256i spaces = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, space ),
+                                                         _mm256_cmpeq_epi8( chunk, tab ) ),
+                                        _mm256_or_si256( _mm256_cmpeq_epi8( chunk, carriageReturn ),
+                                                         _mm256_cmpeq_epi8( chunk, newLine ) ) );
+      unsigned int mask = ~unsigned( _mm256_movemask_epi8( spaces ) );
+      if ( mask )
+         return begin + __builtin_ctz( mask );
+   }
+   return scanNonSpaceSse2( begin, end );
+}
+
+
+static inline bool
+hasAvx2()
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports( "avx2" );
+}
+
+#endif // JSON_SCANNER_AVX2
+
+
+#if defined(JSON_SCANNER_NEON)
+
+// Narrows a byte mask of 0x00/0xff lanes to 4 bits per lane, so that the
+// index of the first set lane is the count of trailing zero bits / 4.
+static inline uint64_t
+neonMask( uint8x16_t lanes )
+{
+   return vget_lane_u64( vreinterpret_u64_u8( vshrn_n_u16( vreinterpretq_u16_u8( lanes ), 4 ) ), 0 );
+}
+
+
+static inline const char *
+scanStringSpecialNeon( const char *begin, const char *end )
+{
+   const uint8x16_t quote = vdupq_n_u8( '"' );
+   const uint8x16_t backslash = vdupq_n_u8( '\\' );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      uint8x16_t chunk = vld1q_u8( reinterpret_cast<const uint8_t *>( begin ) );
+      uint64_t mask = neonMask( vorrq_u8( vceqq_u8( chunk, quote ), vceqq_u8( chunk, backslash ) ) );
+      if ( mask )
+         return begin + ( __builtin_ctzll( mask ) >> 2 );
+   }
+   return scanStringSpecialScalar( begin, end );
+}
+
+
+static inline const char *
+scanEscapedNeon( const char *begin, const char *end )
+{
+   const uint8x16_t quote = vdupq_n_u8( '"' );
+   const uint8x16_t backslash = vdupq_n_u8( '\\' );
+   const uint8x16_t space = vdupq_n_u8( 0x20 );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      uint8x16_t chunk = vld1q_u8( reinterpret_cast<const uint8_t *>( begin ) );
+      uint8x16_t escaped = vorrq_u8( vorrq_u8( vceqq_u8( chunk, quote ), vceqq_u8( chunk, backslash ) ),
+                                     vcltq_u8( chunk, space ) );
+      uint64_t mask = neonMask( escaped );
+      if ( mask )
+         return begin + ( __builtin_ctzll( mask ) >> 2 );
+   }
+   return scanEscapedScalar( begin, end );
+}
+
+
+static inline const char *
+scanNonSpaceNeon( const char *begin, const char *end )
+{
+   const uint8x16_t space = vdupq_n_u8( ' ' );
+   const uint8x16_t tab = vdupq_n_u8( '\t' );
+   const uint8x16_t carriageReturn = vdupq_n_u8( '\r' );
+   const uint8x16_t newLine = vdupq_n_u8( '\n' );
+   for ( ; end - begin >= 16; begin += 16 )
+   {
+      uint8x16_t chunk = vld1q_u8( reinterpret_cast<const uint8_t *>( begin ) );
+      uint8x16_t spaces = vorrq_u8( vorrq_u8( vceqq_u8( chunk, space ), vceqq_u8( chunk, tab ) ),
+                                    vorrq_u8( vceqq_u8( chunk, carriageReturn ), vceqq_u8( chunk, newLine ) ) );
+      uint64_t mask = neonMask( vmvnq_u8( spaces ) );
+      if ( mask )
+         return begin + ( __builtin_ctzll( mask ) >> 2 );
+   }
+   return scanNonSpaceScalar( begin, end );
+}
+
+#endif // JSON_SCANNER_NEON
+
+
+// Picks the best variant of a scanner for this CPU.
+#if defined(JSON_SCANNER_AVX2)
+# define JSON_SELECT_SCANNER( name ) ( hasAvx2() ? name##Avx2 : name##Sse2 )
+#elif defined(JSON_SCANNER_SSE2)
+# define JSON_SELECT_SCANNER( name ) name##Sse2
+#elif defined(JSON_SCANNER_NEON)
+# define JSON_SELECT_SCANNER( name ) name##Neon
+#else
+# define JSON_SELECT_SCANNER( name ) name##Scalar
+#endif
+
+// The selection is made once, on first use; being a function local static
+// it is also valid for readers and writers used by static initializers.
+
+static inline const char *
+scanStringSpecial( const char *begin, const char *end )
+{
+   static const ScanFunction scanner = JSON_SELECT_SCANNER( scanStringSpecial );
+   return scanner( begin, end );
+}
+
+
+static inline const char *
+scanEscaped( const char *begin, const char *end )
+{
+   static const ScanFunction scanner = JSON_SELECT_SCANNER( scanEscaped );
+   return scanner( begin, end );
+}
+
+
+static inline const char *
+scanNonSpace( const char *begin, const char *end )
+{
+   static const ScanFunction scanner = JSON_SELECT_SCANNER( scanNonSpace );
+   return scanner( begin, end );
+}
+
+#undef JSON_SELECT_SCANNER
+
+} // namespace Json
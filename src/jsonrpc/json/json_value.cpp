@@ -9,9 +9,7 @@
 # include <cpptl/conststring.h>
 #endif
 #include <cstddef>    // size_t
-#ifndef JSON_USE_SIMPLE_INTERNAL_ALLOCATOR
-# include "json_batchallocator.h"
-#endif // #ifndef JSON_USE_SIMPLE_INTERNAL_ALLOCATOR
+#include <cstdlib>    // malloc, free
 
 #define JSON_ASSERT_UNREACHABLE assert( false )
 #define JSON_ASSERT( condition ) assert( condition );  // @todo <= change this into an exception throw
@@ -23,6 +21,9 @@ const Value Value::null;
 const Int Value::minInt = Int( ~(UInt(-1)/2) );
 const Int Value::maxInt = Int( UInt(-1)/2 );
 const UInt Value::maxUInt = UInt(-1);
+const Int64 Value::minInt64 = Int64( ~(UInt64(-1)/2) );
+const Int64 Value::maxInt64 = Int64( UInt64(-1)/2 );
+const UInt64 Value::maxUInt64 = UInt64(-1);
 
 // A "safe" implementation of strdup. Allow null pointer to be passed. 
 // Also avoid warning on msvc80.
@@ -52,205 +53,326 @@ const UInt Value::maxUInt = UInt(-1);
 //   return 0;
 //}
 
-ValueAllocator::~ValueAllocator()
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// Every block handed out by ValueArena::allocate() is preceded by a header
+// pointing to the arena pages it was carved from, or 0 for the heap.
+union AllocationHeader
 {
-}
+   void *pages_;
+   double alignment_;
+};
 
-class DefaultValueAllocator : public ValueAllocator
+// Arena bound to the calling thread by ValueArenaScope.
+static __thread ValueArena *boundArena = 0;
+
+/* Pages of a ValueArena. Reference counted by the ValueArena that owns them and
+ * by each block carved from them, so that they survive both the blocks released
+ * after the arena was reset or destroyed and the arena itself.
+ * The first page is allocated together with the Pages, the following ones are
+ * chained after it and kept for reuse by rewind().
+ */
+struct ValueArena::Pages
 {
-public:
-   virtual ~DefaultValueAllocator()
+   struct Page
    {
-   }
+      Page *next_;
+      AllocationHeader data_[1];
+   };
 
-   virtual char *makeMemberName( const char *memberName )
+   static Pages *create( size_t pageSize )
    {
-      return duplicateStringValue( memberName );
+      void *memory = malloc( sizeof(Pages) + pageSize );
+      if ( !memory )
+         throw std::bad_alloc();
+      return new ( memory ) Pages( pageSize );
    }
 
-   virtual void releaseMemberName( char *memberName )
+   void *allocate( size_t size )
    {
-      releaseStringValue( memberName );
+      if ( size > size_t( end_ - next_ ) )
+      {
+         if ( !current_->next_ )
+         {
+            Page *page = static_cast<Page *>( malloc( offsetof( Page, data_ ) + pageSize_ ) );
+            if ( !page )
+               throw std::bad_alloc();
+            page->next_ = 0;
+            current_->next_ = page;
+         }
+         current_ = current_->next_;
+         next_ = reinterpret_cast<char *>( current_->data_ );
+         end_ = next_ + pageSize_;
+      }
+      void *memory = next_;
+      next_ += size;
+      used_ += size;
+      __sync_add_and_fetch( &references_, 1 );
+      return memory;
    }
 
-   virtual char *duplicateStringValue( const char *value, 
-                                       unsigned int length = unknown )
+   void rewind()
    {
-      //@todo invesgate this old optimization
-      //if ( !value  ||  value[0] == 0 )
-      //   return 0;
-
-      if ( length == unknown )
-         length = (unsigned int)strlen(value);
-      char *newString = static_cast<char *>( malloc( length + 1 ) );
-      memcpy( newString, value, length );
-      newString[length] = 0;
-      return newString;
+      current_ = &first_;
+      next_ = reinterpret_cast<char *>( first_.data_ );
+      end_ = next_ + pageSize_;
+      used_ = 0;
    }
 
-   virtual void releaseStringValue( char *value )
+   bool isShared()
    {
-      if ( value )
-         free( value );
+      return __sync_add_and_fetch( &references_, 0 ) != 1;
    }
-};
 
-static ValueAllocator *&valueAllocator()
-{
-   static DefaultValueAllocator defaultAllocator;
-   static ValueAllocator *valueAllocator = &defaultAllocator;
-   return valueAllocator;
-}
+   void unreference()
+   {
+      if ( __sync_sub_and_fetch( &references_, 1 ) != 0 )
+         return;
+      for ( Page *page = first_.next_; page; )
+      {
+         Page *next = page->next_;
+         free( page );
+         page = next;
+      }
+      this->~Pages();
+      free( this );
+   }
 
-static struct DummyValueAllocatorInitializer {
-   DummyValueAllocatorInitializer() 
+   int references_;
+   size_t pageSize_;
+   size_t used_;
+   Page *current_;
+   char *next_;
+   char *end_;
+   Page first_;   // must be last, its data_ extends over the first page.
+
+private:
+   explicit Pages( size_t pageSize )
+      : references_( 1 )
+      , pageSize_( pageSize )
    {
-      valueAllocator();      // ensure valueAllocator() statics are initialized before main().
+      first_.next_ = 0;
+      rewind();
    }
-} dummyValueAllocatorInitializer;
+};
 
 
+ValueArena::ValueArena( unsigned int pageSize )
+   : pages_( Pages::create( pageSize ) )
+   , pageSize_( pageSize )
+{
+}
 
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// ValueInternals...
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
-# include "json_internalarray.inl"
-# include "json_internalmap.inl"
-#endif // JSON_VALUE_USE_INTERNAL_MAP
 
-# include "json_valueiterator.inl"
+ValueArena::~ValueArena()
+{
+   JSON_ASSERT( boundArena != this );
+   pages_->unreference();
+}
 
 
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// class Value::CommentInfo
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
+void 
+ValueArena::reset()
+{
+   if ( pages_->isShared() )
+   {
+      // Some values are still alive, they keep the current pages.
+      Pages *pages = Pages::create( pageSize_ );
+      pages_->unreference();
+      pages_ = pages;
+   }
+   else
+      pages_->rewind();
+}
 
 
-Value::CommentInfo::CommentInfo()
-   : comment_( 0 )
+size_t 
+ValueArena::usedBytes() const
 {
+   return pages_->used_;
 }
 
-Value::CommentInfo::~CommentInfo()
+
+void *
+ValueArena::allocate( size_t size )
 {
-   if ( comment_ )
-      valueAllocator()->releaseStringValue( comment_ );
+   size = ( size + 2 * sizeof(AllocationHeader) - 1 ) / sizeof(AllocationHeader) * sizeof(AllocationHeader);
+   ValueArena *arena = boundArena;
+   AllocationHeader *header;
+   if ( arena  &&  size <= arena->pageSize_ / 4 )
+   {
+      header = static_cast<AllocationHeader *>( arena->pages_->allocate( size ) );
+      header->pages_ = arena->pages_;
+   }
+   else
+   {
+      header = static_cast<AllocationHeader *>( malloc( size ) );
+      if ( !header )
+         throw std::bad_alloc();
+      header->pages_ = 0;
+   }
+   return header + 1;
 }
 
 
 void 
-Value::CommentInfo::setComment( const char *text )
+ValueArena::release( void *memory )
 {
-   if ( comment_ )
-      valueAllocator()->releaseStringValue( comment_ );
-   JSON_ASSERT( text );
-   JSON_ASSERT_MESSAGE( text[0]=='\0' || text[0]=='/', "Comments must start with /");
-   // It seems that /**/ style comments are acceptable as well.
-   comment_ = valueAllocator()->duplicateStringValue( text );
+   if ( !memory )
+      return;
+   AllocationHeader *header = static_cast<AllocationHeader *>( memory ) - 1;
+   if ( header->pages_ )
+      static_cast<Pages *>( header->pages_ )->unreference();
+   else
+      free( header );
 }
 
 
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// class Value::CZString
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-// //////////////////////////////////////////////////////////////////
-# ifndef JSON_VALUE_USE_INTERNAL_MAP
+ValueArenaScope::ValueArenaScope( ValueArena &arena )
+   : previous_( boundArena )
+{
+   boundArena = &arena;
+}
 
-// Notes: index_ indicates if the string was allocated when
-// a string is stored.
 
-Value::CZString::CZString( int index )
-   : cstr_( 0 )
-   , index_( index )
+ValueArenaScope::ValueArenaScope()
+   : previous_( boundArena )
 {
+   boundArena = 0;
 }
 
-Value::CZString::CZString( const char *cstr, DuplicationPolicy allocate )
-   : cstr_( allocate == duplicate ? valueAllocator()->makeMemberName(cstr) 
-                                  : cstr )
-   , index_( allocate )
+
+ValueArenaScope::~ValueArenaScope()
 {
+   boundArena = previous_;
 }
 
-Value::CZString::CZString( const CZString &other )
-: cstr_( other.index_ != noDuplication &&  other.cstr_ != 0
-                ?  valueAllocator()->makeMemberName( other.cstr_ )
-                : other.cstr_ )
-   , index_( other.cstr_ ? (other.index_ == noDuplication ? noDuplication : duplicate)
-                         : other.index_ )
+
+static inline char *
+duplicateStringValue( const char *value, 
+                      unsigned int length )
 {
+   char *newString = static_cast<char *>( ValueArena::allocate( length + 1 ) );
+   memcpy( newString, value, length );
+   newString[length] = 0;
+   return newString;
 }
 
-Value::CZString::~CZString()
+
+static inline char *
+duplicateStringValue( const char *value )
 {
-   if ( cstr_  &&  index_ == duplicate )
-      valueAllocator()->releaseMemberName( const_cast<char *>( cstr_ ) );
+   return duplicateStringValue( value, (unsigned int)strlen( value ) );
 }
 
-void 
-Value::CZString::swap( CZString &other )
+
+static inline void 
+releaseStringValue( char *value )
 {
-   std::swap( cstr_, other.cstr_ );
-   std::swap( index_, other.index_ );
+   ValueArena::release( value );
 }
 
-Value::CZString &
-Value::CZString::operator =( const CZString &other )
+
+template<typename Container>
+static Container *
+newContainer()
 {
-   CZString temp( other );
-   swap( temp );
-   return *this;
+   return new ( ValueArena::allocate( sizeof(Container) ) ) Container();
 }
 
-bool 
-Value::CZString::operator<( const CZString &other ) const 
+
+template<typename Container>
+static Container *
+copyContainer( const Container &other )
 {
-   if ( cstr_ )
-      return strcmp( cstr_, other.cstr_ ) < 0;
-   return index_ < other.index_;
+   void *memory = ValueArena::allocate( sizeof(Container) );
+   try
+   {
+      return new ( memory ) Container( other );
+   }
+   catch ( ... )
+   {
+      ValueArena::release( memory );
+      throw;
+   }
 }
 
-bool 
-Value::CZString::operator==( const CZString &other ) const 
+
+template<typename Container>
+static void 
+deleteContainer( Container *container )
 {
-   if ( cstr_ )
-      return strcmp( cstr_, other.cstr_ ) == 0;
-   return index_ == other.index_;
+   container->~Container();
+   ValueArena::release( container );
 }
 
 
-int 
-Value::CZString::index() const
+
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// ValueInternals...
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+# include "json_objectmap.inl"
+# include "json_valueiterator.inl"
+
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class MemberKey
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+MemberKey::MemberKey( const char *name )
+   : name_( name )
+   , hash_( ValueObjectMap::hash( name ) )
 {
-   return index_;
 }
 
 
-const char *
-Value::CZString::c_str() const
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::CommentInfo
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+
+Value::CommentInfo::CommentInfo()
+   : comment_( 0 )
 {
-   return cstr_;
 }
 
-bool 
-Value::CZString::isStaticString() const
+Value::CommentInfo::~CommentInfo()
 {
-   return index_ == noDuplication;
+   if ( comment_ )
+      releaseStringValue( comment_ );
 }
 
-#endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
+
+void 
+Value::CommentInfo::setComment( const char *text )
+{
+   if ( comment_ )
+      releaseStringValue( comment_ );
+   JSON_ASSERT( text );
+   JSON_ASSERT_MESSAGE( text[0]=='\0' || text[0]=='/', "Comments must start with /");
+   // It seems that /**/ style comments are acceptable as well.
+   comment_ = duplicateStringValue( text );
+}
 
 
 // //////////////////////////////////////////////////////////////////
@@ -261,17 +383,10 @@ Value::CZString::isStaticString() const
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 
-/*! \internal Default constructor initialization must be equivalent to:
- * memset( this, 0, sizeof(Value) )
- * This optimization is used in ValueInternalMap fast allocator.
- */
 Value::Value( ValueType type )
    : type_( type )
    , allocated_( 0 )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    switch ( type )
    {
@@ -287,19 +402,12 @@ Value::Value( ValueType type )
    case stringValue:
       value_.string_ = 0;
       break;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
-   case objectValue:
-      value_.map_ = new ObjectValues();
-      break;
-#else
-   case arrayValue:
-      value_.array_ = arrayAllocator()->newArray();
+      value_.array_ = newContainer<ArrayValues>();
       break;
    case objectValue:
-      value_.map_ = mapAllocator()->newMap();
+      value_.map_ = newContainer<ObjectValues>();
       break;
-#endif
    case booleanValue:
       value_.bool_ = false;
       break;
@@ -312,9 +420,6 @@ Value::Value( ValueType type )
 Value::Value( Int value )
    : type_( intValue )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    value_.int_ = value;
 }
@@ -323,19 +428,30 @@ Value::Value( Int value )
 Value::Value( UInt value )
    : type_( uintValue )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    value_.uint_ = value;
 }
 
+
+Value::Value( Int64 value )
+   : type_( intValue )
+   , comments_( 0 )
+{
+   value_.int_ = value;
+}
+
+
+Value::Value( UInt64 value )
+   : type_( uintValue )
+   , comments_( 0 )
+{
+   value_.uint_ = value;
+}
+
+
 Value::Value( double value )
    : type_( realValue )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    value_.real_ = value;
 }
@@ -344,11 +460,8 @@ Value::Value( const char *value )
    : type_( stringValue )
    , allocated_( true )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( value );
+   value_.string_ = duplicateStringValue( value );
 }
 
 
@@ -357,11 +470,8 @@ Value::Value( const char *beginValue,
    : type_( stringValue )
    , allocated_( true )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( beginValue, 
+   value_.string_ = duplicateStringValue( beginValue, 
                                                             UInt(endValue - beginValue) );
 }
 
@@ -370,11 +480,8 @@ Value::Value( const std::string &value )
    : type_( stringValue )
    , allocated_( true )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( value.c_str(), 
+   value_.string_ = duplicateStringValue( value.c_str(), 
                                                             (unsigned int)value.length() );
 
 }
@@ -383,9 +490,6 @@ Value::Value( const StaticString &value )
    : type_( stringValue )
    , allocated_( false )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    value_.string_ = const_cast<char *>( value.c_str() );
 }
@@ -396,20 +500,14 @@ Value::Value( const CppTL::ConstString &value )
    : type_( stringValue )
    , allocated_( true )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( value, value.length() );
+   value_.string_ = duplicateStringValue( value, value.length() );
 }
 # endif
 
 Value::Value( bool value )
    : type_( booleanValue )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    value_.bool_ = value;
 }
@@ -418,9 +516,6 @@ Value::Value( bool value )
 Value::Value( const Value &other )
    : type_( other.type_ )
    , comments_( 0 )
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-   , itemIsUsed_( 0 )
-#endif
 {
    switch ( type_ )
    {
@@ -434,25 +529,18 @@ Value::Value( const Value &other )
    case stringValue:
       if ( other.value_.string_ )
       {
-         value_.string_ = valueAllocator()->duplicateStringValue( other.value_.string_ );
+         value_.string_ = duplicateStringValue( other.value_.string_ );
          allocated_ = true;
       }
       else
          value_.string_ = 0;
       break;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
-   case objectValue:
-      value_.map_ = new ObjectValues( *other.value_.map_ );
-      break;
-#else
-   case arrayValue:
-      value_.array_ = arrayAllocator()->newArrayCopy( *other.value_.array_ );
+      value_.array_ = copyContainer( *other.value_.array_ );
       break;
    case objectValue:
-      value_.map_ = mapAllocator()->newMapCopy( *other.value_.map_ );
+      value_.map_ = copyContainer( *other.value_.map_ );
       break;
-#endif
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -469,6 +557,7 @@ Value::Value( const Value &other )
 }
 
 
+
 Value::~Value()
 {
    switch ( type_ )
@@ -481,21 +570,14 @@ Value::~Value()
       break;
    case stringValue:
       if ( allocated_ )
-         valueAllocator()->releaseStringValue( value_.string_ );
+         releaseStringValue( value_.string_ );
       break;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
-   case objectValue:
-      delete value_.map_;
-      break;
-#else
-   case arrayValue:
-      arrayAllocator()->destructArray( value_.array_ );
+      deleteContainer( value_.array_ );
       break;
    case objectValue:
-      mapAllocator()->destructMap( value_.map_ );
+      deleteContainer( value_.map_ );
       break;
-#endif
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -584,8 +666,13 @@ Value::operator <( const Value &other ) const
              || ( other.value_.string_  
                   &&  value_.string_  
                   && strcmp( value_.string_, other.value_.string_ ) < 0 );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
+      {
+         int delta = int( value_.array_->size() - other.value_.array_->size() );
+         if ( delta )
+            return delta < 0;
+         return (*value_.array_) < (*other.value_.array_);
+      }
    case objectValue:
       {
          int delta = int( value_.map_->size() - other.value_.map_->size() );
@@ -593,12 +680,6 @@ Value::operator <( const Value &other ) const
             return delta < 0;
          return (*value_.map_) < (*other.value_.map_);
       }
-#else
-   case arrayValue:
-      return value_.array_->compare( *(other.value_.array_) ) < 0;
-   case objectValue:
-      return value_.map_->compare( *(other.value_.map_) ) < 0;
-#endif
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -650,17 +731,12 @@ Value::operator ==( const Value &other ) const
              || ( other.value_.string_  
                   &&  value_.string_  
                   && strcmp( value_.string_, other.value_.string_ ) == 0 );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
+      return value_.array_->size() == other.value_.array_->size()
+             && (*value_.array_) == (*other.value_.array_);
    case objectValue:
       return value_.map_->size() == other.value_.map_->size()
              && (*value_.map_) == (*other.value_.map_);
-#else
-   case arrayValue:
-      return value_.array_->compare( *(other.value_.array_) ) == 0;
-   case objectValue:
-      return value_.map_->compare( *(other.value_.map_) ) == 0;
-#endif
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -720,10 +796,11 @@ Value::asInt() const
    case nullValue:
       return 0;
    case intValue:
-      return value_.int_;
+      JSON_ASSERT_MESSAGE( value_.int_ >= minInt  &&  value_.int_ <= maxInt, "integer out of signed integer range" );
+      return Int( value_.int_ );
    case uintValue:
-      JSON_ASSERT_MESSAGE( value_.uint_ < (unsigned)maxInt, "integer out of signed integer range" );
-      return value_.uint_;
+      JSON_ASSERT_MESSAGE( value_.uint_ <= UInt64(maxInt), "integer out of signed integer range" );
+      return Int( value_.uint_ );
    case realValue:
       JSON_ASSERT_MESSAGE( value_.real_ >= minInt  &&  value_.real_ <= maxInt, "Real out of signed integer range" );
       return Int( value_.real_ );
@@ -748,9 +825,11 @@ Value::asUInt() const
       return 0;
    case intValue:
       JSON_ASSERT_MESSAGE( value_.int_ >= 0, "Negative integer can not be converted to unsigned integer" );
-      return value_.int_;
+      JSON_ASSERT_MESSAGE( value_.int_ <= Int64(maxUInt), "integer out of unsigned integer range" );
+      return UInt( value_.int_ );
    case uintValue:
-      return value_.uint_;
+      JSON_ASSERT_MESSAGE( value_.uint_ <= maxUInt, "integer out of unsigned integer range" );
+      return UInt( value_.uint_ );
    case realValue:
       JSON_ASSERT_MESSAGE( value_.real_ >= 0  &&  value_.real_ <= maxUInt,  "Real out of unsigned integer range" );
       return UInt( value_.real_ );
@@ -766,6 +845,64 @@ Value::asUInt() const
    return 0; // unreachable;
 }
 
+
+Value::Int64 
+Value::asInt64() const
+{
+   switch ( type_ )
+   {
+   case nullValue:
+      return 0;
+   case intValue:
+      return value_.int_;
+   case uintValue:
+      JSON_ASSERT_MESSAGE( value_.uint_ <= UInt64(maxInt64), "integer out of signed 64 bit integer range" );
+      return Int64( value_.uint_ );
+   case realValue:
+      // maxInt64 is not representable as double, compare against 2^63 instead
+      JSON_ASSERT_MESSAGE( value_.real_ >= double(minInt64)  &&  value_.real_ < -double(minInt64), "Real out of signed 64 bit integer range" );
+      return Int64( value_.real_ );
+   case booleanValue:
+      return value_.bool_ ? 1 : 0;
+   case stringValue:
+   case arrayValue:
+   case objectValue:
+      JSON_ASSERT_MESSAGE( false, "Type is not convertible to int64" );
+   default:
+      JSON_ASSERT_UNREACHABLE;
+   }
+   return 0; // unreachable;
+}
+
+
+Value::UInt64 
+Value::asUInt64() const
+{
+   switch ( type_ )
+   {
+   case nullValue:
+      return 0;
+   case intValue:
+      JSON_ASSERT_MESSAGE( value_.int_ >= 0, "Negative integer can not be converted to unsigned integer" );
+      return UInt64( value_.int_ );
+   case uintValue:
+      return value_.uint_;
+   case realValue:
+      // maxUInt64 is not representable as double, compare against 2^64 instead
+      JSON_ASSERT_MESSAGE( value_.real_ >= 0  &&  value_.real_ < -2.0 * double(minInt64), "Real out of unsigned 64 bit integer range" );
+      return UInt64( value_.real_ );
+   case booleanValue:
+      return value_.bool_ ? 1 : 0;
+   case stringValue:
+   case arrayValue:
+   case objectValue:
+      JSON_ASSERT_MESSAGE( false, "Type is not convertible to uint64" );
+   default:
+      JSON_ASSERT_UNREACHABLE;
+   }
+   return 0; // unreachable;
+}
+
 double 
 Value::asDouble() const
 {
@@ -774,9 +911,9 @@ Value::asDouble() const
    case nullValue:
       return 0.0;
    case intValue:
-      return value_.int_;
+      return double( value_.int_ );
    case uintValue:
-      return value_.uint_;
+      return double( value_.uint_ );
    case realValue:
       return value_.real_;
    case booleanValue:
@@ -809,7 +946,7 @@ Value::asBool() const
       return value_.string_  &&  value_.string_[0] != 0;
    case arrayValue:
    case objectValue:
-      return value_.map_->size() != 0;
+      return size() != 0;
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -826,15 +963,15 @@ Value::isConvertibleTo( ValueType other ) const
       return true;
    case intValue:
       return ( other == nullValue  &&  value_.int_ == 0 )
-             || other == intValue
-             || ( other == uintValue  && value_.int_ >= 0 )
+             || ( other == intValue  &&  value_.int_ >= minInt  &&  value_.int_ <= maxInt )
+             || ( other == uintValue  &&  value_.int_ >= 0  &&  value_.int_ <= Int64(maxUInt) )
              || other == realValue
              || other == stringValue
              || other == booleanValue;
    case uintValue:
       return ( other == nullValue  &&  value_.uint_ == 0 )
-             || ( other == intValue  && value_.uint_ <= (unsigned)maxInt )
-             || other == uintValue
+             || ( other == intValue  &&  value_.uint_ <= UInt64(maxInt) )
+             || ( other == uintValue  &&  value_.uint_ <= maxUInt )
              || other == realValue
              || other == stringValue
              || other == booleanValue;
@@ -857,10 +994,10 @@ Value::isConvertibleTo( ValueType other ) const
              || ( other == nullValue  &&  (!value_.string_  ||  value_.string_[0] == 0) );
    case arrayValue:
       return other == arrayValue
-             ||  ( other == nullValue  &&  value_.map_->size() == 0 );
+             ||  ( other == nullValue  &&  size() == 0 );
    case objectValue:
       return other == objectValue
-             ||  ( other == nullValue  &&  value_.map_->size() == 0 );
+             ||  ( other == nullValue  &&  size() == 0 );
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -881,23 +1018,10 @@ Value::size() const
    case booleanValue:
    case stringValue:
       return 0;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   case arrayValue:  // size of the array is highest index + 1
-      if ( !value_.map_->empty() )
-      {
-         ObjectValues::const_iterator itLast = value_.map_->end();
-         --itLast;
-         return (*itLast).first.index()+1;
-      }
-      return 0;
-   case objectValue:
-      return Int( value_.map_->size() );
-#else
    case arrayValue:
-      return Int( value_.array_->size() );
+      return UInt( value_.array_->size() );
    case objectValue:
       return Int( value_.map_->size() );
-#endif
    default:
       JSON_ASSERT_UNREACHABLE;
    }
@@ -929,19 +1053,12 @@ Value::clear()
 
    switch ( type_ )
    {
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   case arrayValue:
-   case objectValue:
-      value_.map_->clear();
-      break;
-#else
    case arrayValue:
       value_.array_->clear();
       break;
    case objectValue:
       value_.map_->clear();
       break;
-#endif
    default:
       break;
    }
@@ -953,21 +1070,31 @@ Value::resize( UInt newSize )
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
    if ( type_ == nullValue )
       *this = Value( arrayValue );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   UInt oldSize = size();
-   if ( newSize == 0 )
-      clear();
-   else if ( newSize > oldSize )
-      (*this)[ newSize - 1 ];
-   else
+   reserve( newSize );
+   value_.array_->resize( newSize );
+}
+
+
+void 
+Value::reserve( UInt newSize )
+{
+   JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
+   if ( type_ == nullValue )
+      *this = Value( arrayValue );
+   if ( newSize <= value_.array_->capacity() )
+      return;
+   // Let std::vector allocate the new block, but transfer the elements by
+   // swapping them (comments included) instead of deep copying each subtree.
+   ArrayValues grown;
+   grown.reserve( newSize );
+   grown.resize( value_.array_->size() );
+   for ( ArrayIndex index = 0; index < grown.size(); ++index )
    {
-      for ( UInt index = newSize; index < oldSize; ++index )
-         value_.map_->erase( index );
-      assert( size() == newSize );
+      Value &from = (*value_.array_)[index];
+      grown[index].swap( from );
+      std::swap( grown[index].comments_, from.comments_ );
    }
-#else
-   value_.array_->resize( newSize );
-#endif
+   value_.array_->swap( grown );
 }
 
 
@@ -977,18 +1104,14 @@ Value::operator[]( UInt index )
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
    if ( type_ == nullValue )
       *this = Value( arrayValue );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   CZString key( index );
-   ObjectValues::iterator it = value_.map_->lower_bound( key );
-   if ( it != value_.map_->end()  &&  (*it).first == key )
-      return (*it).second;
-
-   ObjectValues::value_type defaultValue( key, null );
-   it = value_.map_->insert( it, defaultValue );
-   return (*it).second;
-#else
-   return value_.array_->resolveReference( index );
-#endif
+   if ( index >= value_.array_->size() )
+   {
+      UInt capacity = UInt( value_.array_->capacity() );
+      if ( index >= capacity )
+         reserve( index < capacity * 2 ? capacity * 2 : index + 1 );
+      value_.array_->resize( index + 1 );
+   }
+   return (*value_.array_)[index];
 }
 
 
@@ -998,16 +1121,9 @@ Value::operator[]( UInt index ) const
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
    if ( type_ == nullValue )
       return null;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   CZString key( index );
-   ObjectValues::const_iterator it = value_.map_->find( key );
-   if ( it == value_.map_->end() )
+   if ( index >= value_.array_->size() )
       return null;
-   return (*it).second;
-#else
-   Value *value = value_.array_->find( index );
-   return value ? *value : null;
-#endif
+   return (*value_.array_)[index];
 }
 
 
@@ -1025,20 +1141,7 @@ Value::resolveReference( const char *key,
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
    if ( type_ == nullValue )
       *this = Value( objectValue );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   CZString actualKey( key, isStatic ? CZString::noDuplication 
-                                     : CZString::duplicateOnCopy );
-   ObjectValues::iterator it = value_.map_->lower_bound( actualKey );
-   if ( it != value_.map_->end()  &&  (*it).first == actualKey )
-      return (*it).second;
-
-   ObjectValues::value_type defaultValue( actualKey, null );
-   it = value_.map_->insert( it, defaultValue );
-   Value &value = (*it).second;
-   return value;
-#else
    return value_.map_->resolveReference( key, isStatic );
-#endif
 }
 
 
@@ -1065,16 +1168,8 @@ Value::operator[]( const char *key ) const
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
    if ( type_ == nullValue )
       return null;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   CZString actualKey( key, CZString::noDuplication );
-   ObjectValues::const_iterator it = value_.map_->find( actualKey );
-   if ( it == value_.map_->end() )
-      return null;
-   return (*it).second;
-#else
    const Value *value = value_.map_->find( key );
    return value ? *value : null;
-#endif
 }
 
 
@@ -1117,10 +1212,18 @@ Value::operator[]( const CppTL::ConstString &key ) const
 Value &
 Value::append( const Value &value )
 {
-   return (*this)[size()] = value;
+   JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
+   if ( type_ == nullValue )
+      *this = Value( arrayValue );
+   UInt capacity = UInt( value_.array_->capacity() );
+   if ( value_.array_->size() == capacity )
+      reserve( capacity ? capacity * 2 : 4 );
+   value_.array_->push_back( value );
+   return value_.array_->back();
 }
 
 
+
 Value 
 Value::get( const char *key, 
             const Value &defaultValue ) const
@@ -1143,24 +1246,12 @@ Value::removeMember( const char* key )
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
    if ( type_ == nullValue )
       return null;
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   CZString actualKey( key, CZString::noDuplication );
-   ObjectValues::iterator it = value_.map_->find( actualKey );
-   if ( it == value_.map_->end() )
+   const Value *value = value_.map_->find( key );
+   if ( !value )
       return null;
-   Value old(it->second);
-   value_.map_->erase(it);
+   Value old( *value );
+   value_.map_->remove( key );
    return old;
-#else
-   Value *value = value_.map_->find( key );
-   if (value){
-      Value old(*value);
-      value_.map_.remove( key );
-      return old;
-   } else {
-      return null;
-   }
-#endif
 }
 
 Value
@@ -1178,6 +1269,24 @@ Value::get( const CppTL::ConstString &key,
 }
 # endif
 
+const Value *
+Value::find( const char *key ) const
+{
+   if ( type_ != objectValue )
+      return 0;
+   return value_.map_->find( key );
+}
+
+
+const Value *
+Value::find( const MemberKey &key ) const
+{
+   if ( type_ != objectValue )
+      return 0;
+   return value_.map_->find( key.c_str(), key.hash() );
+}
+
+
 bool 
 Value::isMember( const char *key ) const
 {
@@ -1209,19 +1318,8 @@ Value::getMemberNames() const
        return Value::Members();
    Members members;
    members.reserve( value_.map_->size() );
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-   ObjectValues::const_iterator it = value_.map_->begin();
-   ObjectValues::const_iterator itEnd = value_.map_->end();
-   for ( ; it != itEnd; ++it )
-      members.push_back( std::string( (*it).first.c_str() ) );
-#else
-   ValueInternalMap::IteratorState it;
-   ValueInternalMap::IteratorState itEnd;
-   value_.map_->makeBeginIterator( it );
-   value_.map_->makeEndIterator( itEnd );
-   for ( ; !ValueInternalMap::equals( it, itEnd ); ValueInternalMap::increment(it) )
-      members.push_back( std::string( ValueInternalMap::key( it ) ) );
-#endif
+   for ( ObjectValues::MemberIndex position = 0; position < value_.map_->size(); ++position )
+      members.push_back( std::string( value_.map_->keyAt( position ) ) );
    return members;
 }
 //
@@ -1369,30 +1467,14 @@ Value::begin() const
 {
    switch ( type_ )
    {
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
       if ( value_.array_ )
-      {
-         ValueInternalArray::IteratorState it;
-         value_.array_->makeBeginIterator( it );
-         return const_iterator( it );
-      }
-      break;
-   case objectValue:
-      if ( value_.map_ )
-      {
-         ValueInternalMap::IteratorState it;
-         value_.map_->makeBeginIterator( it );
-         return const_iterator( it );
-      }
+         return const_iterator( value_.array_->begin(), value_.array_->begin() );
       break;
-#else
-   case arrayValue:
    case objectValue:
       if ( value_.map_ )
-         return const_iterator( value_.map_->begin() );
+         return const_iterator( value_.map_, 0 );
       break;
-#endif
    default:
       break;
    }
@@ -1404,30 +1486,14 @@ Value::end() const
 {
    switch ( type_ )
    {
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
       if ( value_.array_ )
-      {
-         ValueInternalArray::IteratorState it;
-         value_.array_->makeEndIterator( it );
-         return const_iterator( it );
-      }
-      break;
-   case objectValue:
-      if ( value_.map_ )
-      {
-         ValueInternalMap::IteratorState it;
-         value_.map_->makeEndIterator( it );
-         return const_iterator( it );
-      }
+         return const_iterator( value_.array_->begin(), value_.array_->end() );
       break;
-#else
-   case arrayValue:
    case objectValue:
       if ( value_.map_ )
-         return const_iterator( value_.map_->end() );
+         return const_iterator( value_.map_, value_.map_->size() );
       break;
-#endif
    default:
       break;
    }
@@ -1440,30 +1506,14 @@ Value::begin()
 {
    switch ( type_ )
    {
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
       if ( value_.array_ )
-      {
-         ValueInternalArray::IteratorState it;
-         value_.array_->makeBeginIterator( it );
-         return iterator( it );
-      }
-      break;
-   case objectValue:
-      if ( value_.map_ )
-      {
-         ValueInternalMap::IteratorState it;
-         value_.map_->makeBeginIterator( it );
-         return iterator( it );
-      }
+         return iterator( value_.array_->begin(), value_.array_->begin() );
       break;
-#else
-   case arrayValue:
    case objectValue:
       if ( value_.map_ )
-         return iterator( value_.map_->begin() );
+         return iterator( value_.map_, 0 );
       break;
-#endif
    default:
       break;
    }
@@ -1475,30 +1525,14 @@ Value::end()
 {
    switch ( type_ )
    {
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
       if ( value_.array_ )
-      {
-         ValueInternalArray::IteratorState it;
-         value_.array_->makeEndIterator( it );
-         return iterator( it );
-      }
-      break;
-   case objectValue:
-      if ( value_.map_ )
-      {
-         ValueInternalMap::IteratorState it;
-         value_.map_->makeEndIterator( it );
-         return iterator( it );
-      }
+         return iterator( value_.array_->begin(), value_.array_->end() );
       break;
-#else
-   case arrayValue:
    case objectValue:
       if ( value_.map_ )
-         return iterator( value_.map_->end() );
+         return iterator( value_.map_, value_.map_->size() );
       break;
-#endif
    default:
       break;
    }
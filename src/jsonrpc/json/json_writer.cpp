@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -11,23 +12,65 @@
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
 #endif
 
+#include "json_scanner.inl"
+
 namespace Json {
 
-static bool isControlCharacter(char ch)
-{
-   return ch > 0 && ch <= 0x1F;
-}
+#include "json_grisu.inl"
 
-static bool containsControlCharacter( const char* str )
+/// Appends [begin, end) as a quoted JSON string. Runs of characters that
+/// need no escaping are found by the scanner and copied in one go.
+static void 
+appendQuotedString( std::string &document, const char *begin, const char *end )
 {
-   while ( *str ) 
+   static const char hexDigits[] = "0123456789ABCDEF";
+   document += '"';
+   while ( true )
    {
-      if ( isControlCharacter( *(str++) ) )
-         return true;
+      const char *escaped = scanEscaped( begin, end );
+      document.append( begin, escaped );
+      if ( escaped == end )
+         break;
+      switch ( *escaped )
+      {
+      case '"':
+         document.append( "\\\"", 2 );
+         break;
+      case '\\':
+         document.append( "\\\\", 2 );
+         break;
+      case '\b':
+         document.append( "\\b", 2 );
+         break;
+      case '\f':
+         document.append( "\\f", 2 );
+         break;
+      case '\n':
+         document.append( "\\n", 2 );
+         break;
+      case '\r':
+         document.append( "\\r", 2 );
+         break;
+      case '\t':
+         document.append( "\\t", 2 );
+         break;
+      // Even though \/ is considered a legal escape in JSON, a bare
+      // slash is also legal, so it is not escaped.
+      default:
+         {
+            // other control characters
+            unsigned char c = (unsigned char)( *escaped );
+            const char unicode[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xf] };
+            document.append( unicode, sizeof(unicode) );
+         }
+         break;
+      }
+      begin = escaped + 1;
    }
-   return false;
+   document += '"';
 }
-static void uintToString( unsigned int value, 
+
+static void uintToString( UInt64 value, 
                           char *&current )
 {
    *--current = 0;
@@ -63,43 +106,33 @@ std::string valueToString( UInt value )
    return current;
 }
 
+std::string valueToString( Int64 value )
+{
+   char buffer[32];
+   char *current = buffer + sizeof(buffer);
+   bool isNegative = value < 0;
+   // negate as unsigned, -minInt64 does not fit into Int64
+   uintToString( isNegative ? UInt64(0) - UInt64(value) : UInt64(value), current );
+   if ( isNegative )
+      *--current = '-';
+   assert( current >= buffer );
+   return current;
+}
+
+
+std::string valueToString( UInt64 value )
+{
+   char buffer[32];
+   char *current = buffer + sizeof(buffer);
+   uintToString( value, current );
+   assert( current >= buffer );
+   return current;
+}
+
 std::string valueToString( double value )
 {
    char buffer[32];
-#if defined(_MSC_VER) && defined(__STDC_SECURE_LIB__) // Use secure version with visual studio 2005 to avoid warning. 
-   sprintf_s(buffer, sizeof(buffer), "%#.16g", value); 
-#else	
-   sprintf(buffer, "%#.16g", value); 
-#endif
-   char* ch = buffer + strlen(buffer) - 1;
-   if (*ch != '0') return buffer; // nothing to truncate, so save time
-   while(ch > buffer && *ch == '0'){
-     --ch;
-   }
-   char* last_nonzero = ch;
-   while(ch >= buffer){
-     switch(*ch){
-     case '0':
-     case '1':
-     case '2':
-     case '3':
-     case '4':
-     case '5':
-     case '6':
-     case '7':
-     case '8':
-     case '9':
-       --ch;
-       continue;
-     case '.':
-       // Truncate zeroes to save bytes in output, but keep one.
-       *(last_nonzero+2) = '\0';
-       return buffer;
-     default:
-       return buffer;
-     }
-   }
-   return buffer;
+   return std::string( buffer, formatDouble( value, buffer ) );
 }
 
 
@@ -110,64 +143,8 @@ std::string valueToString( bool value )
 
 std::string valueToQuotedString( const char *value )
 {
-   // Not sure how to handle unicode...
-   if (strpbrk(value, "\"\\\b\f\n\r\t") == NULL && !containsControlCharacter( value ))
-      return std::string("\"") + value + "\"";
-   // We have to walk value and escape any special characters.
-   // Appending to std::string is not efficient, but this should be rare.
-   // (Note: forward slashes are *not* rare, but I am not escaping them.)
-   unsigned maxsize = strlen(value)*2 + 3; // allescaped+quotes+NULL
    std::string result;
-   result.reserve(maxsize); // to avoid lots of mallocs
-   result += "\"";
-   for (const char* c=value; *c != 0; ++c)
-   {
-      switch(*c)
-      {
-         case '\"':
-            result += "\\\"";
-            break;
-         case '\\':
-            result += "\\\\";
-            break;
-         case '\b':
-            result += "\\b";
-            break;
-         case '\f':
-            result += "\\f";
-            break;
-         case '\n':
-            result += "\\n";
-            break;
-         case '\r':
-            result += "\\r";
-            break;
-         case '\t':
-            result += "\\t";
-            break;
-         //case '/':
-            // Even though \/ is considered a legal escape in JSON, a bare
-            // slash is also legal, so I see no reason to escape it.
-            // (I hope I am not misunderstanding something.
-            // blep notes: actually escaping \/ may be useful in javascript to avoid </ 
-            // sequence.
-            // Should add a flag to allow this compatibility mode and prevent this 
-            // sequence from occurring.
-         default:
-            if ( isControlCharacter( *c ) )
-            {
-               std::ostringstream oss;
-               oss << "\\u" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << static_cast<int>(*c);
-               result += oss.str();
-            }
-            else
-            {
-               result += *c;
-            }
-            break;
-      }
-   }
-   result += "\"";
+   appendQuotedString( result, value, value + strlen( value ) );
    return result;
 }
 
@@ -178,11 +155,22 @@ Writer::~Writer()
 }
 
 
+// Class OutputSink
+// //////////////////////////////////////////////////////////////////
+OutputSink::~OutputSink()
+{
+}
+
+
 // Class FastWriter
 // //////////////////////////////////////////////////////////////////
 
 FastWriter::FastWriter()
-   : yamlCompatiblityEnabled_( false )
+   : templates_( 0 )
+   , templateCount_( 0 )
+   , sink_( 0 )
+   , chunkSize_( 16384 )
+   , yamlCompatiblityEnabled_( false )
 {
 }
 
@@ -194,16 +182,140 @@ FastWriter::enableYAMLCompatibility()
 }
 
 
+void 
+FastWriter::setChunkSize( size_t chunkSize )
+{
+   chunkSize_ = chunkSize > 0 ? chunkSize : 1;
+}
+
+
+void 
+FastWriter::setRawMember( const std::string &member, const std::string &outputName )
+{
+   rawMember_ = member;
+   rawOutputName_ = outputName;
+}
+
+
+void 
+FastWriter::setTemplates( const ObjectTemplate *templates, unsigned int count )
+{
+   templates_ = templates;
+   templateCount_ = count;
+}
+
+
 std::string 
 FastWriter::write( const Value &root )
 {
    document_ = "";
-   writeValue( root );
+   writeRoot( root );
    document_ += "\n";
    return document_;
 }
 
 
+void 
+FastWriter::write( const Value &root, OutputSink &sink )
+{
+   document_.clear();
+   document_.reserve( chunkSize_ );
+   sink_ = &sink;
+   writeRoot( root );
+   document_ += "\n";
+   flushChunk();
+   sink_ = 0;
+   // a huge string can blow the chunk buffer up, which is not worth keeping
+   if ( document_.capacity() > 2 * chunkSize_ )
+      std::string().swap( document_ );
+}
+
+
+void 
+FastWriter::flushChunk()
+{
+   sink_->write( document_.data(), document_.size() );
+   // keeps the capacity, so the chunk buffer is allocated once per document
+   document_.clear();
+}
+
+
+void 
+FastWriter::writeRoot( const Value &root )
+{
+   if ( rawMember_.empty()  &&  templateCount_ == 0 )
+      writeValue( root );
+   else if ( root.type() == arrayValue )
+   {
+      document_ += "[";
+      Value::const_iterator itBegin = root.begin();
+      Value::const_iterator itEnd = root.end();
+      for ( Value::const_iterator it = itBegin; it != itEnd; ++it )
+      {
+         if ( it != itBegin )
+            document_ += ",";
+         writeRootObject( *it );
+      }
+      document_ += "]";
+   }
+   else
+      writeRootObject( root );
+}
+
+
+void 
+FastWriter::writeRootObject( const Value &value )
+{
+   if ( value.type() != objectValue )
+      writeValue( value );
+   else if ( !writeTemplate( value ) )
+      writeObject( value, !rawMember_.empty() );
+}
+
+
+bool 
+FastWriter::writeTemplate( const Value &value )
+{
+   for ( unsigned int index = 0; index < templateCount_; ++index )
+   {
+      const ObjectTemplate &objectTemplate = templates_[index];
+      if ( value.size() != objectTemplate.memberCount )
+         continue;
+      // everything is checked before anything is written, a chunk may be flushed meanwhile
+      const ObjectTemplate::Member *member = objectTemplate.members;
+      Value::const_iterator itEnd = value.end();
+      Value::const_iterator it = value.begin();
+      for ( ; it != itEnd; ++it, ++member )
+      {
+         if ( strcmp( it.memberName(), member->name ) != 0 )
+            break;
+         if ( member->constant  &&  ( (*it).type() != stringValue  ||  strcmp( (*it).asCString(), member->constant ) != 0 ) )
+            break;
+      }
+      if ( it != itEnd )
+         continue;
+
+      member = objectTemplate.members;
+      for ( it = value.begin(); it != itEnd; ++it, ++member )
+      {
+         document_ += member->prefix;
+         if ( member->constant )
+            continue;
+         const char *rendered = member->renderer ? member->renderer( *it ) : 0;
+         if ( rendered )
+            document_ += rendered;
+         else
+            writeValue( *it );
+      }
+      document_ += objectTemplate.suffix;
+      if ( sink_  &&  document_.size() >= chunkSize_ )
+         flushChunk();
+      return true;
+   }
+   return false;
+}
+
+
 void 
 FastWriter::writeValue( const Value &value )
 {
@@ -213,16 +325,19 @@ FastWriter::writeValue( const Value &value )
       document_ += "null";
       break;
    case intValue:
-      document_ += valueToString( value.asInt() );
+      document_ += valueToString( value.asInt64() );
       break;
    case uintValue:
-      document_ += valueToString( value.asUInt() );
+      document_ += valueToString( value.asUInt64() );
       break;
    case realValue:
       document_ += valueToString( value.asDouble() );
       break;
    case stringValue:
-      document_ += valueToQuotedString( value.asCString() );
+      {
+         const char *string = value.asCString();
+         appendQuotedString( document_, string, string + strlen( string ) );
+      }
       break;
    case booleanValue:
       document_ += valueToString( value.asBool() );
@@ -230,36 +345,51 @@ FastWriter::writeValue( const Value &value )
    case arrayValue:
       {
          document_ += "[";
-         int size = value.size();
-         for ( int index =0; index < size; ++index )
+         Value::const_iterator itBegin = value.begin();
+         Value::const_iterator itEnd = value.end();
+         for ( Value::const_iterator it = itBegin; it != itEnd; ++it )
          {
-            if ( index > 0 )
+            if ( it != itBegin )
                document_ += ",";
-            writeValue( value[index] );
+            writeValue( *it );
          }
          document_ += "]";
       }
       break;
    case objectValue:
+      writeObject( value, false );
+      break;
+   }
+   if ( sink_  &&  document_.size() >= chunkSize_ )
+      flushChunk();
+}
+
+
+void 
+FastWriter::writeObject( const Value &value, bool spliceRaw )
+{
+   document_ += "{";
+   Value::const_iterator itBegin = value.begin();
+   Value::const_iterator itEnd = value.end();
+   for ( Value::const_iterator it = itBegin; it != itEnd; ++it )
+   {
+      if ( it != itBegin )
+         document_ += ",";
+      const char *name = it.memberName();
+      if ( spliceRaw  &&  (*it).type() == stringValue  &&  rawMember_ == name )
       {
-         Value::Members members( value.getMemberNames() );
-         document_ += "{";
-         for ( Value::Members::iterator it = members.begin(); 
-               it != members.end(); 
-               ++it )
-         {
-            const std::string &name = *it;
-            if ( it != members.begin() )
-               document_ += ",";
-            document_ += valueToQuotedString( name.c_str() );
-            document_ += yamlCompatiblityEnabled_ ? ": " 
-                                                  : ":";
-            writeValue( value[name] );
-         }
-         document_ += "}";
+         appendQuotedString( document_, rawOutputName_.data(), rawOutputName_.data() + rawOutputName_.size() );
+         document_ += yamlCompatiblityEnabled_ ? ": " 
+                                               : ":";
+         document_ += (*it).asCString();
+         continue;
       }
-      break;
+      appendQuotedString( document_, name, name + strlen( name ) );
+      document_ += yamlCompatiblityEnabled_ ? ": " 
+                                            : ":";
+      writeValue( *it );
    }
+   document_ += "}";
 }
 
 
@@ -296,10 +426,10 @@ StyledWriter::writeValue( const Value &value )
       pushValue( "null" );
       break;
    case intValue:
-      pushValue( valueToString( value.asInt() ) );
+      pushValue( valueToString( value.asInt64() ) );
       break;
    case uintValue:
-      pushValue( valueToString( value.asUInt() ) );
+      pushValue( valueToString( value.asUInt64() ) );
       break;
    case realValue:
       pushValue( valueToString( value.asDouble() ) );
@@ -572,10 +702,10 @@ StyledStreamWriter::writeValue( const Value &value )
       pushValue( "null" );
       break;
    case intValue:
-      pushValue( valueToString( value.asInt() ) );
+      pushValue( valueToString( value.asInt64() ) );
       break;
    case uintValue:
-      pushValue( valueToString( value.asUInt() ) );
+      pushValue( valueToString( value.asUInt64() ) );
       break;
    case realValue:
       pushValue( valueToString( value.asDouble() ) );
@@ -4,12 +4,9 @@
 # include "forwards.h"
 # include <string>
 # include <vector>
+# include <new>
+# include <cstddef>
 
-# ifndef JSON_USE_CPPTL_SMALLMAP
-#  include <map>
-# else
-#  include <cpptl/smallmap.h>
-# endif
 # ifdef JSON_USE_CPPTL
 #  include <cpptl/forwards.h>
 # endif
@@ -81,11 +78,191 @@ namespace Json {
       const char *str_;
    };
 
+   /** \brief A member name with its hash computed once.
+    *
+    * Looking a member up with Value::find( const MemberKey & ) spares hashing the
+    * name on every look-up. The name is not copied and must outlive the key.
+    */
+   class JSON_API MemberKey
+   {
+   public:
+      explicit MemberKey( const char *name );
+
+      const char *c_str() const
+      {
+         return name_;
+      }
+
+      unsigned int hash() const
+      {
+         return hash_;
+      }
+
+   private:
+      const char *name_;
+      unsigned int hash_;
+   };
+
+   /** \brief Monotonic memory arena for the Value trees of a request.
+    *
+    * While a ValueArenaScope is active on a thread, the memory used by the Value
+    * trees created on that thread (array and object storage, member names and
+    * strings) is carved out of the arena pages instead of being malloc'ed piece by
+    * piece, and releasing it only decrements a counter. Once the request is
+    * handled, reset() makes the pages available again in one shot.
+    *
+    * A Value may safely outlive the scope or the arena, or be destroyed by another
+    * thread: the arena pages stay alive until their last Value is released, and
+    * reset() then continues with fresh pages. Allocations larger than a quarter of
+    * a page are served by the heap. Since one surviving Value keeps all pages of
+    * its arena generation alive, code that keeps Values beyond the request should
+    * create them in a ValueArenaScope that binds no arena.
+    *
+    * Example of usage:
+    * \code
+    * Json::ValueArena arena;
+    * {
+    *    Json::ValueArenaScope scope( arena );
+    *    Json::Value request;
+    *    reader.parse( document, request );
+    *    ...
+    * }
+    * arena.reset();
+    * \endcode
+    */
+   class JSON_API ValueArena
+   {
+   public:
+      enum { defaultPageSize = 4096 };
+
+      explicit ValueArena( unsigned int pageSize = defaultPageSize );
+      ~ValueArena();
+
+      /// Rewinds the arena so that its pages are reused by the next allocations.
+      void reset();
+
+      /// Number of bytes handed out since construction or the last reset().
+      size_t usedBytes() const;
+
+      /// Allocates size bytes from the arena bound to the calling thread, or from
+      /// the heap if there is none. Used by Value, exposed for ValueArenaAllocator.
+      static void *allocate( size_t size );
+      /// Releases memory obtained from allocate(), whichever thread allocated it.
+      static void release( void *memory );
+
+   private:
+      friend class ValueArenaScope;
+      struct Pages;
+
+      ValueArena( const ValueArena & );          // no implementation
+      void operator =( const ValueArena & );     // no implementation
+
+      Pages *pages_;
+      unsigned int pageSize_;
+   };
+
+   /** \brief Binds the calling thread's Value allocations to a ValueArena for its lifetime.
+    *
+    * Scopes may be nested, the previous binding is restored on destruction.
+    */
+   class JSON_API ValueArenaScope
+   {
+   public:
+      explicit ValueArenaScope( ValueArena &arena );
+      /// Binds no arena, the Values created meanwhile use the heap and can be kept
+      /// without holding on to the pages of an arena.
+      ValueArenaScope();
+      ~ValueArenaScope();
+
+   private:
+      ValueArenaScope( const ValueArenaScope & );      // no implementation
+      void operator =( const ValueArenaScope & );      // no implementation
+
+      ValueArena *previous_;
+   };
+
+   /** \brief Standard allocator routing the storage of Value containers through ValueArena.
+    */
+   template<typename T>
+   class ValueArenaAllocator
+   {
+   public:
+      typedef T value_type;
+      typedef T *pointer;
+      typedef const T *const_pointer;
+      typedef T &reference;
+      typedef const T &const_reference;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+
+      template<typename U>
+      struct rebind
+      {
+         typedef ValueArenaAllocator<U> other;
+      };
+
+      ValueArenaAllocator()
+      {
+      }
+
+      template<typename U>
+      ValueArenaAllocator( const ValueArenaAllocator<U> & )
+      {
+      }
+
+      pointer address( reference value ) const
+      {
+         return &value;
+      }
+
+      const_pointer address( const_reference value ) const
+      {
+         return &value;
+      }
+
+      pointer allocate( size_type count, const void * = 0 )
+      {
+         return static_cast<pointer>( ValueArena::allocate( count * sizeof(T) ) );
+      }
+
+      void deallocate( pointer memory, size_type )
+      {
+         ValueArena::release( memory );
+      }
+
+      size_type max_size() const
+      {
+         return size_type(-1) / sizeof(T);
+      }
+
+      void construct( pointer memory, const T &value )
+      {
+         new ( memory ) T( value );
+      }
+
+      void destroy( pointer memory )
+      {
+         memory->~T();
+      }
+
+      template<typename U>
+      bool operator ==( const ValueArenaAllocator<U> & ) const
+      {
+         return true;
+      }
+
+      template<typename U>
+      bool operator !=( const ValueArenaAllocator<U> & ) const
+      {
+         return false;
+      }
+   };
+
    /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
     *
     * This class is a discriminated union wrapper that can represents a:
-    * - signed integer [range: Value::minInt - Value::maxInt]
-    * - unsigned integer (range: 0 - Value::maxUInt)
+    * - signed integer [range: Value::minInt64 - Value::maxInt64]
+    * - unsigned integer (range: 0 - Value::maxUInt64)
     * - double
     * - UTF-8 string
     * - boolean
@@ -111,58 +288,30 @@ namespace Json {
    class JSON_API Value 
    {
       friend class ValueIteratorBase;
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-      friend class ValueInternalLink;
-      friend class ValueInternalMap;
-# endif
+      friend class ValueObjectMap;
    public:
       typedef std::vector<std::string> Members;
       typedef ValueIterator iterator;
       typedef ValueConstIterator const_iterator;
       typedef Json::UInt UInt;
       typedef Json::Int Int;
+      typedef Json::UInt64 UInt64;
+      typedef Json::Int64 Int64;
       typedef UInt ArrayIndex;
 
       static const Value null;
       static const Int minInt;
       static const Int maxInt;
       static const UInt maxUInt;
+      static const Int64 minInt64;
+      static const Int64 maxInt64;
+      static const UInt64 maxUInt64;
 
-   private:
 #ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
-# ifndef JSON_VALUE_USE_INTERNAL_MAP
-      class CZString 
-      {
-      public:
-         enum DuplicationPolicy 
-         {
-            noDuplication = 0,
-            duplicate,
-            duplicateOnCopy
-         };
-         CZString( int index );
-         CZString( const char *cstr, DuplicationPolicy allocate );
-         CZString( const CZString &other );
-         ~CZString();
-         CZString &operator =( const CZString &other );
-         bool operator<( const CZString &other ) const;
-         bool operator==( const CZString &other ) const;
-         int index() const;
-         const char *c_str() const;
-         bool isStaticString() const;
-      private:
-         void swap( CZString &other );
-         const char *cstr_;
-         int index_;
-      };
-
-   public:
-#  ifndef JSON_USE_CPPTL_SMALLMAP
-      typedef std::map<CZString, Value> ObjectValues;
-#  else
-      typedef CppTL::SmallMap<CZString, Value> ObjectValues;
-#  endif // ifndef JSON_USE_CPPTL_SMALLMAP
-# endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
+      /// Compact storage of an #objectValue, see ValueObjectMap.
+      typedef ValueObjectMap ObjectValues;
+      /// Contiguous storage of an #arrayValue (amortized O(1) append and index).
+      typedef std::vector<Value, ValueArenaAllocator<Value> > ArrayValues;
 #endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
 
    public:
@@ -184,6 +333,8 @@ namespace Json {
       Value( ValueType type = nullValue );
       Value( Int value );
       Value( UInt value );
+      Value( Int64 value );
+      Value( UInt64 value );
       Value( double value );
       Value( const char *value );
       Value( const char *beginValue, const char *endValue );
@@ -204,9 +355,34 @@ namespace Json {
 # endif
       Value( bool value );
       Value( const Value &other );
+# ifdef JSON_HAS_RVALUE_REFERENCES
+      /// Steal the payload and comments of other, which is left null.
+      /// The rvalue overloads are defined inline, so they do not depend on
+      /// the C++ standard the library was built with.
+      Value( Value &&other )
+         : type_( other.type_ )
+         , allocated_( other.allocated_ )
+         , comments_( other.comments_ )
+      {
+         value_ = other.value_;
+         other.type_ = nullValue;
+         other.allocated_ = 0;
+         other.comments_ = 0;
+      }
+# endif
       ~Value();
 
       Value &operator=( const Value &other );
+# ifdef JSON_HAS_RVALUE_REFERENCES
+      /// Steal the payload of other, which is left null. Comments are kept, as with copy assignment.
+      Value &operator=( Value &&other )
+      {
+         Value temp;
+         temp.swap( other );
+         swap( temp );
+         return *this;
+      }
+# endif
       /// Swap values.
       /// \note Currently, comments are intentionally not swapped, for
       /// both logic and efficiency.
@@ -231,6 +407,8 @@ namespace Json {
 # endif
       Int asInt() const;
       UInt asUInt() const;
+      Int64 asInt64() const;
+      UInt64 asUInt64() const;
       double asDouble() const;
       bool asBool() const;
 
@@ -269,6 +447,12 @@ namespace Json {
       /// \post type() is arrayValue
       void resize( UInt size );
 
+      /// Preallocate storage for at least size array elements, without changing size().
+      /// Has no effect if the array can already hold that many elements.
+      /// \pre type() is arrayValue or nullValue
+      /// \post type() is arrayValue
+      void reserve( UInt size );
+
       /// Access an array element (zero based index ).
       /// If the array contains less than index element, then null value are inserted
       /// in the array so that its size is index+1.
@@ -289,6 +473,17 @@ namespace Json {
       ///
       /// Equivalent to jsonvalue[jsonvalue.size()] = value;
       Value &append( const Value &value );
+# ifdef JSON_HAS_RVALUE_REFERENCES
+      /// \brief Append value to array at the end without copying it.
+      ///
+      /// value is left null. Assigning an rvalue through operator[] moves as well.
+      Value &append( Value &&value )
+      {
+         Value &appended = append( null );
+         appended.swap( value );
+         return appended;
+      }
+# endif
 
       /// Access an object value by name, create a null member if it does not exist.
       Value &operator[]( const char *key );
@@ -337,6 +532,12 @@ namespace Json {
       /// Same as removeMember(const char*)
       Value removeMember( const std::string &key );
 
+      /// Return the member named key, or 0 if there is none or this is not an object.
+      /// Unlike isMember() followed by operator[], this looks the member up only once.
+      const Value *find( const char *key ) const;
+      /// Same as find( const char * ), using the precomputed hash of key.
+      const Value *find( const MemberKey &key ) const;
+
       /// Return true if the object has a member named key.
       bool isMember( const char *key ) const;
       /// Return true if the object has a member named key.
@@ -380,28 +581,6 @@ namespace Json {
       Value &resolveReference( const char *key, 
                                bool isStatic );
 
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-      inline bool isItemAvailable() const
-      {
-         return itemIsUsed_ == 0;
-      }
-
-      inline void setItemUsed( bool isUsed = true )
-      {
-         itemIsUsed_ = isUsed ? 1 : 0;
-      }
-
-      inline bool isMemberNameStatic() const
-      {
-         return memberNameIsStatic_ == 0;
-      }
-
-      inline void setMemberNameIsStatic( bool isStatic )
-      {
-         memberNameIsStatic_ = isStatic ? 1 : 0;
-      }
-# endif // # ifdef JSON_VALUE_USE_INTERNAL_MAP
-
    private:
       struct CommentInfo
       {
@@ -413,35 +592,18 @@ namespace Json {
          char *comment_;
       };
 
-      //struct MemberNamesTransform
-      //{
-      //   typedef const char *result_type;
-      //   const char *operator()( const CZString &name ) const
-      //   {
-      //      return name.c_str();
-      //   }
-      //};
-
       union ValueHolder
       {
-         Int int_;
-         UInt uint_;
+         Int64 int_;
+         UInt64 uint_;
          double real_;
          bool bool_;
          char *string_;
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-         ValueInternalArray *array_;
-         ValueInternalMap *map_;
-#else
+         ArrayValues *array_;
          ObjectValues *map_;
-# endif
       } value_;
       ValueType type_ : 8;
       int allocated_ : 1;     // Notes: if declared as bool, bitfield is useless.
-# ifdef JSON_VALUE_USE_INTERNAL_MAP
-      unsigned int itemIsUsed_ : 1;      // used by the ValueInternalMap container.
-      int memberNameIsStatic_ : 1;       // used by the ValueInternalMap container.
-# endif
       CommentInfo *comments_;
    };
 
@@ -513,364 +675,126 @@ namespace Json {
       Args args_;
    };
 
-   /** \brief Experimental do not use: Allocator to customize member name and string value memory management done by Value.
-    *
-    * - makeMemberName() and releaseMemberName() are called to respectively duplicate and
-    *   free an Json::objectValue member name.
-    * - duplicateStringValue() and releaseStringValue() are called similarly to
-    *   duplicate and free a Json::stringValue value.
+   /** \brief Storage of the members of an #objectValue (for internal use only).
+    * \internal
+    * Designed for the small objects that make up most JSON-RPC traffic (envelopes,
+    * parameter objects with a handful of members):
+    * - the first #inlineMembers members and up to #inlineKeyBytes bytes of member
+    *   names are stored inside the map itself, so such an object costs a single
+    *   allocation. Further members are stored in pages of doubling size and further
+    *   member names in separately allocated key pages.
+    * - members never move once created: a reference returned by resolveReference()
+    *   remains valid until the member is removed or the map is cleared or destroyed.
+    * - the member name order (used for iteration and comparison) is kept in a sorted
+    *   index of member numbers, which is binary searched. Once the map holds more than
+    *   #hashThreshold members, an open addressing hash table over the member numbers
+    *   is maintained and used for look-ups instead.
+    * - a member added out of name order shifts the index entries after it, so building
+    *   an object of n members costs O(n^2) moves of 4 byte entries in the worst case
+    *   (names arriving in descending order). That is negligible for the sizes met in
+    *   practice, but adds up to seconds for hundreds of thousands of members.
+    * - the names of removed members are reclaimed by copying the remaining names into
+    *   a fresh key page once they take up more room than those.
     */
-   class ValueAllocator
+   class JSON_API ValueObjectMap
    {
    public:
-      enum { unknown = (unsigned)-1 };
-
-      virtual ~ValueAllocator();
-
-      virtual char *makeMemberName( const char *memberName ) = 0;
-      virtual void releaseMemberName( char *memberName ) = 0;
-      virtual char *duplicateStringValue( const char *value, 
-                                          unsigned int length = unknown ) = 0;
-      virtual void releaseStringValue( char *value ) = 0;
-   };
-
-#ifdef JSON_VALUE_USE_INTERNAL_MAP
-   /** \brief Allocator to customize Value internal map.
-    * Below is an example of a simple implementation (default implementation actually
-    * use memory pool for speed).
-    * \code
-      class DefaultValueMapAllocator : public ValueMapAllocator
-      {
-      public: // overridden from ValueMapAllocator
-         virtual ValueInternalMap *newMap()
-         {
-            return new ValueInternalMap();
-         }
-
-         virtual ValueInternalMap *newMapCopy( const ValueInternalMap &other )
-         {
-            return new ValueInternalMap( other );
-         }
-
-         virtual void destructMap( ValueInternalMap *map )
-         {
-            delete map;
-         }
-
-         virtual ValueInternalLink *allocateMapBuckets( unsigned int size )
-         {
-            return new ValueInternalLink[size];
-         }
-
-         virtual void releaseMapBuckets( ValueInternalLink *links )
-         {
-            delete [] links;
-         }
-
-         virtual ValueInternalLink *allocateMapLink()
-         {
-            return new ValueInternalLink();
-         }
-
-         virtual void releaseMapLink( ValueInternalLink *link )
-         {
-            delete link;
-         }
-      };
-    * \endcode
-    */ 
-   class JSON_API ValueMapAllocator
-   {
-   public:
-      virtual ~ValueMapAllocator();
-      virtual ValueInternalMap *newMap() = 0;
-      virtual ValueInternalMap *newMapCopy( const ValueInternalMap &other ) = 0;
-      virtual void destructMap( ValueInternalMap *map ) = 0;
-      virtual ValueInternalLink *allocateMapBuckets( unsigned int size ) = 0;
-      virtual void releaseMapBuckets( ValueInternalLink *links ) = 0;
-      virtual ValueInternalLink *allocateMapLink() = 0;
-      virtual void releaseMapLink( ValueInternalLink *link ) = 0;
-   };
-
-   /** \brief ValueInternalMap hash-map bucket chain link (for internal use only).
-    * \internal previous_ & next_ allows for bidirectional traversal.
-    */
-   class JSON_API ValueInternalLink
-   {
-   public:
-      enum { itemPerLink = 6 };  // sizeof(ValueInternalLink) = 128 on 32 bits architecture.
-      enum InternalFlags { 
-         flagAvailable = 0,
-         flagUsed = 1
-      };
-
-      ValueInternalLink();
-
-      ~ValueInternalLink();
-
-      Value items_[itemPerLink];
-      char *keys_[itemPerLink];
-      ValueInternalLink *previous_;
-      ValueInternalLink *next_;
-   };
-
-
-   /** \brief A linked page based hash-table implementation used internally by Value.
-    * \internal ValueInternalMap is a tradional bucket based hash-table, with a linked
-    * list in each bucket to handle collision. There is an addional twist in that
-    * each node of the collision linked list is a page containing a fixed amount of
-    * value. This provides a better compromise between memory usage and speed.
-    * 
-    * Each bucket is made up of a chained list of ValueInternalLink. The last
-    * link of a given bucket can be found in the 'previous_' field of the following bucket.
-    * The last link of the last bucket is stored in tailLink_ as it has no following bucket.
-    * Only the last link of a bucket may contains 'available' item. The last link always
-    * contains at least one element unless is it the bucket one very first link.
-    */
-   class JSON_API ValueInternalMap
-   {
-      friend class ValueIteratorBase;
-      friend class Value;
-   public:
-      typedef unsigned int HashKey;
-      typedef unsigned int BucketIndex;
-
-# ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
-      struct IteratorState
+      typedef unsigned int MemberIndex;
+      enum
       {
-         IteratorState() 
-            : map_(0)
-            , link_(0)
-            , itemIndex_(0)
-            , bucketIndex_(0) 
-         {
-         }
-         ValueInternalMap *map_;
-         ValueInternalLink *link_;
-         BucketIndex itemIndex_;
-         BucketIndex bucketIndex_;
+         inlineMembers = 8,
+         inlineKeyBytes = 64,
+         hashThreshold = 16
       };
-# endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
 
-      ValueInternalMap();
-      ValueInternalMap( const ValueInternalMap &other );
-      ValueInternalMap &operator =( const ValueInternalMap &other );
-      ~ValueInternalMap();
+      ValueObjectMap();
+      ValueObjectMap( const ValueObjectMap &other );
+      ~ValueObjectMap();
 
-      void swap( ValueInternalMap &other );
-
-      BucketIndex size() const;
+      /// Number of members.
+      MemberIndex size() const;
 
+      /// Removes all the members, keeping the inline storage.
       void clear();
 
-      bool reserveDelta( BucketIndex growth );
-
-      bool reserve( BucketIndex newItemCount );
-
+      /// Returns the value of the member named key, or 0 if there is none.
       const Value *find( const char *key ) const;
-
       Value *find( const char *key );
+      /// Same as find( const char * ) with hashedKey being hash( key ).
+      const Value *find( const char *key, 
+                         unsigned int hashedKey ) const;
+
+      /// Hash of a member name, see MemberKey.
+      static unsigned int hash( const char *key );
 
+      /// Returns the value of the member named key, adding a null member if there is none.
+      /// If isStatic is true, key is not copied and must outlive the map.
       Value &resolveReference( const char *key, 
                                bool isStatic );
 
-      void remove( const char *key );
+      /// Removes the member named key. Returns false if there is none.
+      bool remove( const char *key );
 
-      void doActualRemove( ValueInternalLink *link, 
-                           BucketIndex index,
-                           BucketIndex bucketIndex );
+      bool operator ==( const ValueObjectMap &other ) const;
+      bool operator <( const ValueObjectMap &other ) const;
 
-      ValueInternalLink *&getLastLinkInBucket( BucketIndex bucketIndex );
-
-      Value &setNewItem( const char *key, 
-                         bool isStatic, 
-                         ValueInternalLink *link, 
-                         BucketIndex index );
-
-      Value &unsafeAdd( const char *key, 
-                        bool isStatic, 
-                        HashKey hashedKey );
-
-      HashKey hash( const char *key ) const;
-
-      int compare( const ValueInternalMap &other ) const;
+      /// Name of the member at position (0 <= position < size()) in member name order.
+      const char *keyAt( MemberIndex position ) const;
+      /// Whether the name of the member at position was stored without being copied.
+      bool isStaticKeyAt( MemberIndex position ) const;
+      /// Value of the member at position in member name order.
+      Value &valueAt( MemberIndex position );
+      const Value &valueAt( MemberIndex position ) const;
 
    private:
-      void makeBeginIterator( IteratorState &it ) const;
-      void makeEndIterator( IteratorState &it ) const;
-      static bool equals( const IteratorState &x, const IteratorState &other );
-      static void increment( IteratorState &iterator );
-      static void incrementBucket( IteratorState &iterator );
-      static void decrement( IteratorState &iterator );
-      static const char *key( const IteratorState &iterator );
-      static const char *key( const IteratorState &iterator, bool &isStatic );
-      static Value &value( const IteratorState &iterator );
-      static int distance( const IteratorState &x, const IteratorState &y );
-
-   private:
-      ValueInternalLink *buckets_;
-      ValueInternalLink *tailLink_;
-      BucketIndex bucketsSize_;
-      BucketIndex itemCount_;
-   };
-
-   /** \brief A simplified deque implementation used internally by Value.
-   * \internal
-   * It is based on a list of fixed "page", each page contains a fixed number of items.
-   * Instead of using a linked-list, a array of pointer is used for fast item look-up.
-   * Look-up for an element is as follow:
-   * - compute page index: pageIndex = itemIndex / itemsPerPage
-   * - look-up item in page: pages_[pageIndex][itemIndex % itemsPerPage]
-   *
-   * Insertion is amortized constant time (only the array containing the index of pointers
-   * need to be reallocated when items are appended).
-   */
-   class JSON_API ValueInternalArray
-   {
-      friend class Value;
-      friend class ValueIteratorBase;
-   public:
-      enum { itemsPerPage = 8 };    // should be a power of 2 for fast divide and modulo.
-      typedef Value::ArrayIndex ArrayIndex;
-      typedef unsigned int PageIndex;
-
-# ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
-      struct IteratorState // Must be a POD
+      struct Member
       {
-         IteratorState() 
-            : array_(0)
-            , currentPageIndex_(0)
-            , currentItemIndex_(0) 
-         {
-         }
-         ValueInternalArray *array_;
-         Value **currentPageIndex_;
-         unsigned int currentItemIndex_;
+         const char *key_;
+         unsigned int hash_;
+         bool isStatic_;
+         Value value_;
       };
-# endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
-
-      ValueInternalArray();
-      ValueInternalArray( const ValueInternalArray &other );
-      ValueInternalArray &operator =( const ValueInternalArray &other );
-      ~ValueInternalArray();
-      void swap( ValueInternalArray &other );
-
-      void clear();
-      void resize( ArrayIndex newSize );
-
-      Value &resolveReference( ArrayIndex index );
 
-      Value *find( ArrayIndex index ) const;
+      ValueObjectMap &operator =( const ValueObjectMap &other );  // no implementation
 
-      ArrayIndex size() const;
-
-      int compare( const ValueInternalArray &other ) const;
-
-   private:
-      static bool equals( const IteratorState &x, const IteratorState &other );
-      static void increment( IteratorState &iterator );
-      static void decrement( IteratorState &iterator );
-      static Value &dereference( const IteratorState &iterator );
-      static Value &unsafeDereference( const IteratorState &iterator );
-      static int distance( const IteratorState &x, const IteratorState &y );
-      static ArrayIndex indexOf( const IteratorState &iterator );
-      void makeBeginIterator( IteratorState &it ) const;
-      void makeEndIterator( IteratorState &it ) const;
-      void makeIterator( IteratorState &it, ArrayIndex index ) const;
-
-      void makeIndexValid( ArrayIndex index );
-
-      Value **pages_;
-      ArrayIndex size_;
-      PageIndex pageCount_;
-   };
-
-   /** \brief Experimental: do not use. Allocator to customize Value internal array.
-    * Below is an example of a simple implementation (actual implementation use
-    * memory pool).
-      \code
-class DefaultValueArrayAllocator : public ValueArrayAllocator
-{
-public: // overridden from ValueArrayAllocator
-   virtual ~DefaultValueArrayAllocator()
-   {
-   }
-
-   virtual ValueInternalArray *newArray()
-   {
-      return new ValueInternalArray();
-   }
-
-   virtual ValueInternalArray *newArrayCopy( const ValueInternalArray &other )
-   {
-      return new ValueInternalArray( other );
-   }
-
-   virtual void destruct( ValueInternalArray *array )
-   {
-      delete array;
-   }
-
-   virtual void reallocateArrayPageIndex( Value **&indexes, 
-                                          ValueInternalArray::PageIndex &indexCount,
-                                          ValueInternalArray::PageIndex minNewIndexCount )
-   {
-      ValueInternalArray::PageIndex newIndexCount = (indexCount*3)/2 + 1;
-      if ( minNewIndexCount > newIndexCount )
-         newIndexCount = minNewIndexCount;
-      void *newIndexes = realloc( indexes, sizeof(Value*) * newIndexCount );
-      if ( !newIndexes )
-         throw std::bad_alloc();
-      indexCount = newIndexCount;
-      indexes = static_cast<Value **>( newIndexes );
-   }
-   virtual void releaseArrayPageIndex( Value **indexes, 
-                                       ValueInternalArray::PageIndex indexCount )
-   {
-      if ( indexes )
-         free( indexes );
-   }
-
-   virtual Value *allocateArrayPage()
-   {
-      return static_cast<Value *>( malloc( sizeof(Value) * ValueInternalArray::itemsPerPage ) );
-   }
-
-   virtual void releaseArrayPage( Value *value )
-   {
-      if ( value )
-         free( value );
-   }
-};
-      \endcode
-    */ 
-   class JSON_API ValueArrayAllocator
-   {
-   public:
-      virtual ~ValueArrayAllocator();
-      virtual ValueInternalArray *newArray() = 0;
-      virtual ValueInternalArray *newArrayCopy( const ValueInternalArray &other ) = 0;
-      virtual void destructArray( ValueInternalArray *array ) = 0;
-      /** \brief Reallocate array page index.
-       * Reallocates an array of pointer on each page.
-       * \param indexes [input] pointer on the current index. May be \c NULL.
-       *                [output] pointer on the new index of at least 
-       *                         \a minNewIndexCount pages. 
-       * \param indexCount [input] current number of pages in the index.
-       *                   [output] number of page the reallocated index can handle.
-       *                            \b MUST be >= \a minNewIndexCount.
-       * \param minNewIndexCount Minimum number of page the new index must be able to
-       *                         handle.
-       */
-      virtual void reallocateArrayPageIndex( Value **&indexes, 
-                                             ValueInternalArray::PageIndex &indexCount,
-                                             ValueInternalArray::PageIndex minNewIndexCount ) = 0;
-      virtual void releaseArrayPageIndex( Value **indexes, 
-                                          ValueInternalArray::PageIndex indexCount ) = 0;
-      virtual Value *allocateArrayPage() = 0;
-      virtual void releaseArrayPage( Value *value ) = 0;
+      Member &member( MemberIndex index );
+      const Member &member( MemberIndex index ) const;
+      MemberIndex lowerBound( const char *key ) const;
+      MemberIndex findMember( const char *key, 
+                              unsigned int hash ) const;
+      Value &addMember( const char *key, 
+                        bool isStatic, 
+                        unsigned int hash, 
+                        MemberIndex position );
+      const char *copyKey( const char *key );
+      void compactKeys();
+      void insertBucket( MemberIndex index );
+      void rehash( MemberIndex bucketCount );
+      void releaseStorage();
+      static Member *newPage( MemberIndex size );
+      static void deletePage( Member *page, 
+                              MemberIndex size );
+      static void resetValue( Value &value );
+
+      Member inline_[inlineMembers];
+      MemberIndex inlineOrder_[inlineMembers];
+      char inlineKeys_[inlineKeyBytes];
+      std::vector<Member *, ValueArenaAllocator<Member *> > pages_;
+      std::vector<char *, ValueArenaAllocator<char *> > keyPages_;
+      /// Member numbers sorted by member name, points to inlineOrder_ while it fits.
+      MemberIndex *order_;
+      /// Open addressing hash table of member numbers (MemberIndex(-1) if empty), or 0.
+      MemberIndex *buckets_;
+      char *keyCurrent_;
+      char *keyEnd_;
+      MemberIndex size_;
+      MemberIndex memberCount_;   // members ever created, including removed ones.
+      MemberIndex freeMember_;    // first removed member available for reuse, chained through hash_.
+      MemberIndex orderCapacity_;
+      MemberIndex bucketCount_;
+      size_t keyBytes_;           // bytes of the copied names of the members.
+      size_t deadKeyBytes_;       // bytes of the copied names of removed members, not reclaimed yet.
    };
-#endif // #ifdef JSON_VALUE_USE_INTERNAL_MAP
 
 
    /** \brief base class for Value iterators.
@@ -884,12 +808,10 @@ public: // overridden from ValueArrayAllocator
       typedef ValueIteratorBase SelfType;
 
       ValueIteratorBase();
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-      explicit ValueIteratorBase( const Value::ObjectValues::iterator &current );
-#else
-      ValueIteratorBase( const ValueInternalArray::IteratorState &state );
-      ValueIteratorBase( const ValueInternalMap::IteratorState &state );
-#endif
+      ValueIteratorBase( ValueObjectMap *map,
+                         ValueObjectMap::MemberIndex position );
+      ValueIteratorBase( const Value::ArrayValues::iterator &begin,
+                         const Value::ArrayValues::iterator &current );
 
       bool operator ==( const SelfType &other ) const
       {
@@ -929,18 +851,16 @@ public: // overridden from ValueArrayAllocator
       void copy( const SelfType &other );
 
    private:
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-      Value::ObjectValues::iterator current_;
+      // Referenced objectValue storage and position in its member name order.
+      ValueObjectMap *map_;
+      ValueObjectMap::MemberIndex position_;
+      // Position in an arrayValue, and the first element to compute the index from.
+      Value::ArrayValues::iterator arrayCurrent_;
+      Value::ArrayValues::iterator arrayBegin_;
       // Indicates that iterator is for a null value.
       bool isNull_;
-#else
-      union
-      {
-         ValueInternalArray::IteratorState array_;
-         ValueInternalMap::IteratorState map_;
-      } iterator_;
+      // Indicates that iterator is for an arrayValue (arrayCurrent_ is used).
       bool isArray_;
-#endif
    };
 
    /** \brief const iterator for object and array value.
@@ -960,12 +880,10 @@ public: // overridden from ValueArrayAllocator
    private:
       /*! \internal Use by Value to create an iterator.
        */
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-      explicit ValueConstIterator( const Value::ObjectValues::iterator &current );
-#else
-      ValueConstIterator( const ValueInternalArray::IteratorState &state );
-      ValueConstIterator( const ValueInternalMap::IteratorState &state );
-#endif
+      ValueConstIterator( ValueObjectMap *map,
+                          ValueObjectMap::MemberIndex position );
+      ValueConstIterator( const Value::ArrayValues::iterator &begin,
+                          const Value::ArrayValues::iterator &current );
    public:
       SelfType &operator =( const ValueIteratorBase &other );
 
@@ -1020,12 +938,10 @@ public: // overridden from ValueArrayAllocator
    private:
       /*! \internal Use by Value to create an iterator.
        */
-#ifndef JSON_VALUE_USE_INTERNAL_MAP
-      explicit ValueIterator( const Value::ObjectValues::iterator &current );
-#else
-      ValueIterator( const ValueInternalArray::IteratorState &state );
-      ValueIterator( const ValueInternalMap::IteratorState &state );
-#endif
+      ValueIterator( ValueObjectMap *map,
+                     ValueObjectMap::MemberIndex position );
+      ValueIterator( const Value::ArrayValues::iterator &begin,
+                     const Value::ArrayValues::iterator &current );
    public:
 
       SelfType &operator =( const SelfType &other );
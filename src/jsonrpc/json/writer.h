@@ -20,6 +20,51 @@ namespace Json {
       virtual std::string write( const Value &root ) = 0;
    };
 
+   /** \brief Receives a serialized document piece by piece.
+    *
+    * Used by writers that hand out their output in chunks instead of returning one
+    * string, so that a connector can send a large document while it is still being
+    * serialized.
+    * \sa FastWriter::write( const Value &, OutputSink & )
+    */
+   class JSON_API OutputSink
+   {
+   public:
+      virtual ~OutputSink();
+
+      /// Called with the next \c length bytes of the document, in order.
+      virtual void write( const char *data, size_t length ) = 0;
+   };
+
+   /** \brief Pre-rendered layout of objects with a fixed set of members, see FastWriter::setTemplates().
+    *
+    * An object matches if its member names are exactly those of \c members, in member
+    * name order, and each member with a \c constant is a string equal to it. Each member
+    * of a matching object is written as its \c prefix followed by its value, and the object
+    * is closed with \c suffix: the member names, the separators and the constant members
+    * are part of the fragments, so only the other values are serialized.
+    */
+   struct JSON_API ObjectTemplate
+   {
+      /// Returns the pre-serialized JSON of a value, or 0 to have it serialized as usual.
+      typedef const char *(*Renderer)( const Value &value );
+
+      struct Member
+      {
+         const char *name;
+         /// Written before the value, e.g. <tt>,"id":</tt>. Includes the whole member if it is constant.
+         const char *prefix;
+         /// If not 0, the member must be this string and its value is not written.
+         const char *constant;
+         /// If not 0, asked for the value before it is serialized.
+         Renderer renderer;
+      };
+
+      const Member *members;
+      unsigned int memberCount;
+      const char *suffix;
+   };
+
    /** \brief Outputs a Value in <a HREF="http://www.json.org">JSON</a> format without formatting (not human friendly).
     *
     * The JSON document is written in a single line. It is not intended for 'human' consumption,
@@ -34,13 +79,55 @@ namespace Json {
 
       void enableYAMLCompatibility();
 
+      /** \brief Sets the number of bytes buffered before they are passed to an OutputSink.
+       *
+       * A chunk is handed out as soon as it holds at least \c chunkSize bytes, so
+       * chunks may exceed that size by the length of the last written string.
+       */
+      void setChunkSize( size_t chunkSize );
+
+      /** \brief Serializes \c root into \c sink in chunks of about setChunkSize() bytes.
+       *
+       * The output is identical to write( const Value & ), but only one chunk of it
+       * is held in memory at a time.
+       */
+      void write( const Value &root, OutputSink &sink );
+
+      /** \brief Splices pre-serialized JSON into the document.
+       *
+       * String members named \c member of the root object, or of the objects in the
+       * root array, are written unquoted and named \c outputName. Deeper members are
+       * written as usual. An empty \c member turns splicing off again.
+       */
+      void setRawMember( const std::string &member, const std::string &outputName );
+
+      /** \brief Writes objects of a known layout from pre-rendered fragments.
+       *
+       * The root object, or an object in the root array, that matches one of the
+       * \c count \c templates is written as described by the first match. Other objects
+       * are written as usual. The templates are not copied and must outlive their use,
+       * \c count 0 turns them off again.
+       */
+      void setTemplates( const ObjectTemplate *templates, unsigned int count );
+
    public: // overridden from Writer
       virtual std::string write( const Value &root );
 
    private:
+      void writeRoot( const Value &root );
+      void writeRootObject( const Value &value );
+      bool writeTemplate( const Value &value );
       void writeValue( const Value &value );
+      void writeObject( const Value &value, bool spliceRaw );
+      void flushChunk();
 
       std::string document_;
+      std::string rawMember_;
+      std::string rawOutputName_;
+      const ObjectTemplate *templates_;
+      unsigned int templateCount_;
+      OutputSink *sink_;
+      size_t chunkSize_;
       bool yamlCompatiblityEnabled_;
    };
 
@@ -159,6 +246,8 @@ namespace Json {
 
    std::string JSON_API valueToString( Int value );
    std::string JSON_API valueToString( UInt value );
+   std::string JSON_API valueToString( Int64 value );
+   std::string JSON_API valueToString( UInt64 value );
    std::string JSON_API valueToString( double value );
    std::string JSON_API valueToString( bool value );
    std::string JSON_API valueToQuotedString( const char *value );
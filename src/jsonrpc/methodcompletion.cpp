@@ -0,0 +1,91 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    methodcompletion.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "methodcompletion.h"
+#include "errors.h"
+
+namespace jsonrpc
+{
+    void AbstractRequestHandler::handleAsyncMethodCall(Procedure* proc, const Json::Value& input, MethodCompletion* completion)
+    {
+        Json::Value result;
+        try
+        {
+            this->handleMethodCall(proc, input, result);
+        }
+        catch (const JsonRpcException& exc)
+        {
+            completion->Fail(exc);
+            return;
+        }
+        catch (...)
+        {
+            completion->Fail(JsonRpcException(Errors::ERROR_RPC_INTERNAL_ERROR));
+            return;
+        }
+        completion->Complete(result);
+    }
+
+    MethodCompletion::MethodCompletion(RpcProtocolServer* server, RpcProtocolServer::PendingRequest* pending,
+                                       const Json::Value& request, Json::Value& response, ConcurrencyLimit* limit,
+                                       ProcedureStats* stats) :
+        server(server),
+        pending(pending),
+        request(request),
+        response(response),
+        limit(limit),
+        stats(stats),
+        started(stats != NULL ? ProcedureStats::Now() : 0),
+        references(2),
+        answered(0)
+    {
+    }
+
+    void MethodCompletion::Complete(const Json::Value& result)
+    {
+        if (__sync_bool_compare_and_swap(&this->answered, 0, 1))
+        {
+            this->response[Json::StaticString(KEY_RESPONSE_RESULT)] = result;
+            this->Finish(0);
+        }
+    }
+
+    void MethodCompletion::Fail(const JsonRpcException& exception)
+    {
+        if (__sync_bool_compare_and_swap(&this->answered, 0, 1))
+        {
+            Errors::GetErrorBlock(this->request, exception).swap(this->response);
+            this->Finish(exception.GetCode());
+        }
+    }
+
+    void MethodCompletion::Release()
+    {
+        if (__sync_sub_and_fetch(&this->references, 1) == 0)
+        {
+            delete this;
+        }
+    }
+
+    void MethodCompletion::Finish(int errorCode)
+    {
+        if (this->stats != NULL)
+        {
+            this->stats->RecordPhase(STATS_DISPATCH, ProcedureStats::Now() - this->started);
+            this->stats->RecordCall(errorCode);
+        }
+        if (this->limit != NULL)
+        {
+            this->limit->Release();
+        }
+        this->server->ReleaseRequest(this->pending);
+        this->Release();
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,83 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    methodcompletion.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef METHODCOMPLETION_H_
+#define METHODCOMPLETION_H_
+
+#include "rpcprotocolserver.h"
+#include "exception.h"
+
+namespace jsonrpc
+{
+    /**
+     * @brief Completes an asynchronous method call, see AbstractRequestHandler::handleAsyncMethodCall.
+     *
+     * Exactly one of Complete or Fail has to be called, from any thread and at any time after the
+     * handler was invoked. The completion deletes itself afterwards. Once the last pending call of a
+     * request is completed, its response is handed to the connector. If the handler throws before the
+     * call is completed, the call fails with the exception, or with an internal error for anything but
+     * a JsonRpcException, and the completion must not be used any more.
+     */
+    class MethodCompletion
+    {
+        public:
+            /**
+             * @brief Answers the call with result.
+             */
+            void Complete(const Json::Value& result);
+
+            /**
+             * @brief Answers the call with the error described by exception.
+             */
+            void Fail(const JsonRpcException& exception);
+
+        private:
+            friend class RpcProtocolServer;
+
+            MethodCompletion(RpcProtocolServer* server, RpcProtocolServer::PendingRequest* pending,
+                             const Json::Value& request, Json::Value& response, ConcurrencyLimit* limit,
+                             ProcedureStats* stats);
+            MethodCompletion(const MethodCompletion&);  // no implementation
+            void operator=(const MethodCompletion&);    // no implementation
+
+            /**
+             * @param errorCode - 0 if the call succeeded.
+             */
+            void Finish(int errorCode);
+            /**
+             * @brief Drops one reference, the last one deletes the completion.
+             */
+            void Release();
+
+            RpcProtocolServer* server;
+            RpcProtocolServer::PendingRequest* pending;
+            /**
+             * The request Object and its place in the response, both owned by pending.
+             */
+            const Json::Value& request;
+            Json::Value& response;
+            /**
+             * The slot of the call, released once it is completed. NULL if the procedure is not limited.
+             */
+            ConcurrencyLimit* limit;
+            /**
+             * Receives the call and the time until its completion as the dispatch phase. NULL if no stats are recorded.
+             */
+            ProcedureStats* stats;
+            unsigned long long started;
+            /**
+             * Held by the running handler and by the unanswered call, so a handler that throws after
+             * completing its call does not touch a deleted completion.
+             */
+            volatile int references;
+            volatile int answered;
+    };
+
+} /* namespace jsonrpc */
+#endif /* METHODCOMPLETION_H_ */
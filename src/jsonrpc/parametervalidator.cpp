@@ -0,0 +1,393 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    parametervalidator.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "parametervalidator.h"
+#include "exception.h"
+#include "errors.h"
+
+#include <cstring>
+#include <limits>
+
+#define SCHEMA_TYPE "type"
+#define SCHEMA_MINIMUM "minimum"
+#define SCHEMA_MAXIMUM "maximum"
+#define SCHEMA_MIN_LENGTH "minLength"
+#define SCHEMA_MAX_LENGTH "maxLength"
+#define SCHEMA_MIN_ITEMS "minItems"
+#define SCHEMA_MAX_ITEMS "maxItems"
+#define SCHEMA_ITEMS "items"
+#define SCHEMA_PROPERTIES "properties"
+#define SCHEMA_REQUIRED "required"
+
+using namespace std;
+
+namespace jsonrpc
+{
+    enum
+    {
+        OP_TYPE,        //the value has type operand
+        OP_SIZE,        //the array has exactly operand elements
+        OP_MEMBER,      //the children apply to the member with key operand, which must exist if required
+        OP_ELEMENT,     //the children apply to the element at position operand
+        OP_EACH,        //the children apply to every element
+        OP_RANGE,       //the value is a number within minimum and maximum
+        OP_LENGTH,      //the string length or number of elements is within minimum and maximum
+        OP_ITEMS        //the number of elements is within minimum and maximum
+    };
+
+    enum
+    {
+        TYPE_STRING,
+        TYPE_BOOLEAN,
+        TYPE_INT,       //an int as checked for JSON_INTEGER parameters
+        TYPE_INTEGER,   //any integer, signed or not
+        TYPE_REAL,
+        TYPE_NUMBER,
+        TYPE_OBJECT,
+        TYPE_ARRAY,
+        TYPE_NULL,
+        TYPE_ANY
+    };
+
+    static unsigned int ToValueType(jsontype_t type)
+    {
+        switch (type)
+        {
+            case JSON_STRING:   return TYPE_STRING;
+            case JSON_BOOLEAN:  return TYPE_BOOLEAN;
+            case JSON_INTEGER:  return TYPE_INT;
+            case JSON_REAL:     return TYPE_REAL;
+            case JSON_OBJECT:   return TYPE_OBJECT;
+            case JSON_ARRAY:    return TYPE_ARRAY;
+            case JSON_NULL:     return TYPE_NULL;
+        }
+        return TYPE_ANY;
+    }
+
+    static bool HasType(const Json::Value& value, unsigned int type)
+    {
+        switch (type)
+        {
+            case TYPE_STRING:   return value.isString();
+            case TYPE_BOOLEAN:  return value.isBool();
+            case TYPE_INT:      return value.isInt();
+            case TYPE_INTEGER:  return value.isInt() || value.isUInt();
+            case TYPE_REAL:     return value.isDouble();
+            case TYPE_NUMBER:   return value.isInt() || value.isUInt() || value.isDouble();
+            case TYPE_OBJECT:   return value.isObject();
+            case TYPE_ARRAY:    return value.isArray();
+            case TYPE_NULL:     return value.isNull();
+        }
+        return true;
+    }
+
+    static void SchemaError(const string& message, const Json::Value& schema)
+    {
+        throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX, message + ": " + schema.toStyledString());
+    }
+
+    ParameterValidator::ParameterValidator()
+    {
+    }
+
+    void ParameterValidator::CompileNamed(const map<string, jsontype_t>& parameters, const parameterSchemaList_t& schemas)
+    {
+        this->Clear();
+        for (parameterSchemaList_t::const_iterator it = schemas.begin(); it != schemas.end(); it++)
+        {
+            if (parameters.find(it->first) == parameters.end())
+            {
+                SchemaError("schema for the undeclared parameter " + it->first, it->second);
+            }
+        }
+        for (map<string, jsontype_t>::const_iterator it = parameters.begin(); it != parameters.end(); it++)
+        {
+            size_t member = this->Emit(OP_MEMBER, this->Intern(it->first));
+            this->program[member].required = true;
+            this->CompileParameter(it->second, schemas, it->first);
+            this->Close(member);
+        }
+    }
+
+    void ParameterValidator::CompilePositional(const vector<string>& names, const vector<jsontype_t>& types,
+                                               const parameterSchemaList_t& schemas)
+    {
+        this->Clear();
+        for (parameterSchemaList_t::const_iterator it = schemas.begin(); it != schemas.end(); it++)
+        {
+            bool declared = false;
+            for (size_t i = 0; i < names.size() && !declared; i++)
+            {
+                declared = names[i] == it->first;
+            }
+            if (!declared)
+            {
+                SchemaError("schema for the undeclared parameter " + it->first, it->second);
+            }
+        }
+        this->Emit(OP_SIZE, (unsigned int) types.size());
+        for (unsigned int i = 0; i < types.size(); i++)
+        {
+            size_t element = this->Emit(OP_ELEMENT, i);
+            this->CompileParameter(types[i], schemas, i < names.size() ? names[i] : string());
+            this->Close(element);
+        }
+    }
+
+    void ParameterValidator::CheckSchema(const Json::Value& schema)
+    {
+        ParameterValidator validator;
+        validator.CompileSchema(schema);
+    }
+
+    bool ParameterValidator::Validate(const Json::Value& parameters) const
+    {
+        return this->Run(0, this->program.size(), parameters);
+    }
+
+    void ParameterValidator::Clear()
+    {
+        this->program.clear();
+        this->keys.clear();
+        this->names.clear();
+    }
+
+    unsigned int ParameterValidator::Intern(const string& name)
+    {
+        for (unsigned int i = 0; i < this->names.size(); i++)
+        {
+            if (this->names[i] == name)
+            {
+                return i;
+            }
+        }
+        this->names.push_back(name);
+        this->keys.push_back(Json::MemberKey(this->names.back().c_str()));
+        return (unsigned int) this->keys.size() - 1;
+    }
+
+    size_t ParameterValidator::Emit(int opcode, unsigned int operand)
+    {
+        Instruction instruction;
+        instruction.opcode = opcode;
+        instruction.operand = operand;
+        instruction.children = 0;
+        instruction.required = false;
+        instruction.minimum = -numeric_limits<double>::infinity();
+        instruction.maximum = numeric_limits<double>::infinity();
+        this->program.push_back(instruction);
+        return this->program.size() - 1;
+    }
+
+    void ParameterValidator::Close(size_t position)
+    {
+        this->program[position].children = (unsigned int) (this->program.size() - position - 1);
+    }
+
+    void ParameterValidator::CompileParameter(jsontype_t type, const parameterSchemaList_t& schemas, const string& name)
+    {
+        if (ToValueType(type) != TYPE_ANY)
+        {
+            this->Emit(OP_TYPE, ToValueType(type));
+        }
+        parameterSchemaList_t::const_iterator schema = schemas.find(name);
+        if (schema != schemas.end())
+        {
+            this->CompileSchema(schema->second);
+        }
+    }
+
+    void ParameterValidator::CompileSchema(const Json::Value& schema)
+    {
+        if (!schema.isObject())
+        {
+            SchemaError("a schema must be an object", schema);
+        }
+
+        const Json::Value* type = schema.find(SCHEMA_TYPE);
+        if (type != NULL)
+        {
+            static const char* typeNames[] = {"string", "boolean", NULL, "integer", NULL, "number", "object", "array", "null"};
+            unsigned int found = TYPE_ANY;
+            for (unsigned int i = 0; type->isString() && i < sizeof(typeNames) / sizeof(typeNames[0]); i++)
+            {
+                if (typeNames[i] != NULL && strcmp(typeNames[i], type->asCString()) == 0)
+                {
+                    found = i;
+                }
+            }
+            if (found == TYPE_ANY)
+            {
+                SchemaError("unknown schema type", schema);
+            }
+            this->Emit(OP_TYPE, found);
+        }
+
+        this->CompileBounds(schema, OP_RANGE, SCHEMA_MINIMUM, SCHEMA_MAXIMUM);
+        this->CompileBounds(schema, OP_LENGTH, SCHEMA_MIN_LENGTH, SCHEMA_MAX_LENGTH);
+        this->CompileBounds(schema, OP_ITEMS, SCHEMA_MIN_ITEMS, SCHEMA_MAX_ITEMS);
+
+        const Json::Value* required = schema.find(SCHEMA_REQUIRED);
+        const Json::Value* properties = schema.find(SCHEMA_PROPERTIES);
+        if ((required != NULL || properties != NULL) && (type == NULL || type->asString() != "object"))
+        {
+            //Members are looked up in objects only, so the type is checked first.
+            this->Emit(OP_TYPE, TYPE_OBJECT);
+        }
+        if (required != NULL && !required->isArray())
+        {
+            SchemaError("required must be an array of member names", schema);
+        }
+        if (properties != NULL)
+        {
+            if (!properties->isObject())
+            {
+                SchemaError("properties must be an object", schema);
+            }
+            for (Json::Value::const_iterator it = properties->begin(); it != properties->end(); ++it)
+            {
+                size_t member = this->Emit(OP_MEMBER, this->Intern(it.memberName()));
+                for (unsigned int i = 0; required != NULL && i < required->size(); i++)
+                {
+                    this->program[member].required |= (*required)[i].isString() && strcmp((*required)[i].asCString(), it.memberName()) == 0;
+                }
+                this->CompileSchema(*it);
+                this->Close(member);
+            }
+        }
+        for (unsigned int i = 0; required != NULL && i < required->size(); i++)
+        {
+            if (!(*required)[i].isString())
+            {
+                SchemaError("required must be an array of member names", schema);
+            }
+            if (properties == NULL || properties->find((*required)[i].asCString()) == NULL)
+            {
+                size_t member = this->Emit(OP_MEMBER, this->Intern((*required)[i].asString()));
+                this->program[member].required = true;
+            }
+        }
+
+        const Json::Value* items = schema.find(SCHEMA_ITEMS);
+        if (items != NULL)
+        {
+            if (type == NULL || type->asString() != "array")
+            {
+                this->Emit(OP_TYPE, TYPE_ARRAY);
+            }
+            size_t each = this->Emit(OP_EACH);
+            this->CompileSchema(*items);
+            this->Close(each);
+        }
+    }
+
+    void ParameterValidator::CompileBounds(const Json::Value& schema, int opcode, const char* minimum, const char* maximum)
+    {
+        const Json::Value* lower = schema.find(minimum);
+        const Json::Value* upper = schema.find(maximum);
+        if (lower == NULL && upper == NULL)
+        {
+            return;
+        }
+        if ((lower != NULL && !HasType(*lower, TYPE_NUMBER)) || (upper != NULL && !HasType(*upper, TYPE_NUMBER)))
+        {
+            SchemaError(string(minimum) + " and " + maximum + " must be numbers", schema);
+        }
+        size_t bounds = this->Emit(opcode);
+        if (lower != NULL)
+        {
+            this->program[bounds].minimum = lower->asDouble();
+        }
+        if (upper != NULL)
+        {
+            this->program[bounds].maximum = upper->asDouble();
+        }
+    }
+
+    bool ParameterValidator::Run(size_t begin, size_t end, const Json::Value& value) const
+    {
+        size_t pc = begin;
+        while (pc < end)
+        {
+            const Instruction& instruction = this->program[pc];
+            switch (instruction.opcode)
+            {
+                case OP_TYPE:
+                    if (!HasType(value, instruction.operand))
+                    {
+                        return false;
+                    }
+                    break;
+                case OP_SIZE:
+                    if (value.size() != instruction.operand)
+                    {
+                        return false;
+                    }
+                    break;
+                case OP_MEMBER:
+                {
+                    const Json::Value* member = value.find(this->keys[instruction.operand]);
+                    if (member == NULL ? instruction.required : !this->Run(pc + 1, pc + 1 + instruction.children, *member))
+                    {
+                        return false;
+                    }
+                    break;
+                }
+                case OP_ELEMENT:
+                    if (!this->Run(pc + 1, pc + 1 + instruction.children, value[instruction.operand]))
+                    {
+                        return false;
+                    }
+                    break;
+                case OP_EACH:
+                    for (unsigned int i = 0; i < value.size(); i++)
+                    {
+                        if (!this->Run(pc + 1, pc + 1 + instruction.children, value[i]))
+                        {
+                            return false;
+                        }
+                    }
+                    break;
+                case OP_RANGE:
+                    if (!HasType(value, TYPE_NUMBER) || value.asDouble() < instruction.minimum || value.asDouble() > instruction.maximum)
+                    {
+                        return false;
+                    }
+                    break;
+                case OP_LENGTH:
+                {
+                    if (!value.isString())
+                    {
+                        return false;
+                    }
+                    //Characters are counted, not the bytes of their UTF-8 encoding.
+                    double length = 0;
+                    for (const char* c = value.asCString(); *c != 0; c++)
+                    {
+                        length += ((unsigned char) *c & 0xC0) != 0x80 ? 1 : 0;
+                    }
+                    if (length < instruction.minimum || length > instruction.maximum)
+                    {
+                        return false;
+                    }
+                    break;
+                }
+                case OP_ITEMS:
+                    if (!value.isArray() || value.size() < instruction.minimum || value.size() > instruction.maximum)
+                    {
+                        return false;
+                    }
+                    break;
+            }
+            pc += 1 + instruction.children;
+        }
+        return true;
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,108 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    parametervalidator.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef PARAMETERVALIDATOR_H_
+#define PARAMETERVALIDATOR_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "json/json.h"
+#include "specification.h"
+
+namespace jsonrpc
+{
+    typedef std::map<std::string, Json::Value> parameterSchemaList_t;
+
+    /**
+     * @brief The parameter checks of a procedure, compiled into a flat list of instructions.
+     *
+     * Every instruction checks the value it is applied to. Instructions that descend into a member or an
+     * element are followed by the instructions for that child, so validating a request is one pass over
+     * the list with one look-up per member. Member names are interned with their hash, see Json::MemberKey.
+     *
+     * Parameters can be refined with a subset of JSON Schema: "type" (string, boolean, integer, number,
+     * object, array, null), "minimum" and "maximum", "minLength" and "maxLength" of strings, "minItems" and
+     * "maxItems" of arrays, "items", "properties" and "required".
+     */
+    class ParameterValidator
+    {
+        public:
+            ParameterValidator();
+
+            /**
+             * @brief Compiles the checks for parameters passed by name. Every parameter is required and must
+             * have its declared type and match its schema, if it has one.
+             * @throws JsonRpcException if a schema is malformed or refers to an undeclared parameter.
+             */
+            void CompileNamed(const std::map<std::string, jsontype_t>& parameters, const parameterSchemaList_t& schemas);
+
+            /**
+             * @brief Compiles the checks for parameters passed by position, names[i] is the name of the i-th parameter.
+             * @throws JsonRpcException if a schema is malformed or refers to an undeclared parameter.
+             */
+            void CompilePositional(const std::vector<std::string>& names, const std::vector<jsontype_t>& types,
+                                   const parameterSchemaList_t& schemas);
+
+            /**
+             * @brief Checks a schema without compiling it.
+             * @throws JsonRpcException if the schema is malformed.
+             */
+            static void CheckSchema(const Json::Value& schema);
+
+            /**
+             * @return true if parameters pass all compiled checks.
+             */
+            bool Validate(const Json::Value& parameters) const;
+
+        private:
+            struct Instruction
+            {
+                int opcode;
+                /**
+                 * Value type, interned key, element position or size, depending on the opcode.
+                 */
+                unsigned int operand;
+                /**
+                 * Number of instructions for the child a member or element instruction descends into.
+                 */
+                unsigned int children;
+                bool required;
+                double minimum;
+                double maximum;
+            };
+
+            ParameterValidator(const ParameterValidator&);  // no implementation
+            void operator=(const ParameterValidator&);      // no implementation
+
+            void Clear();
+            unsigned int Intern(const std::string& name);
+            size_t Emit(int opcode, unsigned int operand = 0);
+            void CompileParameter(jsontype_t type, const parameterSchemaList_t& schemas, const std::string& name);
+            void CompileSchema(const Json::Value& schema);
+            void CompileBounds(const Json::Value& schema, int opcode, const char* minimum, const char* maximum);
+            /**
+             * @brief Sets the number of children of the instruction at position to the instructions emitted since.
+             */
+            void Close(size_t position);
+
+            bool Run(size_t begin, size_t end, const Json::Value& value) const;
+
+            std::vector<Instruction> program;
+            /**
+             * Interned member names, a deque so that the keys can point into its strings.
+             */
+            std::deque<std::string> names;
+            std::vector<Json::MemberKey> keys;
+    };
+
+} /* namespace jsonrpc */
+#endif /* PARAMETERVALIDATOR_H_ */
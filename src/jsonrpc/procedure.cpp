@@ -20,6 +20,8 @@ namespace jsonrpc
 {
     Procedure::Procedure(const string name, parameterDeclaration_t paramType, jsontype_t returntype, ...)
     {
+        //The declaration type is set first, the validator is compiled with every added parameter.
+        this->paramDeclaration = paramType;
         va_list parameters;
         va_start(parameters, returntype);
         const char* paramname = va_arg(parameters, const char*);
@@ -33,11 +35,19 @@ namespace jsonrpc
         this->procedureName = name;
         this->returntype = returntype;
         this->procedureType = RPC_METHOD;
-        this->paramDeclaration = paramType;
+        this->dispatchIndex = -1;
+        this->runSerially = false;
+        this->asynchronous = false;
+        this->concurrencyLimit = NULL;
+        this->cacheable = false;
+        this->cacheTtl = PROCEDURE_DEFAULT_CACHE_TTL;
+        this->singleFlight = false;
+        this->CompileValidator();
     }
 
     Procedure::Procedure(const string name, parameterDeclaration_t paramType, ...)
     {
+        this->paramDeclaration = paramType;
         va_list parameters;
         va_start(parameters, paramType);
         const char* paramname = va_arg(parameters, const char*);
@@ -50,23 +60,31 @@ namespace jsonrpc
         va_end(parameters);
         this->procedureName = name;
         this->procedureType = RPC_NOTIFICATION;
-        this->paramDeclaration = paramType;
+        this->dispatchIndex = -1;
+        this->runSerially = false;
+        this->asynchronous = false;
+        this->concurrencyLimit = NULL;
+        this->cacheable = false;
+        this->cacheTtl = PROCEDURE_DEFAULT_CACHE_TTL;
+        this->singleFlight = false;
+        this->CompileValidator();
     }
 
     Procedure::~Procedure()
     {
         this->parametersName.clear();
+        delete this->concurrencyLimit;
     }
 
     bool Procedure::ValdiateParameters(const Json::Value& parameters)
     {
         if(parameters.isArray() && this->paramDeclaration == PARAMS_BY_POSITION)
         {
-            return this->ValidatePositionalParameters(parameters);
+            return this->validator.Validate(parameters);
         }
         else if(parameters.isObject() && this->paramDeclaration == PARAMS_BY_NAME)
         {
-            return this->ValidateNamedParameters(parameters);
+            return this->validator.Validate(parameters);
         }
         else
         {
@@ -97,83 +115,114 @@ namespace jsonrpc
     {
         this->parametersName[name] = type;
         this->parametersPosition.push_back(type);
+        this->parametersPositionName.push_back(name);
+        this->CompileValidator();
     }
 
-    parameterDeclaration_t Procedure::GetParameterDeclarationType()
+    void Procedure::SetParameterSchema(const string& name, const Json::Value& schema)
     {
-        return this->paramDeclaration;
-    }
-
-    bool Procedure::ValidateNamedParameters(const Json::Value &parameters)
-    {
-        map<string, jsontype_t>::iterator it = this->parametersName.begin();
-        bool ok = true;
-        while (ok == true && it != this->parametersName.end())
+        if (this->parametersName.find(name) == this->parametersName.end())
         {
-            if (!parameters.isMember(it->first.c_str()))
-            {
-                ok = false;
-            }
-            else
-            {
-                ok = this->ValidateSingleParameter(it->second, parameters[it->first]);
-            }
-            it++;
+            throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                   "schema for the undeclared parameter " + name + " of " + this->procedureName);
         }
-        return ok;
+        ParameterValidator::CheckSchema(schema);
+        this->parameterSchemas[name] = schema;
+        this->CompileValidator();
     }
 
-    bool Procedure::ValidatePositionalParameters(const Json::Value &parameters)
+    const parameterSchemaList_t& Procedure::GetParameterSchemas() const
     {
-        bool ok = true;
+        return this->parameterSchemas;
+    }
 
-        if(parameters.size() != this->parametersPosition.size())
+    void Procedure::CompileValidator()
+    {
+        if (this->paramDeclaration == PARAMS_BY_NAME)
         {
-            return false;
+            this->validator.CompileNamed(this->parametersName, this->parameterSchemas);
         }
-
-        for(unsigned int i=0; ok && i < this->parametersPosition.size(); i++)
+        else
         {
-            ok = this->ValidateSingleParameter(this->parametersPosition.at(i), parameters[i]);
+            this->validator.CompilePositional(this->parametersPositionName, this->parametersPosition, this->parameterSchemas);
         }
-        return ok;
     }
 
-    bool Procedure::ValidateSingleParameter(jsontype_t expectedType, const Json::Value &value)
+    parameterDeclaration_t Procedure::GetParameterDeclarationType()
+    {
+        return this->paramDeclaration;
+    }
+
+    int Procedure::GetDispatchIndex() const
     {
-        bool ok = true;
-        switch (expectedType)
-        {
-            case JSON_STRING:
-                if (!value.isString())
-                    ok = false;
-                break;
-            case JSON_BOOLEAN:
-                if (!value.isBool())
-                    ok = false;
-                break;
-            case JSON_INTEGER:
-                if (!value.isInt())
-                    ok = false;
-                break;
-            case JSON_REAL:
-                if (!value.isDouble())
-                    ok = false;
-                break;
-            case JSON_OBJECT:
-                if (!value.isObject())
-                    ok = false;
-                break;
-            case JSON_ARRAY:
-                if (!value.isArray())
-                    ok = false;
-                break;
-            case JSON_NULL:
-                if (!value.isNull())
-                    ok = false;
-                break;
-        }
-        return ok;
+        return this->dispatchIndex;
+    }
+
+    void Procedure::SetDispatchIndex(int index)
+    {
+        this->dispatchIndex = index;
+    }
+
+    void Procedure::SetRunSerially(bool serially)
+    {
+        this->runSerially = serially;
+    }
+
+    bool Procedure::GetRunSerially() const
+    {
+        return this->runSerially;
+    }
+
+    void Procedure::SetAsynchronous(bool asynchronous)
+    {
+        this->asynchronous = asynchronous;
+    }
+
+    bool Procedure::GetAsynchronous() const
+    {
+        return this->asynchronous;
+    }
+
+    void Procedure::SetConcurrencyLimit(unsigned int maxConcurrent, unsigned int maxQueued, unsigned int maxQueueTime)
+    {
+        delete this->concurrencyLimit;
+        this->concurrencyLimit = maxConcurrent > 0 ? new ConcurrencyLimit(maxConcurrent, maxQueued, maxQueueTime) : NULL;
+    }
+
+    ConcurrencyLimit* Procedure::GetConcurrencyLimit() const
+    {
+        return this->concurrencyLimit;
+    }
+
+    void Procedure::SetCacheable(bool cacheable, unsigned int ttl)
+    {
+        this->cacheable = cacheable;
+        this->cacheTtl = ttl;
+    }
+
+    bool Procedure::GetCacheable() const
+    {
+        return this->cacheable;
+    }
+
+    unsigned int Procedure::GetCacheTtl() const
+    {
+        return this->cacheTtl;
+    }
+
+    void Procedure::SetSingleFlight(bool singleFlight)
+    {
+        this->singleFlight = singleFlight;
+    }
+
+    bool Procedure::GetSingleFlight() const
+    {
+        return this->singleFlight;
+    }
+
+    ProcedureStats& Procedure::GetStats()
+    {
+        return this->stats;
     }
 
 } /* namespace jsonrpc */
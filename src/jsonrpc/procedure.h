@@ -15,6 +15,12 @@
 
 #include "json/json.h"
 #include "specification.h"
+#include "concurrencylimit.h"
+#include "parametervalidator.h"
+#include "procedurestats.h"
+
+#define PROCEDURE_DEFAULT_MAX_QUEUE_TIME 100
+#define PROCEDURE_DEFAULT_CACHE_TTL 1000
 
 namespace jsonrpc
 {
@@ -51,7 +57,7 @@ namespace jsonrpc
              * @see http://groups.google.com/group/json-rpc/web/json-rpc-2-0
              * @return true on successful validation false otherwise.
              *
-             * If the valid parameters are of Type JSON_ARRAY or JSON_OBJECT, they can only be checked for name and not for their structure.
+             * Parameters of Type JSON_ARRAY or JSON_OBJECT are only checked for their structure if they have a schema, see SetParameterSchema.
              */
             bool ValdiateParameters(const Json::Value &parameters);
 
@@ -63,8 +69,72 @@ namespace jsonrpc
 
             void AddParameter(const std::string& name, jsontype_t type);
 
+            /**
+             * @brief Checks the declared parameter name against schema in addition to its type, see ParameterValidator for the
+             * supported part of JSON Schema. Positional parameters read from a specification are named param1, param2, ...
+             * @throws JsonRpcException if the parameter is not declared or the schema is malformed.
+             */
+            void SetParameterSchema(const std::string& name, const Json::Value& schema);
+            const parameterSchemaList_t& GetParameterSchemas() const;
+
             parameterDeclaration_t GetParameterDeclarationType();
 
+            /**
+             * @brief Position of the bound handler in the dispatch table of the server, -1 if none is bound.
+             * Set by AbstractServer when a method or notification is bound to this procedure.
+             */
+            int GetDispatchIndex() const;
+            void SetDispatchIndex(int index);
+
+            /**
+             * @brief Marks the procedure to be kept out of parallel batch execution. Its calls within a batch run
+             * on the connector thread, one after another and after all other elements of the batch finished.
+             */
+            void SetRunSerially(bool serially);
+            bool GetRunSerially() const;
+
+            /**
+             * @brief Marks the method to be answered through a MethodCompletion instead of its output parameter,
+             * see AbstractRequestHandler::handleAsyncMethodCall. Set by AbstractServer when an asynchronous method is bound.
+             */
+            void SetAsynchronous(bool asynchronous);
+            bool GetAsynchronous() const;
+
+            /**
+             * @brief Limits the number of calls of this procedure that run at once. Calls over the limit wait for a free slot
+             * if fewer than maxQueued calls are waiting already, for at most maxQueueTime milliseconds. All others are answered
+             * with Errors::ERROR_SERVER_PROCEDURE_BUSY. An asynchronous call keeps its slot until it is completed.
+             * The limit has to be set before the server handles requests, maxConcurrent 0 removes it.
+             */
+            void SetConcurrencyLimit(unsigned int maxConcurrent, unsigned int maxQueued = 0,
+                                     unsigned int maxQueueTime = PROCEDURE_DEFAULT_MAX_QUEUE_TIME);
+
+            /**
+             * @return the limit set by SetConcurrencyLimit, NULL if the calls are not limited.
+             */
+            ConcurrencyLimit* GetConcurrencyLimit() const;
+
+            /**
+             * @brief Marks the method to have its results kept in the ResultCache of the server for ttl milliseconds.
+             * A call with the same parameters is answered from the cache without validating the parameters or calling
+             * the handler, so the result must only depend on the parameters. Asynchronous methods are never cached.
+             */
+            void SetCacheable(bool cacheable, unsigned int ttl = PROCEDURE_DEFAULT_CACHE_TTL);
+            bool GetCacheable() const;
+            unsigned int GetCacheTtl() const;
+
+            /**
+             * @brief Lets calls of the method with the same parameters share one execution. A call arriving while an identical one
+             * is running waits for it and is answered with its result or error, only the id differs. Asynchronous methods never share.
+             */
+            void SetSingleFlight(bool singleFlight);
+            bool GetSingleFlight() const;
+
+            /**
+             * @brief Counters of the calls of this procedure, only recorded by servers with RpcProtocolServer::SetStatsEnabled.
+             */
+            ProcedureStats& GetStats();
+
         private:
             /**
              * Each Procedure should have a name.
@@ -81,6 +151,14 @@ namespace jsonrpc
              * This vector holds all parametertypes by position.
              */
             parameterPositionList_t parametersPosition;
+            std::vector<std::string> parametersPositionName;
+
+            parameterSchemaList_t parameterSchemas;
+
+            /**
+             * Checks compiled from the parameters and their schemas whenever one of them changes.
+             */
+            ParameterValidator validator;
 
             /**
              * defines whether the procedure is a real procedure or just a notification
@@ -94,9 +172,26 @@ namespace jsonrpc
 
             parameterDeclaration_t paramDeclaration;
 
-            bool ValidateNamedParameters(const Json::Value &parameters);
-            bool ValidatePositionalParameters(const Json::Value &parameters);
-            bool ValidateSingleParameter(jsontype_t expectedType, const Json::Value &value);
+            int dispatchIndex;
+
+            bool runSerially;
+
+            bool asynchronous;
+
+            ConcurrencyLimit* concurrencyLimit;
+
+            bool cacheable;
+
+            unsigned int cacheTtl;
+
+            bool singleFlight;
+
+            ProcedureStats stats;
+
+            Procedure(const Procedure&);            // no implementation
+            void operator=(const Procedure&);       // no implementation
+
+            void CompileValidator();
     };
 
     typedef std::map<std::string, Procedure*> procedurelist_t;
@@ -0,0 +1,80 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    procedureindex.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "procedureindex.h"
+#include <cstring>
+
+using namespace std;
+
+namespace jsonrpc
+{
+    ProcedureIndex::ProcedureIndex() :
+        mask(0)
+    {
+    }
+
+    void ProcedureIndex::Build(const procedurelist_t& procedures)
+    {
+        //Power of two capacity with at most 50% load keeps the probe sequences short.
+        size_t capacity = 8;
+        while (capacity < procedures.size() * 2)
+        {
+            capacity *= 2;
+        }
+        Slot empty = {0, NULL};
+        this->slots.assign(capacity, empty);
+        this->mask = capacity - 1;
+
+        for (procedurelist_t::const_iterator it = procedures.begin(); it != procedures.end(); it++)
+        {
+            size_t hash = Hash(it->first.data(), it->first.size());
+            size_t i = hash & this->mask;
+            while (this->slots[i].procedure != NULL)
+            {
+                i = (i + 1) & this->mask;
+            }
+            this->slots[i].hash = hash;
+            this->slots[i].procedure = it->second;
+        }
+    }
+
+    Procedure* ProcedureIndex::Find(const char* name, size_t length) const
+    {
+        if (this->slots.empty())
+        {
+            return NULL;
+        }
+        size_t hash = Hash(name, length);
+        for (size_t i = hash & this->mask; this->slots[i].procedure != NULL; i = (i + 1) & this->mask)
+        {
+            const Slot& slot = this->slots[i];
+            if (slot.hash == hash)
+            {
+                const string& procedureName = slot.procedure->GetProcedureName();
+                if (procedureName.size() == length && memcmp(procedureName.data(), name, length) == 0)
+                {
+                    return slot.procedure;
+                }
+            }
+        }
+        return NULL;
+    }
+
+    size_t ProcedureIndex::Hash(const char* name, size_t length)
+    {
+        //FNV-1a
+        size_t hash = (size_t) 2166136261u;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,57 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    procedureindex.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef PROCEDUREINDEX_H_
+#define PROCEDUREINDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "procedure.h"
+
+namespace jsonrpc
+{
+    /**
+     * @brief Open addressing hash table from procedure names to Procedures.
+     *
+     * It is rebuilt from the procedure list whenever procedures are registered, and
+     * resolves the method name of a request in a single probe sequence, without
+     * copying the name into a std::string.
+     */
+    class ProcedureIndex
+    {
+        public:
+            ProcedureIndex();
+
+            /**
+             * @brief Replaces the content of the index by procedures.
+             */
+            void Build(const procedurelist_t& procedures);
+
+            /**
+             * @brief Looks up the procedure called name.
+             * @return the procedure, or NULL if there is none with this name.
+             */
+            Procedure* Find(const char* name, size_t length) const;
+
+        private:
+            struct Slot
+            {
+                size_t hash;
+                Procedure* procedure;
+            };
+
+            static size_t Hash(const char* name, size_t length);
+
+            std::vector<Slot> slots;
+            size_t mask;
+    };
+
+} /* namespace jsonrpc */
+#endif /* PROCEDUREINDEX_H_ */
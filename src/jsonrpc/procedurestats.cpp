@@ -0,0 +1,428 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    procedurestats.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "procedurestats.h"
+#include <pthread.h>
+#include <time.h>
+#include <sstream>
+
+/**
+ * Latencies below this number of ticks get a bucket each.
+ */
+#define STATS_LINEAR_BUCKETS 16
+#define STATS_LINEAR_BITS 4
+/**
+ * Every power of two above the linear range is split into 2^STATS_SUB_BUCKET_BITS buckets.
+ */
+#define STATS_SUB_BUCKET_BITS 3
+/**
+ * Latencies of 2^STATS_MAX_EXPONENT ticks and more share the last bucket.
+ */
+#define STATS_MAX_EXPONENT 40
+
+#define STATS_BUCKETS (STATS_LINEAR_BUCKETS + ((STATS_MAX_EXPONENT - STATS_LINEAR_BITS) << STATS_SUB_BUCKET_BITS))
+
+namespace jsonrpc
+{
+    //The counters of a slot are only written by the thread owning it, which lets it count with plain loads and
+    //stores instead of locked instructions. They are relaxed atomics only to keep the concurrent reads well defined.
+    static inline unsigned long long Load(const unsigned long long& counter)
+    {
+        return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    }
+
+    static inline void Add(unsigned long long& counter, unsigned long long value, bool shared)
+    {
+        if (shared)
+        {
+            __atomic_fetch_add(&counter, value, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+        }
+    }
+
+    static inline unsigned int Bucket(unsigned long long ticks)
+    {
+        if (ticks < STATS_LINEAR_BUCKETS)
+        {
+            return (unsigned int) ticks;
+        }
+        int exponent = 63 - __builtin_clzll(ticks);
+        if (exponent >= STATS_MAX_EXPONENT)
+        {
+            return STATS_BUCKETS - 1;
+        }
+        unsigned int sub = (unsigned int) (ticks >> (exponent - STATS_SUB_BUCKET_BITS)) & ((1 << STATS_SUB_BUCKET_BITS) - 1);
+        return STATS_LINEAR_BUCKETS + ((exponent - STATS_LINEAR_BITS) << STATS_SUB_BUCKET_BITS) + sub;
+    }
+
+    //Slot of the calling thread in every ProcedureStats, the key hands it back when the thread exits.
+    static __thread int threadSlot = -1;
+    static volatile int slotOwners[STATS_MAX_THREADS];
+    static pthread_key_t threadSlotKey;
+    static pthread_once_t threadSlotKeyOnce = PTHREAD_ONCE_INIT;
+
+    static void ReleaseThreadSlot(void* slot)
+    {
+        //Stored off by one, because the key only calls back for values other than NULL.
+        __sync_lock_release(&slotOwners[(long) slot - 1]);
+    }
+
+    static void CreateThreadSlotKey()
+    {
+        pthread_key_create(&threadSlotKey, ReleaseThreadSlot);
+    }
+
+    static int ClaimThreadSlot()
+    {
+        pthread_once(&threadSlotKeyOnce, CreateThreadSlotKey);
+        threadSlot = STATS_MAX_THREADS;
+        for (int i = 0; i < STATS_MAX_THREADS; i++)
+        {
+            if (__sync_bool_compare_and_swap(&slotOwners[i], 0, 1))
+            {
+                pthread_setspecific(threadSlotKey, (void*) (long) (i + 1));
+                threadSlot = i;
+                break;
+            }
+        }
+        return threadSlot;
+    }
+
+    static unsigned long long MonotonicNanoseconds()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+
+    static double nanosecondsPerTick = 1.0;
+    static pthread_once_t calibrationOnce = PTHREAD_ONCE_INIT;
+
+    static void Calibrate()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned long long startTime = MonotonicNanoseconds();
+        unsigned long long startTicks = ProcedureStats::Now();
+        struct timespec pause = {0, 10000000};
+        nanosleep(&pause, NULL);
+        unsigned long long ticks = ProcedureStats::Now() - startTicks;
+        unsigned long long time = MonotonicNanoseconds() - startTime;
+        if (ticks > 0)
+        {
+            nanosecondsPerTick = (double) time / ticks;
+        }
+#endif
+    }
+
+    /**
+     * @brief The counters of one thread slot.
+     */
+    class ProcedureStats::Shard
+    {
+        public:
+            Shard() :
+                calls(0),
+                bytesIn(0),
+                bytesOut(0),
+                otherErrors(0)
+            {
+                for (int i = 0; i < STATS_MAX_ERROR_CODES; i++)
+                {
+                    this->errorCodes[i] = 0;
+                    this->errorCounts[i] = 0;
+                }
+                for (int phase = 0; phase < STATS_PHASES; phase++)
+                {
+                    this->ticks[phase] = 0;
+                    for (int i = 0; i < STATS_BUCKETS; i++)
+                    {
+                        this->counts[phase][i] = 0;
+                    }
+                }
+            }
+
+            unsigned long long calls;
+            unsigned long long bytesIn;
+            unsigned long long bytesOut;
+            unsigned long long otherErrors;
+            /**
+             * Error codes in the order they were first seen, 0 marks a free entry.
+             */
+            volatile int errorCodes[STATS_MAX_ERROR_CODES];
+            unsigned long long errorCounts[STATS_MAX_ERROR_CODES];
+            unsigned long long ticks[STATS_PHASES];
+            unsigned long long counts[STATS_PHASES][STATS_BUCKETS];
+    };
+
+    const unsigned int LatencyHistogram::BUCKETS = STATS_BUCKETS;
+
+    LatencyHistogram::LatencyHistogram() :
+        counts(STATS_BUCKETS, 0),
+        ticks(0),
+        nanosecondsPerTick(1.0)
+    {
+    }
+
+    unsigned long long LatencyHistogram::GetCount() const
+    {
+        unsigned long long count = 0;
+        for (unsigned int i = 0; i < this->counts.size(); i++)
+        {
+            count += this->counts[i];
+        }
+        return count;
+    }
+
+    double LatencyHistogram::GetMean() const
+    {
+        unsigned long long count = this->GetCount();
+        return count > 0 ? this->ticks * this->nanosecondsPerTick / count : 0.0;
+    }
+
+    double LatencyHistogram::GetPercentile(double percentile) const
+    {
+        unsigned long long count = this->GetCount();
+        if (count == 0)
+        {
+            return 0.0;
+        }
+        double rank = percentile / 100.0 * count;
+        unsigned long long seen = 0;
+        for (unsigned int i = 0; i < this->counts.size(); i++)
+        {
+            seen += this->counts[i];
+            if (seen > 0 && seen >= rank)
+            {
+                return GetBucketLimit(i) * this->nanosecondsPerTick;
+            }
+        }
+        return this->GetMax();
+    }
+
+    double LatencyHistogram::GetMax() const
+    {
+        for (unsigned int i = (unsigned int) this->counts.size(); i > 0; i--)
+        {
+            if (this->counts[i - 1] > 0)
+            {
+                return GetBucketLimit(i - 1) * this->nanosecondsPerTick;
+            }
+        }
+        return 0.0;
+    }
+
+    Json::Value LatencyHistogram::ToJson() const
+    {
+        Json::Value result;
+        result["count"] = Json::Value::UInt64(this->GetCount());
+        result["mean"] = this->GetMean();
+        result["p50"] = this->GetPercentile(50);
+        result["p90"] = this->GetPercentile(90);
+        result["p99"] = this->GetPercentile(99);
+        result["max"] = this->GetMax();
+        return result;
+    }
+
+    unsigned int LatencyHistogram::GetBucket(unsigned long long ticks)
+    {
+        return Bucket(ticks);
+    }
+
+    unsigned long long LatencyHistogram::GetBucketLimit(unsigned int bucket)
+    {
+        if (bucket < STATS_LINEAR_BUCKETS)
+        {
+            return bucket;
+        }
+        int exponent = STATS_LINEAR_BITS + ((bucket - STATS_LINEAR_BUCKETS) >> STATS_SUB_BUCKET_BITS);
+        unsigned long long sub = (bucket - STATS_LINEAR_BUCKETS) & ((1 << STATS_SUB_BUCKET_BITS) - 1);
+        int step = exponent - STATS_SUB_BUCKET_BITS;
+        return (((1ULL << STATS_SUB_BUCKET_BITS) + sub + 1) << step) - 1;
+    }
+
+    StatsSnapshot::StatsSnapshot() :
+        calls(0),
+        otherErrors(0),
+        bytesIn(0),
+        bytesOut(0)
+    {
+    }
+
+    Json::Value StatsSnapshot::ToJson() const
+    {
+        static const char* phaseNames[STATS_PHASES] = {"parse", "validate", "dispatch", "serialize"};
+
+        Json::Value result;
+        result["calls"] = Json::Value::UInt64(this->calls);
+        result["errors"] = Json::Value(Json::objectValue);
+        for (std::map<int, unsigned long long>::const_iterator it = this->errors.begin(); it != this->errors.end(); it++)
+        {
+            std::stringstream code;
+            code << it->first;
+            result["errors"][code.str()] = Json::Value::UInt64(it->second);
+        }
+        if (this->otherErrors > 0)
+        {
+            result["errors"]["other"] = Json::Value::UInt64(this->otherErrors);
+        }
+        result["bytesIn"] = Json::Value::UInt64(this->bytesIn);
+        result["bytesOut"] = Json::Value::UInt64(this->bytesOut);
+        for (int phase = 0; phase < STATS_PHASES; phase++)
+        {
+            result["latency"][phaseNames[phase]] = this->phases[phase].ToJson();
+        }
+        return result;
+    }
+
+    ProcedureStats::ProcedureStats()
+    {
+        for (int i = 0; i <= STATS_MAX_THREADS; i++)
+        {
+            this->shards[i] = NULL;
+        }
+    }
+
+    ProcedureStats::~ProcedureStats()
+    {
+        for (int i = 0; i <= STATS_MAX_THREADS; i++)
+        {
+            delete this->shards[i];
+        }
+    }
+
+    void ProcedureStats::RecordCall(int errorCode)
+    {
+        bool shared;
+        Shard* shard = this->GetShard(shared);
+        Add(shard->calls, 1, shared);
+        if (errorCode == 0)
+        {
+            return;
+        }
+        for (int i = 0; i < STATS_MAX_ERROR_CODES; i++)
+        {
+            int code = __atomic_load_n(&shard->errorCodes[i], __ATOMIC_RELAXED);
+            if (code == 0)
+            {
+                //Only the shared slot can lose this race, then the entry is looked at again.
+                code = __sync_val_compare_and_swap(&shard->errorCodes[i], 0, errorCode);
+                if (code == 0)
+                {
+                    code = errorCode;
+                }
+            }
+            if (code == errorCode)
+            {
+                Add(shard->errorCounts[i], 1, shared);
+                return;
+            }
+        }
+        Add(shard->otherErrors, 1, shared);
+    }
+
+    void ProcedureStats::RecordPhase(statsphase_t phase, unsigned long long ticks)
+    {
+        bool shared;
+        Shard* shard = this->GetShard(shared);
+        Add(shard->ticks[phase], ticks, shared);
+        Add(shard->counts[phase][Bucket(ticks)], 1, shared);
+    }
+
+    void ProcedureStats::RecordBytes(unsigned long long in, unsigned long long out)
+    {
+        bool shared;
+        Shard* shard = this->GetShard(shared);
+        Add(shard->bytesIn, in, shared);
+        Add(shard->bytesOut, out, shared);
+    }
+
+    void ProcedureStats::GetSnapshot(StatsSnapshot& snapshot) const
+    {
+        snapshot = StatsSnapshot();
+        double tick = GetNanosecondsPerTick();
+        for (int phase = 0; phase < STATS_PHASES; phase++)
+        {
+            snapshot.phases[phase].nanosecondsPerTick = tick;
+        }
+        for (int i = 0; i <= STATS_MAX_THREADS; i++)
+        {
+            const Shard* shard = __atomic_load_n(&this->shards[i], __ATOMIC_ACQUIRE);
+            if (shard == NULL)
+            {
+                continue;
+            }
+            snapshot.calls += Load(shard->calls);
+            snapshot.bytesIn += Load(shard->bytesIn);
+            snapshot.bytesOut += Load(shard->bytesOut);
+            snapshot.otherErrors += Load(shard->otherErrors);
+            for (int j = 0; j < STATS_MAX_ERROR_CODES; j++)
+            {
+                int code = __atomic_load_n(&shard->errorCodes[j], __ATOMIC_RELAXED);
+                unsigned long long count = Load(shard->errorCounts[j]);
+                if (code != 0 && count > 0)
+                {
+                    snapshot.errors[code] += count;
+                }
+            }
+            for (int phase = 0; phase < STATS_PHASES; phase++)
+            {
+                snapshot.phases[phase].ticks += Load(shard->ticks[phase]);
+                for (int j = 0; j < STATS_BUCKETS; j++)
+                {
+                    snapshot.phases[phase].counts[j] += Load(shard->counts[phase][j]);
+                }
+            }
+        }
+    }
+
+    unsigned long long ProcedureStats::Now()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        return __builtin_ia32_rdtsc();
+#else
+        return MonotonicNanoseconds();
+#endif
+    }
+
+    double ProcedureStats::GetNanosecondsPerTick()
+    {
+        pthread_once(&calibrationOnce, Calibrate);
+        return nanosecondsPerTick;
+    }
+
+    ProcedureStats::Shard* ProcedureStats::GetShard(bool& shared)
+    {
+        int slot = threadSlot;
+        if (slot < 0)
+        {
+            slot = ClaimThreadSlot();
+        }
+        shared = slot == STATS_MAX_THREADS;
+        Shard* shard = __atomic_load_n(&this->shards[slot], __ATOMIC_ACQUIRE);
+        if (shard == NULL)
+        {
+            //Owned slots are created by their thread alone, only the shared one may be created twice at once.
+            Shard* created = new Shard();
+            shard = __sync_val_compare_and_swap(&this->shards[slot], (Shard*) NULL, created);
+            if (shard == NULL)
+            {
+                shard = created;
+            }
+            else
+            {
+                delete created;
+            }
+        }
+        return shard;
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,156 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    procedurestats.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef PROCEDURESTATS_H_
+#define PROCEDURESTATS_H_
+
+#include <map>
+#include <vector>
+
+#include "json/json.h"
+
+/**
+ * Threads recording at the same time beyond this number share one set of counters, which they update with atomic additions.
+ */
+#define STATS_MAX_THREADS 64
+/**
+ * Distinct error codes counted per thread, further codes are counted as "other".
+ */
+#define STATS_MAX_ERROR_CODES 16
+
+namespace jsonrpc
+{
+    /**
+     * @brief The phases a call is timed in. Parsing and serializing belong to the whole request,
+     * the calls of a batch get an equal share of them.
+     */
+    typedef enum
+    {
+        STATS_PARSE, STATS_VALIDATE, STATS_DISPATCH, STATS_SERIALIZE, STATS_PHASES
+    } statsphase_t;
+
+    /**
+     * @brief Latencies counted in logarithmic buckets with 8 linear steps per power of two,
+     * which keeps the error of a reported value below 12.5% over the whole range.
+     */
+    class LatencyHistogram
+    {
+        public:
+            LatencyHistogram();
+
+            unsigned long long GetCount() const;
+            /**
+             * @return the mean latency in nanoseconds.
+             */
+            double GetMean() const;
+            /**
+             * @return the latency in nanoseconds that percentile percent of the calls did not exceed.
+             */
+            double GetPercentile(double percentile) const;
+            double GetMax() const;
+
+            /**
+             * @brief count, mean, p50, p90, p99 and max, in nanoseconds.
+             */
+            Json::Value ToJson() const;
+
+            /**
+             * @return the bucket of a latency of ticks clock ticks.
+             */
+            static unsigned int GetBucket(unsigned long long ticks);
+            /**
+             * @return the largest number of ticks counted in bucket.
+             */
+            static unsigned long long GetBucketLimit(unsigned int bucket);
+
+            static const unsigned int BUCKETS;
+
+        private:
+            friend class ProcedureStats;
+
+            std::vector<unsigned long long> counts;
+            unsigned long long ticks;
+            double nanosecondsPerTick;
+    };
+
+    /**
+     * @brief The counters of a procedure summed up over all threads.
+     */
+    class StatsSnapshot
+    {
+        public:
+            StatsSnapshot();
+
+            unsigned long long calls;
+            /**
+             * Failed calls by error code.
+             */
+            std::map<int, unsigned long long> errors;
+            /**
+             * Failed calls whose code did not fit into the counters of their thread.
+             */
+            unsigned long long otherErrors;
+            unsigned long long bytesIn;
+            unsigned long long bytesOut;
+            LatencyHistogram phases[STATS_PHASES];
+
+            Json::Value ToJson() const;
+    };
+
+    /**
+     * @brief Call counters and latency histograms of one procedure.
+     *
+     * Every thread records into counters of its own without locks or atomic read-modify-write instructions.
+     * GetSnapshot adds them up, so it may miss the calls that are being recorded meanwhile.
+     * Latencies are measured in ticks of Now(), the time stamp counter on x86, and converted when read.
+     */
+    class ProcedureStats
+    {
+        public:
+            ProcedureStats();
+            ~ProcedureStats();
+
+            /**
+             * @param errorCode - 0 for a successful call, the error code of the response otherwise.
+             */
+            void RecordCall(int errorCode);
+            void RecordPhase(statsphase_t phase, unsigned long long ticks);
+            void RecordBytes(unsigned long long in, unsigned long long out);
+
+            void GetSnapshot(StatsSnapshot& snapshot) const;
+
+            /**
+             * @return the current time in ticks.
+             */
+            static unsigned long long Now();
+            /**
+             * @brief Measures the length of a tick, once per process. Blocks for a few milliseconds the first time.
+             */
+            static double GetNanosecondsPerTick();
+
+        private:
+            class Shard;
+
+            ProcedureStats(const ProcedureStats&);      // no implementation
+            void operator=(const ProcedureStats&);      // no implementation
+
+            /**
+             * @param shared - set to true if the calling thread shares its counters with others.
+             */
+            Shard* GetShard(bool& shared);
+
+            /**
+             * Counters of every thread slot, created on the first call recorded by that slot.
+             * The last one is shared by the threads that found no free slot.
+             */
+            Shard* shards[STATS_MAX_THREADS + 1];
+    };
+
+} /* namespace jsonrpc */
+#endif /* PROCEDURESTATS_H_ */
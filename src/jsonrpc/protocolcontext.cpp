@@ -0,0 +1,216 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    protocolcontext.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "protocolcontext.h"
+#include <pthread.h>
+
+#define DEFAULT_MAX_RETAINED_SIZE (1024 * 1024)
+#define STRING_CHUNK_SIZE 16384
+
+namespace jsonrpc
+{
+    /**
+     * @brief Appends the chunks of a writer to a string.
+     */
+    class StringSink : public Json::OutputSink
+    {
+        public:
+            StringSink(std::string& document) :
+                document(document)
+            {
+            }
+
+            virtual void write(const char* data, size_t length)
+            {
+                this->document.append(data, length);
+            }
+
+        private:
+            std::string& document;
+    };
+
+    /**
+     * @brief Passes the chunks of a writer on and counts their bytes.
+     */
+    class CountingSink : public Json::OutputSink
+    {
+        public:
+            CountingSink(Json::OutputSink& sink) :
+                sink(sink),
+                bytes(0)
+            {
+            }
+
+            virtual void write(const char* data, size_t length)
+            {
+                this->bytes += length;
+                this->sink.write(data, length);
+            }
+
+            size_t GetBytes() const
+            {
+                return this->bytes;
+            }
+
+        private:
+            Json::OutputSink& sink;
+            size_t bytes;
+    };
+
+    //Context of the calling thread, the key only deletes it when the thread exits.
+    static __thread ProtocolContext* threadContext = NULL;
+    static pthread_key_t threadContextKey;
+    static pthread_once_t threadContextKeyOnce = PTHREAD_ONCE_INIT;
+
+    static void DeleteThreadContext(void* context)
+    {
+        delete (ProtocolContext*) context;
+    }
+
+    static void CreateThreadContextKey()
+    {
+        pthread_key_create(&threadContextKey, DeleteThreadContext);
+    }
+
+    size_t ProtocolContext::maxRetainedSize = DEFAULT_MAX_RETAINED_SIZE;
+
+    ProtocolContext::ProtocolContext() :
+        arena(new Json::ValueArena()),
+        inUse(false),
+        splicing(false),
+        writtenBytes(0)
+    {
+    }
+
+    ProtocolContext::~ProtocolContext()
+    {
+        delete this->arena;
+    }
+
+    bool ProtocolContext::Parse(const std::string& document, Json::Value& root, bool collectComments)
+    {
+        return this->Parse(document.data(), document.data() + document.size(), root, collectComments);
+    }
+
+    bool ProtocolContext::Parse(const char* begin, const char* end, Json::Value& root, bool collectComments)
+    {
+        //Parsing the caller's buffer directly spares the reader a copy of the document.
+        return this->reader.parse(begin, end, root, collectComments);
+    }
+
+    void ProtocolContext::Write(const Json::Value& root, std::string& document)
+    {
+        StringSink sink(document);
+        document.clear();
+        this->writer.setChunkSize(STRING_CHUNK_SIZE);
+        this->writer.write(root, sink);
+        this->writtenBytes = document.size();
+    }
+
+    void ProtocolContext::Write(const Json::Value& root, Json::OutputSink& sink, size_t chunkSize)
+    {
+        CountingSink counter(sink);
+        this->writer.setChunkSize(chunkSize);
+        this->writer.write(root, counter);
+        this->writtenBytes = counter.GetBytes();
+    }
+
+    size_t ProtocolContext::GetWrittenBytes() const
+    {
+        return this->writtenBytes;
+    }
+
+    void ProtocolContext::SetRawMember(const std::string& member, const std::string& outputName)
+    {
+        this->writer.setRawMember(member, outputName);
+        this->splicing = !member.empty();
+    }
+
+    void ProtocolContext::SetTemplates(const Json::ObjectTemplate* templates, unsigned int count)
+    {
+        this->writer.setTemplates(templates, count);
+    }
+
+    Json::ValueArena& ProtocolContext::GetArena()
+    {
+        return *this->arena;
+    }
+
+    void ProtocolContext::SetMaxRetainedSize(size_t bytes)
+    {
+        maxRetainedSize = bytes;
+    }
+
+    size_t ProtocolContext::GetMaxRetainedSize()
+    {
+        return maxRetainedSize;
+    }
+
+    void ProtocolContext::Recycle()
+    {
+        if (this->arena->usedBytes() > maxRetainedSize)
+        {
+            delete this->arena;
+            this->arena = new Json::ValueArena();
+        }
+        else
+        {
+            this->arena->reset();
+        }
+        if (this->splicing)
+        {
+            this->SetRawMember(std::string(), std::string());
+        }
+        this->writer.setTemplates(NULL, 0);
+        this->writtenBytes = 0;
+    }
+
+    ProtocolContextScope::ProtocolContextScope() :
+        context(threadContext),
+        temporary(false)
+    {
+        if (this->context == NULL)
+        {
+            pthread_once(&threadContextKeyOnce, CreateThreadContextKey);
+            this->context = new ProtocolContext();
+            pthread_setspecific(threadContextKey, this->context);
+            threadContext = this->context;
+        }
+        else if (this->context->inUse)
+        {
+            this->context = new ProtocolContext();
+            this->temporary = true;
+        }
+        this->context->inUse = true;
+    }
+
+    ProtocolContextScope::~ProtocolContextScope()
+    {
+        if (this->temporary)
+        {
+            delete this->context;
+        }
+        else
+        {
+            this->context->Recycle();
+            this->context->inUse = false;
+        }
+    }
+
+    ProtocolContext& ProtocolContextScope::operator*()
+    {
+        return *this->context;
+    }
+
+    ProtocolContext* ProtocolContextScope::operator->()
+    {
+        return this->context;
+    }
+
+} /* namespace jsonrpc */
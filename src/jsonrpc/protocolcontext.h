@@ -0,0 +1,132 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    protocolcontext.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef PROTOCOLCONTEXT_H_
+#define PROTOCOLCONTEXT_H_
+
+#include <string>
+#include "json/json.h"
+
+namespace jsonrpc
+{
+    /**
+     * @brief The reader, writer and Value arena used to handle one request or response.
+     *
+     * Every thread keeps one context across requests, so that the buffers grown by
+     * the previous request are reused instead of being allocated again. Buffers that
+     * grew beyond GetMaxRetainedSize() are released when the context is handed back.
+     * Contexts are borrowed through ProtocolContextScope.
+     */
+    class ProtocolContext
+    {
+        public:
+            ProtocolContext();
+            ~ProtocolContext();
+
+            /**
+             * @brief Parses document into root without copying it.
+             * @return true on success, false if the document is not valid JSON.
+             */
+            bool Parse(const std::string& document, Json::Value& root, bool collectComments = false);
+
+            /**
+             * @brief Parses the document between begin and end into root, the buffer does not have to be terminated.
+             * @return true on success, false if the document is not valid JSON.
+             */
+            bool Parse(const char* begin, const char* end, Json::Value& root, bool collectComments = false);
+
+            /**
+             * @brief Serializes root into document, replacing its content but keeping its capacity.
+             */
+            void Write(const Json::Value& root, std::string& document);
+
+            /**
+             * @brief Serializes root into sink in chunks of chunkSize bytes.
+             */
+            void Write(const Json::Value& root, Json::OutputSink& sink, size_t chunkSize);
+
+            /**
+             * @brief Number of bytes produced by the last Write since the context was borrowed, 0 if there was none.
+             */
+            size_t GetWrittenBytes() const;
+
+            /**
+             * @brief Lets Write splice pre-serialized JSON into the document, see Json::FastWriter::setRawMember.
+             * Splicing is turned off again when the context is handed back.
+             * @param member - name of the string members holding the serialized JSON.
+             * @param outputName - name the spliced members are written with.
+             */
+            void SetRawMember(const std::string& member, const std::string& outputName);
+
+            /**
+             * @brief Lets Write render objects of a known layout from pre-rendered fragments, see Json::FastWriter::setTemplates.
+             * The templates are turned off again when the context is handed back.
+             */
+            void SetTemplates(const Json::ObjectTemplate* templates, unsigned int count);
+
+            /**
+             * @brief Arena for the Values of the current request. Bind it with a Json::ValueArenaScope.
+             * RpcProtocolServer unbinds it while handlers run, so that the Values they keep come from the heap
+             * instead of holding on to the pages of the request.
+             */
+            Json::ValueArena& GetArena();
+
+            /**
+             * @brief Sets the number of bytes a context may keep for the next request, 1 MiB by default.
+             * Applies to all threads, it should be set before the first request is handled.
+             */
+            static void SetMaxRetainedSize(size_t bytes);
+            static size_t GetMaxRetainedSize();
+
+        private:
+            friend class ProtocolContextScope;
+
+            ProtocolContext(const ProtocolContext&);    // no implementation
+            void operator=(const ProtocolContext&);     // no implementation
+
+            /**
+             * @brief Prepares the context for the next request and releases oversized buffers.
+             */
+            void Recycle();
+
+            Json::Reader reader;
+            Json::FastWriter writer;
+            Json::ValueArena* arena;
+            bool inUse;
+            bool splicing;
+            size_t writtenBytes;
+
+            static size_t maxRetainedSize;
+    };
+
+    /**
+     * @brief Borrows the calling thread's ProtocolContext for its lifetime.
+     *
+     * If the thread's context is already borrowed, e.g. by a request handler that calls
+     * another server or a client on the same thread, a temporary context is used instead.
+     */
+    class ProtocolContextScope
+    {
+        public:
+            ProtocolContextScope();
+            ~ProtocolContextScope();
+
+            ProtocolContext& operator*();
+            ProtocolContext* operator->();
+
+        private:
+            ProtocolContextScope(const ProtocolContextScope&);  // no implementation
+            void operator=(const ProtocolContextScope&);        // no implementation
+
+            ProtocolContext* context;
+            bool temporary;
+    };
+
+} /* namespace jsonrpc */
+#endif /* PROTOCOLCONTEXT_H_ */
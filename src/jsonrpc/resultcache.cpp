@@ -0,0 +1,284 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    resultcache.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "resultcache.h"
+#include <list>
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+
+namespace jsonrpc
+{
+    static unsigned long long NowMs()
+    {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        return now.tv_sec * 1000ULL + now.tv_usec / 1000;
+    }
+
+    /**
+     * @brief Appends a type tag and the value to key, strings with their length so that no two values collide.
+     */
+    static void AppendCanonical(const Json::Value& value, std::string& key)
+    {
+        char number[32];
+        switch (value.type())
+        {
+            case Json::nullValue:
+                key += 'n';
+                break;
+            case Json::booleanValue:
+                key += value.asBool() ? 't' : 'f';
+                break;
+            case Json::intValue:
+                //Non-negative integers are read as either type, they have to give the same key.
+                if (value.asInt64() >= 0)
+                {
+                    snprintf(number, sizeof(number), "u%llu;", (unsigned long long) value.asUInt64());
+                }
+                else
+                {
+                    snprintf(number, sizeof(number), "i%lld;", (long long) value.asInt64());
+                }
+                key += number;
+                break;
+            case Json::uintValue:
+                snprintf(number, sizeof(number), "u%llu;", (unsigned long long) value.asUInt64());
+                key += number;
+                break;
+            case Json::realValue:
+                snprintf(number, sizeof(number), "d%.17g;", value.asDouble());
+                key += number;
+                break;
+            case Json::stringValue:
+            {
+                const char* string = value.asCString();
+                std::string::size_type length = strlen(string);
+                snprintf(number, sizeof(number), "s%lu:", (unsigned long) length);
+                key += number;
+                key.append(string, length);
+                break;
+            }
+            case Json::arrayValue:
+                key += '[';
+                for (unsigned int i = 0; i < value.size(); i++)
+                {
+                    AppendCanonical(value[i], key);
+                }
+                key += ']';
+                break;
+            case Json::objectValue:
+                //Members are iterated in name order.
+                key += '{';
+                for (Json::Value::const_iterator it = value.begin(); it != value.end(); ++it)
+                {
+                    const char* name = it.memberName();
+                    std::string::size_type length = strlen(name);
+                    snprintf(number, sizeof(number), "%lu:", (unsigned long) length);
+                    key += number;
+                    key.append(name, length);
+                    AppendCanonical(*it, key);
+                }
+                key += '}';
+                break;
+        }
+    }
+
+    /**
+     * @brief One independently locked part of the cache.
+     */
+    class ResultCache::Shard
+    {
+        public:
+            struct Entry
+            {
+                std::string result;
+                unsigned long long expires;
+                std::list<const std::string*>::iterator position;
+            };
+            typedef std::map<std::string, Entry> entries_t;
+
+            Shard(size_t maxBytes) :
+                maxBytes(maxBytes),
+                bytes(0),
+                hits(0),
+                misses(0)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+            }
+
+            ~Shard()
+            {
+                pthread_mutex_destroy(&this->mutex);
+            }
+
+            void Erase(entries_t::iterator entry)
+            {
+                this->bytes -= entry->first.size() + entry->second.result.size();
+                this->lru.erase(entry->second.position);
+                this->entries.erase(entry);
+            }
+
+            size_t maxBytes;
+            size_t bytes;
+            unsigned long hits;
+            unsigned long misses;
+            entries_t entries;
+            /**
+             * Keys of the entries, the most recently used first.
+             */
+            std::list<const std::string*> lru;
+            pthread_mutex_t mutex;
+    };
+
+    ResultCache::ResultCache(size_t maxBytes, unsigned int shards) :
+        maxBytes(maxBytes)
+    {
+        if (shards == 0)
+        {
+            shards = 1;
+        }
+        for (unsigned int i = 0; i < shards; i++)
+        {
+            this->shards.push_back(new Shard(maxBytes / shards));
+        }
+    }
+
+    ResultCache::~ResultCache()
+    {
+        for (unsigned int i = 0; i < this->shards.size(); i++)
+        {
+            delete this->shards[i];
+        }
+    }
+
+    void ResultCache::BuildKey(const std::string& method, const Json::Value& parameters, std::string& key)
+    {
+        key = method;
+        key += '\n';
+        AppendCanonical(parameters, key);
+    }
+
+    bool ResultCache::Lookup(const std::string& key, std::string& result)
+    {
+        Shard& shard = this->GetShard(key);
+        pthread_mutex_lock(&shard.mutex);
+        Shard::entries_t::iterator entry = shard.entries.find(key);
+        if (entry != shard.entries.end() && entry->second.expires <= NowMs())
+        {
+            shard.Erase(entry);
+            entry = shard.entries.end();
+        }
+        if (entry == shard.entries.end())
+        {
+            shard.misses++;
+            pthread_mutex_unlock(&shard.mutex);
+            return false;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry->second.position);
+        result = entry->second.result;
+        shard.hits++;
+        pthread_mutex_unlock(&shard.mutex);
+        return true;
+    }
+
+    void ResultCache::Store(const std::string& key, const std::string& result, unsigned int ttl)
+    {
+        Shard& shard = this->GetShard(key);
+        size_t size = key.size() + result.size();
+        if (size > shard.maxBytes || ttl == 0)
+        {
+            return;
+        }
+        pthread_mutex_lock(&shard.mutex);
+        Shard::entries_t::iterator entry = shard.entries.find(key);
+        if (entry != shard.entries.end())
+        {
+            shard.Erase(entry);
+        }
+        while (shard.bytes + size > shard.maxBytes)
+        {
+            shard.Erase(shard.entries.find(*shard.lru.back()));
+        }
+        entry = shard.entries.insert(std::make_pair(key, Shard::Entry())).first;
+        entry->second.result = result;
+        entry->second.expires = NowMs() + ttl;
+        shard.lru.push_front(&entry->first);
+        entry->second.position = shard.lru.begin();
+        shard.bytes += size;
+        pthread_mutex_unlock(&shard.mutex);
+    }
+
+    void ResultCache::Clear()
+    {
+        for (unsigned int i = 0; i < this->shards.size(); i++)
+        {
+            Shard& shard = *this->shards[i];
+            pthread_mutex_lock(&shard.mutex);
+            shard.entries.clear();
+            shard.lru.clear();
+            shard.bytes = 0;
+            pthread_mutex_unlock(&shard.mutex);
+        }
+    }
+
+    unsigned long ResultCache::GetHits() const
+    {
+        unsigned long hits = 0;
+        for (unsigned int i = 0; i < this->shards.size(); i++)
+        {
+            pthread_mutex_lock(&this->shards[i]->mutex);
+            hits += this->shards[i]->hits;
+            pthread_mutex_unlock(&this->shards[i]->mutex);
+        }
+        return hits;
+    }
+
+    unsigned long ResultCache::GetMisses() const
+    {
+        unsigned long misses = 0;
+        for (unsigned int i = 0; i < this->shards.size(); i++)
+        {
+            pthread_mutex_lock(&this->shards[i]->mutex);
+            misses += this->shards[i]->misses;
+            pthread_mutex_unlock(&this->shards[i]->mutex);
+        }
+        return misses;
+    }
+
+    size_t ResultCache::GetSize() const
+    {
+        size_t bytes = 0;
+        for (unsigned int i = 0; i < this->shards.size(); i++)
+        {
+            pthread_mutex_lock(&this->shards[i]->mutex);
+            bytes += this->shards[i]->bytes;
+            pthread_mutex_unlock(&this->shards[i]->mutex);
+        }
+        return bytes;
+    }
+
+    size_t ResultCache::GetMaxSize() const
+    {
+        return this->maxBytes;
+    }
+
+    ResultCache::Shard& ResultCache::GetShard(const std::string& key)
+    {
+        //FNV-1a
+        size_t hash = (size_t) 2166136261u;
+        for (size_t i = 0; i < key.size(); i++)
+        {
+            hash = (hash ^ (unsigned char) key[i]) * 16777619u;
+        }
+        return *this->shards[hash % this->shards.size()];
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,84 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    resultcache.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "json/json.h"
+
+#define RESULTCACHE_DEFAULT_SHARDS 16
+
+namespace jsonrpc
+{
+    /**
+     * @brief Serialized results of cacheable procedures, see Procedure::SetCacheable.
+     *
+     * The entries are spread over shards by the hash of their key, every shard has a lock, an equal
+     * part of the byte budget and an LRU list of its own. An entry expires after the ttl it was
+     * stored with, a shard over its budget evicts its least recently used entries. The hit and
+     * miss counters are kept per shard as well and summed up when they are read.
+     */
+    class ResultCache
+    {
+        public:
+            /**
+             * @param maxBytes - byte budget for all keys and results together.
+             * @param shards - number of independently locked parts of the cache.
+             */
+            ResultCache(size_t maxBytes, unsigned int shards = RESULTCACHE_DEFAULT_SHARDS);
+            ~ResultCache();
+
+            /**
+             * @brief Builds the key of a call, equal parameters give equal keys regardless of their member order.
+             */
+            static void BuildKey(const std::string& method, const Json::Value& parameters, std::string& key);
+
+            /**
+             * @brief Copies the result stored for key into result, unless it is missing or expired.
+             * @return true on a hit.
+             */
+            bool Lookup(const std::string& key, std::string& result);
+
+            /**
+             * @brief Stores result for ttl milliseconds. Results larger than the budget of a shard are not stored.
+             */
+            void Store(const std::string& key, const std::string& result, unsigned int ttl);
+
+            /**
+             * @brief Removes all entries, the counters are kept.
+             */
+            void Clear();
+
+            unsigned long GetHits() const;
+            unsigned long GetMisses() const;
+
+            /**
+             * @return bytes of keys and results currently stored.
+             */
+            size_t GetSize() const;
+            size_t GetMaxSize() const;
+
+        private:
+            class Shard;
+
+            ResultCache(const ResultCache&);        // no implementation
+            void operator=(const ResultCache&);     // no implementation
+
+            Shard& GetShard(const std::string& key);
+
+            size_t maxBytes;
+            std::vector<Shard*> shards;
+    };
+
+} /* namespace jsonrpc */
+#endif /* RESULTCACHE_H_ */
@@ -17,6 +17,7 @@
 #include "exception.h"
 
 #include "connectors/httpserver.h"
+#include "connectors/epollhttpserver.h"
 #include "connectors/websocketserver.h"
 #include "connectors/httpclient.h"
 
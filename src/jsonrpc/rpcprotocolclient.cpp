@@ -8,7 +8,7 @@
  ************************************************************************/
 
 #include "rpcprotocolclient.h"
-#include "json/writer.h"
+#include "protocolcontext.h"
 
 namespace jsonrpc
 {
@@ -34,10 +34,10 @@ namespace jsonrpc
 
     void RpcProtocolClient::BuildRequest(const std::string &method, const Json::Value &parameter, std::string &result, bool isNotification)
     {
+        ProtocolContextScope context;
         Json::Value request;
-        Json::FastWriter writer;
         this->BuildRequest(method,parameter,request, isNotification);
-        result = writer.write(request);
+        context->Write(request, result);
     }
 
     std::string RpcProtocolClient::BuildBatchRequest(batchProcedureCall_t &requests, bool isNotification)
@@ -49,17 +49,15 @@ namespace jsonrpc
 
     void RpcProtocolClient::BuildBatchRequest(batchProcedureCall_t &requests, std::string &result, bool isNotification)
     {
-        Json::Value singlerequest;
+        ProtocolContextScope context;
         Json::Value res;
-        Json::FastWriter writer;
         int i=0;
         for(batchProcedureCall_t::iterator it = requests.begin(); it != requests.end(); it++)
         {
-            this->BuildRequest(it->first, it->second, singlerequest, isNotification);
-            res[i] = singlerequest;
+            this->BuildRequest(it->first, it->second, res[i], isNotification);
             i++;
         }
-        result = writer.write(res);
+        context->Write(res, result);
     }
 
     Json::Value RpcProtocolClient::HandleResponse(const std::string &response) throw(JsonRpcException)
@@ -71,15 +69,16 @@ namespace jsonrpc
 
     void RpcProtocolClient::HandleResponse(const std::string &response, Json::Value& result) throw(JsonRpcException)
     {
-        Json::Reader reader;
+        ProtocolContextScope context;
         Json::Value value;
-        if(reader.parse(response, value))
+        if(context->Parse(response, value, true))
         {
             if(value.isMember(KEY_ID) && value.isMember(KEY_PROTOCOL_VERSION) && (value.isMember(KEY_RESULT) || value.isMember(KEY_ERROR)))
             {
                 if(value.isMember(KEY_RESULT))
                 {
-                    result = value[KEY_RESULT];
+                    //value is discarded anyway, so the result is swapped out instead of copied.
+                    result.swap(value[KEY_RESULT]);
                 }
                 else
                 {
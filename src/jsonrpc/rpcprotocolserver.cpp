@@ -10,25 +10,431 @@
 #include "rpcprotocolserver.h"
 #include "errors.h"
 #include "server.h"
+#include "methodcompletion.h"
 
+#include <algorithm>
 #include <iostream>
+#include <cstring>
 
 using namespace std;
 
+/**
+ * Member of a response holding a serialized result from the cache or another call, it is written as "result".
+ * Sorting right after "result" keeps the member order of the envelope.
+ */
+#define KEY_RESPONSE_RAW_RESULT "result\x01"
+
 namespace jsonrpc
 {
+    static const char* RenderRawResult(const Json::Value& result)
+    {
+        return result.isString() ? result.asCString() : NULL;
+    }
+
+    /**
+     * Responses without authentication are written from these fragments, only their ids, results
+     * and custom errors are serialized. The members are listed in name order, like the writer walks them.
+     */
+    static const Json::ObjectTemplate::Member resultMembers[] = {
+        {KEY_REQUEST_ID, "{\"" KEY_REQUEST_ID "\":", NULL, NULL},
+        {KEY_REQUEST_VERSION, ",\"" KEY_REQUEST_VERSION "\":\"" JSON_RPC_VERSION "\"", JSON_RPC_VERSION, NULL},
+        {KEY_RESPONSE_RESULT, ",\"" KEY_RESPONSE_RESULT "\":", NULL, NULL}
+    };
+    static const Json::ObjectTemplate::Member errorMembers[] = {
+        {KEY_RESPONSE_ERROR, "{\"" KEY_RESPONSE_ERROR "\":", NULL, Errors::GetSerializedError},
+        {KEY_REQUEST_ID, ",\"" KEY_REQUEST_ID "\":", NULL, NULL},
+        {KEY_REQUEST_VERSION, ",\"" KEY_REQUEST_VERSION "\":\"" JSON_RPC_VERSION "\"", JSON_RPC_VERSION, NULL}
+    };
+    static const Json::ObjectTemplate::Member splicedResultMembers[] = {
+        {KEY_REQUEST_ID, "{\"" KEY_REQUEST_ID "\":", NULL, NULL},
+        {KEY_REQUEST_VERSION, ",\"" KEY_REQUEST_VERSION "\":\"" JSON_RPC_VERSION "\"", JSON_RPC_VERSION, NULL},
+        {KEY_RESPONSE_RAW_RESULT, ",\"" KEY_RESPONSE_RESULT "\":", NULL, RenderRawResult}
+    };
+    static const Json::ObjectTemplate responseTemplates[] = {
+        {resultMembers, 3, "}"},
+        {errorMembers, 3, "}"},
+        {splicedResultMembers, 3, "}"}
+    };
+
+    /**
+     * @brief A request with its response while it is being answered. It is referenced by the
+     * dispatching thread and by every MethodCompletion of its asynchronous methods, whoever
+     * releases the last reference hands the response on.
+     */
+    class RpcProtocolServer::PendingRequest
+    {
+        public:
+            PendingRequest(AbstractResponseHandler* responseHandler) :
+                responseHandler(responseHandler),
+                procedure(NULL),
+                parseTicks(0),
+                requestBytes(0),
+                references(1),
+                spliced(0),
+                answered(false)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+                pthread_cond_init(&this->done, NULL);
+            }
+
+            ~PendingRequest()
+            {
+                pthread_cond_destroy(&this->done);
+                pthread_mutex_destroy(&this->mutex);
+                delete this->responseHandler;
+            }
+
+            void Reference()
+            {
+                __sync_add_and_fetch(&this->references, 1);
+            }
+
+            /**
+             * @return true if this was the last reference.
+             */
+            bool Unreference()
+            {
+                return __sync_sub_and_fetch(&this->references, 1) == 0;
+            }
+
+            /**
+             * @brief Wakes up the thread waiting in Wait, used if there is no response handler.
+             */
+            void Answer()
+            {
+                pthread_mutex_lock(&this->mutex);
+                this->answered = true;
+                pthread_cond_broadcast(&this->done);
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            /**
+             * @brief Records that the response holds cached results, which have to be spliced in when it is written.
+             */
+            void SpliceResults()
+            {
+                __sync_lock_test_and_set(&this->spliced, 1);
+            }
+
+            bool HasSplicedResults()
+            {
+                return __sync_add_and_fetch(&this->spliced, 0) != 0;
+            }
+
+            void Wait()
+            {
+                pthread_mutex_lock(&this->mutex);
+                while (!this->answered)
+                {
+                    pthread_cond_wait(&this->done, &this->mutex);
+                }
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            Json::Value request;
+            Json::Value response;
+            AbstractResponseHandler* responseHandler;
+            /**
+             * Procedure called by a single request, kept for the stats.
+             */
+            Procedure* procedure;
+            unsigned long long parseTicks;
+            size_t requestBytes;
+
+        private:
+            volatile int references;
+            volatile int spliced;
+            bool answered;
+            pthread_mutex_t mutex;
+            pthread_cond_t done;
+    };
+
+    /**
+     * @brief The elements of one batch shared by the connector thread and the pool threads helping it.
+     * Every thread claims the next unprocessed element until none is left. The job is reference
+     * counted, because helpers may only start after the batch was finished by the others.
+     */
+    class RpcProtocolServer::BatchJob
+    {
+        public:
+            BatchJob(RpcProtocolServer* server, Json::Value& requests, Json::Value& responses, PendingRequest* pending) :
+                server(server),
+                requests(requests),
+                responses(responses),
+                pending(pending),
+                next(0),
+                finished(0),
+                references(1)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+                pthread_cond_init(&this->done, NULL);
+            }
+
+            ~BatchJob()
+            {
+                pthread_cond_destroy(&this->done);
+                pthread_mutex_destroy(&this->mutex);
+            }
+
+            void Run()
+            {
+                unsigned int position;
+                while ((position = __sync_fetch_and_add(&this->next, 1)) < this->elements.size())
+                {
+                    unsigned int i = this->elements[position];
+                    try
+                    {
+                        this->server->HandleSingleRequest(this->requests[i], this->responses[i], this->pending);
+                    }
+                    catch (...)
+                    {
+                        Errors::GetErrorBlock(this->requests[i], Errors::ERROR_RPC_INTERNAL_ERROR).swap(this->responses[i]);
+                    }
+                    if (__sync_add_and_fetch(&this->finished, 1) == this->elements.size())
+                    {
+                        pthread_mutex_lock(&this->mutex);
+                        pthread_cond_broadcast(&this->done);
+                        pthread_mutex_unlock(&this->mutex);
+                    }
+                }
+            }
+
+            void Wait()
+            {
+                pthread_mutex_lock(&this->mutex);
+                while (__sync_add_and_fetch(&this->finished, 0) < this->elements.size())
+                {
+                    pthread_cond_wait(&this->done, &this->mutex);
+                }
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            void Reference()
+            {
+                __sync_add_and_fetch(&this->references, 1);
+            }
+
+            void Unreference()
+            {
+                if (__sync_sub_and_fetch(&this->references, 1) == 0)
+                {
+                    delete this;
+                }
+            }
+
+            RpcProtocolServer* server;
+            Json::Value& requests;
+            Json::Value& responses;
+            PendingRequest* pending;
+            /**
+             * Positions of the batch elements that may run in parallel.
+             */
+            std::vector<unsigned int> elements;
+
+        private:
+            volatile unsigned int next;
+            volatile unsigned int finished;
+            volatile int references;
+            pthread_mutex_t mutex;
+            pthread_cond_t done;
+    };
+
+    /**
+     * @brief Lets a pool thread help with a batch.
+     */
+    class RpcProtocolServer::BatchTask : public ThreadPoolTask
+    {
+        public:
+            BatchTask(BatchJob* job) :
+                job(job)
+            {
+            }
+
+            virtual void Run()
+            {
+                this->job->Run();
+                this->job->server->ReleaseBatchHelper();
+                this->job->Unreference();
+            }
+
+        private:
+            BatchJob* job;
+    };
+
+    /**
+     * @brief Builds the response of a request on a thread of the request executor.
+     * The request is only copied if nobody waits for the response, otherwise the caller's buffer outlives the task.
+     */
+    class RpcProtocolServer::RequestTask : public ThreadPoolTask
+    {
+        public:
+            RequestTask(RpcProtocolServer* server, const char* request, size_t length, PendingRequest* pending) :
+                server(server),
+                request(request),
+                length(length),
+                pending(pending)
+            {
+                if (pending->responseHandler != NULL)
+                {
+                    this->copy.assign(request, length);
+                    this->request = this->copy.data();
+                }
+            }
+
+            virtual void Run()
+            {
+                ProtocolContextScope context;
+                Json::ValueArenaScope arenaScope(context->GetArena());
+                this->server->BuildResponse(*context, this->request, this->length, *this->pending);
+                if (this->pending->Unreference())
+                {
+                    this->server->FinishRequest(*context, this->pending);
+                }
+            }
+
+        private:
+            RpcProtocolServer* server;
+            const char* request;
+            size_t length;
+            std::string copy;
+            PendingRequest* pending;
+    };
+
+    /**
+     * @brief Runs the notifications of a request that was already acknowledged, on a copy of the request.
+     */
+    class RpcProtocolServer::NotificationTask : public ThreadPoolTask
+    {
+        public:
+            NotificationTask(RpcProtocolServer* server, const char* request, size_t length) :
+                server(server),
+                request(request, length)
+            {
+            }
+
+            virtual void Run()
+            {
+                ProtocolContextScope context;
+                Json::ValueArenaScope arenaScope(context->GetArena());
+                PendingRequest pending(NULL);
+                this->server->BuildResponse(*context, this->request.data(), this->request.size(), pending);
+                if (!pending.Unreference())
+                {
+                    pending.Wait();
+                }
+                if (this->server->statsEnabled)
+                {
+                    this->server->RecordRequest(pending, 0, 0);
+                }
+            }
+
+        private:
+            RpcProtocolServer* server;
+            std::string request;
+    };
+
+    /**
+     * @brief One execution of a single flight procedure and the calls waiting for its outcome.
+     */
+    class RpcProtocolServer::Flight
+    {
+        public:
+            Flight() :
+                error(NULL),
+                references(1),
+                landed(false)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+                pthread_cond_init(&this->done, NULL);
+            }
+
+            ~Flight()
+            {
+                delete this->error;
+                pthread_cond_destroy(&this->done);
+                pthread_mutex_destroy(&this->mutex);
+            }
+
+            /**
+             * @brief Publishes the serialized result, or the error if error is not NULL.
+             */
+            void Land(const std::string& result, const JsonRpcException* error)
+            {
+                pthread_mutex_lock(&this->mutex);
+                this->result = result;
+                this->error = error != NULL ? new JsonRpcException(*error) : NULL;
+                this->landed = true;
+                pthread_cond_broadcast(&this->done);
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            void Wait()
+            {
+                pthread_mutex_lock(&this->mutex);
+                while (!this->landed)
+                {
+                    pthread_cond_wait(&this->done, &this->mutex);
+                }
+                pthread_mutex_unlock(&this->mutex);
+            }
+
+            /**
+             * @brief Only called with the flights mutex of the server held.
+             */
+            void Reference()
+            {
+                __sync_add_and_fetch(&this->references, 1);
+            }
+
+            void Unreference()
+            {
+                if (__sync_sub_and_fetch(&this->references, 1) == 0)
+                {
+                    delete this;
+                }
+            }
+
+            std::string result;
+            JsonRpcException* error;
+
+        private:
+            volatile int references;
+            bool landed;
+            pthread_mutex_t mutex;
+            pthread_cond_t done;
+    };
+
     RpcProtocolServer::RpcProtocolServer(AbstractRequestHandler* server, procedurelist_t *procedures, AbstractAuthenticator* auth) :
         procedures(procedures),
         authManager(auth),
-        server(server)
+        server(server),
+        resultCache(NULL),
+        statsEnabled(false),
+        statsProcedure(NULL),
+        requestPool(NULL),
+        batchPool(NULL),
+        batchMaxParallel(1),
+        batchHelpers(0),
+        droppedNotifications(0)
     {
+        pthread_mutex_init(&this->flightsMutex, NULL);
+        this->index.Build(*this->procedures);
     }
 
     RpcProtocolServer::RpcProtocolServer(AbstractRequestHandler* server, AbstractAuthenticator* auth) :
         procedures(new procedurelist_t()),
         authManager(auth),
-        server(server)
+        server(server),
+        resultCache(NULL),
+        statsEnabled(false),
+        statsProcedure(NULL),
+        requestPool(NULL),
+        batchPool(NULL),
+        batchMaxParallel(1),
+        batchHelpers(0),
+        droppedNotifications(0)
     {
+        pthread_mutex_init(&this->flightsMutex, NULL);
     }
 
     RpcProtocolServer::~RpcProtocolServer()
@@ -41,33 +447,248 @@ namespace jsonrpc
         this->SetAuthenticator(NULL);
         this->procedures->clear();
         delete this->procedures;
+        delete this->statsProcedure;
+        pthread_mutex_destroy(&this->flightsMutex);
     }
 
     void RpcProtocolServer::HandleRequest(const std::string& request,
                                           std::string& retValue)
     {
-        Json::Reader reader;
-        Json::Value req;
-        Json::Value response, resp;
-        Json::FastWriter w;
+        this->HandleRequest(request.data(), request.size(), retValue);
+    }
+
+    void RpcProtocolServer::HandleRequest(const std::string& request,
+                                          Json::OutputSink& sink, size_t chunkSize)
+    {
+        this->HandleRequest(request.data(), request.size(), sink, chunkSize);
+    }
+
+    void RpcProtocolServer::HandleRequest(const std::string& request, AbstractResponseHandler* responseHandler)
+    {
+        this->HandleRequest(request.data(), request.size(), responseHandler);
+    }
+
+    void RpcProtocolServer::HandleRequest(const char* request, size_t length, std::string& retValue)
+    {
+        //The reader, writer and arena of this thread are reused, all Json::Values
+        //of this request are released in one shot with the arena.
+        ProtocolContextScope context;
+        Json::ValueArenaScope arenaScope(context->GetArena());
+        PendingRequest pending(NULL);
+
+        this->DispatchRequest(*context, request, length, pending);
+        if (!pending.Unreference())
+        {
+            pending.Wait();
+        }
+        unsigned long long started = this->statsEnabled ? ProcedureStats::Now() : 0;
+        this->PrepareWrite(*context, pending);
+        context->Write(pending.response, retValue);
+        if (this->statsEnabled)
+        {
+            this->RecordRequest(pending, ProcedureStats::Now() - started, context->GetWrittenBytes());
+        }
+    }
+
+    void RpcProtocolServer::HandleRequest(const char* request, size_t length, Json::OutputSink& sink, size_t chunkSize)
+    {
+        ProtocolContextScope context;
+        Json::ValueArenaScope arenaScope(context->GetArena());
+        PendingRequest pending(NULL);
+
+        this->DispatchRequest(*context, request, length, pending);
+        if (!pending.Unreference())
+        {
+            pending.Wait();
+        }
+        unsigned long long started = this->statsEnabled ? ProcedureStats::Now() : 0;
+        this->PrepareWrite(*context, pending);
+        context->Write(pending.response, sink, chunkSize);
+        if (this->statsEnabled)
+        {
+            this->RecordRequest(pending, ProcedureStats::Now() - started, context->GetWrittenBytes());
+        }
+    }
+
+    void RpcProtocolServer::HandleRequest(const char* request, size_t length, AbstractResponseHandler* responseHandler)
+    {
+        //The request outlives this call if one of its methods is still running, the Values
+        //keep their arena pages alive until then.
+        ProtocolContextScope context;
+        Json::ValueArenaScope arenaScope(context->GetArena());
+        PendingRequest* pending = new PendingRequest(responseHandler);
+
+        this->DispatchRequest(*context, request, length, *pending);
+        if (pending->Unreference())
+        {
+            this->FinishRequest(*context, pending);
+        }
+    }
+
+    /**
+     * @return true if request is an Object with a method but without an id.
+     */
+    static bool IsNotification(const Json::Value& request)
+    {
+        return request.isObject() && !request.isMember(KEY_REQUEST_ID) && request[KEY_REQUEST_METHODNAME].isString();
+    }
+
+    bool RpcProtocolServer::HandleNotifications(const char* request, size_t length, ThreadPool& pool, overflowpolicy_t policy)
+    {
+        //A method call names its id, so most requests are turned away without being parsed twice.
+        static const char idKey[] = "\"" KEY_REQUEST_ID "\"";
+        if (std::search(request, request + length, idKey, idKey + sizeof(idKey) - 1) != request + length)
+        {
+            return false;
+        }
+        {
+            ProtocolContextScope context;
+            Json::ValueArenaScope arenaScope(context->GetArena());
+            Json::Value req;
+            if (!context->Parse(request, request + length, req))
+            {
+                return false;
+            }
+            bool notifications = req.isArray() ? req.size() > 0 : IsNotification(req);
+            for (unsigned int i = 0; req.isArray() && notifications && i < req.size(); i++)
+            {
+                notifications = IsNotification(req[i]);
+            }
+            if (!notifications)
+            {
+                return false;
+            }
+        }
+        NotificationTask* task = new NotificationTask(this, request, length);
+        if (!pool.SubmitBounded(task, policy))
+        {
+            delete task;
+            __sync_add_and_fetch(&this->droppedNotifications, 1);
+        }
+        return true;
+    }
+
+    unsigned long RpcProtocolServer::GetDroppedNotifications() const
+    {
+        return __sync_add_and_fetch(const_cast<volatile unsigned long*>(&this->droppedNotifications), 0);
+    }
 
-        if (reader.parse(request, req, false))
+    void RpcProtocolServer::DispatchRequest(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending)
+    {
+        if (this->requestPool == NULL || this->requestPool->IsWorkerThread())
+        {
+            this->BuildResponse(context, request, length, pending);
+            return;
+        }
+        pending.Reference();
+        RequestTask* task = new RequestTask(this, request, length, &pending);
+        if (!this->requestPool->TrySubmit(task))
+        {
+            //The caller still holds its reference, so this is not the last one.
+            delete task;
+            pending.Unreference();
+            this->RejectRequest(context, request, length, pending);
+        }
+    }
+
+    void RpcProtocolServer::RejectRequest(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending)
+    {
+        Json::Value& req = pending.request;
+        if (!context.Parse(request, request + length, req))
+        {
+            Errors::GetErrorBlock(Json::nullValue, Errors::ERROR_RPC_JSON_PARSE_ERROR).swap(pending.response);
+        }
+        else if (req.isArray())
+        {
+            //Notifications are left null as in any batch, one holding nothing else gets no response at all.
+            for (unsigned int i = 0; i < req.size(); i++)
+            {
+                if (IsNotification(req[i]))
+                {
+                    continue;
+                }
+                if (pending.response.isNull())
+                {
+                    pending.response.resize(req.size());
+                }
+                const Json::Value& element = req[i].isObject() ? req[i] : Json::Value::null;
+                Errors::GetErrorBlock(element, Errors::ERROR_SERVER_BUSY).swap(pending.response[i]);
+            }
+        }
+        else if (req.isObject() && !IsNotification(req))
+        {
+            Errors::GetErrorBlock(req, Errors::ERROR_SERVER_BUSY).swap(pending.response);
+        }
+    }
+
+    void RpcProtocolServer::BuildResponse(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending)
+    {
+        Json::Value& req = pending.request;
+
+        unsigned long long started = this->statsEnabled ? ProcedureStats::Now() : 0;
+        bool parsed = context.Parse(request, request + length, req);
+        unsigned long long validating = 0;
+        if (this->statsEnabled)
+        {
+            validating = ProcedureStats::Now();
+            pending.parseTicks = validating - started;
+            pending.requestBytes = length;
+        }
+        if (parsed)
         {
             //It could be a Batch Request
             if (req.isArray())
             {
-                this->HandleBatchRequest(req, response);
+                this->HandleBatchRequest(req, pending.response, &pending);
             } //It could be a simple Request
             else if (req.isObject())
             {
-                this->HandleSingleRequest(req, response);
+                pending.procedure = this->HandleSingleRequest(req, pending.response, &pending, validating);
             }
         }
         else
         {
-            response = Errors::GetErrorBlock(Json::nullValue, Errors::ERROR_RPC_JSON_PARSE_ERROR);
+            Errors::GetErrorBlock(Json::nullValue, Errors::ERROR_RPC_JSON_PARSE_ERROR).swap(pending.response);
+        }
+    }
+
+    void RpcProtocolServer::FinishRequest(ProtocolContext& context, PendingRequest* pending)
+    {
+        if (pending->responseHandler == NULL)
+        {
+            //The dispatching thread is waiting for the response and serializes it itself.
+            pending->Answer();
+            return;
+        }
+        unsigned long long started = this->statsEnabled ? ProcedureStats::Now() : 0;
+        this->PrepareWrite(context, *pending);
+        {
+            Json::ValueArenaScope heapScope;
+            pending->responseHandler->OnResponse(context, pending->response);
+        }
+        if (this->statsEnabled)
+        {
+            this->RecordRequest(*pending, ProcedureStats::Now() - started, context.GetWrittenBytes());
+        }
+        delete pending;
+    }
+
+    void RpcProtocolServer::PrepareWrite(ProtocolContext& context, PendingRequest& pending)
+    {
+        context.SetTemplates(responseTemplates, sizeof(responseTemplates) / sizeof(responseTemplates[0]));
+        if (pending.HasSplicedResults())
+        {
+            context.SetRawMember(KEY_RESPONSE_RAW_RESULT, KEY_RESPONSE_RESULT);
+        }
+    }
+
+    void RpcProtocolServer::ReleaseRequest(PendingRequest* pending)
+    {
+        if (pending->Unreference())
+        {
+            ProtocolContextScope context;
+            this->FinishRequest(*context, pending);
         }
-        retValue = w.write(response);
     }
 
     void RpcProtocolServer::SetAuthenticator(AbstractAuthenticator *auth)
@@ -79,50 +700,407 @@ namespace jsonrpc
         this->authManager = auth;
     }
 
-    void RpcProtocolServer::HandleSingleRequest(Json::Value &req, Json::Value& response)
+    Procedure* RpcProtocolServer::HandleSingleRequest(Json::Value &req, Json::Value& response, PendingRequest* pending,
+                                                      unsigned long long started)
     {
-        int error = this->ValidateRequest(req);
-        if (error == 0)
+        if (this->statsEnabled && started == 0)
         {
-            try
+            started = ProcedureStats::Now();
+        }
+        unsigned long long validated = 0;
+        Procedure* proc = this->FindShareable(req);
+        std::string key;
+        bool cached = false;
+        if (proc != NULL)
+        {
+            const Json::Value& request = req;
+            ResultCache::BuildKey(proc->GetProcedureName(), request[KEY_REQUEST_PARAMETERS], key);
+            cached = this->AnswerFromCache(proc, key, request, response, pending);
+        }
+
+        int error = 0;
+        if (!cached)
+        {
+            error = this->ValidateRequest(req, proc);
+            validated = this->statsEnabled ? ProcedureStats::Now() : 0;
+            if (error == 0)
             {
-                this->ProcessRequest(req, response);
+                try
+                {
+                    if (key.empty())
+                    {
+                        this->ProcessRequest(proc, req, response, pending);
+                    }
+                    else
+                    {
+                        this->ProcessShared(proc, key, req, response, pending);
+                    }
+                }
+                catch (const JsonRpcException & exc)
+                {
+                    error = exc.GetCode();
+                    Errors::GetErrorBlock(req, exc).swap(response);
+                }
             }
-            catch (const JsonRpcException & exc)
+            else
             {
-                response = Errors::GetErrorBlock(req, exc);
+                Errors::GetErrorBlock(req, error).swap(response);
             }
         }
-        else
+
+        if (this->statsEnabled && proc != NULL)
+        {
+            //A call answered from the cache never reaches the dispatch phase, an asynchronous one is recorded by its completion.
+            ProcedureStats& stats = proc->GetStats();
+            unsigned long long finished = ProcedureStats::Now();
+            stats.RecordPhase(STATS_VALIDATE, (cached ? finished : validated) - started);
+            if (cached || error != 0 || proc->GetProcedureType() != RPC_METHOD || !proc->GetAsynchronous())
+            {
+                if (!cached)
+                {
+                    stats.RecordPhase(STATS_DISPATCH, finished - validated);
+                }
+                stats.RecordCall(error);
+            }
+        }
+        return proc;
+    }
+
+    Procedure* RpcProtocolServer::FindProcedure(const char* name)
+    {
+        Procedure* proc = this->index.Find(name, strlen(name));
+        if (proc == NULL && this->statsProcedure != NULL && strcmp(name, RPC_STATS_METHOD) == 0)
+        {
+            return this->statsProcedure;
+        }
+        return proc;
+    }
+
+    void RpcProtocolServer::RecordRequest(PendingRequest& pending, unsigned long long serializeTicks, size_t bytesOut)
+    {
+        const Json::Value& request = pending.request;
+        if (request.isObject())
+        {
+            if (pending.procedure != NULL)
+            {
+                ProcedureStats& stats = pending.procedure->GetStats();
+                stats.RecordPhase(STATS_PARSE, pending.parseTicks);
+                stats.RecordPhase(STATS_SERIALIZE, serializeTicks);
+                stats.RecordBytes(pending.requestBytes, bytesOut);
+            }
+            return;
+        }
+        if (!request.isArray() || request.size() == 0)
+        {
+            return;
+        }
+        unsigned int calls = request.size();
+        for (unsigned int i = 0; i < calls; i++)
+        {
+            const Json::Value& element = request[i];
+            if (!element.isObject() || !element[KEY_REQUEST_METHODNAME].isString())
+            {
+                continue;
+            }
+            Procedure* proc = this->FindProcedure(element[KEY_REQUEST_METHODNAME].asCString());
+            if (proc != NULL)
+            {
+                ProcedureStats& stats = proc->GetStats();
+                stats.RecordPhase(STATS_PARSE, pending.parseTicks / calls);
+                stats.RecordPhase(STATS_SERIALIZE, serializeTicks / calls);
+                stats.RecordBytes(pending.requestBytes / calls, bytesOut / calls);
+            }
+        }
+    }
+
+    Procedure* RpcProtocolServer::FindShareable(const Json::Value& request)
+    {
+        //Only requests that could pass ValidateRequest are looked up, anything else gets its error as usual.
+        if (!request.isObject() || !request.isMember(KEY_REQUEST_VERSION) || !request.isMember(KEY_REQUEST_ID)
+                || !request.isMember(KEY_REQUEST_PARAMETERS) || !request[KEY_REQUEST_METHODNAME].isString())
+        {
+            return NULL;
+        }
+        const char* name = request[KEY_REQUEST_METHODNAME].asCString();
+        Procedure* proc = this->index.Find(name, strlen(name));
+        if (proc == NULL || proc->GetProcedureType() != RPC_METHOD || proc->GetAsynchronous()
+                || !((proc->GetCacheable() && this->resultCache != NULL) || proc->GetSingleFlight()))
         {
-            response = Errors::GetErrorBlock(req, error);
+            return NULL;
         }
+        return proc;
     }
 
-    void RpcProtocolServer::HandleBatchRequest(Json::Value &req, Json::Value& response)
+    bool RpcProtocolServer::AnswerFromCache(Procedure* proc, const std::string& key, const Json::Value& request,
+                                            Json::Value& response, PendingRequest* pending)
     {
+        if (this->resultCache == NULL || !proc->GetCacheable())
+        {
+            return false;
+        }
+        if (this->authManager != NULL && this->authManager->CheckPermission(request[KEY_AUTHENTICATION], proc->GetProcedureName()) != 0)
+        {
+            return false;
+        }
+        std::string result;
+        if (!this->resultCache->Lookup(key, result))
+        {
+            return false;
+        }
+        this->AnswerWithResult(result, request, response, pending);
+        return true;
+    }
+
+    void RpcProtocolServer::AddEnvelope(const Json::Value& request, Json::Value& response)
+    {
+        //The member names and the version are not copied into every response.
+        response[Json::StaticString(KEY_REQUEST_VERSION)] = Json::StaticString(JSON_RPC_VERSION);
+        response[Json::StaticString(KEY_REQUEST_ID)] = request[KEY_REQUEST_ID];
+        if (this->authManager != NULL)
+        {
+            this->authManager->ProcessAuthentication(
+                        request[KEY_AUTHENTICATION],
+                        response[KEY_AUTHENTICATION]);
+        }
+    }
+
+    void RpcProtocolServer::AnswerWithResult(const std::string& result, const Json::Value& request,
+                                             Json::Value& response, PendingRequest* pending)
+    {
+        this->AddEnvelope(request, response);
+        //The result bytes are written as they are, see PrepareWrite.
+        response[Json::StaticString(KEY_RESPONSE_RAW_RESULT)] = result;
+        pending->SpliceResults();
+    }
+
+    void RpcProtocolServer::StoreResult(Procedure* proc, const std::string& key, const std::string& result)
+    {
+        if (this->resultCache != NULL && proc->GetCacheable())
+        {
+            this->resultCache->Store(key, result, proc->GetCacheTtl());
+        }
+    }
+
+    void RpcProtocolServer::ProcessShared(Procedure* proc, const std::string& key, const Json::Value& request,
+                                          Json::Value& response, PendingRequest* pending)
+    {
+        Flight* flight = NULL;
+        if (proc->GetSingleFlight())
+        {
+            pthread_mutex_lock(&this->flightsMutex);
+            std::map<std::string, Flight*>::iterator it = this->flights.find(key);
+            if (it != this->flights.end())
+            {
+                //Another call with the same key is running, its outcome is taken over.
+                flight = it->second;
+                flight->Reference();
+                pthread_mutex_unlock(&this->flightsMutex);
+                flight->Wait();
+                if (flight->error != NULL)
+                {
+                    JsonRpcException error(*flight->error);
+                    flight->Unreference();
+                    throw error;
+                }
+                this->AnswerWithResult(flight->result, request, response, pending);
+                flight->Unreference();
+                return;
+            }
+            flight = new Flight();
+            this->flights[key] = flight;
+            pthread_mutex_unlock(&this->flightsMutex);
+        }
+
+        std::string result;
+        try
+        {
+            this->ProcessRequest(proc, request, response, pending);
+            if (response.isMember(KEY_RESPONSE_RESULT))
+            {
+                Json::FastWriter writer;
+                result = writer.write(response[KEY_RESPONSE_RESULT]);
+                //Drops the newline that ends every document.
+                result.erase(result.size() - 1);
+                this->StoreResult(proc, key, result);
+            }
+        }
+        catch (const JsonRpcException& exc)
+        {
+            if (flight != NULL)
+            {
+                this->LandFlight(key, flight, result, &exc);
+            }
+            throw;
+        }
+        catch (...)
+        {
+            if (flight != NULL)
+            {
+                JsonRpcException exc(Errors::ERROR_RPC_INTERNAL_ERROR);
+                this->LandFlight(key, flight, result, &exc);
+            }
+            throw;
+        }
+        if (flight != NULL)
+        {
+            //The result is cached before the flight is removed, so later calls find one or the other.
+            this->LandFlight(key, flight, result, NULL);
+        }
+    }
+
+    void RpcProtocolServer::LandFlight(const std::string& key, Flight* flight, const std::string& result, const JsonRpcException* error)
+    {
+        pthread_mutex_lock(&this->flightsMutex);
+        this->flights.erase(key);
+        pthread_mutex_unlock(&this->flightsMutex);
+        flight->Land(result, error);
+        flight->Unreference();
+    }
+
+    void RpcProtocolServer::HandleBatchRequest(Json::Value &req, Json::Value& response, PendingRequest* pending)
+    {
+        if (req.size() > 0)
+        {
+            response.resize(req.size());
+        }
+        if (this->batchPool != NULL && this->batchMaxParallel > 1 && req.size() > 1)
+        {
+            this->HandleBatchRequestParallel(req, response, pending);
+            return;
+        }
         for (unsigned int i = 0; i < req.size(); i++)
         {
-            this->HandleSingleRequest(req[i], response[i]);
+            this->HandleSingleRequest(req[i], response[i], pending);
         }
     }
 
-    int RpcProtocolServer::ValidateRequest(const Json::Value& request)
+    void RpcProtocolServer::HandleBatchRequestParallel(Json::Value &req, Json::Value& response, PendingRequest* pending)
+    {
+        BatchJob* job = new BatchJob(this, req, response, pending);
+        std::vector<unsigned int> serial;
+        for (unsigned int i = 0; i < req.size(); i++)
+        {
+            if (this->RunsSerially(req[i]))
+            {
+                serial.push_back(i);
+            }
+            else
+            {
+                job->elements.push_back(i);
+            }
+        }
+
+        if (!job->elements.empty())
+        {
+            unsigned int helpers = this->AcquireBatchHelpers((unsigned int)job->elements.size() - 1);
+            for (unsigned int i = 0; i < helpers; i++)
+            {
+                job->Reference();
+                this->batchPool->Submit(new BatchTask(job));
+            }
+            job->Run();
+            job->Wait();
+        }
+        job->Unreference();
+
+        for (unsigned int i = 0; i < serial.size(); i++)
+        {
+            this->HandleSingleRequest(req[serial[i]], response[serial[i]], pending);
+        }
+    }
+
+    bool RpcProtocolServer::RunsSerially(const Json::Value& request)
+    {
+        if (!request.isObject() || !request[KEY_REQUEST_METHODNAME].isString())
+        {
+            return false;
+        }
+        const char* name = request[KEY_REQUEST_METHODNAME].asCString();
+        Procedure* proc = this->index.Find(name, strlen(name));
+        return proc != NULL && proc->GetRunSerially();
+    }
+
+    unsigned int RpcProtocolServer::AcquireBatchHelpers(unsigned int wanted)
+    {
+        //The connector thread itself is one of the batchMaxParallel elements in flight.
+        while (true)
+        {
+            unsigned int running = this->batchHelpers;
+            unsigned int available = this->batchMaxParallel - 1 > running ? this->batchMaxParallel - 1 - running : 0;
+            unsigned int granted = wanted < available ? wanted : available;
+            if (granted == 0 || __sync_bool_compare_and_swap(&this->batchHelpers, running, running + granted))
+            {
+                return granted;
+            }
+        }
+    }
+
+    void RpcProtocolServer::ReleaseBatchHelper()
+    {
+        __sync_sub_and_fetch(&this->batchHelpers, 1);
+    }
+
+    void RpcProtocolServer::SetRequestExecutor(ThreadPool* pool)
+    {
+        this->requestPool = pool;
+    }
+
+    void RpcProtocolServer::SetResultCache(ResultCache* cache)
+    {
+        this->resultCache = cache;
+    }
+
+    void RpcProtocolServer::SetStatsEnabled(bool enabled, bool statsMethod)
+    {
+        this->statsEnabled = enabled;
+        if (statsMethod && this->statsProcedure == NULL)
+        {
+            this->statsProcedure = new Procedure(RPC_STATS_METHOD, PARAMS_BY_NAME, JSON_OBJECT, NULL);
+        }
+        else if (!statsMethod)
+        {
+            delete this->statsProcedure;
+            this->statsProcedure = NULL;
+        }
+    }
+
+    Json::Value RpcProtocolServer::GetStats()
+    {
+        Json::Value result(Json::objectValue);
+        StatsSnapshot snapshot;
+        for (procedurelist_t::iterator it = this->procedures->begin(); it != this->procedures->end(); it++)
+        {
+            it->second->GetStats().GetSnapshot(snapshot);
+            result[it->first] = snapshot.ToJson();
+        }
+        return result;
+    }
+
+    void RpcProtocolServer::SetBatchExecutor(ThreadPool* pool, unsigned int maxParallel)
+    {
+        this->batchPool = pool;
+        this->batchMaxParallel = maxParallel;
+    }
+
+    int RpcProtocolServer::ValidateRequest(const Json::Value& request, Procedure*& proc)
     {
         int error = 0;
-        Procedure* proc;
         if (!(request.isMember(KEY_REQUEST_METHODNAME)
               && request.isMember(KEY_REQUEST_VERSION)
               && request.isMember(KEY_REQUEST_PARAMETERS)))
         {
             error = Errors::ERROR_RPC_INVALID_REQUEST;
         }
+        else if (!request[KEY_REQUEST_METHODNAME].isString())
+        {
+            error = Errors::ERROR_RPC_INVALID_REQUEST;
+        }
         else
         {
-            map<string, Procedure*>::iterator it = procedures->find(request[KEY_REQUEST_METHODNAME].asString());
-            if (it != this->procedures->end())
+            //The method is resolved once here, the Procedure is handed on to ProcessRequest.
+            proc = this->FindProcedure(request[KEY_REQUEST_METHODNAME].asCString());
+            if (proc != NULL)
             {
-                proc = (*this->procedures)[request[KEY_REQUEST_METHODNAME].asString()];
                 if(request.isMember(KEY_REQUEST_ID) && proc->GetProcedureType() == RPC_NOTIFICATION)
                 {
                     error = Errors::ERROR_SERVER_PROCEDURE_IS_NOTIFICATION;
@@ -153,36 +1131,86 @@ namespace jsonrpc
         return error;
     }
 
-    void RpcProtocolServer::ProcessRequest(const Json::Value& request,
-                                           Json::Value& response)
+    void RpcProtocolServer::ProcessRequest(Procedure* method, const Json::Value& request,
+                                           Json::Value& response, PendingRequest* pending)
     {
-        Procedure* method = (*this->procedures)[request[KEY_REQUEST_METHODNAME].asString()];
-        Json::Value result;
+        ConcurrencyLimit* limit = method->GetConcurrencyLimit();
+        if (limit != NULL && !limit->Acquire())
+        {
+            throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_BUSY);
+        }
 
-        if (method->GetProcedureType() == RPC_METHOD)
+        if (method->GetProcedureType() == RPC_METHOD && method->GetAsynchronous())
         {
-            server->handleMethodCall(method, request[KEY_REQUEST_PARAMETERS],
-                                     result);
-            response[KEY_REQUEST_VERSION] = JSON_RPC_VERSION;
-            response[KEY_RESPONSE_RESULT] = result;
-            response[KEY_REQUEST_ID] = request[KEY_REQUEST_ID];
-            if (this->authManager != NULL)
+            //The envelope is complete before the handler runs, the completion only adds the result
+            //and nothing but the completion touches the response afterwards.
+            this->AddEnvelope(request, response);
+            //The completion releases the slot of the call.
+            pending->Reference();
+            MethodCompletion* completion = new MethodCompletion(this, pending, request, response, limit,
+                                                                this->statsEnabled ? &method->GetStats() : NULL);
+            try
+            {
+                Json::ValueArenaScope heapScope;
+                server->handleAsyncMethodCall(method, request[KEY_REQUEST_PARAMETERS], completion);
+            }
+            catch (const JsonRpcException& exc)
             {
-                this->authManager->ProcessAuthentication(
-                            request[KEY_AUTHENTICATION],
-                            response[KEY_AUTHENTICATION]);
+                completion->Fail(exc);
             }
+            catch (...)
+            {
+                completion->Fail(JsonRpcException(Errors::ERROR_RPC_INTERNAL_ERROR));
+            }
+            completion->Release();
+            return;
         }
-        else
+
+        try
+        {
+            if (method->GetProcedureType() == RPC_METHOD)
+            {
+                //The handler writes straight into the envelope, so the result is never copied before it is written.
+                if (method == this->statsProcedure)
+                {
+                    response[Json::StaticString(KEY_RESPONSE_RESULT)] = this->GetStats();
+                }
+                else
+                {
+                    Json::Value& result = response[Json::StaticString(KEY_RESPONSE_RESULT)];
+                    //Handlers may keep what they create or copy, so it must not come from the arena of the request.
+                    Json::ValueArenaScope heapScope;
+                    server->handleMethodCall(method, request[KEY_REQUEST_PARAMETERS], result);
+                }
+                this->AddEnvelope(request, response);
+            }
+            else
+            {
+                {
+                    Json::ValueArenaScope heapScope;
+                    server->handleNotificationCall(method, request[KEY_REQUEST_PARAMETERS]);
+                }
+                response = Json::Value::null;
+            }
+        }
+        catch (...)
+        {
+            if (limit != NULL)
+            {
+                limit->Release();
+            }
+            throw;
+        }
+        if (limit != NULL)
         {
-            server->handleNotificationCall(method, request[KEY_REQUEST_PARAMETERS]);
-            response = Json::Value::null;
+            limit->Release();
         }
     }
 
     void RpcProtocolServer::AddProcedure(Procedure *procedure)
     {
         (*this->procedures)[procedure->GetProcedureName()] = procedure;
+        this->index.Build(*this->procedures);
     }
 
     procedurelist_t& RpcProtocolServer::GetProcedures()
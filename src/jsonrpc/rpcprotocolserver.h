@@ -17,6 +17,11 @@
 #include "specificationparser.h"
 #include "abstractauthenticator.h"
 #include "abstractrequesthandler.h"
+#include "abstractresponsehandler.h"
+#include "protocolcontext.h"
+#include "procedureindex.h"
+#include "threadpool.h"
+#include "resultcache.h"
 
 #define KEY_REQUEST_METHODNAME "method"
 #define KEY_REQUEST_VERSION "jsonrpc"
@@ -26,6 +31,11 @@
 #define KEY_RESPONSE_RESULT "result"
 #define KEY_AUTHENTICATION "auth"
 
+/**
+ * Reserved method answered with RpcProtocolServer::GetStats, see RpcProtocolServer::SetStatsEnabled.
+ */
+#define RPC_STATS_METHOD "rpc.stats"
+
 #define JSON_RPC_VERSION "2.0"
 
 namespace jsonrpc
@@ -45,6 +55,54 @@ namespace jsonrpc
              */
             void HandleRequest(const std::string& request, std::string& retValue);
 
+            /**
+             * @brief Handles the request like HandleRequest(const std::string&, std::string&), but serializes the
+             * response straight into sink, in chunks of chunkSize bytes.
+             * @param request - holds (hopefully) a valid JSON-Request Object.
+             * @param sink - receives the response piece by piece.
+             * @param chunkSize - number of bytes collected before they are passed to sink.
+             */
+            void HandleRequest(const std::string& request, Json::OutputSink& sink, size_t chunkSize);
+
+            /**
+             * @brief Handles the request and passes the response to responseHandler once all its calls are answered.
+             * The variants above wait for the asynchronous methods of the request on the calling thread, this one
+             * returns as soon as the request is dispatched, so a connector can send the responses later and in any order.
+             * @param request - holds (hopefully) a valid JSON-Request Object.
+             * @param responseHandler - receives the response, it is deleted afterwards.
+             */
+            void HandleRequest(const std::string& request, AbstractResponseHandler* responseHandler);
+
+            /**
+             * @brief The variants above for a request that is not held by a std::string, e.g. the receive buffer of a connector.
+             * The request is parsed straight from the buffer, which does not have to be terminated. It is only read before
+             * these methods return, unless it is handed to the request executor without anyone waiting for its response,
+             * then a copy is made.
+             * @param request - the first byte of the request.
+             * @param length - the number of bytes of the request.
+             */
+            void HandleRequest(const char* request, size_t length, std::string& retValue);
+            void HandleRequest(const char* request, size_t length, Json::OutputSink& sink, size_t chunkSize);
+            void HandleRequest(const char* request, size_t length, AbstractResponseHandler* responseHandler);
+
+            /**
+             * @brief Hands request to pool if it consists of notifications only, so that a connector can acknowledge it before
+             * the handlers ran. Notifications are never answered, not even with an error, so nothing of their execution reaches
+             * the caller. Other requests are left untouched and have to be handled with HandleRequest.
+             * The request is copied, the pool must be drained before the server is destroyed.
+             * @param request - the first byte of the request, it does not have to be terminated.
+             * @param length - the number of bytes of the request.
+             * @param pool - the pool that runs the notifications.
+             * @param policy - whether the notifications are dropped or the caller waits if the queue of pool is full.
+             * @return true if the request holds only notifications and was queued or dropped, false if it needs a response.
+             */
+            bool HandleNotifications(const char* request, size_t length, ThreadPool& pool, overflowpolicy_t policy);
+
+            /**
+             * @return the number of notification requests HandleNotifications dropped because the pool was full.
+             */
+            unsigned long GetDroppedNotifications() const;
+
             /**
              * @brief This method sets an Authenticator mechanism for the server. The object is deleted
              * automatically by the RpcProtocolServer instance.
@@ -59,35 +117,200 @@ namespace jsonrpc
              */
             void AddProcedure(Procedure* procedure);
 
+            /**
+             * @brief Lets the elements of batch requests run concurrently on pool. The connector thread works on
+             * the batch as well, helped by at most maxParallel - 1 pool threads, a limit shared by all batches of
+             * this server. Procedures marked with Procedure::SetRunSerially are kept out of the parallel part. The response
+             * order is not affected. Pass NULL to run batches sequentially again, which is the default.
+             * The pool is not owned by the server and must outlive it, and the handler must be thread safe.
+             * @param pool - the pool that executes batch elements.
+             * @param maxParallel - maximum number of elements of a batch in flight, including the connector thread.
+             */
+            void SetBatchExecutor(ThreadPool* pool, unsigned int maxParallel);
+
+            /**
+             * @brief Lets pool run the requests instead of the connector threads, so that the number of threads
+             * running handlers no longer depends on the number of connector threads. A request finding pool with its
+             * queue limit reached is answered right away with Errors::ERROR_SERVER_BUSY. Requests handled by a thread
+             * of pool itself run on that thread. Pass NULL to run requests on the connector threads again, which is the default.
+             * The pool is not owned by the server and must outlive it, and the handler must be thread safe.
+             * @param pool - the pool that runs the requests, usually with one thread per processor and a queue limit.
+             */
+            void SetRequestExecutor(ThreadPool* pool);
+
+            /**
+             * @brief Keeps the results of the procedures marked with Procedure::SetCacheable in cache. A call found in
+             * the cache is answered with the stored result bytes, neither its parameters are validated nor is the handler
+             * called, only the permission of the authenticator is checked. Pass NULL to stop caching, which is the default.
+             * The cache is not owned by the server and must outlive it, it may be shared by several servers with the same procedures.
+             * @param cache - the cache for the results.
+             */
+            void SetResultCache(ResultCache* cache);
+
+            /**
+             * @brief Records the calls of every procedure into Procedure::GetStats: their number, errors by code, bytes
+             * received and sent and the time spent parsing, validating, dispatching and serializing them. Parsing, serializing
+             * and the bytes are split equally among the calls of a batch. The dispatch time of an asynchronous method lasts until
+             * its completion, for responses passed to an AbstractResponseHandler serializing includes its OnResponse.
+             * Off by default, it should be set before the first request is handled.
+             * @param enabled - whether calls are recorded.
+             * @param statsMethod - answers the reserved method RPC_STATS_METHOD with GetStats, if its caller gets the
+             * permission of the authenticator. The method takes no parameters.
+             */
+            void SetStatsEnabled(bool enabled, bool statsMethod = false);
+
+            /**
+             * @return an Object with the StatsSnapshot::ToJson of every procedure by its name.
+             */
+            Json::Value GetStats();
+
+            /**
+             * @brief Returns all registered procedures. New procedures must be registered with AddProcedure,
+             * otherwise requests will not find them.
+             */
             procedurelist_t& GetProcedures();
 
         private:
+            friend class MethodCompletion;
+            class PendingRequest;
+            class BatchJob;
+            class BatchTask;
+            class RequestTask;
+            class NotificationTask;
+            class Flight;
 
-            void HandleSingleRequest(Json::Value& request, Json::Value& response);
-            void HandleBatchRequest(Json::Value& requests, Json::Value& response);
+            /**
+             * @brief Builds the response on this thread or hands the request to the request executor.
+             */
+            void DispatchRequest(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending);
+            /**
+             * @brief Answers every method call of request with Errors::ERROR_SERVER_BUSY, notifications are not answered.
+             */
+            void RejectRequest(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending);
+            void BuildResponse(ProtocolContext& context, const char* request, size_t length, PendingRequest& pending);
+            /**
+             * @param started - time the call was taken up for the stats, 0 to take it now.
+             * @return the procedure called by request, NULL if there is none.
+             */
+            Procedure* HandleSingleRequest(Json::Value& request, Json::Value& response, PendingRequest* pending,
+                                           unsigned long long started = 0);
+            /**
+             * @return the procedure called name, including the stats method if it is enabled. NULL if there is none.
+             */
+            Procedure* FindProcedure(const char* name);
+            /**
+             * @brief Splits the parse and serialize time and the bytes of pending among the procedures it called.
+             */
+            void RecordRequest(PendingRequest& pending, unsigned long long serializeTicks, size_t bytesOut);
+
+            /**
+             * @return the procedure requested by request if its result may be cached or shared, NULL otherwise.
+             */
+            Procedure* FindShareable(const Json::Value& request);
+            /**
+             * @brief Builds the response from the cached result of key, if there is one.
+             * @return true if the request was answered.
+             */
+            bool AnswerFromCache(Procedure* proc, const std::string& key, const Json::Value& request,
+                                 Json::Value& response, PendingRequest* pending);
+            /**
+             * @brief Adds the version, the id and, with an authentication manager, the authentication to the response of request.
+             */
+            void AddEnvelope(const Json::Value& request, Json::Value& response);
+            /**
+             * @brief Builds the envelope of request around result, which is spliced in as it is.
+             */
+            void AnswerWithResult(const std::string& result, const Json::Value& request,
+                                  Json::Value& response, PendingRequest* pending);
+            void StoreResult(Procedure* proc, const std::string& key, const std::string& result);
+            /**
+             * @brief Runs ProcessRequest unless an identical call of proc is running already, whose result is taken then.
+             */
+            void ProcessShared(Procedure* proc, const std::string& key, const Json::Value& request,
+                               Json::Value& response, PendingRequest* pending);
+            /**
+             * @brief Removes flight from the running calls and hands its outcome to the waiting ones.
+             */
+            void LandFlight(const std::string& key, Flight* flight, const std::string& result, const JsonRpcException* error);
+            /**
+             * @brief Lets context write the envelopes from pre-rendered fragments and splice the cached results of pending into the response.
+             */
+            void PrepareWrite(ProtocolContext& context, PendingRequest& pending);
+            void HandleBatchRequest(Json::Value& requests, Json::Value& response, PendingRequest* pending);
+            void HandleBatchRequestParallel(Json::Value& requests, Json::Value& response, PendingRequest* pending);
+            bool RunsSerially(const Json::Value& request);
 
-            int ValidateRequest(const Json::Value &val);
+            /**
+             * @brief Hands the response of pending on, once its last call was answered.
+             */
+            void FinishRequest(ProtocolContext& context, PendingRequest* pending);
+
+            /**
+             * @brief Drops the reference of a completed asynchronous call on pending.
+             */
+            void ReleaseRequest(PendingRequest* pending);
+
+            /**
+             * @brief Reserves up to wanted helper threads within the batch parallelism limit.
+             * @return the number of helpers that may be started.
+             */
+            unsigned int AcquireBatchHelpers(unsigned int wanted);
+            void ReleaseBatchHelper();
+
+            /**
+             * @param val - the request Object to validate.
+             * @param proc - is set to the requested procedure, if it exists.
+             * @return 0 if the request is valid, the error code otherwise.
+             */
+            int ValidateRequest(const Json::Value &val, Procedure*& proc);
 
             /**
              * @pre the request must be a valid request
+             * @param method - the procedure resolved by ValidateRequest.
              * @param request - the request Object compliant to Json-RPC 2.0
              * @param retValue - a reference to an object which will hold the returnValue afterwards.
+             * @param pending - the request being handled, asynchronous methods keep it open until they are completed.
              *
              * after calling this method, the requested Method will be executed. It is important, that this method only gets called once per request.
              */
-            void ProcessRequest(const Json::Value &request,
-                    Json::Value &retValue);
+            void ProcessRequest(Procedure* method, const Json::Value &request,
+                    Json::Value &retValue, PendingRequest* pending);
 
             /**
              * This map holds all procedures. The string holds the name of each procedure.
              */
             procedurelist_t* procedures;
+            /**
+             * Hash index over procedures, rebuilt whenever a procedure is added.
+             */
+            ProcedureIndex index;
             /**
              * this objects decides whether a request is allowed to be processed or not.
              */
             AbstractAuthenticator* authManager;
             AbstractRequestHandler* server;
 
+            ResultCache* resultCache;
+            bool statsEnabled;
+            /**
+             * Answers RPC_STATS_METHOD, NULL unless it is enabled. It is not part of procedures.
+             */
+            Procedure* statsProcedure;
+            ThreadPool* requestPool;
+            ThreadPool* batchPool;
+            unsigned int batchMaxParallel;
+            /**
+             * Number of pool threads currently working on batches of this server.
+             */
+            volatile unsigned int batchHelpers;
+            volatile unsigned long droppedNotifications;
+
+            /**
+             * Running calls of single flight procedures by their key.
+             */
+            std::map<std::string, Flight*> flights;
+            pthread_mutex_t flightsMutex;
+
     };
 
 } /* namespace jsonrpc */
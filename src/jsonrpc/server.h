@@ -10,12 +10,16 @@
 #ifndef SERVER_H_
 #define SERVER_H_
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
 
 #include "rpcprotocolserver.h"
 #include "serverconnector.h"
+#include "methodcompletion.h"
+#include "errors.h"
+#include "exception.h"
 
 namespace jsonrpc
 {
@@ -25,6 +29,7 @@ namespace jsonrpc
         public:
             typedef void(S::*methodPointer_t)(const Json::Value &parameter, Json::Value &result);
             typedef void(S::*notificationPointer_t)(const Json::Value &parameter);
+            typedef void(S::*asyncMethodPointer_t)(const Json::Value &parameter, MethodCompletion* completion);
 
             AbstractServer(AbstractServerConnector *connector) :
                 connection(connector),
@@ -79,24 +84,65 @@ namespace jsonrpc
                 return &this->handler;
             }
 
+            /**
+             * @brief Calls the member function bound to proc. The function is found by the dispatch index stored
+             * on the procedure, so neither RTTI nor a lookup by name is needed.
+             */
             virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
             {
-                S* instance = dynamic_cast<S*>(this);
-                (instance->*methods[proc->GetProcedureName()])(input, output);
+                int index = proc->GetDispatchIndex();
+                if (index < 0)
+                {
+                    throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_POINTER_IS_NULL, proc->GetProcedureName());
+                }
+                (static_cast<S*>(this)->*this->methods[index])(input, output);
             }
 
             virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
             {
-                S* instance = dynamic_cast<S*>(this);
-                (instance->*notifications[proc->GetProcedureName()])(input);
+                int index = proc->GetDispatchIndex();
+                if (index < 0)
+                {
+                    throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_POINTER_IS_NULL, proc->GetProcedureName());
+                }
+                (static_cast<S*>(this)->*this->notifications[index])(input);
+            }
+
+            virtual void handleAsyncMethodCall(Procedure* proc, const Json::Value& input, MethodCompletion* completion)
+            {
+                int index = proc->GetDispatchIndex();
+                if (index < 0)
+                {
+                    completion->Fail(JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_POINTER_IS_NULL, proc->GetProcedureName()));
+                    return;
+                }
+                (static_cast<S*>(this)->*this->asyncMethods[index])(input, completion);
             }
 
         protected:
             virtual bool bindMethod(std::string& name, methodPointer_t method)
             {
-                if(this->handler.GetProcedures().find(name) != this->handler.GetProcedures().end() && this->handler.GetProcedures()[name]->GetProcedureType() == RPC_METHOD)
+                procedurelist_t::iterator it = this->handler.GetProcedures().find(name);
+                if(it != this->handler.GetProcedures().end() && it->second->GetProcedureType() == RPC_METHOD)
+                {
+                    it->second->SetAsynchronous(false);
+                    this->Bind(it->second, this->methods, method);
+                    return true;
+                }
+                return false;
+            }
+
+            /**
+             * @brief Binds an asynchronous method, which answers its calls through a MethodCompletion,
+             * possibly after it returned and from another thread.
+             */
+            virtual bool bindAsyncMethod(std::string& name, asyncMethodPointer_t method)
+            {
+                procedurelist_t::iterator it = this->handler.GetProcedures().find(name);
+                if(it != this->handler.GetProcedures().end() && it->second->GetProcedureType() == RPC_METHOD)
                 {
-                    this->methods[name] = method;
+                    it->second->SetAsynchronous(true);
+                    this->Bind(it->second, this->asyncMethods, method);
                     return true;
                 }
                 return false;
@@ -104,9 +150,10 @@ namespace jsonrpc
 
             virtual bool bindNotification(std::string& name, notificationPointer_t notification)
             {
-                if(this->handler.GetProcedures().find(name) != this->handler.GetProcedures().end() && this->handler.GetProcedures()[name]->GetProcedureType() == RPC_NOTIFICATION)
+                procedurelist_t::iterator it = this->handler.GetProcedures().find(name);
+                if(it != this->handler.GetProcedures().end() && it->second->GetProcedureType() == RPC_NOTIFICATION)
                 {
-                    this->notifications[name] = notification;
+                    this->Bind(it->second, this->notifications, notification);
                     return true;
                 }
                 return false;
@@ -117,7 +164,20 @@ namespace jsonrpc
                 if(proc->GetProcedureType() == RPC_METHOD)
                 {
                     this->handler.AddProcedure(proc);
-                    this->methods[proc->GetProcedureName()] = pointer;
+                    proc->SetAsynchronous(false);
+                    this->Bind(proc, this->methods, pointer);
+                    return true;
+                }
+                return false;
+            }
+
+            virtual bool bindAndAddAsyncMethod(Procedure* proc, asyncMethodPointer_t pointer)
+            {
+                if(proc->GetProcedureType() == RPC_METHOD)
+                {
+                    this->handler.AddProcedure(proc);
+                    proc->SetAsynchronous(true);
+                    this->Bind(proc, this->asyncMethods, pointer);
                     return true;
                 }
                 return false;
@@ -128,17 +188,46 @@ namespace jsonrpc
                 if(proc->GetProcedureType() == RPC_NOTIFICATION)
                 {
                     this->handler.AddProcedure(proc);
-                    this->notifications[proc->GetProcedureName()] = pointer;
+                    this->Bind(proc, this->notifications, pointer);
                     return true;
                 }
                 return false;
             }
 
         private:
+            /**
+             * @brief Stores pointer in table and records its position on proc. Binding a procedure again
+             * replaces its previous pointer. A method keeps its position when it switches between the tables
+             * of synchronous and asynchronous methods, which are indexed alike.
+             */
+            template<typename P>
+            void Bind(Procedure* proc, std::vector<P>& table, P pointer)
+            {
+                int index = proc->GetDispatchIndex();
+                if (index < 0)
+                {
+                    if (proc->GetProcedureType() == RPC_METHOD)
+                    {
+                        index = (int)std::max(this->methods.size(), this->asyncMethods.size());
+                    }
+                    else
+                    {
+                        index = (int)this->notifications.size();
+                    }
+                    proc->SetDispatchIndex(index);
+                }
+                if (index >= (int)table.size())
+                {
+                    table.resize(index + 1, NULL);
+                }
+                table[index] = pointer;
+            }
+
             AbstractServerConnector* connection;
             RpcProtocolServer handler;
-            std::map<std::string, methodPointer_t> methods;
-            std::map<std::string, notificationPointer_t> notifications;
+            std::vector<methodPointer_t> methods;
+            std::vector<notificationPointer_t> notifications;
+            std::vector<asyncMethodPointer_t> asyncMethods;
     };
 
 } /* namespace jsonrpc */
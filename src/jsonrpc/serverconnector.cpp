@@ -27,11 +27,14 @@ namespace jsonrpc
     
     bool AbstractServerConnector::OnRequest(const std::string& request, void* addInfo)
     {
-        string response;
+        return this->OnRequest(request.data(), request.size(), addInfo);
+    }
+
+    bool AbstractServerConnector::OnRequest(const char* request, size_t length, void* addInfo)
+    {
         if (this->handler != NULL)
         {
-            this->handler->HandleRequest(request, response);
-            this->SendResponse(response, addInfo);
+            this->ProcessRequest(request, length, *this->handler, addInfo);
             return true;
         }
         else
@@ -40,6 +43,13 @@ namespace jsonrpc
         }
     }
 
+    bool AbstractServerConnector::ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo)
+    {
+        string response;
+        handler.HandleRequest(request, length, response);
+        return this->SendResponse(response, addInfo);
+    }
+
     string AbstractServerConnector::GetSpecification()
     {
         return SpecificationWriter::toString(this->handler->GetProcedures());
@@ -56,10 +56,34 @@ namespace jsonrpc
              */
             bool OnRequest(const std::string& request, void* addInfo = NULL);
 
+            /**
+             * @brief Like OnRequest(const std::string&, void*), for connectors that receive the request into a buffer of their own.
+             * The request is parsed straight from the buffer, which does not have to be terminated and may be reused once this method returns.
+             * @param request - the first byte of the request.
+             * @param length - the number of bytes of the request.
+             * @param addInfo - additional Info, that the Connector might need for responding.
+             */
+            bool OnRequest(const char* request, size_t length, void* addInfo = NULL);
+
             std::string GetSpecification();
 
             void SetHandler(RpcProtocolServer& handler);
 
+        protected:
+            /**
+             * This method is called by OnRequest to let handler process the request and send its response.
+             * The default implementation collects the whole response in a string and passes it to SendResponse.
+             * Connectors that can send a response in pieces override it and serialize the response with
+             * RpcProtocolServer::HandleRequest(const char*, size_t, Json::OutputSink&, size_t), so that only one
+             * chunk of a large response has to be kept in memory.
+             * @param request - the first byte of the request that has been recognised, it is not terminated.
+             * @param length - the number of bytes of the request.
+             * @param handler - the handler that processes the request.
+             * @param addInfo - additional Info, that the Connector might need for responding.
+             * @return returns true on success, false otherwise
+             */
+            virtual bool ProcessRequest(const char* request, size_t length, RpcProtocolServer& handler, void* addInfo);
+
         private:
             RpcProtocolServer* handler;
     };
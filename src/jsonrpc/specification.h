@@ -14,6 +14,13 @@
 #define KEY_NOTIFICATION_NAME "notification"
 #define KEY_PROCEDURE_PARAMETERS "params"
 #define KEY_RETURN_TYPE "returns"
+#define KEY_MAX_CONCURRENT "maxConcurrent"
+#define KEY_MAX_QUEUED "maxQueued"
+#define KEY_MAX_QUEUE_TIME "maxQueueTime"
+#define KEY_CACHEABLE "cacheable"
+#define KEY_CACHE_TTL "cacheTtl"
+#define KEY_SINGLE_FLIGHT "singleFlight"
+#define KEY_PARAMETER_SCHEMAS "schemas"
 
 namespace jsonrpc
 {
@@ -33,10 +33,22 @@ namespace jsonrpc {
 
         procedurelist_t* procedures = new procedurelist_t();
         Procedure* proc;
-        for (unsigned int i = 0; i < val.size(); i++)
+        try
         {
-            proc = GetProcedure(val[i]);
-            (*procedures)[proc->GetProcedureName()] = proc;
+            for (unsigned int i = 0; i < val.size(); i++)
+            {
+                proc = GetProcedure(val[i]);
+                (*procedures)[proc->GetProcedureName()] = proc;
+            }
+        }
+        catch (const JsonRpcException&)
+        {
+            for (procedurelist_t::iterator it = procedures->begin(); it != procedures->end(); it++)
+            {
+                delete it->second;
+            }
+            delete procedures;
+            throw;
         }
         return procedures;
     }
@@ -116,6 +128,10 @@ namespace jsonrpc {
                         result->AddParameter(paramname.str(), toJsonType(signature[KEY_PROCEDURE_PARAMETERS][i]));
                     }
                 }
+                GetConcurrencyLimit(signature, result);
+                GetCacheable(signature, result);
+                GetSingleFlight(signature, result);
+                GetParameterSchemas(signature, result);
             }
             else
             {
@@ -133,6 +149,118 @@ namespace jsonrpc {
         return result;
     }
 
+    void SpecificationParser::GetConcurrencyLimit(Json::Value &signature, Procedure* procedure)
+    {
+        if (!signature.isMember(KEY_MAX_CONCURRENT))
+        {
+            if (signature.isMember(KEY_MAX_QUEUED) || signature.isMember(KEY_MAX_QUEUE_TIME))
+            {
+                delete procedure;
+                throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                       "maxQueued and maxQueueTime require maxConcurrent: " + signature.toStyledString());
+            }
+            return;
+        }
+        try
+        {
+            unsigned int maxConcurrent = GetLimitValue(signature, KEY_MAX_CONCURRENT, 0);
+            unsigned int maxQueued = GetLimitValue(signature, KEY_MAX_QUEUED, 0);
+            unsigned int maxQueueTime = GetLimitValue(signature, KEY_MAX_QUEUE_TIME, PROCEDURE_DEFAULT_MAX_QUEUE_TIME);
+            procedure->SetConcurrencyLimit(maxConcurrent, maxQueued, maxQueueTime);
+        }
+        catch (const JsonRpcException&)
+        {
+            delete procedure;
+            throw;
+        }
+    }
+
+    void SpecificationParser::GetCacheable(Json::Value &signature, Procedure* procedure)
+    {
+        if (!signature.isMember(KEY_CACHEABLE))
+        {
+            if (signature.isMember(KEY_CACHE_TTL))
+            {
+                delete procedure;
+                throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                       "cacheTtl requires cacheable: " + signature.toStyledString());
+            }
+            return;
+        }
+        if (!signature[KEY_CACHEABLE].isBool() || (signature[KEY_CACHEABLE].asBool() && procedure->GetProcedureType() != RPC_METHOD))
+        {
+            delete procedure;
+            throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                   "cacheable must be a boolean and only methods can be cached: " + signature.toStyledString());
+        }
+        try
+        {
+            unsigned int ttl = GetLimitValue(signature, KEY_CACHE_TTL, PROCEDURE_DEFAULT_CACHE_TTL);
+            procedure->SetCacheable(signature[KEY_CACHEABLE].asBool(), ttl);
+        }
+        catch (const JsonRpcException&)
+        {
+            delete procedure;
+            throw;
+        }
+    }
+
+    void SpecificationParser::GetSingleFlight(Json::Value &signature, Procedure* procedure)
+    {
+        if (!signature.isMember(KEY_SINGLE_FLIGHT))
+        {
+            return;
+        }
+        if (!signature[KEY_SINGLE_FLIGHT].isBool() || (signature[KEY_SINGLE_FLIGHT].asBool() && procedure->GetProcedureType() != RPC_METHOD))
+        {
+            delete procedure;
+            throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                   "singleFlight must be a boolean and only methods can share calls: " + signature.toStyledString());
+        }
+        procedure->SetSingleFlight(signature[KEY_SINGLE_FLIGHT].asBool());
+    }
+
+    void SpecificationParser::GetParameterSchemas(Json::Value &signature, Procedure* procedure)
+    {
+        if (!signature.isMember(KEY_PARAMETER_SCHEMAS))
+        {
+            return;
+        }
+        const Json::Value& schemas = signature[KEY_PARAMETER_SCHEMAS];
+        try
+        {
+            if (!schemas.isObject())
+            {
+                throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                       "schemas must map parameter names to schemas: " + signature.toStyledString());
+            }
+            for (Json::Value::const_iterator it = schemas.begin(); it != schemas.end(); ++it)
+            {
+                procedure->SetParameterSchema(it.memberName(), *it);
+            }
+        }
+        catch (const JsonRpcException&)
+        {
+            delete procedure;
+            throw;
+        }
+    }
+
+    unsigned int SpecificationParser::GetLimitValue(Json::Value &signature, const char* key, unsigned int defaultValue)
+    {
+        if (!signature.isMember(key))
+        {
+            return defaultValue;
+        }
+        const Json::Value& value = signature[key];
+        if (!value.isUInt() && !(value.isInt() && value.asInt() >= 0))
+        {
+            throw JsonRpcException(Errors::ERROR_SERVER_PROCEDURE_SPECIFICATION_SYNTAX,
+                                   std::string(key) + " must be a non-negative integer: " + signature.toStyledString());
+        }
+        return value.asUInt();
+    }
+
     void SpecificationParser::GetFileContent(const std::string &filename, std::string& target)
     {
         ifstream config(filename.c_str());
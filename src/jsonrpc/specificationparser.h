@@ -26,6 +26,11 @@ namespace jsonrpc {
 
         private:
             static Procedure* GetProcedure(Json::Value& val);
+            static void GetConcurrencyLimit(Json::Value& signature, Procedure* procedure);
+            static void GetCacheable(Json::Value& signature, Procedure* procedure);
+            static void GetSingleFlight(Json::Value& signature, Procedure* procedure);
+            static void GetParameterSchemas(Json::Value& signature, Procedure* procedure);
+            static unsigned int GetLimitValue(Json::Value& signature, const char* key, unsigned int defaultValue);
             static void GetFileContent(const std::string& filename, std::string& target);
             static jsontype_t toJsonType(Json::Value& val);
     };
@@ -108,5 +108,27 @@ namespace jsonrpc
         {
             target[KEY_PROCEDURE_PARAMETERS] = Json::nullValue;
         }
+
+        ConcurrencyLimit* limit = procedure->GetConcurrencyLimit();
+        if(limit != NULL)
+        {
+            target[KEY_MAX_CONCURRENT] = limit->GetMaxConcurrent();
+            target[KEY_MAX_QUEUED] = limit->GetMaxQueued();
+            target[KEY_MAX_QUEUE_TIME] = limit->GetMaxQueueTime();
+        }
+        if(procedure->GetCacheable())
+        {
+            target[KEY_CACHEABLE] = true;
+            target[KEY_CACHE_TTL] = procedure->GetCacheTtl();
+        }
+        if(procedure->GetSingleFlight())
+        {
+            target[KEY_SINGLE_FLIGHT] = true;
+        }
+        const parameterSchemaList_t& schemas = procedure->GetParameterSchemas();
+        for(parameterSchemaList_t::const_iterator it = schemas.begin(); it != schemas.end(); it++)
+        {
+            target[KEY_PARAMETER_SCHEMAS][it->first] = it->second;
+        }
     }
 }
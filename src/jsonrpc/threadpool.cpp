@@ -0,0 +1,247 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    threadpool.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "threadpool.h"
+#include <unistd.h>
+
+namespace jsonrpc
+{
+    /**
+     * Pool and worker position of the calling thread, if it is a pool worker.
+     */
+    static __thread ThreadPool* currentPool = NULL;
+    static __thread unsigned int currentWorker = 0;
+
+    /**
+     * @brief A worker thread and the queue it takes its tasks from.
+     */
+    class ThreadPool::Worker
+    {
+        public:
+            Worker(ThreadPool* pool, unsigned int index) :
+                pool(pool),
+                index(index)
+            {
+                pthread_mutex_init(&this->mutex, NULL);
+            }
+
+            ~Worker()
+            {
+                pthread_mutex_destroy(&this->mutex);
+            }
+
+            ThreadPool* pool;
+            unsigned int index;
+            pthread_t thread;
+            pthread_mutex_t mutex;
+            std::deque<ThreadPoolTask*> queue;
+    };
+
+    ThreadPoolTask::~ThreadPoolTask()
+    {
+    }
+
+    ThreadPool::ThreadPool(unsigned int threads, unsigned int maxQueued) :
+        maxQueued(maxQueued),
+        queued(0),
+        nextWorker(0),
+        sleeping(0),
+        blocked(0),
+        stopping(false)
+    {
+        if (threads == 0)
+        {
+            long processors = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = processors > 0 ? (unsigned int) processors : 1;
+        }
+        pthread_mutex_init(&this->mutex, NULL);
+        pthread_cond_init(&this->available, NULL);
+        pthread_cond_init(&this->room, NULL);
+        for (unsigned int i = 0; i < threads; i++)
+        {
+            this->workers.push_back(new Worker(this, i));
+        }
+        //All queues exist before the first worker looks for work.
+        for (unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            pthread_create(&this->workers[i]->thread, NULL, ThreadPool::Work, this->workers[i]);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        pthread_mutex_lock(&this->mutex);
+        this->stopping = true;
+        pthread_cond_broadcast(&this->available);
+        pthread_mutex_unlock(&this->mutex);
+        for (unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            pthread_join(this->workers[i]->thread, NULL);
+        }
+        //Running workers look into the queues of the others until they are joined.
+        for (unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            delete this->workers[i];
+        }
+        pthread_cond_destroy(&this->room);
+        pthread_cond_destroy(&this->available);
+        pthread_mutex_destroy(&this->mutex);
+    }
+
+    void ThreadPool::Submit(ThreadPoolTask* task)
+    {
+        __sync_add_and_fetch(&this->queued, 1);
+        this->Push(task);
+    }
+
+    bool ThreadPool::TrySubmit(ThreadPoolTask* task)
+    {
+        if (this->maxQueued == 0)
+        {
+            this->Submit(task);
+            return true;
+        }
+        //The place in the queue is reserved before the task is pushed, so that the limit holds under contention.
+        while (true)
+        {
+            unsigned int waiting = __sync_add_and_fetch(&this->queued, 0);
+            if (waiting >= this->maxQueued)
+            {
+                return false;
+            }
+            if (__sync_bool_compare_and_swap(&this->queued, waiting, waiting + 1))
+            {
+                break;
+            }
+        }
+        this->Push(task);
+        return true;
+    }
+
+    bool ThreadPool::SubmitBounded(ThreadPoolTask* task, overflowpolicy_t policy)
+    {
+        if (policy == OVERFLOW_DROP)
+        {
+            return this->TrySubmit(task);
+        }
+        if (this->IsWorkerThread())
+        {
+            //A worker waiting for its own pool could wait forever.
+            this->Submit(task);
+            return true;
+        }
+        while (!this->TrySubmit(task))
+        {
+            //blocked is raised before queued is read and Pop lowers queued before it reads blocked,
+            //so either the submitter sees the room or Pop sees the submitter.
+            pthread_mutex_lock(&this->mutex);
+            __sync_add_and_fetch(&this->blocked, 1);
+            while (__sync_add_and_fetch(&this->queued, 0) >= this->maxQueued)
+            {
+                pthread_cond_wait(&this->room, &this->mutex);
+            }
+            __sync_sub_and_fetch(&this->blocked, 1);
+            pthread_mutex_unlock(&this->mutex);
+        }
+        return true;
+    }
+
+    unsigned int ThreadPool::GetThreadCount() const
+    {
+        return (unsigned int) this->workers.size();
+    }
+
+    unsigned int ThreadPool::GetQueuedCount() const
+    {
+        return __sync_add_and_fetch(const_cast<volatile unsigned int*>(&this->queued), 0);
+    }
+
+    bool ThreadPool::IsWorkerThread() const
+    {
+        return currentPool == this;
+    }
+
+    void ThreadPool::Push(ThreadPoolTask* task)
+    {
+        unsigned int position = this->IsWorkerThread() ? currentWorker : __sync_fetch_and_add(&this->nextWorker, 1) % this->workers.size();
+        Worker* worker = this->workers[position];
+        pthread_mutex_lock(&worker->mutex);
+        worker->queue.push_back(task);
+        pthread_mutex_unlock(&worker->mutex);
+
+        //queued was raised before sleeping is read and workers raise sleeping before they read queued,
+        //so either a worker sees the task or the task sees the sleeping worker.
+        if (__sync_add_and_fetch(&this->sleeping, 0) > 0)
+        {
+            pthread_mutex_lock(&this->mutex);
+            pthread_cond_signal(&this->available);
+            pthread_mutex_unlock(&this->mutex);
+        }
+    }
+
+    ThreadPoolTask* ThreadPool::Pop(unsigned int worker)
+    {
+        for (unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            Worker* victim = this->workers[(worker + i) % this->workers.size()];
+            pthread_mutex_lock(&victim->mutex);
+            if (!victim->queue.empty())
+            {
+                ThreadPoolTask* task = victim->queue.front();
+                victim->queue.pop_front();
+                pthread_mutex_unlock(&victim->mutex);
+                __sync_sub_and_fetch(&this->queued, 1);
+                if (__sync_add_and_fetch(&this->blocked, 0) > 0)
+                {
+                    pthread_mutex_lock(&this->mutex);
+                    pthread_cond_signal(&this->room);
+                    pthread_mutex_unlock(&this->mutex);
+                }
+                return task;
+            }
+            pthread_mutex_unlock(&victim->mutex);
+        }
+        return NULL;
+    }
+
+    void* ThreadPool::Work(void* data)
+    {
+        Worker* worker = (Worker*) data;
+        ThreadPool* pool = worker->pool;
+        currentPool = pool;
+        currentWorker = worker->index;
+        while (true)
+        {
+            ThreadPoolTask* task = pool->Pop(worker->index);
+            if (task != NULL)
+            {
+                task->Run();
+                delete task;
+                continue;
+            }
+
+            pthread_mutex_lock(&pool->mutex);
+            __sync_add_and_fetch(&pool->sleeping, 1);
+            while (__sync_add_and_fetch(&pool->queued, 0) == 0 && !pool->stopping)
+            {
+                pthread_cond_wait(&pool->available, &pool->mutex);
+            }
+            __sync_sub_and_fetch(&pool->sleeping, 1);
+            bool done = pool->stopping && __sync_add_and_fetch(&pool->queued, 0) == 0;
+            pthread_mutex_unlock(&pool->mutex);
+            if (done)
+            {
+                break;
+            }
+        }
+        currentPool = NULL;
+        return NULL;
+    }
+
+} /* namespace jsonrpc */
@@ -0,0 +1,123 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    threadpool.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+namespace jsonrpc
+{
+    /**
+     * @brief What ThreadPool::SubmitBounded does with a task that finds the queue full.
+     */
+    typedef enum
+    {
+        OVERFLOW_DROP, OVERFLOW_BLOCK
+    } overflowpolicy_t;
+
+    /**
+     * @brief A unit of work executed by a ThreadPool.
+     */
+    class ThreadPoolTask
+    {
+        public:
+            virtual ~ThreadPoolTask();
+
+            /**
+             * @brief Does the work. Runs on one of the pool's threads, the task is deleted afterwards.
+             */
+            virtual void Run() = 0;
+    };
+
+    /**
+     * @brief A fixed number of worker threads that execute submitted tasks.
+     *
+     * Every worker has a queue of its own. Tasks submitted by a worker go to its own queue, others
+     * are spread over the queues in turn. A worker takes the tasks of its queue in submission
+     * order and steals from the other queues once its own is empty, so no lock is shared by all
+     * workers while there is work to do.
+     */
+    class ThreadPool
+    {
+        public:
+            /**
+             * @param threads - number of worker threads, 0 starts one per online processor.
+             * @param maxQueued - number of waiting tasks above which TrySubmit refuses new ones, 0 for no limit.
+             */
+            ThreadPool(unsigned int threads = 0, unsigned int maxQueued = 0);
+
+            /**
+             * @brief Runs the tasks that are still queued and joins all worker threads.
+             */
+            ~ThreadPool();
+
+            /**
+             * @brief Queues task for execution, the pool takes ownership of it. The queue limit does not apply.
+             */
+            void Submit(ThreadPoolTask* task);
+
+            /**
+             * @brief Queues task for execution unless maxQueued tasks are already waiting.
+             * @return true if the pool took ownership of task, false if it is full and task is left to the caller.
+             */
+            bool TrySubmit(ThreadPoolTask* task);
+
+            /**
+             * @brief Queues task like TrySubmit, a full queue either refuses it or blocks the caller until a worker takes a task.
+             * Workers of the pool never block on it, the queue limit does not apply to them.
+             * @return true if the pool took ownership of task, false if it was refused and is left to the caller.
+             */
+            bool SubmitBounded(ThreadPoolTask* task, overflowpolicy_t policy);
+
+            unsigned int GetThreadCount() const;
+
+            /**
+             * @return the number of tasks that wait for a worker.
+             */
+            unsigned int GetQueuedCount() const;
+
+            /**
+             * @return true if the calling thread is one of the workers of this pool.
+             */
+            bool IsWorkerThread() const;
+
+        private:
+            class Worker;
+
+            ThreadPool(const ThreadPool&);          // no implementation
+            void operator=(const ThreadPool&);      // no implementation
+
+            void Push(ThreadPoolTask* task);
+            ThreadPoolTask* Pop(unsigned int worker);
+
+            static void* Work(void* data);
+
+            std::vector<Worker*> workers;
+            unsigned int maxQueued;
+            volatile unsigned int queued;
+            volatile unsigned int nextWorker;
+            /**
+             * Number of workers waiting for tasks, they sleep on available.
+             */
+            volatile unsigned int sleeping;
+            /**
+             * Number of submitters waiting for room in the queue, they sleep on room.
+             */
+            volatile unsigned int blocked;
+            pthread_mutex_t mutex;
+            pthread_cond_t available;
+            pthread_cond_t room;
+            bool stopping;
+    };
+
+} /* namespace jsonrpc */
+#endif /* THREADPOOL_H_ */
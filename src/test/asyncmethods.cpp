@@ -0,0 +1,275 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    asyncmethods.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace jsonrpc;
+using namespace std;
+
+/**
+ * @brief Connector that never receives anything, AbstractServer only needs one to exist.
+ */
+class NullConnector : public AbstractServerConnector
+{
+    public:
+        virtual bool StartListening() { return true; }
+        virtual bool StopListening() { return true; }
+        virtual bool SendResponse(const std::string& response, void* addInfo) { return true; }
+        virtual bool SendEvent(const std::string& data) { return true; }
+};
+
+/**
+ * @brief "defer" keeps its calls open until CompleteAll is called, "fail" answers with an error right away.
+ */
+class AsyncServer : public AbstractServer<AsyncServer>
+{
+    public:
+        AsyncServer() :
+            AbstractServer<AsyncServer>(new NullConnector())
+        {
+            pthread_mutex_init(&this->mutex, NULL);
+            this->bindAndAddAsyncMethod(new Procedure("defer", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL), &AsyncServer::defer);
+            this->bindAndAddAsyncMethod(new Procedure("fail", PARAMS_BY_NAME, JSON_INTEGER, NULL), &AsyncServer::fail);
+            Procedure* explode = new Procedure("explode", PARAMS_BY_NAME, JSON_INTEGER, NULL);
+            explode->SetConcurrencyLimit(1);
+            this->bindAndAddAsyncMethod(explode, &AsyncServer::explode);
+            this->bindAndAddAsyncMethod(new Procedure("answerAndExplode", PARAMS_BY_NAME, JSON_INTEGER, NULL), &AsyncServer::answerAndExplode);
+            this->bindAndAddMethod(new Procedure("sayHello", PARAMS_BY_NAME, JSON_STRING, "name", JSON_STRING, NULL), &AsyncServer::sayHello);
+        }
+
+        ~AsyncServer()
+        {
+            pthread_mutex_destroy(&this->mutex);
+        }
+
+        void defer(const Json::Value& request, MethodCompletion* completion)
+        {
+            pthread_mutex_lock(&this->mutex);
+            this->calls.push_back(make_pair(completion, request["value"].asInt()));
+            pthread_mutex_unlock(&this->mutex);
+        }
+
+        void fail(const Json::Value& request, MethodCompletion* completion)
+        {
+            completion->Fail(JsonRpcException(-32099, "failed"));
+        }
+
+        void explode(const Json::Value& request, MethodCompletion* completion)
+        {
+            throw runtime_error("exploded");
+        }
+
+        void answerAndExplode(const Json::Value& request, MethodCompletion* completion)
+        {
+            completion->Complete(42);
+            throw JsonRpcException(-32099, "exploded");
+        }
+
+        void sayHello(const Json::Value& request, Json::Value& response)
+        {
+            response = "Hello: " + request["name"].asString();
+        }
+
+        void sayHelloLater(const Json::Value& request, MethodCompletion* completion)
+        {
+            completion->Complete("Later: " + request["name"].asString());
+        }
+
+        /**
+         * @brief Binds sayHello to sayHelloLater or back to the synchronous sayHello.
+         */
+        void Rebind(bool asynchronous)
+        {
+            string name = "sayHello";
+            if (asynchronous)
+            {
+                this->bindAsyncMethod(name, &AsyncServer::sayHelloLater);
+            }
+            else
+            {
+                this->bindMethod(name, &AsyncServer::sayHello);
+            }
+        }
+
+        size_t Pending()
+        {
+            pthread_mutex_lock(&this->mutex);
+            size_t pending = this->calls.size();
+            pthread_mutex_unlock(&this->mutex);
+            return pending;
+        }
+
+        /**
+         * @brief Answers the open calls, the latest one first.
+         */
+        void CompleteAll()
+        {
+            pthread_mutex_lock(&this->mutex);
+            vector<pair<MethodCompletion*, int> > calls;
+            calls.swap(this->calls);
+            pthread_mutex_unlock(&this->mutex);
+            while (!calls.empty())
+            {
+                calls.back().first->Complete(calls.back().second * 2);
+                calls.pop_back();
+            }
+        }
+
+    private:
+        pthread_mutex_t mutex;
+        vector<pair<MethodCompletion*, int> > calls;
+};
+
+/**
+ * @brief Records the responses in the order they are handed on.
+ */
+class ResponseCollector : public AbstractResponseHandler
+{
+    public:
+        ResponseCollector(vector<string>* responses) : responses(responses) {}
+
+        virtual void OnResponse(ProtocolContext& context, const Json::Value& response)
+        {
+            string document;
+            context.Write(response, document);
+            this->responses->push_back(document);
+        }
+
+    private:
+        vector<string>* responses;
+};
+
+static string DeferRequest(int id)
+{
+    stringstream request;
+    request << "{\"jsonrpc\":\"2.0\",\"method\":\"defer\",\"params\":{\"value\":" << id << "},\"id\":" << id << "}";
+    return request.str();
+}
+
+static string DeferResponse(int id)
+{
+    stringstream response;
+    response << "{\"id\":" << id << ",\"jsonrpc\":\"2.0\",\"result\":" << id * 2 << "}\n";
+    return response.str();
+}
+
+static void* CompleteLater(void* data)
+{
+    AsyncServer* server = (AsyncServer*) data;
+    while (server->Pending() == 0)
+    {
+        usleep(1000);
+    }
+    server->CompleteAll();
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    AsyncServer server;
+    RpcProtocolServer* protocol = server.GetProtocolHanlder();
+
+    //The synchronous variant waits for a call completed by another thread
+    pthread_t completer;
+    pthread_create(&completer, NULL, CompleteLater, &server);
+    string response;
+    protocol->HandleRequest(DeferRequest(21), response);
+    pthread_join(completer, NULL);
+    if (response != DeferResponse(21))
+    {
+        cerr << "waiting for a deferred call returned " << response << endl;
+        return -1;
+    }
+
+    //Responses are handed on in the order their calls are completed
+    vector<string> responses;
+    for (int i = 0; i < 3; i++)
+    {
+        protocol->HandleRequest(DeferRequest(i), new ResponseCollector(&responses));
+    }
+    if (!responses.empty() || server.Pending() != 3)
+    {
+        cerr << "deferred calls were answered before they were completed" << endl;
+        return -2;
+    }
+    server.CompleteAll();
+    if (responses.size() != 3 || responses[0] != DeferResponse(2) || responses[2] != DeferResponse(0))
+    {
+        cerr << "deferred calls were answered out of completion order" << endl;
+        return -3;
+    }
+
+    //A batch is answered once its last call is completed, in request order and with failed calls as errors
+    responses.clear();
+    protocol->HandleRequest("[" + DeferRequest(1) + ","
+                            "{\"jsonrpc\":\"2.0\",\"method\":\"sayHello\",\"params\":{\"name\":\"Peter\"},\"id\":2},"
+                            "{\"jsonrpc\":\"2.0\",\"method\":\"fail\",\"params\":{},\"id\":3}," + DeferRequest(4) + "]",
+                            new ResponseCollector(&responses));
+    if (!responses.empty())
+    {
+        cerr << "batch was answered before its calls were completed" << endl;
+        return -4;
+    }
+    server.CompleteAll();
+    Json::Value batch;
+    if (responses.size() != 1 || !Json::Reader().parse(responses[0], batch) || batch.size() != 4
+            || batch[0u]["result"].asInt() != 2 || batch[1u]["result"].asString() != "Hello: Peter"
+            || batch[2u]["error"]["code"].asInt() != -32099 || batch[2u]["id"].asInt() != 3
+            || batch[3u]["result"].asInt() != 8)
+    {
+        cerr << "batch returned " << (responses.empty() ? string() : responses[0]) << endl;
+        return -5;
+    }
+
+    //A throwing handler fails its call and frees the slot of the call, unless it answered before
+    for (int i = 0; i < 2; i++)
+    {
+        string exploded;
+        protocol->HandleRequest("{\"jsonrpc\":\"2.0\",\"method\":\"explode\",\"params\":{},\"id\":1}", exploded);
+        string answered;
+        protocol->HandleRequest("{\"jsonrpc\":\"2.0\",\"method\":\"answerAndExplode\",\"params\":{},\"id\":2}", answered);
+        Json::Value error;
+        if (!Json::Reader().parse(exploded, error) || error["error"]["code"].asInt() != Errors::ERROR_RPC_INTERNAL_ERROR
+                || answered != "{\"id\":2,\"jsonrpc\":\"2.0\",\"result\":42}\n")
+        {
+            cerr << "throwing handlers were answered with " << exploded << answered << endl;
+            return -6;
+        }
+    }
+
+    //A method switched between synchronous and asynchronous keeps its dispatch slot
+    string hello = "{\"jsonrpc\":\"2.0\",\"method\":\"sayHello\",\"params\":{\"name\":\"Peter\"},\"id\":1}";
+    int slot = protocol->GetProcedures()["sayHello"]->GetDispatchIndex();
+    for (int i = 0; i < 100; i++)
+    {
+        string later;
+        server.Rebind(true);
+        protocol->HandleRequest(hello, later);
+        string now;
+        server.Rebind(false);
+        protocol->HandleRequest(hello, now);
+        if (later != "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":\"Later: Peter\"}\n"
+                || now != "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":\"Hello: Peter\"}\n"
+                || protocol->GetProcedures()["sayHello"]->GetDispatchIndex() != slot)
+        {
+            cerr << "rebound method answered " << later << now << " from slot "
+                 << protocol->GetProcedures()["sayHello"]->GetDispatchIndex() << " instead of " << slot << endl;
+            return -7;
+        }
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
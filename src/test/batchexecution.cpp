@@ -0,0 +1,141 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    batchexecution.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace jsonrpc;
+using namespace std;
+
+#define BATCH_SIZE 32
+#define CALL_DURATION_US 10000
+
+/**
+ * @brief "wait" sleeps and reports its value back, "serial" checks that nothing else runs meanwhile.
+ * Both keep track of how many calls are in flight.
+ */
+class BatchHandler : public AbstractRequestHandler
+{
+    public:
+        BatchHandler() : running(0), maxRunning(0), serialOverlaps(0) {}
+
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            int now = __sync_add_and_fetch(&this->running, 1);
+            int seen;
+            while ((seen = __sync_add_and_fetch(&this->maxRunning, 0)) < now && !__sync_bool_compare_and_swap(&this->maxRunning, seen, now))
+            {
+            }
+            if (proc->GetProcedureName() == "serial" && now != 1)
+            {
+                __sync_add_and_fetch(&this->serialOverlaps, 1);
+            }
+            usleep(CALL_DURATION_US);
+            output = input["value"];
+            __sync_sub_and_fetch(&this->running, 1);
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+
+        volatile int running;
+        volatile int maxRunning;
+        volatile int serialOverlaps;
+};
+
+static double NowMs()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec * 1000.0 + now.tv_usec / 1000.0;
+}
+
+static string Batch(int serialEvery)
+{
+    stringstream batch;
+    batch << "[";
+    for (int i = 0; i < BATCH_SIZE; i++)
+    {
+        const char* method = serialEvery > 0 && i % serialEvery == 0 ? "serial" : "wait";
+        batch << (i > 0 ? "," : "") << "{\"jsonrpc\":\"2.0\",\"method\":\"" << method
+              << "\",\"params\":{\"value\":" << i << "},\"id\":" << i << "}";
+    }
+    batch << "]";
+    return batch.str();
+}
+
+static bool InOrder(const string& response)
+{
+    Json::Value responses;
+    if (!Json::Reader().parse(response, responses) || responses.size() != BATCH_SIZE)
+    {
+        return false;
+    }
+    for (int i = 0; i < BATCH_SIZE; i++)
+    {
+        if (responses[i]["id"].asInt() != i || responses[i]["result"].asInt() != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BatchHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("wait", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL));
+    Procedure* serial = new Procedure("serial", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL);
+    serial->SetRunSerially(true);
+    server.AddProcedure(serial);
+
+    //Sequential by default
+    string response;
+    server.HandleRequest(Batch(0), response);
+    if (!InOrder(response) || handler.maxRunning != 1)
+    {
+        cerr << "sequential batch ran " << handler.maxRunning << " calls at once: " << response << endl;
+        return -1;
+    }
+
+    //At most four elements in flight, the responses keep their order
+    ThreadPool pool(8);
+    server.SetBatchExecutor(&pool, 4);
+    handler.maxRunning = 0;
+    double start = NowMs();
+    server.HandleRequest(Batch(0), response);
+    double elapsed = NowMs() - start;
+    if (!InOrder(response) || handler.maxRunning < 2 || handler.maxRunning > 4)
+    {
+        cerr << "parallel batch ran " << handler.maxRunning << " calls at once: " << response << endl;
+        return -2;
+    }
+    if (elapsed > BATCH_SIZE * CALL_DURATION_US / 1000.0 * 0.75)
+    {
+        cerr << "parallel batch took " << elapsed << " ms" << endl;
+        return -3;
+    }
+
+    //Serial procedures never overlap with other elements
+    server.HandleRequest(Batch(4), response);
+    if (!InOrder(response) || handler.serialOverlaps != 0)
+    {
+        cerr << handler.serialOverlaps << " serial calls overlapped: " << response << endl;
+        return -4;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    concurrencylimit.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <pthread.h>
+#include <unistd.h>
+#include "gatehandler.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define SPECIFICATION "[{\"method\":\"slow\",\"params\":null,\"returns\":1,\"maxConcurrent\":1,\"maxQueued\":1,\"maxQueueTime\":5000}," \
+                      "{\"method\":\"cheap\",\"params\":null,\"returns\":1}]"
+
+/**
+ * @brief "slow" blocks until the gate is opened, "cheap" returns right away.
+ */
+class SlowHandler : public GateHandler
+{
+    public:
+        SlowHandler() : GateHandler("slow")
+        {
+        }
+
+        virtual void Answer(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            output = 1;
+        }
+};
+
+static Json::Value Call(RpcProtocolServer& server, const string& method)
+{
+    string response;
+    server.HandleRequest("{\"jsonrpc\":\"2.0\",\"method\":\"" + method + "\",\"params\":null,\"id\":1}", response);
+    Json::Value result;
+    Json::Reader().parse(response, result);
+    return result;
+}
+
+static void* CallSlow(void* data)
+{
+    Json::Value* result = new Json::Value(Call(*(RpcProtocolServer*) data, "slow"));
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    //The limits are read from the specification
+    SlowHandler handler;
+    RpcProtocolServer server(&handler, SpecificationParser::GetProceduresFromString(SPECIFICATION));
+    ConcurrencyLimit* limit = server.GetProcedures()["slow"]->GetConcurrencyLimit();
+    if (limit == NULL || limit->GetMaxConcurrent() != 1 || limit->GetMaxQueued() != 1 || limit->GetMaxQueueTime() != 5000
+            || server.GetProcedures()["cheap"]->GetConcurrencyLimit() != NULL)
+    {
+        cerr << "limits were not read from the specification" << endl;
+        return -1;
+    }
+    try
+    {
+        delete SpecificationParser::GetProceduresFromString("[{\"method\":\"slow\",\"params\":null,\"maxConcurrent\":-1}]");
+        cerr << "negative limit was accepted" << endl;
+        return -2;
+    }
+    catch (const JsonRpcException&)
+    {
+    }
+
+    //One call runs, one waits and the next one is turned away, other procedures are not affected
+    pthread_t running, queued;
+    pthread_create(&running, NULL, CallSlow, &server);
+    while (__sync_add_and_fetch(&handler.entered, 0) == 0)
+    {
+        usleep(1000);
+    }
+    pthread_create(&queued, NULL, CallSlow, &server);
+    usleep(50000);
+    Json::Value rejected = Call(server, "slow");
+    Json::Value cheap = Call(server, "cheap");
+    handler.SetOpen(true);
+    void* runningResult;
+    void* queuedResult;
+    pthread_join(running, &runningResult);
+    pthread_join(queued, &queuedResult);
+    bool admitted = (*(Json::Value*) runningResult)["result"].asInt() == 1 && (*(Json::Value*) queuedResult)["result"].asInt() == 1;
+    delete (Json::Value*) runningResult;
+    delete (Json::Value*) queuedResult;
+    if (rejected["error"]["code"].asInt() != Errors::ERROR_SERVER_PROCEDURE_BUSY)
+    {
+        cerr << "call over the limit returned " << rejected.toStyledString() << endl;
+        return -3;
+    }
+    if (cheap["result"].asInt() != 1 || !admitted)
+    {
+        cerr << "admitted calls were not answered" << endl;
+        return -4;
+    }
+
+    //A waiting call gives up after the queue time
+    Procedure* quick = new Procedure("quick", PARAMS_BY_NAME, JSON_INTEGER, NULL);
+    quick->SetConcurrencyLimit(1, 1, 20);
+    server.AddProcedure(quick);
+    if (!quick->GetConcurrencyLimit()->Acquire())
+    {
+        cerr << "free slot was not granted" << endl;
+        return -5;
+    }
+    if (Call(server, "quick")["error"]["code"].asInt() != Errors::ERROR_SERVER_PROCEDURE_BUSY)
+    {
+        cerr << "waiting call was not rejected after the queue time" << endl;
+        return -6;
+    }
+    quick->GetConcurrencyLimit()->Release();
+    if (Call(server, "quick")["result"].asInt() != 1)
+    {
+        cerr << "released slot was not granted" << endl;
+        return -7;
+    }
+
+    //The limits survive a round trip through the specification writer
+    procedurelist_t* procedures = SpecificationParser::GetProceduresFromString(SpecificationWriter::toString(server.GetProcedures()));
+    limit = (*procedures)["quick"]->GetConcurrencyLimit();
+    bool restored = limit != NULL && limit->GetMaxConcurrent() == 1 && limit->GetMaxQueued() == 1 && limit->GetMaxQueueTime() == 20;
+    for (procedurelist_t::iterator it = procedures->begin(); it != procedures->end(); it++)
+    {
+        delete it->second;
+    }
+    delete procedures;
+    if (!restored)
+    {
+        cerr << "limits were not written to the specification" << endl;
+        return -8;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    epollhttpserver.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <vector>
+#include <ctime>
+#include <unistd.h>
+#include <sys/time.h>
+#include "httpconnection.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define PORT 8387
+#define CONCURRENT_CONNECTIONS 1000
+
+static double Now()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+int main(int argc, char** argv)
+{
+    AddHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL));
+    server.AddProcedure(new Procedure("length", PARAMS_BY_NAME, JSON_INTEGER, "text", JSON_STRING, NULL));
+    server.AddProcedure(new Procedure("log", PARAMS_BY_NAME, "value", JSON_INTEGER, NULL));
+
+    EpollHttpServer connector(PORT, true, 2);
+    connector.SetHandler(server);
+    connector.SetKeepAlive(true, 300, 3);
+    if (!connector.StartListening())
+    {
+        cerr << "could not listen on port " << PORT << endl;
+        return -1;
+    }
+
+    //HttpClient gets its answers, a large body is sent after 100 Continue, GET returns the specification
+    {
+        HttpClient client("http://127.0.0.1:8387");
+        string response;
+        client.SendMessage(Body(1), response);
+        string text(100000, 'x');
+        double started = Now();
+        string large;
+        client.SendMessage("{\"jsonrpc\":\"2.0\",\"method\":\"length\",\"params\":{\"text\":\"" + text + "\"},\"id\":2}", large);
+        double elapsed = Now() - started;
+        Connection connection(PORT);
+        connection.Send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        string specification = connection.Receive();
+        if (response != "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":2}\n" || large != "{\"id\":2,\"jsonrpc\":\"2.0\",\"result\":100000}\n"
+                || elapsed > 0.5 || specification.find("200 OK|keep-alive|[") != 0 || specification.find("\"length\"") == string::npos)
+        {
+            cerr << "client got " << response << large << " after " << elapsed << " s and " << specification << endl;
+            connector.StopListening();
+            return -2;
+        }
+    }
+
+    //Pipelined requests are answered in order, a request arriving byte by byte is parsed as it comes
+    {
+        Connection pipelined(PORT);
+        pipelined.Send(Request(Body(4)) + Request(Body(5)) + Request(Body(6)));
+        string first = pipelined.Receive();
+        string second = pipelined.Receive();
+        string third = pipelined.Receive();
+        Connection trickling(PORT);
+        string request = Request(Body(7));
+        for (size_t i = 0; i < request.size(); i++)
+        {
+            trickling.Send(request.substr(i, 1));
+            usleep(200);
+        }
+        string trickled = trickling.Receive();
+        if (first != Response("keep-alive", 4) || second != Response("keep-alive", 5) || third != Response("close", 6)
+                || !pipelined.IsClosed() || trickled != Response("keep-alive", 7))
+        {
+            cerr << "pipelined requests were answered with " << first << second << third << " and " << trickled << endl;
+            connector.StopListening();
+            return -3;
+        }
+    }
+
+    //HTTP/1.0 clients keep their connection only if they ask for it, others may refuse it
+    {
+        Connection plain(PORT);
+        plain.Send(Request(Body(8), "1.0"));
+        string closed = plain.Receive();
+        Connection asking(PORT);
+        asking.Send(Request(Body(9), "1.0", "Connection: keep-alive\r\n"));
+        string kept = asking.Receive();
+        Connection refusing(PORT);
+        refusing.Send(Request(Body(10), "1.1", "Connection: close\r\n"));
+        string refused = refusing.Receive();
+        if (closed != Response("close", 8) || !plain.IsClosed() || kept != Response("keep-alive", 9)
+                || refused != Response("close", 10) || !refusing.IsClosed())
+        {
+            cerr << "connection headers were " << closed << kept << refused << endl;
+            connector.StopListening();
+            return -4;
+        }
+    }
+
+    //An idle connection is closed after the timeout, even in the middle of a request
+    {
+        Connection idle(PORT);
+        idle.Send(Request(Body(11)));
+        string response = idle.Receive();
+        Connection partial(PORT);
+        partial.Send("POST / HTTP/1.1\r\nContent-Length: 10\r\n");
+        usleep(600000);
+        if (response != Response("keep-alive", 11) || !idle.IsClosed() || !partial.IsClosed())
+        {
+            cerr << "idle connection was not closed" << endl;
+            connector.StopListening();
+            return -5;
+        }
+    }
+
+    //Malformed and unsupported requests are refused and their connection closed
+    {
+        Connection garbage(PORT);
+        garbage.Send("nonsense\r\n\r\n");
+        string bad = garbage.Receive();
+        Connection chunked(PORT);
+        chunked.Send("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n");
+        string unsupported = chunked.Receive();
+        Connection deleting(PORT);
+        deleting.Send("DELETE / HTTP/1.1\r\n\r\n");
+        string notAllowed = deleting.Receive();
+        Connection huge(PORT);
+        huge.Send("POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n");
+        string tooLarge = huge.Receive();
+        if (bad != "400 Bad Request|close|" || !garbage.IsClosed() || unsupported != "501 Not Implemented|close|"
+                || notAllowed != "405 Method Not Allowed|close|" || tooLarge != "413 Payload Too Large|close|")
+        {
+            cerr << "bad requests were answered with " << bad << unsupported << notAllowed << tooLarge << endl;
+            connector.StopListening();
+            return -6;
+        }
+    }
+
+    connector.StopListening();
+
+    //Many connections are open at once without a thread each
+    connector.SetKeepAlive(true);
+    connector.StartListening();
+    {
+        vector<Connection*> connections;
+        for (int i = 0; i < CONCURRENT_CONNECTIONS; i++)
+        {
+            connections.push_back(new Connection(PORT));
+            connections.back()->Send(Request(Body(i)));
+        }
+        int answered = 0;
+        for (int i = 0; i < CONCURRENT_CONNECTIONS; i++)
+        {
+            if (connections[i]->Receive() == Response("keep-alive", i))
+            {
+                answered++;
+            }
+        }
+        unsigned int open = connector.GetConnectionCount();
+        for (int i = 0; i < CONCURRENT_CONNECTIONS; i++)
+        {
+            delete connections[i];
+        }
+        for (int i = 0; i < 100 && connector.GetConnectionCount() > 0; i++)
+        {
+            usleep(10000);
+        }
+        if (answered != CONCURRENT_CONNECTIONS || open != CONCURRENT_CONNECTIONS || connector.GetConnectionCount() != 0)
+        {
+            cerr << answered << " of " << CONCURRENT_CONNECTIONS << " connections answered, " << open << " open" << endl;
+            connector.StopListening();
+            return -7;
+        }
+    }
+
+    //Stopping closes idle connections right away
+    Connection idle(PORT);
+    idle.Send(Request(Body(12)));
+    idle.Receive();
+    time_t stopping = time(NULL);
+    connector.StopListening();
+    if (time(NULL) - stopping > 1 || !idle.IsClosed())
+    {
+        cerr << "stopping waited for an idle connection" << endl;
+        return -8;
+    }
+
+    //Notifications are acknowledged before they run
+    connector.SetNotificationExecutor(1, 100);
+    connector.StartListening();
+    {
+        Connection connection(PORT);
+        connection.Send(Request("{\"jsonrpc\":\"2.0\",\"method\":\"log\",\"params\":{\"value\":1}}"));
+        string acknowledged = connection.Receive();
+        connector.StopListening();
+        if (acknowledged != "204 No Content|keep-alive|" || handler.logged != 1)
+        {
+            cerr << "notification was answered with " << acknowledged << endl;
+            return -9;
+        }
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    gatehandler.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "gatehandler.h"
+
+using namespace std;
+using namespace jsonrpc;
+
+GateHandler::GateHandler(const string& gated, ThreadPool* pool) :
+    open(false),
+    entered(0),
+    outsidePool(0),
+    gated(gated),
+    pool(pool)
+{
+    pthread_mutex_init(&this->mutex, NULL);
+    pthread_cond_init(&this->opened, NULL);
+}
+
+GateHandler::~GateHandler()
+{
+    pthread_cond_destroy(&this->opened);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void GateHandler::handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+{
+    if (this->gated.empty() || proc->GetProcedureName() == this->gated)
+    {
+        if (this->pool != NULL && !this->pool->IsWorkerThread())
+        {
+            __sync_add_and_fetch(&this->outsidePool, 1);
+        }
+        __sync_add_and_fetch(&this->entered, 1);
+        pthread_mutex_lock(&this->mutex);
+        while (!this->open)
+        {
+            pthread_cond_wait(&this->opened, &this->mutex);
+        }
+        pthread_mutex_unlock(&this->mutex);
+    }
+    this->Answer(proc, input, output);
+}
+
+void GateHandler::handleNotificationCall(Procedure* proc, const Json::Value& input)
+{
+}
+
+void GateHandler::Answer(Procedure* proc, const Json::Value& input, Json::Value& output)
+{
+    output = input["value"];
+}
+
+void GateHandler::SetOpen(bool open)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->open = open;
+    pthread_cond_broadcast(&this->opened);
+    pthread_mutex_unlock(&this->mutex);
+}
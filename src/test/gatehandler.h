@@ -0,0 +1,52 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    gatehandler.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef GATEHANDLER_H
+#define GATEHANDLER_H
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/threadpool.h>
+#include <pthread.h>
+#include <string>
+
+/**
+ * @brief Holds its calls until the gate is opened, then answers them with Answer().
+ */
+class GateHandler : public jsonrpc::AbstractRequestHandler
+{
+    public:
+        /**
+         * @param gated the only procedure whose calls are held, all of them if empty.
+         * @param pool if given, the held calls that do not run on one of its workers are counted in outsidePool.
+         */
+        GateHandler(const std::string& gated = "", jsonrpc::ThreadPool* pool = NULL);
+        virtual ~GateHandler();
+
+        virtual void handleMethodCall(jsonrpc::Procedure* proc, const Json::Value& input, Json::Value& output);
+        virtual void handleNotificationCall(jsonrpc::Procedure* proc, const Json::Value& input);
+
+        /**
+         * @brief Answers a call once it passed the gate, with its "value" parameter by default.
+         */
+        virtual void Answer(jsonrpc::Procedure* proc, const Json::Value& input, Json::Value& output);
+
+        void SetOpen(bool open);
+
+        bool open;
+        volatile int entered;
+        volatile int outsidePool;
+
+    private:
+        std::string gated;
+        jsonrpc::ThreadPool* pool;
+        pthread_mutex_t mutex;
+        pthread_cond_t opened;
+};
+
+#endif // GATEHANDLER_H
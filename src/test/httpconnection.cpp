@@ -0,0 +1,137 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    httpconnection.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include "httpconnection.h"
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace std;
+using namespace jsonrpc;
+
+AddHandler::AddHandler() :
+    logged(0)
+{
+}
+
+void AddHandler::handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+{
+    if (proc->GetProcedureName() == "length")
+    {
+        output = (int) input["text"].asString().size();
+    }
+    else
+    {
+        output = input["value"].asInt() + 1;
+    }
+}
+
+void AddHandler::handleNotificationCall(Procedure* proc, const Json::Value& input)
+{
+    __sync_add_and_fetch(&this->logged, 1);
+}
+
+Connection::Connection(int port)
+{
+    this->sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    this->connected = connect(this->sock, (struct sockaddr*) &address, sizeof(address)) == 0;
+}
+
+Connection::~Connection()
+{
+    close(this->sock);
+}
+
+void Connection::Send(const string& data)
+{
+    send(this->sock, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+string Connection::Receive()
+{
+    size_t headerEnd;
+    while ((headerEnd = this->buffer.find("\r\n\r\n")) == string::npos)
+    {
+        if (!this->Read())
+        {
+            return "";
+        }
+    }
+    string header = this->buffer.substr(0, headerEnd);
+    size_t length = 0;
+    size_t position = header.find("Content-Length: ");
+    if (position != string::npos)
+    {
+        length = atoi(header.c_str() + position + 16);
+    }
+    while (this->buffer.size() < headerEnd + 4 + length)
+    {
+        if (!this->Read())
+        {
+            return "";
+        }
+    }
+    string connection;
+    position = header.find("Connection: ");
+    if (position != string::npos)
+    {
+        connection = header.substr(position + 12, header.find("\r\n", position) - position - 12);
+    }
+    string body = this->buffer.substr(headerEnd + 4, length);
+    this->buffer.erase(0, headerEnd + 4 + length);
+    return header.substr(9, header.find("\r\n") - 9) + "|" + connection + "|" + body;
+}
+
+bool Connection::IsClosed()
+{
+    return this->buffer.empty() && !this->Read();
+}
+
+bool Connection::Read()
+{
+    char data[4096];
+    ssize_t received = recv(this->sock, data, sizeof(data), 0);
+    if (received <= 0)
+    {
+        return false;
+    }
+    this->buffer.append(data, received);
+    return true;
+}
+
+string Body(int value)
+{
+    stringstream body;
+    body << "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value\":" << value << "},\"id\":" << value << "}";
+    return body.str();
+}
+
+string Request(const string& body, const string& version, const string& headers)
+{
+    stringstream request;
+    request << "POST / HTTP/" << version << "\r\nHost: localhost\r\nContent-Type: application/json\r\n" << headers
+            << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    return request.str();
+}
+
+string Response(const string& connection, int value)
+{
+    stringstream response;
+    response << "200 OK|" << connection << "|{\"id\":" << value << ",\"jsonrpc\":\"2.0\",\"result\":" << value + 1 << "}\n";
+    return response.str();
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    httpconnection.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include <jsonrpc/rpc.h>
+#include <string>
+
+/**
+ * @brief Answers "add" with its value plus one and "length" with the length of its text, counts the notifications.
+ */
+class AddHandler : public jsonrpc::AbstractRequestHandler
+{
+    public:
+        AddHandler();
+
+        virtual void handleMethodCall(jsonrpc::Procedure* proc, const Json::Value& input, Json::Value& output);
+        virtual void handleNotificationCall(jsonrpc::Procedure* proc, const Json::Value& input);
+
+        volatile int logged;
+};
+
+/**
+ * @brief A raw client connection that reads the responses one by one.
+ */
+class Connection
+{
+    public:
+        Connection(int port);
+        ~Connection();
+
+        void Send(const std::string& data);
+
+        /**
+         * @return the status line, the Connection header and the body of the next response, empty if the connection was closed.
+         */
+        std::string Receive();
+
+        /**
+         * @return true if the server closed the connection.
+         */
+        bool IsClosed();
+
+        bool connected;
+
+    private:
+        bool Read();
+
+        int sock;
+        std::string buffer;
+};
+
+/**
+ * @return an "add" call of value with value as its id.
+ */
+std::string Body(int value);
+
+/**
+ * @return a POST request carrying body.
+ */
+std::string Request(const std::string& body, const std::string& version = "1.1", const std::string& headers = "");
+
+/**
+ * @return what Connection::Receive() returns for the answer to Body(value).
+ */
+std::string Response(const std::string& connection, int value);
+
+#endif // HTTPCONNECTION_H
@@ -0,0 +1,165 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    httpkeepalive.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <ctime>
+#include <unistd.h>
+#include "httpconnection.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define PORT 8385
+
+int main(int argc, char** argv)
+{
+    AddHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL));
+
+    HttpServer connector(PORT);
+    connector.SetHandler(server);
+    connector.SetKeepAlive(true, 300, 3);
+    if (!connector.StartListening())
+    {
+        cerr << "could not listen on port " << PORT << endl;
+        return -1;
+    }
+
+    //Consecutive requests share one connection until the limit closes it
+    {
+        Connection connection(PORT);
+        string responses[3];
+        for (int i = 0; i < 3; i++)
+        {
+            connection.Send(Request(Body(i)));
+            responses[i] = connection.Receive();
+        }
+        if (!connection.connected || responses[0] != Response("keep-alive", 0) || responses[1] != Response("keep-alive", 1)
+                || responses[2] != Response("close", 2) || !connection.IsClosed())
+        {
+            cerr << "consecutive requests were answered with " << responses[0] << responses[1] << responses[2] << endl;
+            connector.StopListening();
+            return -2;
+        }
+    }
+
+    //Pipelined requests are answered in order
+    {
+        Connection connection(PORT);
+        connection.Send(Request(Body(4)) + Request(Body(5)) + Request(Body(6)));
+        string first = connection.Receive();
+        string second = connection.Receive();
+        string third = connection.Receive();
+        if (first != Response("keep-alive", 4) || second != Response("keep-alive", 5) || third != Response("close", 6))
+        {
+            cerr << "pipelined requests were answered with " << first << second << third << endl;
+            connector.StopListening();
+            return -3;
+        }
+    }
+
+    //An idle connection is closed after the timeout
+    {
+        Connection connection(PORT);
+        connection.Send(Request(Body(7)));
+        string response = connection.Receive();
+        usleep(600000);
+        if (response != Response("keep-alive", 7) || !connection.IsClosed())
+        {
+            cerr << "idle connection was not closed" << endl;
+            connector.StopListening();
+            return -4;
+        }
+    }
+
+    //HTTP/1.0 clients keep their connection only if they ask for it, others may refuse it
+    {
+        Connection plain(PORT);
+        plain.Send(Request(Body(8), "1.0"));
+        string closed = plain.Receive();
+        Connection asking(PORT);
+        asking.Send(Request(Body(9), "1.0", "Connection: keep-alive\r\n"));
+        string kept = asking.Receive();
+        Connection refusing(PORT);
+        refusing.Send(Request(Body(10), "1.1", "Connection: close\r\n"));
+        string refused = refusing.Receive();
+        if (closed != Response("close", 8) || !plain.IsClosed() || kept != Response("keep-alive", 9)
+                || refused != Response("close", 10) || !refusing.IsClosed())
+        {
+            cerr << "connection headers were " << closed << kept << refused << endl;
+            connector.StopListening();
+            return -5;
+        }
+    }
+
+    //A body that is not read completely is not taken for the next request, the connection is closed instead
+    {
+        Connection unparsable(PORT);
+        unparsable.Send("POST / HTTP/1.1\r\nContent-Length: abc\r\n\r\n" + Request(Body(13)));
+        string malformed = unparsable.Receive();
+        Connection negative(PORT);
+        negative.Send("POST / HTTP/1.1\r\nContent-Length: -5\r\n\r\n" + Request(Body(14)));
+        string belowZero = negative.Receive();
+        Connection overflowing(PORT);
+        overflowing.Send("POST / HTTP/1.1\r\nContent-Length: 4294967297\r\n\r\nx");
+        string tooLarge = overflowing.Receive();
+        overflowing.Send(Request(Body(15)));
+        Connection getting(PORT);
+        getting.Send("GET / HTTP/1.1\r\nContent-Length: 100000\r\n\r\n");
+        string specification = getting.Receive();
+        getting.Send(Request(Body(16)));
+        if (malformed.find("200 OK|close|{\"error\"") != 0 || !unparsable.IsClosed()
+                || belowZero.find("200 OK|close|{\"error\"") != 0 || !negative.IsClosed()
+                || tooLarge.find("200 OK|close|{\"error\"") != 0 || !overflowing.IsClosed()
+                || specification.find("200 OK|close|[") != 0 || !getting.IsClosed())
+        {
+            cerr << "requests with unread bodies were answered with " << malformed << belowZero << tooLarge << specification << endl;
+            connector.StopListening();
+            return -6;
+        }
+    }
+
+    connector.StopListening();
+
+    //Stopping does not wait for idle connections
+    connector.SetKeepAlive(true, 10000);
+    connector.StartListening();
+    Connection idle(PORT);
+    idle.Send(Request(Body(11)));
+    idle.Receive();
+    time_t stopping = time(NULL);
+    connector.StopListening();
+    if (time(NULL) - stopping > 2)
+    {
+        cerr << "stopping waited for an idle connection" << endl;
+        return -7;
+    }
+
+    //Without keep alive every connection is closed after its response
+    connector.SetKeepAlive(false);
+    connector.StartListening();
+    {
+        Connection connection(PORT);
+        connection.Send(Request(Body(12)));
+        string response = connection.Receive();
+        if (response != Response("close", 12) || !connection.IsClosed())
+        {
+            cerr << "connection without keep alive was answered with " << response << endl;
+            connector.StopListening();
+            return -8;
+        }
+    }
+    connector.StopListening();
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -70,6 +70,15 @@ int main(int argc, char** argv)
         return -4;
     }
 
+    //A response larger than one chunk is sent with chunked transfer encoding.
+    v.clear();
+    v["name"] = string(100000, 'x');
+    Json::Value result = client->CallMethod("sayHello", v);
+    if (result.asString() != "Hello: " + v["name"].asString() + "!")
+    {
+        cerr << "Large response was not received completely: " << result.asString().size() << " bytes" << endl;
+        return -5;
+    }
 
     delete server;
     delete client;
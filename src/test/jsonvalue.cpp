@@ -0,0 +1,453 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    jsonvalue.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/json/json.h>
+#include <iostream>
+#include <cstdio>
+#include "testutils.h"
+
+using namespace std;
+
+/**
+ * @brief Collects the chunks handed out by FastWriter::write( const Value &, OutputSink & ).
+ */
+class ChunkCollector : public Json::OutputSink
+{
+    public:
+        ChunkCollector() : chunks(0), largestChunk(0) {}
+
+        virtual void write(const char* data, size_t length)
+        {
+            this->document.append(data, length);
+            this->chunks++;
+            this->largestChunk = length > this->largestChunk ? length : this->largestChunk;
+        }
+
+        string document;
+        size_t chunks;
+        size_t largestChunk;
+};
+
+int main(int argc, char** argv)
+{
+    //Arrays
+    Json::Value array;
+    for (int i = 0; i < 1000; i++)
+    {
+        array.append(i);
+    }
+    if (!array.isArray() || array.size() != 1000 || array[999u].asInt() != 999)
+    {
+        cerr << "append did not produce the expected array" << endl;
+        return -1;
+    }
+
+    array[1499u] = "last";
+    if (array.size() != 1500 || !array[1000u].isNull() || array[1499u].asString() != "last")
+    {
+        cerr << "index access did not grow the array" << endl;
+        return -2;
+    }
+
+    array.resize(10);
+    int index = 0;
+    for (Json::Value::iterator it = array.begin(); it != array.end(); ++it, ++index)
+    {
+        if ((*it).asInt() != index || it.index() != (unsigned int)index || it.key().asInt() != index)
+        {
+            cerr << "array iteration returned element " << (*it).asInt() << " at position " << index << endl;
+            return -3;
+        }
+    }
+    if (index != 10)
+    {
+        cerr << "array iteration visited " << index << " elements instead of 10" << endl;
+        return -4;
+    }
+
+    Json::Value reserved;
+    reserved.reserve(100);
+    if (!reserved.isArray() || reserved.size() != 0)
+    {
+        cerr << "reserve changed the size of the array" << endl;
+        return -5;
+    }
+
+    Json::Value nested;
+    nested["list"].append("first");
+    nested["list"][0u].setComment("// first element", Json::commentBefore);
+    for (int i = 1; i < 100; i++)
+    {
+        nested["list"].append(i);
+    }
+    if (nested["list"][0u].asString() != "first" || !nested["list"][0u].hasComment(Json::commentBefore))
+    {
+        cerr << "growing the array lost an element or its comment" << endl;
+        return -6;
+    }
+
+    Json::Value copy = array;
+    if (copy != array || !(array < nested["list"]))
+    {
+        cerr << "array comparison failed" << endl;
+        return -7;
+    }
+
+    Json::Reader reader;
+    Json::FastWriter writer;
+    Json::Value parsed;
+    if (!reader.parse("[1,[2,3],{\"a\":[]},\"x\"]", parsed) || writer.write(parsed) != "[1,[2,3],{\"a\":[]},\"x\"]\n")
+    {
+        cerr << "array round trip failed: " << writer.write(parsed) << endl;
+        return -8;
+    }
+
+    //Objects
+    Json::Value object;
+    object["zeta"] = 1;
+    object["alpha"] = 2;
+    object["mu"] = 3;
+    Json::Value::Members names = object.getMemberNames();
+    if (names.size() != 3 || names[0] != "alpha" || names[1] != "mu" || names[2] != "zeta")
+    {
+        cerr << "member names are not sorted" << endl;
+        return -9;
+    }
+    if (!object.isMember("mu") || object.isMember("m") || object.isMember("muu") || object["alpha"].asInt() != 2)
+    {
+        cerr << "member look up failed" << endl;
+        return -10;
+    }
+
+    Json::Value& first = object["alpha"];
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[16];
+        sprintf(key, "key%d", (i * 7919) % 1000);
+        object[key] = i;
+    }
+    first = "still valid";
+    if (object.size() != 1003 || object["alpha"].asString() != "still valid")
+    {
+        cerr << "growing the object invalidated a member reference" << endl;
+        return -11;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[16];
+        sprintf(key, "key%d", (i * 7919) % 1000);
+        if (!object.isMember(key) || object[key].asInt() != i)
+        {
+            cerr << "member " << key << " not found in large object" << endl;
+            return -12;
+        }
+    }
+
+    const Json::Value& constObject = object;
+    string previous;
+    index = 0;
+    for (Json::Value::const_iterator it = constObject.begin(); it != constObject.end(); ++it, ++index)
+    {
+        string name = it.memberName();
+        if (index > 0 && !(previous < name))
+        {
+            cerr << "object iteration is not in member name order: " << previous << ", " << name << endl;
+            return -13;
+        }
+        if (it.key().asString() != name || (*it) != constObject[name])
+        {
+            cerr << "object iteration returned a wrong member for " << name << endl;
+            return -14;
+        }
+        previous = name;
+    }
+    if (index != 1003)
+    {
+        cerr << "object iteration visited " << index << " members instead of 1003" << endl;
+        return -15;
+    }
+
+    Json::Value removed = object.removeMember("key500");
+    object["key1000"] = "reused";
+    if (removed.asInt() == 0 || object.isMember("key500") || object.size() != 1003 || object["key1000"].asString() != "reused")
+    {
+        cerr << "removeMember failed" << endl;
+        return -16;
+    }
+
+    Json::Value objectCopy = object;
+    objectCopy["alpha"].setComment("// copied", Json::commentBefore);
+    Json::Value commentCopy = objectCopy;
+    if (objectCopy != object || !commentCopy["alpha"].hasComment(Json::commentBefore))
+    {
+        cerr << "object copy differs from the original" << endl;
+        return -17;
+    }
+    objectCopy["key1"] = -1;
+    if (objectCopy == object || !(objectCopy < object))
+    {
+        cerr << "object comparison failed" << endl;
+        return -18;
+    }
+
+    static const Json::StaticString code("code");
+    Json::Value error;
+    error[code] = -32601;
+    error["message"] = "Method not found";
+    if (error.begin().key().asString() != "code" || error[code].asInt() != -32601)
+    {
+        cerr << "static member name failed" << endl;
+        return -19;
+    }
+
+    object.clear();
+    object["after clear"] = true;
+    if (object.size() != 1 || !object["after clear"].asBool() || object.isMember("alpha"))
+    {
+        cerr << "clear did not empty the object" << endl;
+        return -20;
+    }
+
+    if (!reader.parse("{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"m\",\"params\":{\"b\":null,\"a\":{}}}", parsed)
+        || writer.write(parsed) != "{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"m\",\"params\":{\"a\":{},\"b\":null}}\n")
+    {
+        cerr << "object round trip failed: " << writer.write(parsed) << endl;
+        return -21;
+    }
+
+    //Arena
+    Json::Value escaped;
+    {
+        Json::ValueArena arena;
+        {
+            Json::ValueArenaScope scope(arena);
+            Json::Value request;
+            if (!reader.parse("{\"jsonrpc\":\"2.0\",\"method\":\"echo\",\"params\":{\"list\":[1,2,\"three\"]},\"id\":1}", request))
+            {
+                cerr << "parsing within an arena scope failed" << endl;
+                return -22;
+            }
+            if (arena.usedBytes() == 0 || writer.write(request) != "{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"echo\",\"params\":{\"list\":[1,2,\"three\"]}}\n")
+            {
+                cerr << "arena did not serve the request tree" << endl;
+                return -23;
+            }
+            escaped = request["params"];
+        }
+        arena.reset();
+        Json::ValueArena nestedArena;
+        {
+            Json::ValueArenaScope scope(arena);
+            {
+                Json::ValueArenaScope nestedScope(nestedArena);
+                Json::Value nested("nested");
+            }
+            Json::Value outer("outer");
+        }
+        if (arena.usedBytes() == 0 || nestedArena.usedBytes() == 0)
+        {
+            cerr << "nested arena scopes did not restore the binding" << endl;
+            return -24;
+        }
+        arena.reset();
+        if (arena.usedBytes() != 0)
+        {
+            cerr << "reset did not rewind the arena" << endl;
+            return -25;
+        }
+    }
+    if (escaped["list"][2u].asString() != "three" || escaped["list"].size() != 3)
+    {
+        cerr << "value allocated from an arena did not outlive it" << endl;
+        return -26;
+    }
+
+    //Swap and move
+    Json::Value payload;
+    payload["list"].append("first");
+    payload["list"].append(2);
+    Json::Value envelope;
+    envelope["result"].swap(payload);
+    if (!payload.isNull() || envelope["result"]["list"].size() != 2 || envelope["result"]["list"][0u].asString() != "first")
+    {
+        cerr << "swap did not exchange the payload" << endl;
+        return -27;
+    }
+#ifdef JSON_HAS_RVALUE_REFERENCES
+    Json::Value moved(std::move(envelope["result"]));
+    if (!envelope["result"].isNull() || moved["list"][1u].asInt() != 2)
+    {
+        cerr << "move construction did not steal the payload" << endl;
+        return -28;
+    }
+    Json::Value target("previous");
+    target = std::move(moved);
+    if (!moved.isNull() || target["list"].size() != 2)
+    {
+        cerr << "move assignment did not steal the payload" << endl;
+        return -29;
+    }
+    Json::Value list(Json::arrayValue);
+    Json::Value text("moved into an array");
+    list.append(std::move(text));
+    list[1u] = Json::Value("assigned");
+    if (!text.isNull() || list.size() != 2 || list[0u].asString() != "moved into an array" || list[1u].asString() != "assigned")
+    {
+        cerr << "rvalue append did not move the value" << endl;
+        return -30;
+    }
+#endif
+
+    //Scanning strings and whitespace of every length around the vector widths
+    for (int length = 0; length < 80; length++)
+    {
+        for (int position = 0; position <= length; position++)
+        {
+            string expected(length, 'x');
+            string document = "[" + string(length % 37, ' ') + "\"" + expected + "\"" + string(position, '\n') + "]";
+            if (!reader.parse(document, parsed) || parsed[0u].asString() != expected)
+            {
+                cerr << "failed to scan plain string of length " << length << endl;
+                return -31;
+            }
+            if (position < length)
+            {
+                string escapes[] = {"\\\"", "\\\\", "\\n"};
+                string decoded[] = {"\"", "\\", "\n"};
+                for (int e = 0; e < 3; e++)
+                {
+                    document = "{\"key\":\"" + expected.substr(0, position) + escapes[e] + expected.substr(position) + "\"}";
+                    if (!reader.parse(document, parsed) || parsed["key"].asString() != expected.substr(0, position) + decoded[e] + expected.substr(position))
+                    {
+                        cerr << "failed to scan escape at " << position << " of length " << length << endl;
+                        return -32;
+                    }
+                }
+            }
+        }
+        if (reader.parse("[\"" + string(length, 'x') + "\\", parsed) || reader.parse("[\"" + string(length, 'x'), parsed))
+        {
+            cerr << "accepted unterminated string of length " << length << endl;
+            return -33;
+        }
+    }
+
+    //Numbers
+    if (!reader.parse("[9007199254740993,-9223372036854775808,18446744073709551615,18446744073709551616,2147483648,-7]", parsed)
+            || !parsed[0u].isUInt() || parsed[0u].asUInt64() != 9007199254740993ULL
+            || !parsed[1u].isInt() || parsed[1u].asInt64() != Json::Value::minInt64
+            || !parsed[2u].isUInt() || parsed[2u].asUInt64() != Json::Value::maxUInt64
+            || !parsed[3u].isDouble() || parsed[3u].asDouble() != 18446744073709551616.0
+            || !parsed[4u].isUInt() || parsed[4u].asUInt() != 2147483648u
+            || !parsed[5u].isInt() || parsed[5u].asInt() != -7)
+    {
+        cerr << "64 bit integers were not decoded exactly" << endl;
+        return -34;
+    }
+    if (writer.write(parsed) != "[9007199254740993,-9223372036854775808,18446744073709551615,18446744073709552000.0,2147483648,-7]\n")
+    {
+        cerr << "64 bit integers were not written exactly: " << writer.write(parsed);
+        return -35;
+    }
+    //0.1, the largest double, the smallest normal and subnormal doubles, a halfway case rounding to even,
+    //and more digits than fit into 64 bits
+    if (!reader.parse("[0.1,-1.5e-3,1.7976931348623157e308,2.2250738585072014E-308,4.9e-324,9007199254740993.0,"
+                      "0.10000000000000000555111512312578270211815834045410156250000001,1e400,-0.0]", parsed)
+            || parsed[0u].asDouble() != 0.1 || parsed[1u].asDouble() != -0.0015
+            || parsed[2u].asDouble() != 1.7976931348623157e308 || parsed[3u].asDouble() != 2.2250738585072014e-308
+            || parsed[4u].asDouble() != 4.9e-324 || parsed[5u].asDouble() != 9007199254740992.0
+            || parsed[6u].asDouble() != 0.1 || parsed[7u].asDouble() <= 1.7976931348623157e308
+            || !parsed[8u].isDouble() || parsed[8u].asDouble() != 0.0)
+    {
+        cerr << "doubles were not decoded correctly rounded" << endl;
+        return -36;
+    }
+    const char* malformed[] = {"[-]", "[1e]", "[1.5e+]", "[1.2.3]", "[1-2]", "[--1]"};
+    for (int i = 0; i < 6; i++)
+    {
+        if (reader.parse(malformed[i], parsed))
+        {
+            cerr << "accepted malformed number " << malformed[i] << endl;
+            return -37;
+        }
+    }
+
+    //Escaping every special character at every offset around the vector widths
+    const char specials[] = {'"', '\\', '\b', '\f', '\n', '\r', '\t', '\x01', '\x1f'};
+    const char* escapedSpecials[] = {"\\\"", "\\\\", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u0001", "\\u001F"};
+    for (int length = 1; length < 70; length++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            for (int e = 0; e < 9; e++)
+            {
+                string plain(length, 'a');
+                plain[0] = '\xc3';  //bytes >= 0x80 are written unchanged
+                plain[position] = specials[e];
+                string expected = "\"" + plain.substr(0, position) + escapedSpecials[e] + plain.substr(position + 1) + "\"";
+                if (Json::valueToQuotedString(plain.c_str()) != expected || writer.write(Json::Value(plain)) != expected + "\n")
+                {
+                    cerr << "failed to escape character " << e << " at " << position << " of length " << length << endl;
+                    return -38;
+                }
+            }
+        }
+    }
+
+    //Streaming into a sink yields the same document, one bounded chunk at a time
+    Json::Value large;
+    for (int i = 0; i < 5000; i++)
+    {
+        large[i]["index"] = i;
+        large[i]["label"] = "item \"quoted\"";
+        large[i]["ratio"] = i / 7.0;
+    }
+    ChunkCollector collector;
+    Json::FastWriter chunkedWriter;
+    chunkedWriter.setChunkSize(1024);
+    chunkedWriter.write(large, collector);
+    if (collector.document != Json::FastWriter().write(large) || collector.chunks < 100 || collector.largestChunk > 1024 + 128)
+    {
+        cerr << "chunked output differs: " << collector.chunks << " chunks, largest " << collector.largestChunk << " bytes" << endl;
+        return -39;
+    }
+
+    //Doubles are written with the fewest digits that read back the same, including the values at which the fast
+    //digit generation can not decide by itself
+    double doubles[] = {0.1, 1.0 / 3, 1e21, 1e-7, 5e22, 1e23, 9.71e-298, 4.9e-324, 1.7976931348623157e308, -2.5};
+    const char* written[] = {"0.1", "0.3333333333333333", "1e+21", "1e-7", "5e+22", "1e+23", "9.71e-298", "5e-324",
+                             "1.7976931348623157e+308", "-2.5"};
+    for (int i = 0; i < 10; i++)
+    {
+        if (Json::valueToString(doubles[i]) != written[i])
+        {
+            cerr << "double was written as " << Json::valueToString(doubles[i]) << " instead of " << written[i] << endl;
+            return -40;
+        }
+    }
+
+    //The names of removed members are reclaimed, so a long-lived object that keeps adding and removing members does not grow
+    Json::Value churned(Json::objectValue);
+    churned["kept"] = 1;
+    size_t heapBefore = HeapInUse();
+    for (int i = 0; i < 1000000; i++)
+    {
+        churned[string("transient")] = i;
+        churned.removeMember("transient");
+    }
+    size_t heapAfter = HeapInUse();
+    if (churned.size() != 1 || churned["kept"] != 1 || (heapBefore != 0 && heapAfter > heapBefore + 64 * 1024))
+    {
+        cerr << "add/remove cycles grew the heap from " << heapBefore << " to " << heapAfter << " bytes" << endl;
+        return -41;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
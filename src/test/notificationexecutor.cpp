@@ -0,0 +1,260 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    notificationexecutor.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <jsonrpc/connectors/httpserver.h>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace jsonrpc;
+using namespace std;
+
+#define PORT 8384
+#define HANDLER_DELAY_US 500000
+
+#define NOTIFICATION "{\"jsonrpc\":\"2.0\",\"method\":\"log\",\"params\":{\"value\":1}}"
+#define CALL "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value\":1},\"id\":1}"
+
+/**
+ * @brief Counts the notifications, which wait for the gate to open or take HANDLER_DELAY_US if there is none.
+ */
+class LogHandler : public AbstractRequestHandler
+{
+    public:
+        LogHandler() : open(true), logged(0)
+        {
+            pthread_mutex_init(&this->mutex, NULL);
+            pthread_cond_init(&this->opened, NULL);
+        }
+
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            output = input["value"].asInt() + 1;
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+            pthread_mutex_lock(&this->mutex);
+            while (!this->open)
+            {
+                pthread_cond_wait(&this->opened, &this->mutex);
+            }
+            pthread_mutex_unlock(&this->mutex);
+            if (input["value"].asInt() == 1)
+            {
+                usleep(HANDLER_DELAY_US);
+            }
+            __sync_add_and_fetch(&this->logged, 1);
+        }
+
+        void SetOpen(bool open)
+        {
+            pthread_mutex_lock(&this->mutex);
+            this->open = open;
+            pthread_cond_broadcast(&this->opened);
+            pthread_mutex_unlock(&this->mutex);
+        }
+
+        /**
+         * @brief Waits up to a few seconds until count notifications were handled.
+         */
+        bool WaitForLogged(int count)
+        {
+            for (int i = 0; i < 500 && __sync_add_and_fetch(&this->logged, 0) < count; i++)
+            {
+                usleep(10000);
+            }
+            return __sync_add_and_fetch(&this->logged, 0) == count;
+        }
+
+        bool open;
+        volatile int logged;
+
+    private:
+        pthread_mutex_t mutex;
+        pthread_cond_t opened;
+};
+
+struct Submitter
+{
+    RpcProtocolServer* server;
+    ThreadPool* pool;
+    volatile int done;
+};
+
+static void* SubmitBlocking(void* data)
+{
+    Submitter* submitter = (Submitter*) data;
+    string request = "{\"jsonrpc\":\"2.0\",\"method\":\"log\",\"params\":{\"value\":0}}";
+    submitter->server->HandleNotifications(request.data(), request.size(), *submitter->pool, OVERFLOW_BLOCK);
+    __sync_lock_test_and_set(&submitter->done, 1);
+    return NULL;
+}
+
+static double Now()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+/**
+ * @return the status line and the body of the response to a POST of body, empty if it failed.
+ */
+static string Post(const string& body)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(sock, (struct sockaddr*) &address, sizeof(address)) != 0)
+    {
+        close(sock);
+        return "";
+    }
+    stringstream request;
+    request << "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: "
+            << body.size() << "\r\nConnection: close\r\n\r\n" << body;
+    string data = request.str();
+    send(sock, data.data(), data.size(), 0);
+    string response;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, received);
+    }
+    close(sock);
+    size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == string::npos)
+    {
+        return "";
+    }
+    return response.substr(0, response.find("\r\n")) + "|" + response.substr(headerEnd + 4);
+}
+
+int main(int argc, char** argv)
+{
+    LogHandler handler;
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("log", PARAMS_BY_NAME, "value", JSON_INTEGER, NULL));
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL));
+
+    //Only requests consisting of notifications are taken
+    {
+        ThreadPool pool(1);
+        string call = CALL;
+        string mixed = "[" NOTIFICATION "," CALL "]";
+        string escaped = "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"value\":1},\"\\u0069d\":1}";
+        string notification = NOTIFICATION;
+        string batch = "[" NOTIFICATION "," NOTIFICATION "]";
+        if (server.HandleNotifications(call.data(), call.size(), pool, OVERFLOW_DROP)
+                || server.HandleNotifications(mixed.data(), mixed.size(), pool, OVERFLOW_DROP)
+                || server.HandleNotifications(escaped.data(), escaped.size(), pool, OVERFLOW_DROP)
+                || server.HandleNotifications("[]", 2, pool, OVERFLOW_DROP)
+                || server.HandleNotifications("{", 1, pool, OVERFLOW_DROP))
+        {
+            cerr << "a request needing a response was taken as notifications" << endl;
+            return -1;
+        }
+        if (!server.HandleNotifications(notification.data(), notification.size(), pool, OVERFLOW_DROP)
+                || !server.HandleNotifications(batch.data(), batch.size(), pool, OVERFLOW_DROP))
+        {
+            cerr << "notifications were not taken" << endl;
+            return -2;
+        }
+        if (!handler.WaitForLogged(3))
+        {
+            cerr << "pool ran " << handler.logged << " notifications instead of 3" << endl;
+            return -3;
+        }
+    }
+
+    //A full queue drops the notifications or blocks the caller until there is room
+    {
+        handler.logged = 0;
+        handler.SetOpen(false);
+        ThreadPool pool(1, 1);
+        string notification = "{\"jsonrpc\":\"2.0\",\"method\":\"log\",\"params\":{\"value\":0}}";
+        server.HandleNotifications(notification.data(), notification.size(), pool, OVERFLOW_DROP);
+        while (pool.GetQueuedCount() > 0)
+        {
+            usleep(1000);
+        }
+        server.HandleNotifications(notification.data(), notification.size(), pool, OVERFLOW_DROP);
+        server.HandleNotifications(notification.data(), notification.size(), pool, OVERFLOW_DROP);
+        if (server.GetDroppedNotifications() != 1)
+        {
+            cerr << "dropped " << server.GetDroppedNotifications() << " requests instead of 1" << endl;
+            return -4;
+        }
+
+        Submitter submitter = {&server, &pool, 0};
+        pthread_t thread;
+        pthread_create(&thread, NULL, SubmitBlocking, &submitter);
+        usleep(100000);
+        bool blocked = __sync_add_and_fetch(&submitter.done, 0) == 0;
+        handler.SetOpen(true);
+        pthread_join(thread, NULL);
+        if (!blocked || !handler.WaitForLogged(3) || server.GetDroppedNotifications() != 1)
+        {
+            cerr << "blocking submitter " << (blocked ? "lost its notification" : "did not wait") << endl;
+            return -5;
+        }
+    }
+
+    //HttpServer acknowledges notifications before their handlers ran and still answers calls
+    handler.logged = 0;
+    HttpServer connector(PORT);
+    connector.SetHandler(server);
+    connector.SetNotificationExecutor(2, 100);
+    if (!connector.StartListening())
+    {
+        cerr << "could not listen on port " << PORT << endl;
+        return -6;
+    }
+    double started = Now();
+    string acknowledged = Post(NOTIFICATION);
+    double elapsed = Now() - started;
+    string answered = Post(CALL);
+    if (acknowledged != "HTTP/1.1 204 No Content|" || elapsed * 1000000 >= HANDLER_DELAY_US / 2)
+    {
+        cerr << "notification was answered with " << acknowledged << " after " << elapsed << " s" << endl;
+        connector.StopListening();
+        return -7;
+    }
+    if (answered != "HTTP/1.1 200 OK|{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":2}\n")
+    {
+        cerr << "call was answered with " << answered << endl;
+        connector.StopListening();
+        return -8;
+    }
+
+    //Stopping runs the acknowledged notifications that are still queued
+    Post(NOTIFICATION);
+    connector.StopListening();
+    if (handler.logged != 2)
+    {
+        cerr << "ran " << handler.logged << " acknowledged notifications instead of 2" << endl;
+        return -9;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
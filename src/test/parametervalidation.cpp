@@ -8,11 +8,20 @@
  ************************************************************************/
 
 #include <jsonrpc/procedure.h>
+#include <jsonrpc/specificationparser.h>
+#include <jsonrpc/exception.h>
 #include <iostream>
 
 using namespace jsonrpc;
 using namespace std;
 
+static Json::Value Parse(const string& document)
+{
+    Json::Value value;
+    Json::Reader().parse(document, value);
+    return value;
+}
+
 int main() {
 
     Procedure proc1("someprocedure", PARAMS_BY_NAME, JSON_BOOLEAN, "name", JSON_STRING, "ssnr", JSON_INTEGER, NULL);
@@ -50,5 +59,83 @@ int main() {
         return -3;
     }
 
+    //Nested schemas check members, elements and ranges
+    Procedure proc2("order", PARAMS_BY_NAME, JSON_BOOLEAN, "customer", JSON_OBJECT, "items", JSON_ARRAY, "note", JSON_STRING, NULL);
+    proc2.SetParameterSchema("customer", Parse("{\"properties\":{\"id\":{\"type\":\"integer\",\"minimum\":1},"
+                                               "\"email\":{\"type\":\"string\",\"minLength\":3}},\"required\":[\"id\"]}"));
+    proc2.SetParameterSchema("items", Parse("{\"minItems\":1,\"maxItems\":3,\"items\":{\"type\":\"object\",\"required\":[\"sku\",\"count\"],"
+                                            "\"properties\":{\"count\":{\"type\":\"integer\",\"minimum\":1,\"maximum\":99}}}}"));
+    proc2.SetParameterSchema("note", Parse("{\"maxLength\":2}"));
+
+    const char* valid[] = {
+        "{\"customer\":{\"id\":7},\"items\":[{\"sku\":\"a\",\"count\":1}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7,\"email\":\"a@b\"},\"items\":[{\"sku\":1,\"count\":99},{\"sku\":2,\"count\":5}],\"note\":\"\u00e4\u00f6\"}"
+    };
+    const char* invalid[] = {
+        "{\"customer\":{},\"items\":[{\"sku\":\"a\",\"count\":1}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":0},\"items\":[{\"sku\":\"a\",\"count\":1}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7,\"email\":\"a\"},\"items\":[{\"sku\":\"a\",\"count\":1}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7},\"items\":[],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7},\"items\":[{\"sku\":\"a\",\"count\":100}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7},\"items\":[{\"count\":1}],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7},\"items\":[{\"sku\":\"a\",\"count\":1},1],\"note\":\"\"}",
+        "{\"customer\":{\"id\":7},\"items\":[{\"sku\":\"a\",\"count\":1}],\"note\":\"abc\"}",
+        "{\"customer\":{\"id\":7},\"items\":[{\"sku\":\"a\",\"count\":1}]}"
+    };
+    for (unsigned int i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+    {
+        if (!proc2.ValdiateParameters(Parse(valid[i])))
+        {
+            cerr << "Validation rejected " << valid[i] << endl;
+            return -4;
+        }
+    }
+    for (unsigned int i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        if (proc2.ValdiateParameters(Parse(invalid[i])))
+        {
+            cerr << "Validation accepted " << invalid[i] << endl;
+            return -5;
+        }
+    }
+
+    //Malformed schemas and schemas of undeclared parameters are rejected
+    const char* malformed[] = {"{\"type\":\"decimal\"}", "{\"minimum\":\"1\"}", "{\"required\":\"id\"}", "{\"items\":1}"};
+    for (unsigned int i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        try
+        {
+            proc2.SetParameterSchema("customer", Parse(malformed[i]));
+            cerr << "Malformed schema accepted " << malformed[i] << endl;
+            return -6;
+        }
+        catch (const JsonRpcException&)
+        {
+        }
+    }
+    try
+    {
+        proc2.SetParameterSchema("unknown", Parse("{}"));
+        cerr << "Schema of an undeclared parameter accepted" << endl;
+        return -7;
+    }
+    catch (const JsonRpcException&)
+    {
+    }
+
+    //Positional parameters get their schemas from the specification
+    procedurelist_t* procedures = SpecificationParser::GetProceduresFromString(
+                "[{\"method\":\"range\",\"params\":[1,[]],\"returns\":1,\"schemas\":{\"param2\":{\"items\":{\"type\":\"number\",\"maximum\":1.5}}}}]");
+    Procedure* proc3 = (*procedures)["range"];
+    bool positional = proc3->ValdiateParameters(Parse("[1,[1,0.5]]")) && !proc3->ValdiateParameters(Parse("[1,[1,2]]"))
+            && !proc3->ValdiateParameters(Parse("[1,[1],2]")) && proc3->GetParameterSchemas().size() == 1;
+    delete proc3;
+    delete procedures;
+    if (!positional)
+    {
+        cerr << "Positional schema was not applied" << endl;
+        return -8;
+    }
+
     return 0;
 }
@@ -0,0 +1,172 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    procedurestats.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <pthread.h>
+
+using namespace jsonrpc;
+using namespace std;
+
+#define THREADS 80
+#define CALLS_PER_THREAD 200
+
+#define SPECIFICATION "[{\"method\":\"add\",\"params\":{\"a\":1,\"b\":1},\"returns\":1}]"
+
+/**
+ * @brief Adds a and b, fails for negative a.
+ */
+class AddHandler : public AbstractRequestHandler
+{
+    public:
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            if (input["a"].asInt() < 0)
+            {
+                throw JsonRpcException(-32099, "negative");
+            }
+            output = input["a"].asInt() + input["b"].asInt();
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+};
+
+static size_t bytesIn = 0;
+static size_t bytesOut = 0;
+
+static Json::Value Call(RpcProtocolServer& server, const string& request)
+{
+    string response;
+    server.HandleRequest(request, response);
+    bytesIn += request.size();
+    bytesOut += response.size();
+    Json::Value result;
+    Json::Reader().parse(response, result);
+    return result;
+}
+
+static string Add(int a, const string& b)
+{
+    stringstream request;
+    request << "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":{\"a\":" << a << ",\"b\":" << b << "},\"id\":1}";
+    return request.str();
+}
+
+static void* CallMany(void* data)
+{
+    RpcProtocolServer* server = (RpcProtocolServer*) data;
+    string response;
+    for (int i = 0; i < CALLS_PER_THREAD; i++)
+    {
+        server->HandleRequest(Add(i, "1"), response);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    //Every bucket limit falls into its own bucket and is at most 12.5% above the smallest value of the bucket
+    for (unsigned int i = 1; i < LatencyHistogram::BUCKETS; i++)
+    {
+        unsigned long long lower = LatencyHistogram::GetBucketLimit(i - 1) + 1;
+        unsigned long long upper = LatencyHistogram::GetBucketLimit(i);
+        if (LatencyHistogram::GetBucket(lower) != i || LatencyHistogram::GetBucket(upper) != i || (upper - lower) * 8 > lower)
+        {
+            cerr << "bucket " << i << " covers " << lower << " to " << upper << endl;
+            return -1;
+        }
+    }
+
+    //Nothing is recorded unless the stats are enabled
+    AddHandler handler;
+    RpcProtocolServer server(&handler, SpecificationParser::GetProceduresFromString(SPECIFICATION));
+    Procedure* add = server.GetProcedures()["add"];
+    Call(server, Add(1, "2"));
+    StatsSnapshot snapshot;
+    add->GetStats().GetSnapshot(snapshot);
+    if (snapshot.calls != 0 || Call(server, "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.stats\",\"params\":{},\"id\":1}")
+            ["error"]["code"].asInt() != Errors::ERROR_RPC_METHOD_NOT_FOUND)
+    {
+        cerr << "stats were recorded while disabled" << endl;
+        return -2;
+    }
+
+    //Calls, errors by code, bytes and every phase are counted
+    server.SetStatsEnabled(true);
+    bytesIn = bytesOut = 0;
+    Call(server, Add(1, "2"));
+    Call(server, Add(2, "2"));
+    Call(server, Add(-1, "2"));
+    Call(server, Add(3, "\"x\""));
+    add->GetStats().GetSnapshot(snapshot);
+    if (snapshot.calls != 4 || snapshot.errors.size() != 2 || snapshot.errors[-32099] != 1
+            || snapshot.errors[Errors::ERROR_RPC_INVALID_PARAMS] != 1)
+    {
+        cerr << "recorded " << snapshot.ToJson().toStyledString() << endl;
+        return -3;
+    }
+    if (snapshot.bytesIn != bytesIn || snapshot.bytesOut != bytesOut)
+    {
+        cerr << "recorded " << snapshot.bytesIn << " and " << snapshot.bytesOut << " bytes instead of "
+             << bytesIn << " and " << bytesOut << endl;
+        return -4;
+    }
+    for (int phase = 0; phase < STATS_PHASES; phase++)
+    {
+        if (snapshot.phases[phase].GetCount() != 4 || snapshot.phases[phase].GetPercentile(50) > snapshot.phases[phase].GetMax())
+        {
+            cerr << "phase " << phase << " was recorded " << snapshot.phases[phase].GetCount() << " times" << endl;
+            return -5;
+        }
+    }
+
+    //The calls of a batch share the bytes of the request
+    string batch = "[" + Add(1, "1") + "," + Add(2, "2") + "]";
+    Call(server, batch);
+    add->GetStats().GetSnapshot(snapshot);
+    if (snapshot.calls != 6 || snapshot.bytesIn != bytesIn - batch.size() % 2 || snapshot.phases[STATS_PARSE].GetCount() != 6)
+    {
+        cerr << "batch was recorded as " << snapshot.ToJson().toStyledString() << endl;
+        return -6;
+    }
+
+    //Concurrent threads, more than there are slots, lose no call
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, CallMany, &server);
+    }
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    add->GetStats().GetSnapshot(snapshot);
+    if (snapshot.calls != 6 + THREADS * CALLS_PER_THREAD || snapshot.phases[STATS_DISPATCH].GetCount() != snapshot.calls)
+    {
+        cerr << "recorded " << snapshot.calls << " concurrent calls" << endl;
+        return -7;
+    }
+
+    //The stats method reports every procedure
+    server.SetStatsEnabled(true, true);
+    Json::Value stats = Call(server, "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.stats\",\"params\":{},\"id\":1}");
+    if (stats["result"]["add"]["calls"].asUInt64() != snapshot.calls || stats["result"]["add"]["errors"]["-32099"].asInt() != 1
+            || !stats["result"]["add"]["latency"]["dispatch"]["p99"].isDouble())
+    {
+        cerr << "stats method returned " << stats.toStyledString() << endl;
+        return -8;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
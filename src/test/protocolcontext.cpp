@@ -0,0 +1,264 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    protocolcontext.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <jsonrpc/rpcprotocolclient.h>
+#include <iostream>
+#include <sstream>
+#include <pthread.h>
+#include "testutils.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define THREADS 8
+#define REQUESTS_PER_THREAD 2000
+#define RETAINED_REQUESTS 10000
+
+/**
+ * @brief Answers "add" directly and "forward" by handling an "add" request on an inner server,
+ * so that two requests are in flight on the same thread.
+ */
+class ContextHandler : public AbstractRequestHandler
+{
+    public:
+        ContextHandler(RpcProtocolServer* inner) : inner(inner) {}
+
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            if (proc->GetProcedureName() == "add")
+            {
+                output = input["value1"].asInt() + input["value2"].asInt();
+            }
+            else
+            {
+                RpcProtocolClient client;
+                string request, response;
+                client.BuildRequest("add", input, request, false);
+                this->inner->HandleRequest(request, response);
+                output = client.HandleResponse(response);
+            }
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+
+    private:
+        RpcProtocolServer* inner;
+};
+
+/**
+ * @brief Keeps a parameter of every call, like a handler filling a cache or a session store.
+ */
+class RetainingHandler : public AbstractRequestHandler
+{
+    public:
+        RetainingHandler() : kept(Json::arrayValue) {}
+
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            this->kept.append(input["text"]);
+            output = (int) this->kept.size();
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+
+        Json::Value kept;
+};
+
+static void AddProcedures(RpcProtocolServer& server)
+{
+    server.AddProcedure(new Procedure("add", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+    server.AddProcedure(new Procedure("forward", PARAMS_BY_NAME, JSON_INTEGER, "value1", JSON_INTEGER, "value2", JSON_INTEGER, NULL));
+}
+
+static string AddRequest(const string& method, int value1, int value2)
+{
+    stringstream request;
+    request << "{\"jsonrpc\":\"2.0\",\"method\":\"" << method << "\",\"params\":{\"value1\":" << value1
+            << ",\"value2\":" << value2 << "},\"id\":" << value1 << "}";
+    return request.str();
+}
+
+static string AddResponse(int value1, int value2)
+{
+    stringstream response;
+    response << "{\"id\":" << value1 << ",\"jsonrpc\":\"2.0\",\"result\":" << value1 + value2 << "}\n";
+    return response.str();
+}
+
+static const char* RenderPositive(const Json::Value& value)
+{
+    return value.asInt() > 0 ? "\"positive\"" : NULL;
+}
+
+static const Json::ObjectTemplate::Member pairMembers[] = {
+    {"a", "<a=", NULL, RenderPositive},
+    {"b", ",b=", NULL, NULL},
+    {"kind", ",pair", "pair", NULL}
+};
+static const Json::ObjectTemplate pairTemplate[] = {
+    {pairMembers, 3, ">"}
+};
+
+static void* HandleRequests(void* data)
+{
+    RpcProtocolServer* server = (RpcProtocolServer*) data;
+    string response;
+    for (int i = 0; i < REQUESTS_PER_THREAD; i++)
+    {
+        server->HandleRequest(AddRequest(i % 2 ? "add" : "forward", i, 7), response);
+        if (response != AddResponse(i, 7))
+        {
+            return data;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    ContextHandler innerHandler(NULL);
+    RpcProtocolServer inner(&innerHandler);
+    AddProcedures(inner);
+    ContextHandler handler(&inner);
+    RpcProtocolServer server(&handler);
+    AddProcedures(server);
+
+    //A request handled while another one holds the thread's context
+    string response;
+    server.HandleRequest(AddRequest("forward", 3, 4), response);
+    if (response != AddResponse(3, 4))
+    {
+        cerr << "nested request returned " << response << endl;
+        return -1;
+    }
+
+    //Requests larger than the retained size release their buffers, the next ones still work
+    ProtocolContext::SetMaxRetainedSize(4096);
+    stringstream large;
+    large << "[";
+    for (int i = 0; i < 1000; i++)
+    {
+        large << (i > 0 ? "," : "") << AddRequest("add", i, 1);
+    }
+    large << "]";
+    server.HandleRequest(large.str(), response);
+    Json::Value responses;
+    if (!Json::Reader().parse(response, responses) || responses.size() != 1000 || responses[999u]["result"].asInt() != 1000)
+    {
+        cerr << "batch request returned " << response.substr(0, 200) << endl;
+        return -2;
+    }
+    server.HandleRequest(AddRequest("add", 5, 6), response);
+    if (response != AddResponse(5, 6))
+    {
+        cerr << "request after releasing the context returned " << response << endl;
+        return -3;
+    }
+    ProtocolContext::SetMaxRetainedSize(1024 * 1024);
+
+    //Every thread uses its own context
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, HandleRequests, &server);
+    }
+    int failed = 0;
+    for (int i = 0; i < THREADS; i++)
+    {
+        void* result;
+        pthread_join(threads[i], &result);
+        failed += result != NULL ? 1 : 0;
+    }
+    if (failed > 0)
+    {
+        cerr << failed << " threads received wrong responses" << endl;
+        return -4;
+    }
+
+    //Matching objects at the root are written from the fragments, others as usual
+    Json::Value pair;
+    pair["a"] = 1;
+    pair["b"] = 2;
+    pair["kind"] = "pair";
+    Json::Value pairs(Json::arrayValue);
+    pairs.append(pair);
+    pairs.append(pair);
+    pairs[1u]["a"] = -1;
+    pairs.append(pair);
+    pairs[2u]["kind"] = "other";
+    pairs[3u]["nested"] = pair;
+    string document;
+    {
+        ProtocolContextScope context;
+        context->SetTemplates(pairTemplate, 1);
+        context->Write(pairs, document);
+    }
+    if (document != "[<a=\"positive\",b=2,pair>,<a=-1,b=2,pair>,{\"a\":1,\"b\":2,\"kind\":\"other\"},"
+                    "{\"nested\":{\"a\":1,\"b\":2,\"kind\":\"pair\"}}]\n")
+    {
+        cerr << "templates wrote " << document << endl;
+        return -5;
+    }
+    {
+        ProtocolContextScope context;
+        context->Write(pair, document);
+    }
+    if (document != "{\"a\":1,\"b\":2,\"kind\":\"pair\"}\n")
+    {
+        cerr << "templates were still used by the next request: " << document << endl;
+        return -6;
+    }
+
+    //Error blocks are written from their pre-serialized error objects unless the message was changed
+    Json::Value request;
+    request["id"] = 3;
+    Json::Value error = Errors::GetErrorBlock(request, Errors::ERROR_RPC_METHOD_NOT_FOUND);
+    const char* serialized = Errors::GetSerializedError(error["error"]);
+    Json::Value custom = Errors::GetErrorBlock(request, JsonRpcException(Errors::ERROR_RPC_METHOD_NOT_FOUND, "custom"));
+    if (serialized == NULL || serialized + string("\n") != Json::FastWriter().write(error["error"])
+            || Errors::GetSerializedError(custom["error"]) != NULL)
+    {
+        cerr << "pre-serialized error was " << (serialized != NULL ? serialized : "missing") << endl;
+        return -7;
+    }
+    server.HandleRequest("{\"jsonrpc\":\"2.0\",\"method\":\"missing\",\"params\":{},\"id\":3}", response);
+    if (response != Json::FastWriter().write(error))
+    {
+        cerr << "error response was " << response << endl;
+        return -8;
+    }
+
+    //Values kept by a handler do not hold on to the arena pages of their requests
+    RetainingHandler retainingHandler;
+    RpcProtocolServer retainingServer(&retainingHandler);
+    retainingServer.AddProcedure(new Procedure("keep", PARAMS_BY_NAME, JSON_INTEGER, "text", JSON_STRING, NULL));
+    string keepRequest = "{\"jsonrpc\":\"2.0\",\"method\":\"keep\",\"params\":{\"text\":\"abc\"},\"id\":1}";
+    retainingServer.HandleRequest(keepRequest, response);
+    size_t heap = HeapInUse();
+    for (int i = 1; i < RETAINED_REQUESTS; i++)
+    {
+        retainingServer.HandleRequest(keepRequest, response);
+    }
+    size_t grown = HeapInUse() - heap;
+    //A few dozen bytes per kept string, against a page of the arena per request if the strings were pinning them.
+    if (retainingHandler.kept.size() != RETAINED_REQUESTS || grown > RETAINED_REQUESTS * 256)
+    {
+        cerr << "keeping " << retainingHandler.kept.size() << " parameters grew the heap by " << grown << " bytes" << endl;
+        return -9;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -0,0 +1,241 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    requestexecutor.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "gatehandler.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define POOL_THREADS 2
+#define POOL_QUEUE 2
+/**
+ * Number of requests sent while the pool is full.
+ */
+#define REJECTED 4
+
+/**
+ * @brief Records the responses handed on by the server.
+ */
+class ResponseCollector : public AbstractResponseHandler
+{
+    public:
+        ResponseCollector(vector<Json::Value>* responses, pthread_mutex_t* mutex) : responses(responses), mutex(mutex) {}
+
+        virtual void OnResponse(ProtocolContext& context, const Json::Value& response)
+        {
+            pthread_mutex_lock(this->mutex);
+            this->responses->push_back(response);
+            pthread_mutex_unlock(this->mutex);
+        }
+
+    private:
+        vector<Json::Value>* responses;
+        pthread_mutex_t* mutex;
+};
+
+/**
+ * @brief Blocks its worker until released.
+ */
+class BlockingTask : public ThreadPoolTask
+{
+    public:
+        BlockingTask(volatile int* release, volatile int* started = NULL) : release(release), started(started) {}
+
+        virtual void Run()
+        {
+            if (this->started != NULL)
+            {
+                __sync_add_and_fetch(this->started, 1);
+            }
+            while (__sync_add_and_fetch(this->release, 0) == 0)
+            {
+                usleep(1000);
+            }
+        }
+
+    private:
+        volatile int* release;
+        volatile int* started;
+};
+
+class CountingTask : public ThreadPoolTask
+{
+    public:
+        CountingTask(volatile int* count) : count(count) {}
+
+        virtual void Run()
+        {
+            __sync_add_and_fetch(this->count, 1);
+        }
+
+    private:
+        volatile int* count;
+};
+
+static string WaitRequest(int id)
+{
+    stringstream request;
+    request << "{\"jsonrpc\":\"2.0\",\"method\":\"wait\",\"params\":{\"value\":" << id << "},\"id\":" << id << "}";
+    return request.str();
+}
+
+static bool WaitFor(volatile int* value, int expected)
+{
+    for (int i = 0; i < 5000 && __sync_add_and_fetch(value, 0) != expected; i++)
+    {
+        usleep(1000);
+    }
+    return __sync_add_and_fetch(value, 0) == expected;
+}
+
+int main(int argc, char** argv)
+{
+    //Tasks queued behind a blocked worker are stolen by the idle one
+    {
+        ThreadPool pool(2);
+        volatile int release = 0, count = 0;
+        pool.Submit(new BlockingTask(&release));
+        for (int i = 0; i < 8; i++)
+        {
+            pool.Submit(new CountingTask(&count));
+        }
+        bool stolen = WaitFor(&count, 8);
+        __sync_add_and_fetch(&release, 1);
+        if (!stolen)
+        {
+            cerr << "only " << count << " tasks ran while one worker was blocked" << endl;
+            return -1;
+        }
+    }
+
+    ThreadPool pool(POOL_THREADS, POOL_QUEUE);
+    GateHandler handler("", &pool);
+    RpcProtocolServer server(&handler);
+    server.AddProcedure(new Procedure("wait", PARAMS_BY_NAME, JSON_INTEGER, "value", JSON_INTEGER, NULL));
+    server.AddProcedure(new Procedure("log", PARAMS_BY_NAME, "value", JSON_INTEGER, NULL));
+    server.SetRequestExecutor(&pool);
+
+    //Requests beyond the running and queued ones are rejected right away
+    vector<Json::Value> responses;
+    pthread_mutex_t mutex;
+    pthread_mutex_init(&mutex, NULL);
+    for (int i = 0; i < POOL_THREADS; i++)
+    {
+        server.HandleRequest(WaitRequest(i), new ResponseCollector(&responses, &mutex));
+    }
+    if (!WaitFor(&handler.entered, POOL_THREADS))
+    {
+        cerr << "the pool started " << handler.entered << " requests" << endl;
+        return -2;
+    }
+    for (int i = POOL_THREADS; i < POOL_THREADS + POOL_QUEUE; i++)
+    {
+        server.HandleRequest(WaitRequest(i), new ResponseCollector(&responses, &mutex));
+    }
+    //Notifications among them are not answered
+    string notification = "{\"jsonrpc\":\"2.0\",\"method\":\"log\",\"params\":{\"value\":1}}";
+    server.HandleRequest(WaitRequest(99), new ResponseCollector(&responses, &mutex));
+    server.HandleRequest("[" + WaitRequest(98) + "," + notification + "]", new ResponseCollector(&responses, &mutex));
+    server.HandleRequest("[" + notification + "," + notification + "]", new ResponseCollector(&responses, &mutex));
+    server.HandleRequest(notification, new ResponseCollector(&responses, &mutex));
+    pthread_mutex_lock(&mutex);
+    bool rejected = responses.size() == REJECTED && responses[0]["error"]["code"].asInt() == Errors::ERROR_SERVER_BUSY
+            && responses[0]["id"].asInt() == 99 && responses[1].size() == 2
+            && responses[1][0u]["error"]["code"].asInt() == Errors::ERROR_SERVER_BUSY && responses[1][0u]["id"].asInt() == 98
+            && responses[1][1u].isNull() && responses[2].isNull() && responses[3].isNull();
+    pthread_mutex_unlock(&mutex);
+    if (!rejected)
+    {
+        cerr << "the requests over the queue limit were not rejected" << endl;
+        return -3;
+    }
+
+    //The accepted requests are answered once they may proceed, all of them on the pool
+    handler.SetOpen(true);
+    for (int i = 0; i < 5000; i++)
+    {
+        pthread_mutex_lock(&mutex);
+        size_t answered = responses.size();
+        pthread_mutex_unlock(&mutex);
+        if (answered == REJECTED + POOL_THREADS + POOL_QUEUE)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+    pthread_mutex_lock(&mutex);
+    int sum = 0;
+    for (size_t i = REJECTED; i < responses.size(); i++)
+    {
+        sum += responses[i]["result"].asInt();
+    }
+    bool answered = responses.size() == REJECTED + POOL_THREADS + POOL_QUEUE && sum == 0 + 1 + 2 + 3;
+    pthread_mutex_unlock(&mutex);
+    if (!answered || handler.outsidePool != 0)
+    {
+        cerr << "accepted requests were not answered on the pool" << endl;
+        return -4;
+    }
+
+    //The synchronous variant waits for the pool
+    string response;
+    server.HandleRequest(WaitRequest(7), response);
+    if (response != "{\"id\":7,\"jsonrpc\":\"2.0\",\"result\":7}\n" || handler.outsidePool != 0)
+    {
+        cerr << "request through the pool returned " << response << endl;
+        return -5;
+    }
+
+    //A buffer that is not terminated is parsed up to its length, and copied if the pool runs it after the caller returned
+    string unterminated = WaitRequest(8) + "garbage";
+    size_t length = unterminated.size() - 7;
+    server.HandleRequest(unterminated.data(), length, response);
+    volatile int release = 0, started = 0;
+    for (int i = 0; i < POOL_THREADS; i++)
+    {
+        pool.Submit(new BlockingTask(&release, &started));
+    }
+    WaitFor(&started, POOL_THREADS);
+    pthread_mutex_lock(&mutex);
+    responses.clear();
+    pthread_mutex_unlock(&mutex);
+    server.HandleRequest(unterminated.data(), length, new ResponseCollector(&responses, &mutex));
+    unterminated.replace(0, length, length, ' ');
+    __sync_add_and_fetch(&release, 1);
+    for (int i = 0; i < 5000; i++)
+    {
+        pthread_mutex_lock(&mutex);
+        size_t answered = responses.size();
+        pthread_mutex_unlock(&mutex);
+        if (answered == 1)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+    pthread_mutex_lock(&mutex);
+    bool copied = responses.size() == 1 && responses[0]["result"].asInt() == 8;
+    pthread_mutex_unlock(&mutex);
+    if (response != "{\"id\":8,\"jsonrpc\":\"2.0\",\"result\":8}\n" || !copied)
+    {
+        cerr << "request from a buffer returned " << response << endl;
+        return -6;
+    }
+    pthread_mutex_destroy(&mutex);
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
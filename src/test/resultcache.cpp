@@ -0,0 +1,186 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    resultcache.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace jsonrpc;
+using namespace std;
+
+#define SPECIFICATION "[{\"method\":\"describe\",\"params\":{\"a\":1,\"b\":1},\"returns\":{},\"cacheable\":true,\"cacheTtl\":60000}," \
+                      "{\"method\":\"echo\",\"params\":null,\"returns\":{}}]"
+
+/**
+ * @brief Counts the calls that reach it. "describe" fails for negative a, "echo" returns its parameters.
+ */
+class CountingHandler : public AbstractRequestHandler
+{
+    public:
+        CountingHandler() : calls(0) {}
+
+        virtual void handleMethodCall(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            this->calls++;
+            if (proc->GetProcedureName() == "echo")
+            {
+                output = input;
+                return;
+            }
+            if (input["a"].asInt() < 0)
+            {
+                throw JsonRpcException(-32099, "negative");
+            }
+            output["sum"] = input["a"].asInt() + input["b"].asInt();
+            output["text"] = "quote \" and \\u00e4";
+            output["list"].append(this->calls);
+        }
+
+        virtual void handleNotificationCall(Procedure* proc, const Json::Value& input)
+        {
+        }
+
+        int calls;
+};
+
+class StringSink : public Json::OutputSink
+{
+    public:
+        virtual void write(const char* data, size_t length)
+        {
+            this->document.append(data, length);
+        }
+
+        string document;
+};
+
+static string Call(RpcProtocolServer& server, const string& params, int id)
+{
+    stringstream request;
+    request << "{\"jsonrpc\":\"2.0\",\"method\":\"describe\",\"params\":" << params << ",\"id\":" << id << "}";
+    string response;
+    server.HandleRequest(request.str(), response);
+    return response;
+}
+
+static bool Rejected(const string& specification)
+{
+    try
+    {
+        procedurelist_t* procedures = SpecificationParser::GetProceduresFromString(specification);
+        for (procedurelist_t::iterator it = procedures->begin(); it != procedures->end(); it++)
+        {
+            delete it->second;
+        }
+        delete procedures;
+        return false;
+    }
+    catch (const JsonRpcException&)
+    {
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CountingHandler handler;
+    RpcProtocolServer server(&handler, SpecificationParser::GetProceduresFromString(SPECIFICATION));
+    Procedure* describe = server.GetProcedures()["describe"];
+    if (!describe->GetCacheable() || describe->GetCacheTtl() != 60000 || server.GetProcedures()["echo"]->GetCacheable()
+            || !Rejected("[{\"notification\":\"n\",\"params\":null,\"cacheable\":true}]")
+            || !Rejected("[{\"method\":\"m\",\"params\":null,\"cacheTtl\":10}]"))
+    {
+        cerr << "cache settings were not read from the specification" << endl;
+        return -1;
+    }
+
+    //A repeated call is answered from the cache with the same bytes, regardless of the member order
+    ResultCache cache(1024 * 1024);
+    server.SetResultCache(&cache);
+    string first = Call(server, "{\"a\":1,\"b\":2}", 1);
+    string second = Call(server, "{\"b\":2,\"a\":1}", 2);
+    string expected = "{\"id\":2,\"jsonrpc\":\"2.0\",\"result\":{\"list\":[1],\"sum\":3,\"text\":\"quote \\\" and \\\\u00e4\"}}\n";
+    if (second != expected || first.substr(7) != expected.substr(7) || handler.calls != 1
+            || cache.GetHits() != 1 || cache.GetMisses() != 1)
+    {
+        cerr << "cached call returned " << second << " after " << handler.calls << " calls" << endl;
+        return -2;
+    }
+
+    //Different parameters and errors are not answered from the cache
+    Call(server, "{\"a\":2,\"b\":2}", 3);
+    Call(server, "{\"a\":-1,\"b\":2}", 4);
+    string failed = Call(server, "{\"a\":-1,\"b\":2}", 5);
+    if (handler.calls != 4 || failed.find("-32099") == string::npos)
+    {
+        cerr << "uncached calls reached the handler " << handler.calls << " times" << endl;
+        return -3;
+    }
+
+    //Batches and streamed responses splice the cached result, members that only look alike are left alone
+    string batch = "[{\"jsonrpc\":\"2.0\",\"method\":\"describe\",\"params\":{\"a\":1,\"b\":2},\"id\":6},"
+                   "{\"jsonrpc\":\"2.0\",\"method\":\"echo\",\"params\":{\"result\\u0001\":\"[1]\"},\"id\":7}]";
+    StringSink sink;
+    server.HandleRequest(batch, sink, 16);
+    Json::Value responses;
+    if (!Json::Reader().parse(sink.document, responses) || responses.size() != 2 || responses[0u]["result"]["list"][0u].asInt() != 1
+            || responses[1u]["result"]["result\x01"].asString() != "[1]" || handler.calls != 5)
+    {
+        cerr << "batch returned " << sink.document << endl;
+        return -4;
+    }
+
+    //Entries expire after their ttl
+    describe->SetCacheable(true, 20);
+    Call(server, "{\"a\":7,\"b\":7}", 8);
+    usleep(40000);
+    Call(server, "{\"a\":7,\"b\":7}", 9);
+    if (handler.calls != 7)
+    {
+        cerr << "expired entry was used" << endl;
+        return -5;
+    }
+
+    //A full cache evicts the least recently used entry
+    ResultCache small(200, 1);
+    server.SetResultCache(&small);
+    describe->SetCacheable(true, 60000);
+    Call(server, "{\"a\":10,\"b\":0}", 10);
+    Call(server, "{\"a\":11,\"b\":0}", 11);
+    Call(server, "{\"a\":10,\"b\":0}", 12);
+    Call(server, "{\"a\":12,\"b\":0}", 13);
+    int calls = handler.calls;
+    Call(server, "{\"a\":10,\"b\":0}", 14);
+    Call(server, "{\"a\":11,\"b\":0}", 15);
+    if (handler.calls != calls + 1 || small.GetSize() > small.GetMaxSize())
+    {
+        cerr << "eviction kept " << small.GetSize() << " bytes and called the handler " << handler.calls - calls << " times" << endl;
+        return -6;
+    }
+
+    //The settings survive a round trip through the specification writer
+    procedurelist_t* procedures = SpecificationParser::GetProceduresFromString(SpecificationWriter::toString(server.GetProcedures()));
+    bool restored = (*procedures)["describe"]->GetCacheable() && (*procedures)["describe"]->GetCacheTtl() == 60000
+            && !(*procedures)["echo"]->GetCacheable();
+    for (procedurelist_t::iterator it = procedures->begin(); it != procedures->end(); it++)
+    {
+        delete it->second;
+    }
+    delete procedures;
+    if (!restored)
+    {
+        cerr << "cache settings were not written to the specification" << endl;
+        return -7;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
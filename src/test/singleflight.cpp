@@ -0,0 +1,155 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    singleflight.cpp
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#include <jsonrpc/rpc.h>
+#include <jsonrpc/rpcprotocolserver.h>
+#include <iostream>
+#include <sstream>
+#include <pthread.h>
+#include <unistd.h>
+#include "gatehandler.h"
+
+using namespace jsonrpc;
+using namespace std;
+
+#define CALLERS 8
+
+#define SPECIFICATION "[{\"method\":\"shared\",\"params\":{\"value\":1},\"returns\":1,\"singleFlight\":true}," \
+                      "{\"method\":\"single\",\"params\":{\"value\":1},\"returns\":1}]"
+
+/**
+ * @brief Doubles the values of the calls that passed the gate, negative values fail.
+ */
+class DoublingHandler : public GateHandler
+{
+    public:
+        virtual void Answer(Procedure* proc, const Json::Value& input, Json::Value& output)
+        {
+            if (input["value"].asInt() < 0)
+            {
+                throw JsonRpcException(-32099, "negative");
+            }
+            output = input["value"].asInt() * 2;
+        }
+};
+
+struct Caller
+{
+    RpcProtocolServer* server;
+    string request;
+    Json::Value response;
+};
+
+static void* Call(void* data)
+{
+    Caller* caller = (Caller*) data;
+    string response;
+    caller->server->HandleRequest(caller->request, response);
+    Json::Reader().parse(response, caller->response);
+    return NULL;
+}
+
+/**
+ * @brief Lets CALLERS threads call method with value while the gate is closed.
+ * @return the number of calls that reached the handler.
+ */
+static int CallAtOnce(GateHandler& handler, RpcProtocolServer& server, const string& method, int value, Caller* callers)
+{
+    handler.SetOpen(false);
+    __sync_lock_test_and_set(&handler.entered, 0);
+    pthread_t threads[CALLERS];
+    for (int i = 0; i < CALLERS; i++)
+    {
+        stringstream request;
+        request << "{\"jsonrpc\":\"2.0\",\"method\":\"" << method << "\",\"params\":{\"value\":" << value << "},\"id\":" << i << "}";
+        callers[i].server = &server;
+        callers[i].request = request.str();
+        pthread_create(&threads[i], NULL, Call, &callers[i]);
+    }
+    while (__sync_add_and_fetch(&handler.entered, 0) == 0)
+    {
+        usleep(1000);
+    }
+    usleep(100000);
+    handler.SetOpen(true);
+    for (int i = 0; i < CALLERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    return __sync_add_and_fetch(&handler.entered, 0);
+}
+
+int main(int argc, char** argv)
+{
+    DoublingHandler handler;
+    RpcProtocolServer server(&handler, SpecificationParser::GetProceduresFromString(SPECIFICATION));
+    if (!server.GetProcedures()["shared"]->GetSingleFlight() || server.GetProcedures()["single"]->GetSingleFlight())
+    {
+        cerr << "single flight was not read from the specification" << endl;
+        return -1;
+    }
+
+    //Identical calls share one execution, every caller gets the result with its own id
+    Caller callers[CALLERS];
+    int executions = CallAtOnce(handler, server, "shared", 21, callers);
+    for (int i = 0; i < CALLERS; i++)
+    {
+        if (callers[i].response["result"].asInt() != 42 || callers[i].response["id"].asInt() != i)
+        {
+            cerr << "shared call returned " << callers[i].response.toStyledString() << endl;
+            return -2;
+        }
+    }
+    if (executions != 1)
+    {
+        cerr << CALLERS << " identical calls ran " << executions << " times" << endl;
+        return -3;
+    }
+
+    //An error is shared as well
+    executions = CallAtOnce(handler, server, "shared", -1, callers);
+    for (int i = 0; i < CALLERS; i++)
+    {
+        if (callers[i].response["error"]["code"].asInt() != -32099 || callers[i].response["id"].asInt() != i)
+        {
+            cerr << "shared error returned " << callers[i].response.toStyledString() << endl;
+            return -4;
+        }
+    }
+    if (executions != 1)
+    {
+        cerr << CALLERS << " identical failing calls ran " << executions << " times" << endl;
+        return -5;
+    }
+
+    //Procedures without single flight run every call
+    executions = CallAtOnce(handler, server, "single", 21, callers);
+    if (executions != CALLERS)
+    {
+        cerr << CALLERS << " calls without single flight ran " << executions << " times" << endl;
+        return -6;
+    }
+
+    //The setting survives a round trip through the specification writer
+    procedurelist_t* procedures = SpecificationParser::GetProceduresFromString(SpecificationWriter::toString(server.GetProcedures()));
+    bool restored = (*procedures)["shared"]->GetSingleFlight() && !(*procedures)["single"]->GetSingleFlight();
+    for (procedurelist_t::iterator it = procedures->begin(); it != procedures->end(); it++)
+    {
+        delete it->second;
+    }
+    delete procedures;
+    if (!restored)
+    {
+        cerr << "single flight was not written to the specification" << endl;
+        return -7;
+    }
+
+    cout << argv[0] << " passed" << endl;
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*************************************************************************
+ * libjson-rpc-cpp
+ *************************************************************************
+ * @file    testutils.h
+ * @date    18.10.2014
+ * @author  Peter Spiess-Knafl <peter.knafl@gmail.com>
+ * @license See attached LICENSE.txt
+ ************************************************************************/
+
+#ifndef TESTUTILS_H
+#define TESTUTILS_H
+
+#include <cstddef>
+
+/**
+ * @return the bytes allocated from the heap, 0 where they cannot be counted.
+ */
+size_t HeapInUse();
+
+#endif // TESTUTILS_H